@@ -29,6 +29,26 @@ IF(CMAKE_COMPILER_IS_GNUCXX)
   ADD_DEFINITIONS(-D_GNU_SOURCE)
 ENDIF(CMAKE_COMPILER_IS_GNUCXX)
 
+# OpenMP is used to spread the hot loops (kd-tree build and search, ...) over
+# all the cores. Without it the pragmas are ignored and the code runs serially.
+OPTION(WITH_OPENMP "Use OpenMP to parallelize the hot loops." ON)
+IF (WITH_OPENMP)
+  FIND_PACKAGE(OpenMP)
+  IF (OPENMP_FOUND)
+    MESSAGE(STATUS "OpenMP found: parallel code paths enabled.")
+    SET(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${OpenMP_C_FLAGS}")
+    SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+  ENDIF (OPENMP_FOUND)
+ENDIF (WITH_OPENMP)
+
+# Tracing of the pipeline stages (see libmv/logging/tracing.h) is compiled in
+# but off at run time unless a tool is given --trace. Turning it off here
+# removes the instrumentation entirely.
+OPTION(WITH_TRACING "Compile the stage tracing instrumentation." ON)
+IF (NOT WITH_TRACING)
+  ADD_DEFINITIONS(-DLIBMV_DISABLE_TRACING)
+ENDIF (NOT WITH_TRACING)
+
 MESSAGE("CMAKE_MODULE_PATH = ${CMAKE_MODULE_PATH}")
 IF (NOT CMAKE_MODULE_PATH)
   MESSAGE(FATAL_ERROR
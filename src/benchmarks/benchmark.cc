@@ -0,0 +1,246 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "benchmarks/benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "libmv/logging/tracing.h"
+#include "libmv/tools/tool.h"
+
+DEFINE_string(benchmark_filter, "",
+              "Only run the benchmarks whose name contains this string.");
+DEFINE_double(benchmark_min_time, 0.5,
+              "Minimal duration of a benchmark run, in seconds.");
+DEFINE_string(benchmark_out, "",
+              "Write the results to this file, in JSON.");
+
+namespace libmv {
+namespace benchmark {
+
+namespace {
+
+double NowInSeconds() {
+  return 1e-6 * tracing::NowInMicroseconds();
+}
+
+// Construct on first use: benchmarks register from static initializers.
+std::vector<Benchmark *> &Benchmarks() {
+  static std::vector<Benchmark *> benchmarks;
+  return benchmarks;
+}
+
+struct Result {
+  std::string name;
+  int iterations;
+  double seconds_per_iteration;
+  double items_per_second;
+  std::string label;
+};
+
+Result Run(const Benchmark &benchmark, int arg, bool has_arg,
+           double min_time) {
+  Result result;
+  std::ostringstream name;
+  name << benchmark.name();
+  if (has_arg) {
+    name << "/" << arg;
+  }
+  result.name = name.str();
+
+  const int kMaxIterations = 1000000000;
+  int iterations = 1;
+  for (;;) {
+    State state(arg, iterations);
+    benchmark.function()(state);
+    double elapsed = state.elapsed_seconds();
+    if (elapsed >= min_time || iterations >= kMaxIterations) {
+      result.iterations = state.iterations();
+      result.seconds_per_iteration = elapsed / state.iterations();
+      result.items_per_second =
+          elapsed > 0 ? state.items_processed() / elapsed : 0;
+      result.label = state.label();
+      return result;
+    }
+    // Predict the number of iterations needed, at least doubling and at most
+    // multiplying by 10 each time like Google Benchmark does.
+    double multiplier = elapsed > 0 ? 1.4 * min_time / elapsed : 10;
+    multiplier = std::min(10.0, std::max(2.0, multiplier));
+    iterations = static_cast<int>(
+        std::min(double(kMaxIterations), iterations * multiplier));
+  }
+}
+
+std::string FormatTime(double seconds) {
+  std::ostringstream s;
+  s << std::fixed << std::setprecision(3);
+  if (seconds >= 1) {
+    s << seconds << " s";
+  } else if (seconds >= 1e-3) {
+    s << seconds * 1e3 << " ms";
+  } else if (seconds >= 1e-6) {
+    s << seconds * 1e6 << " us";
+  } else {
+    s << seconds * 1e9 << " ns";
+  }
+  return s.str();
+}
+
+void PrintResult(const Result &result) {
+  std::cout << std::left << std::setw(40) << result.name << std::right
+            << std::setw(16) << FormatTime(result.seconds_per_iteration)
+            << std::setw(12) << result.iterations;
+  if (result.items_per_second > 0) {
+    std::cout << "  " << std::setprecision(4) << result.items_per_second
+              << " items/s";
+  }
+  if (!result.label.empty()) {
+    std::cout << "  " << result.label;
+  }
+  std::cout << std::endl;
+}
+
+bool WriteJson(const std::vector<Result> &results,
+               double min_time,
+               const std::string &filename) {
+  std::ofstream os(filename.c_str());
+  if (!os) {
+    return false;
+  }
+  char date[64];
+  time_t now = time(NULL);
+  strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+  int num_threads = 1;
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+  os << "{\n  \"context\": {\n"
+     << "    \"date\": \"" << date << "\",\n"
+     << "    \"num_threads\": " << num_threads << ",\n"
+     << "    \"min_time\": " << min_time << "\n  },\n"
+     << "  \"benchmarks\": [";
+  os << std::setprecision(10);
+  for (int i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    os << (i ? "," : "") << "\n    {\n"
+       << "      \"name\": \"" << result.name << "\",\n"
+       << "      \"iterations\": " << result.iterations << ",\n"
+       << "      \"real_time\": " << result.seconds_per_iteration * 1e9 << ",\n"
+       << "      \"time_unit\": \"ns\",\n"
+       << "      \"items_per_second\": " << result.items_per_second << ",\n"
+       << "      \"label\": \"" << result.label << "\"\n"
+       << "    }";
+  }
+  os << "\n  ]\n}\n";
+  return os.good();
+}
+
+}  // namespace
+
+State::State(int range_x, int max_iterations)
+    : range_x_(range_x),
+      max_iterations_(max_iterations),
+      iterations_(0),
+      running_(false),
+      start_seconds_(0),
+      elapsed_seconds_(0),
+      items_processed_(0) {}
+
+bool State::KeepRunning() {
+  if (iterations_ == 0) {
+    ResumeTiming();
+  }
+  if (iterations_ < max_iterations_) {
+    ++iterations_;
+    return true;
+  }
+  PauseTiming();
+  return false;
+}
+
+void State::PauseTiming() {
+  if (running_) {
+    elapsed_seconds_ += NowInSeconds() - start_seconds_;
+    running_ = false;
+  }
+}
+
+void State::ResumeTiming() {
+  if (!running_) {
+    start_seconds_ = NowInSeconds();
+    running_ = true;
+  }
+}
+
+Benchmark *RegisterBenchmark(const char *name, Function function) {
+  Benchmark *benchmark = new Benchmark(name, function);
+  Benchmarks().push_back(benchmark);
+  return benchmark;
+}
+
+int RunBenchmarks(const std::string &filter,
+                  double min_time,
+                  const std::string &json_filename) {
+  std::vector<Result> results;
+  const std::vector<Benchmark *> &benchmarks = Benchmarks();
+  std::cout << std::left << std::setw(40) << "Benchmark" << std::right
+            << std::setw(16) << "Time" << std::setw(12) << "Iterations"
+            << std::endl;
+  for (int i = 0; i < benchmarks.size(); ++i) {
+    const Benchmark &benchmark = *benchmarks[i];
+    if (benchmark.name().find(filter) == std::string::npos) {
+      continue;
+    }
+    if (benchmark.args().size() == 0) {
+      results.push_back(Run(benchmark, 0, false, min_time));
+      PrintResult(results.back());
+    }
+    for (int j = 0; j < benchmark.args().size(); ++j) {
+      results.push_back(Run(benchmark, benchmark.args()[j], true, min_time));
+      PrintResult(results.back());
+    }
+  }
+  if (!json_filename.empty() && !WriteJson(results, min_time, json_filename)) {
+    LOG(ERROR) << "Couldn't write the results to " << json_filename;
+  }
+  return results.size();
+}
+
+}  // namespace benchmark
+}  // namespace libmv
+
+int main(int argc, char **argv) {
+  libmv::Init("Runs the libmv benchmarks.", &argc, &argv);
+  libmv::benchmark::RunBenchmarks(FLAGS_benchmark_filter,
+                                  FLAGS_benchmark_min_time,
+                                  FLAGS_benchmark_out);
+  return 0;
+}
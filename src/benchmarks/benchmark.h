@@ -0,0 +1,127 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+// A small benchmark harness, modeled after Google Benchmark:
+//
+//   static void BM_ConvolveGaussian(benchmark::State &state) {
+//     FloatImage image;
+//     MakeTexturedImage(state.range_x(), state.range_x(), 0, 0, 1, &image);
+//     FloatImage blurred;
+//     while (state.KeepRunning()) {
+//       ConvolveGaussian(image, 1.6, &blurred);
+//     }
+//     state.SetItemsProcessed(state.iterations() * image.Width() * image.Height());
+//   }
+//   BENCHMARK(BM_ConvolveGaussian)->Arg(256)->Arg(1024);
+//
+// Only the loop is timed. Each benchmark runs with an increasing number of
+// iterations until it lasts at least --benchmark_min_time seconds, then the
+// time per iteration is reported on stdout and, with --benchmark_out, in a
+// JSON file that can be compared across commits.
+
+#ifndef LIBMV_BENCHMARKS_BENCHMARK_H
+#define LIBMV_BENCHMARKS_BENCHMARK_H
+
+#include <string>
+
+#include "libmv/base/vector.h"
+
+namespace libmv {
+namespace benchmark {
+
+class State {
+ public:
+  State(int range_x, int max_iterations);
+
+  // Returns true while the benchmark loop must run. The timer starts at the
+  // first call and stops at the last one.
+  bool KeepRunning();
+
+  // Excludes the per iteration setup from the timing.
+  void PauseTiming();
+  void ResumeTiming();
+
+  int range_x() const { return range_x_; }
+  int iterations() const { return iterations_; }
+  double elapsed_seconds() const { return elapsed_seconds_; }
+
+  // Items (pixels, features, points...) processed by all the iterations.
+  void SetItemsProcessed(double items) { items_processed_ = items; }
+  double items_processed() const { return items_processed_; }
+
+  // Free text printed next to the result (number of matches, inliers, ...).
+  void SetLabel(const std::string &label) { label_ = label; }
+  const std::string &label() const { return label_; }
+
+ private:
+  int range_x_;
+  int max_iterations_;
+  int iterations_;
+  bool running_;
+  double start_seconds_;
+  double elapsed_seconds_;
+  double items_processed_;
+  std::string label_;
+};
+
+typedef void (*Function)(State &state);
+
+class Benchmark {
+ public:
+  Benchmark(const char *name, Function function)
+      : name_(name), function_(function) {}
+
+  // Runs the benchmark once per argument (State::range_x), or once with 0.
+  Benchmark *Arg(int x) {
+    args_.push_back(x);
+    return this;
+  }
+
+  const std::string &name() const { return name_; }
+  Function function() const { return function_; }
+  const vector<int> &args() const { return args_; }
+
+ private:
+  std::string name_;
+  Function function_;
+  vector<int> args_;
+};
+
+Benchmark *RegisterBenchmark(const char *name, Function function);
+
+// Runs the registered benchmarks whose name contains filter and writes the
+// results to stdout and, if json_filename is not empty, to a JSON file.
+// Returns the number of benchmarks that ran.
+int RunBenchmarks(const std::string &filter,
+                  double min_time,
+                  const std::string &json_filename);
+
+}  // namespace benchmark
+}  // namespace libmv
+
+#define LIBMV_BENCHMARK_CONCAT_(a, b) a ## b
+#define LIBMV_BENCHMARK_CONCAT(a, b) LIBMV_BENCHMARK_CONCAT_(a, b)
+
+#define BENCHMARK(function) \
+  static ::libmv::benchmark::Benchmark * \
+      LIBMV_BENCHMARK_CONCAT(benchmark_, __LINE__) = \
+      ::libmv::benchmark::RegisterBenchmark(#function, function)
+
+#endif  // LIBMV_BENCHMARKS_BENCHMARK_H
@@ -0,0 +1,296 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <sstream>
+#include <vector>
+
+#include "benchmarks/benchmark.h"
+#include "benchmarks/synthetic_data.h"
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/ArrayMatcher_Kdtree_Flann.h"
+#include "libmv/correspondence/feature_matching.h"
+#include "libmv/correspondence/frozen_matches.h"
+#include "libmv/correspondence/klt.h"
+#include "libmv/correspondence/matches.h"
+#include "libmv/correspondence/tracker.h"
+#include "libmv/descriptor/simpliest_descriptor.h"
+#include "libmv/detector/fast_detector.h"
+#include "libmv/image/image.h"
+#include "libmv/image/image_pyramid.h"
+
+namespace libmv {
+namespace benchmark {
+namespace {
+
+void DeleteFeatures(KLTContext::FeatureList *features) {
+  KLTContext::FeatureList::iterator it;
+  for (it = features->begin(); it != features->end(); ++it) {
+    delete *it;
+  }
+  features->clear();
+}
+
+// Tracks the features of an image to the same image shifted by a few pixels.
+void BM_KLTTrackFeatures(State &state) {
+  const int size = state.range_x();
+  FloatImage image1, image2;
+  MakeTexturedImage(size, size, 1, 0, 0, &image1);
+  MakeTexturedImage(size, size, 1, 2.3, -1.7, &image2);
+  scoped_ptr<ImagePyramid> pyramid1(MakeImagePyramid(image1, 3, 0.9));
+  scoped_ptr<ImagePyramid> pyramid2(MakeImagePyramid(image2, 3, 0.9));
+
+  KLTContext klt;
+  KLTContext::FeatureList features1, features2;
+  klt.DetectGoodFeatures(pyramid1->Level(0), &features1);
+  while (state.KeepRunning()) {
+    klt.TrackFeatures(pyramid1.get(), features1, pyramid2.get(), &features2);
+    state.PauseTiming();
+    DeleteFeatures(&features2);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(double(state.iterations()) * features1.size());
+  std::ostringstream label;
+  label << features1.size() << " features";
+  state.SetLabel(label.str());
+  DeleteFeatures(&features1);
+}
+BENCHMARK(BM_KLTTrackFeatures)->Arg(256)->Arg(512);
+
+// Symmetric nearest neighbor matching of 64 floats descriptors.
+void BM_FindCandidateMatches(State &state) {
+  const int num_features = state.range_x();
+  FeatureSet left, right;
+  MakeFeatureSets(num_features, 64, &left, &right);
+  int num_matches = 0;
+  while (state.KeepRunning()) {
+    Matches matches;
+    FindCandidateMatches(left, right, &matches);
+    num_matches = matches.NumTracks();
+  }
+  state.SetItemsProcessed(double(state.iterations()) * num_features);
+  std::ostringstream label;
+  label << num_matches << " matches";
+  state.SetLabel(label.str());
+}
+BENCHMARK(BM_FindCandidateMatches)->Arg(1000)->Arg(5000);
+
+// Matches of a video: every frame sees num_tracks tracks, and a track lives
+// for 5 to 40 frames.
+void MakeVideoMatches(int num_images, int num_tracks,
+                      std::vector<PointFeature> *features, Matches *matches) {
+  Random random(7);
+  std::vector<int> track_ids(num_tracks), track_ends(num_tracks, 0);
+  int next_track = 0;
+  features->resize(num_images * num_tracks);
+  for (int i = 0; i < num_images; ++i) {
+    for (int k = 0; k < num_tracks; ++k) {
+      if (track_ends[k] <= i) {
+        track_ids[k] = next_track++;
+        track_ends[k] = i + 5 + random.UniformInt(36);
+      }
+      PointFeature &f = (*features)[i * num_tracks + k];
+      f.coords << 640 * random.Uniform(), 480 * random.Uniform();
+      matches->Insert(i, track_ids[k], &f);
+    }
+  }
+}
+
+// Extracts the tracks common to 3 consecutive frames, for every frame.
+void BM_PointMatchMatrices(State &state) {
+  const int kNumImages = 100;
+  std::vector<PointFeature> features;
+  Matches matches;
+  MakeVideoMatches(kNumImages, state.range_x(), &features, &matches);
+  vector<Matches::ImageID> images(3, 0);
+  vector<Matches::TrackID> tracks;
+  vector<Mat> xs;
+  while (state.KeepRunning()) {
+    for (int i = 0; i + 2 < kNumImages; ++i) {
+      images[0] = i; images[1] = i + 1; images[2] = i + 2;
+      tracks.resize(0);
+      PointMatchMatrices(matches, images, &tracks, &xs);
+    }
+  }
+  state.SetItemsProcessed(double(state.iterations()) * (kNumImages - 2));
+}
+BENCHMARK(BM_PointMatchMatrices)->Arg(1000);
+
+// Same queries on a snapshot of the matches, which is taken in the loop.
+void BM_FrozenPointMatchMatrices(State &state) {
+  const int kNumImages = 100;
+  std::vector<PointFeature> features;
+  Matches matches;
+  MakeVideoMatches(kNumImages, state.range_x(), &features, &matches);
+  vector<Matches::ImageID> images(3, 0);
+  vector<Matches::TrackID> tracks;
+  vector<Mat> xs;
+  while (state.KeepRunning()) {
+    FrozenMatches frozen(matches);
+    for (int i = 0; i + 2 < kNumImages; ++i) {
+      images[0] = i; images[1] = i + 1; images[2] = i + 2;
+      frozen.PointMatchMatrices(images, &tracks, &xs);
+    }
+  }
+  state.SetItemsProcessed(double(state.iterations()) * (kNumImages - 2));
+}
+BENCHMARK(BM_FrozenPointMatchMatrices)->Arg(1000);
+
+// A point feature of a type without a kind mask, which the typed iterators
+// filter with a dynamic_cast.
+struct UntaggedPoint : public PointFeature {
+  virtual ~UntaggedPoint() {}
+};
+
+// range_x images seeing the same 1000 tracks, so 1M edges for 1000 images.
+template<typename FeatureT>
+void MakeDenseMatches(int num_images, std::vector<FeatureT> *features,
+                      Matches *matches) {
+  const int kNumTracks = 1000;
+  Random random(11);
+  features->resize(num_images * kNumTracks);
+  for (int i = 0; i < num_images; ++i) {
+    for (int t = 0; t < kNumTracks; ++t) {
+      FeatureT &f = (*features)[i * kNumTracks + t];
+      f.coords << 640 * random.Uniform(), 480 * random.Uniform();
+      matches->Insert(i, t, &f);
+    }
+  }
+}
+
+// Sums the coordinates of the points of every image through the typed
+// iterator of Matches; with FeatureT = UntaggedPoint every edge goes through
+// a dynamic_cast as all the typed iterations did before the kind tags.
+template<typename FeatureT>
+void IterateInImages(State &state) {
+  const int num_images = state.range_x();
+  std::vector<FeatureT> features;
+  Matches matches;
+  MakeDenseMatches(num_images, &features, &matches);
+  double sum = 0;
+  while (state.KeepRunning()) {
+    for (int i = 0; i < num_images; ++i) {
+      Matches::Features<FeatureT> r = matches.template InImage<FeatureT>(i);
+      for (; r; ++r) {
+        sum += r.feature()->x() + r.feature()->y();
+      }
+    }
+  }
+  state.SetItemsProcessed(double(state.iterations()) * features.size());
+  std::ostringstream label;
+  label << features.size() << " edges, sum " << sum;
+  state.SetLabel(label.str());
+}
+
+void BM_MatchesInImageDynamicCast(State &state) {
+  IterateInImages<UntaggedPoint>(state);
+}
+BENCHMARK(BM_MatchesInImageDynamicCast)->Arg(1000);
+
+void BM_MatchesInImageKindTag(State &state) {
+  IterateInImages<PointFeature>(state);
+}
+BENCHMARK(BM_MatchesInImageKindTag)->Arg(1000);
+
+// Same sums on the contiguous spans of a snapshot.
+void BM_FrozenMatchesInImageSpan(State &state) {
+  const int num_images = state.range_x();
+  std::vector<PointFeature> features;
+  Matches matches;
+  MakeDenseMatches(num_images, &features, &matches);
+  FrozenMatches frozen(matches);
+  double sum = 0;
+  while (state.KeepRunning()) {
+    for (int i = 0; i < num_images; ++i) {
+      FrozenMatches::PointSpan span = frozen.InImage(i);
+      for (int j = 0; j < span.size; ++j) {
+        sum += span.xs[j] + span.ys[j];
+      }
+    }
+  }
+  state.SetItemsProcessed(double(state.iterations()) * features.size());
+  std::ostringstream label;
+  label << features.size() << " edges, sum " << sum;
+  state.SetLabel(label.str());
+}
+BENCHMARK(BM_FrozenMatchesInImageSpan)->Arg(1000);
+
+// A camera panning over a texture: frame i is shifted by i * (2.5, 1.5).
+void MakePanningFrames(int size, int num_frames, vector<Image *> *frames) {
+  for (int i = 0; i < num_frames; ++i) {
+    ByteImage *array = new ByteImage;
+    MakeTexturedImage(size, size, 1, 2.5 * i, 1.5 * i, array);
+    frames->push_back(new Image(array));
+  }
+}
+
+tracker::Tracker *MakeTracker() {
+  return new tracker::Tracker(
+      detector::CreateFastDetector(9, 30),
+      descriptor::CreateSimpliestDescriber(),
+      new correspondence::ArrayMatcher_Kdtree_Flann<float>);
+}
+
+// Tracks 8 frames by pairs of consecutive frames: every frame is detected and
+// described twice.
+void BM_TrackFramePairs(State &state) {
+  const int kNumFrames = 8;
+  vector<Image *> frames;
+  MakePanningFrames(state.range_x(), kNumFrames, &frames);
+  scoped_ptr<tracker::Tracker> tracker(MakeTracker());
+  while (state.KeepRunning()) {
+    for (int i = 0; i + 1 < kNumFrames; ++i) {
+      tracker::FeaturesGraph graph;
+      tracker->Track(*frames[i], *frames[i + 1], &graph);
+      graph.DeleteAndClear();
+    }
+  }
+  state.SetItemsProcessed(double(state.iterations()) * kNumFrames);
+  DeleteElements(&frames);
+}
+BENCHMARK(BM_TrackFramePairs)->Arg(512);
+
+// Same frames with the streaming tracker.
+void BM_TrackPushFrame(State &state) {
+  const int kNumFrames = 8;
+  vector<Image *> frames;
+  MakePanningFrames(state.range_x(), kNumFrames, &frames);
+  scoped_ptr<tracker::Tracker> tracker(MakeTracker());
+  int num_tracks = 0;
+  while (state.KeepRunning()) {
+    tracker::FeaturesGraph graph;
+    tracker->ResetStream();
+    for (int i = 0; i < kNumFrames; ++i) {
+      tracker->PushFrame(*frames[i], &graph);
+    }
+    num_tracks = graph.matches_.NumTracks();
+    graph.DeleteAndClear();
+  }
+  state.SetItemsProcessed(double(state.iterations()) * kNumFrames);
+  std::ostringstream label;
+  label << num_tracks << " tracks";
+  state.SetLabel(label.str());
+  DeleteElements(&frames);
+}
+BENCHMARK(BM_TrackPushFrame)->Arg(512);
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace libmv
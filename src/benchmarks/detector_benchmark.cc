@@ -0,0 +1,138 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <sstream>
+
+#include "benchmarks/benchmark.h"
+#include "benchmarks/synthetic_data.h"
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/simpliest_descriptor.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/fast_detector.h"
+#include "libmv/detector/fast_grid_detector.h"
+#include "libmv/detector/mser_detector.h"
+#include "libmv/detector/star_detector.h"
+#include "libmv/detector/surf_detector.h"
+#include "libmv/image/image.h"
+
+namespace libmv {
+namespace benchmark {
+namespace {
+
+// Takes ownership of the detector.
+void Detect(detector::Detector *detector_pointer, State &state) {
+  const int size = state.range_x();
+  ByteImage *array = new ByteImage;
+  MakeTexturedImage(size, size, 1, 0, 0, array);
+  Image image(array);
+  scoped_ptr<detector::Detector> detector(detector_pointer);
+  vector<Feature *> features;
+  int num_features = 0;
+  while (state.KeepRunning()) {
+    detector->Detect(image, &features, NULL);
+    state.PauseTiming();
+    num_features = features.size();
+    DeleteElements(&features);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(double(state.iterations()) * size * size);
+  std::ostringstream label;
+  label << num_features << " features";
+  state.SetLabel(label.str());
+}
+
+void BM_FastDetector(State &state) {
+  Detect(detector::CreateFastDetector(), state);
+}
+BENCHMARK(BM_FastDetector)->Arg(512)->Arg(1024);
+
+void BM_FastGridDetector(State &state) {
+  Detect(detector::CreateFastGridDetector(), state);
+}
+BENCHMARK(BM_FastGridDetector)->Arg(512)->Arg(1024);
+
+void BM_StarDetector(State &state) {
+  Detect(detector::CreateStarDetector(), state);
+}
+BENCHMARK(BM_StarDetector)->Arg(512)->Arg(1024);
+
+void BM_SurfDetector(State &state) {
+  Detect(detector::CreateSURFDetector(), state);
+}
+BENCHMARK(BM_SurfDetector)->Arg(512)->Arg(1024);
+
+void BM_MserDetector(State &state) {
+  Detect(detector::CreateMserDetector(), state);
+}
+BENCHMARK(BM_MserDetector)->Arg(512);
+
+// Detects and describes (SIMPLIEST) the FAST features of a frame and frees them,
+// either with delete or by recycling the arena they were allocated in.
+void DetectDescribe(bool use_arena, State &state) {
+  const int size = state.range_x();
+  ByteImage *array = new ByteImage;
+  MakeTexturedImage(size, size, 1, 0, 0, array);
+  Image image(array);
+  scoped_ptr<detector::Detector> detector(detector::CreateFastDetector(9, 10));
+  scoped_ptr<descriptor::Describer> describer(
+      descriptor::CreateSimpliestDescriber());
+  FeatureArena arena;
+  if (use_arena) {
+    detector->set_arena(&arena);
+    describer->set_arena(&arena);
+  }
+  vector<Feature *> features;
+  vector<descriptor::Descriptor *> descriptors;
+  int num_features = 0;
+  while (state.KeepRunning()) {
+    features.clear();
+    detector->Detect(image, &features, NULL);
+    describer->Describe(features, image, NULL, &descriptors);
+    num_features = features.size();
+    if (use_arena) {
+      arena.Clear();
+    } else {
+      DeleteElements(&descriptors);
+      DeleteElements(&features);
+    }
+  }
+  state.SetItemsProcessed(double(state.iterations()) * num_features);
+  std::ostringstream label;
+  label << num_features << " features" << (use_arena ? ", arena" : "");
+  state.SetLabel(label.str());
+}
+
+void BM_DetectDescribeFrame(State &state) {
+  DetectDescribe(false, state);
+}
+BENCHMARK(BM_DetectDescribeFrame)->Arg(1024);
+
+void BM_DetectDescribeFrameArena(State &state) {
+  DetectDescribe(true, state);
+}
+BENCHMARK(BM_DetectDescribeFrameArena)->Arg(1024);
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace libmv
@@ -0,0 +1,54 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "benchmarks/benchmark.h"
+#include "benchmarks/synthetic_data.h"
+#include "libmv/image/convolve.h"
+#include "libmv/image/image.h"
+
+namespace libmv {
+namespace benchmark {
+namespace {
+
+void BM_ConvolveGaussian(State &state) {
+  const int size = state.range_x();
+  FloatImage image, blurred;
+  MakeTexturedImage(size, size, 1, 0, 0, &image);
+  while (state.KeepRunning()) {
+    ConvolveGaussian(image, 1.6, &blurred);
+  }
+  state.SetItemsProcessed(double(state.iterations()) * size * size);
+}
+BENCHMARK(BM_ConvolveGaussian)->Arg(256)->Arg(1024);
+
+void BM_BlurredImageAndDerivatives(State &state) {
+  const int size = state.range_x();
+  FloatImage image, blurred_and_gradients;
+  MakeTexturedImage(size, size, 1, 0, 0, &image);
+  while (state.KeepRunning()) {
+    BlurredImageAndDerivativesChannels(image, 0.9, &blurred_and_gradients);
+  }
+  state.SetItemsProcessed(double(state.iterations()) * size * size);
+}
+BENCHMARK(BM_BlurredImageAndDerivatives)->Arg(256)->Arg(1024);
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace libmv
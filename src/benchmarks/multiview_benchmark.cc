@@ -0,0 +1,120 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdlib>
+#include <sstream>
+
+#include "benchmarks/benchmark.h"
+#include "benchmarks/synthetic_data.h"
+#include "libmv/multiview/bundle.h"
+#include "libmv/multiview/pose_refinement.h"
+#include "libmv/multiview/robust_fundamental.h"
+#include "libmv/multiview/test_data_sets.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+namespace benchmark {
+namespace {
+
+// RANSAC estimation of a fundamental matrix (7 points) with 30% outliers.
+void BM_EstimateFundamental(State &state) {
+  const int num_points = state.range_x();
+  srand(1);
+  NViewDataSet d = NRealisticCamerasFull(2, num_points);
+  Mat x1 = d.x[0], x2 = d.x[1];
+  Random random(2);
+  for (int j = 0; j < num_points; ++j) {
+    if (random.Uniform() < 0.3) {
+      x2(0, j) = 1000 * random.Uniform();
+      x2(1, j) = 1000 * random.Uniform();
+    }
+  }
+  // Estimate draws its samples with rand().
+  srand(3);
+  Mat3 F;
+  vector<int> inliers;
+  while (state.KeepRunning()) {
+    FundamentalFromCorrespondences7PointRobust(x1, x2, 1.0, &F, &inliers);
+  }
+  state.SetItemsProcessed(double(state.iterations()) * num_points);
+  std::ostringstream label;
+  label << inliers.size() << " inliers";
+  state.SetLabel(label.str());
+}
+BENCHMARK(BM_EstimateFundamental)->Arg(100)->Arg(1000);
+
+// Euclidean bundle adjustment of 6 views, each seeing 60% of the points,
+// starting from noisy motion and structure.
+void BM_EuclideanBA(State &state) {
+  const int num_points = state.range_x();
+  const int num_views = 6;
+  srand(1);
+  NViewDataSet d = NRealisticCamerasSparse(num_views, num_points);
+  vector<Mat3> R = d.R;
+  vector<Vec3> t = d.t;
+  Mat3X X = d.X;
+  for (int i = 0; i < num_views; ++i) {
+    t[i] += Vec3::Random() * 0.05;
+  }
+  X += Mat3X::Random(3, X.cols()) * 0.05;
+
+  double rms = 0;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    vector<Mat3> Ks = d.K, Rs = R;
+    vector<Vec3> ts = t;
+    Mat3X Xs = X;
+    state.ResumeTiming();
+    rms = EuclideanBA(d.x, d.x_ids, &Ks, &Rs, &ts, &Xs, eBUNDLE_METRIC);
+  }
+  state.SetItemsProcessed(double(state.iterations()) * num_points);
+  std::ostringstream label;
+  label << "rms " << rms;
+  state.SetLabel(label.str());
+}
+BENCHMARK(BM_EuclideanBA)->Arg(100)->Arg(1000);
+
+// Huber refinement of one camera pose, starting from a perturbed pose, with
+// noisy observations.
+void BM_RefineEuclideanPose(State &state) {
+  const int num_points = state.range_x();
+  srand(1);
+  NViewDataSet d = NRealisticCamerasFull(1, num_points);
+  Mat2X x = d.x[0] + Mat2X::Random(2, num_points) * 0.5;
+  Mat3 R0 = RotationAroundY(0.01) * d.R[0];
+  Vec3 t0 = d.t[0] + Vec3(0.02, -0.01, 0.03);
+
+  PoseRefinementOptions options;
+  PoseRefinementSummary summary;
+  while (state.KeepRunning()) {
+    Mat3 R = R0;
+    Vec3 t = t0;
+    RefineEuclideanPose(x, d.X, d.K[0], options, &R, &t, &summary);
+  }
+  state.SetItemsProcessed(double(state.iterations()) * num_points);
+  std::ostringstream label;
+  label << summary.num_iterations << " iterations";
+  state.SetLabel(label.str());
+}
+BENCHMARK(BM_RefineEuclideanPose)->Arg(100)->Arg(1000);
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace libmv
@@ -0,0 +1,149 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdlib>
+#include <sstream>
+
+#include "benchmarks/benchmark.h"
+#include "benchmarks/synthetic_data.h"
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_matching.h"
+#include "libmv/correspondence/matches.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/descriptor_factory.h"
+#include "libmv/descriptor/vector_descriptor.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/detector_factory.h"
+#include "libmv/image/image.h"
+#include "libmv/multiview/bundle.h"
+#include "libmv/multiview/robust_fundamental.h"
+#include "libmv/multiview/test_data_sets.h"
+#include "libmv/multiview/triangulation.h"
+
+namespace libmv {
+namespace benchmark {
+namespace {
+
+const int kWidth = 640;
+const int kHeight = 480;
+
+void DetectAndDescribe(detector::Detector *detector,
+                       descriptor::Describer *describer,
+                       const Image &image,
+                       FeatureSet *feature_set) {
+  vector<Feature *> features;
+  detector->Detect(image, &features, NULL);
+  vector<descriptor::Descriptor *> descriptors;
+  describer->Describe(features, image, NULL, &descriptors);
+  feature_set->features.resize(descriptors.size());
+  for (int i = 0; i < descriptors.size(); ++i) {
+    KeypointFeature &feature = feature_set->features[i];
+    feature.descriptor = *(descriptor::VecfDescriptor *) descriptors[i];
+    *(PointFeature *)(&feature) = *(PointFeature *) features[i];
+  }
+  DeleteElements(&descriptors);
+  DeleteElements(&features);
+}
+
+// Matches two views, estimates their epipolar geometry, triangulates the
+// inliers with the known cameras and bundle adjusts the pair. Returns the
+// number of inliers.
+int MatchAndReconstruct(NViewDataSet &d, int i, int j,
+                        const FeatureSet &features_i,
+                        const FeatureSet &features_j) {
+  Matches matches;
+  FindCandidateMatches(features_i, features_j, &matches);
+  vector<Mat> x;
+  TwoViewPointMatchMatrices(matches, 0, 1, &x);
+  if (x[0].cols() < 8) {
+    return 0;
+  }
+  Mat3 F;
+  vector<int> inliers;
+  FundamentalFromCorrespondences7PointRobust(x[0], x[1], 1.0, &F, &inliers);
+  if (inliers.size() < 8) {
+    return 0;
+  }
+
+  Mat34 P1 = d.P(i), P2 = d.P(j);
+  vector<Mat2X> xs(2);
+  xs[0].resize(2, inliers.size());
+  xs[1].resize(2, inliers.size());
+  Mat3X X(3, inliers.size());
+  for (int k = 0; k < inliers.size(); ++k) {
+    Vec2 x1 = x[0].col(inliers[k]), x2 = x[1].col(inliers[k]);
+    Vec3 X_k;
+    TriangulateDLT(P1, x1, P2, x2, &X_k);
+    X.col(k) = X_k;
+    xs[0].col(k) = x1;
+    xs[1].col(k) = x2;
+  }
+  vector<Mat3> Ks(2), Rs(2);
+  vector<Vec3> ts(2);
+  Ks[0] = d.K[i]; Rs[0] = d.R[i]; ts[0] = d.t[i];
+  Ks[1] = d.K[j]; Rs[1] = d.R[j]; ts[1] = d.t[j];
+  EuclideanBAFull(xs, &Ks, &Rs, &ts, &X, eBUNDLE_METRIC);
+  return inliers.size();
+}
+
+// Full detect -> describe -> match -> reconstruct run on rendered views of a
+// synthetic scene of 400 points.
+void BM_DetectMatchReconstruct(State &state) {
+  const int num_views = state.range_x();
+  srand(1);
+  nViewDatasetConfigator config(500, 500, kWidth / 2, kHeight / 2, 1.5, 0.01);
+  NViewDataSet d = NRealisticCamerasFull(num_views, 400, config);
+  vector<Image *> images(num_views);
+  for (int i = 0; i < num_views; ++i) {
+    ByteImage *array = new ByteImage;
+    RenderView(d, i, kWidth, kHeight, array);
+    images[i] = new Image(array);
+  }
+  scoped_ptr<detector::Detector> detector(
+      detector::detectorFactory(detector::FAST_DETECTOR));
+  scoped_ptr<descriptor::Describer> describer(
+      descriptor::describerFactory(descriptor::DIPOLE_DESCRIBER));
+
+  int num_inliers = 0;
+  while (state.KeepRunning()) {
+    vector<FeatureSet> feature_sets(num_views);
+    for (int i = 0; i < num_views; ++i) {
+      DetectAndDescribe(detector.get(), describer.get(), *images[i],
+                        &feature_sets[i]);
+    }
+    num_inliers = 0;
+    for (int i = 0; i + 1 < num_views; ++i) {
+      num_inliers += MatchAndReconstruct(d, i, i + 1,
+                                         feature_sets[i], feature_sets[i + 1]);
+    }
+  }
+  DeleteElements(&images);
+  state.SetItemsProcessed(double(state.iterations()) * num_views);
+  std::ostringstream label;
+  label << num_inliers << " inliers";
+  state.SetLabel(label.str());
+}
+BENCHMARK(BM_DetectMatchReconstruct)->Arg(4)->Arg(8);
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace libmv
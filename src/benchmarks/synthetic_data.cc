@@ -0,0 +1,158 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "benchmarks/synthetic_data.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "libmv/base/vector.h"
+
+namespace libmv {
+namespace benchmark {
+
+namespace {
+
+// Length of the intersection of [a0, a1] and [b0, b1].
+inline double Overlap(double a0, double a1, double b0, double b1) {
+  return std::max(0.0, std::min(a1, b1) - std::max(a0, b0));
+}
+
+}  // namespace
+
+void MakeTexturedImage(int width, int height, unsigned int seed,
+                       double dx, double dy, FloatImage *image) {
+  image->Resize(height, width, 1);
+  Random random(seed);
+  double phase_x = 2 * M_PI * random.Uniform();
+  double phase_y = 2 * M_PI * random.Uniform();
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      (*image)(y, x) = 0.5 + 0.15 * sin(2 * M_PI * (x - dx) / 97 + phase_x)
+                                  * cos(2 * M_PI * (y - dy) / 61 + phase_y);
+    }
+  }
+  const int num_rectangles = std::max(1, width * height / 400);
+  for (int i = 0; i < num_rectangles; ++i) {
+    double x0 = dx + random.Uniform() * width - 20;
+    double y0 = dy + random.Uniform() * height - 20;
+    double x1 = x0 + 3 + random.Uniform() * 37;
+    double y1 = y0 + 3 + random.Uniform() * 37;
+    float value = random.Uniform();
+    int xmin = std::max(0, static_cast<int>(floor(x0 + 0.5)));
+    int ymin = std::max(0, static_cast<int>(floor(y0 + 0.5)));
+    int xmax = std::min(width - 1, static_cast<int>(ceil(x1 - 0.5)));
+    int ymax = std::min(height - 1, static_cast<int>(ceil(y1 - 0.5)));
+    for (int y = ymin; y <= ymax; ++y) {
+      double coverage_y = Overlap(y - 0.5, y + 0.5, y0, y1);
+      for (int x = xmin; x <= xmax; ++x) {
+        float alpha = coverage_y * Overlap(x - 0.5, x + 0.5, x0, x1);
+        (*image)(y, x) += alpha * (value - (*image)(y, x));
+      }
+    }
+  }
+}
+
+void MakeTexturedImage(int width, int height, unsigned int seed,
+                       double dx, double dy, ByteImage *image) {
+  FloatImage float_image;
+  MakeTexturedImage(width, height, seed, dx, dy, &float_image);
+  image->Resize(height, width, 1);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      float value = 255 * float_image(y, x) + 0.5f;
+      (*image)(y, x) = std::min(255.f, std::max(0.f, value));
+    }
+  }
+}
+
+void RenderView(const NViewDataSet &dataset, int i, int width, int height,
+                ByteImage *image) {
+  // Patches of 3x3 cells of 3x3 pixels, with a random intensity per cell.
+  const int kCells = 3;
+  const int kCellSize = 3;
+  const int kHalfPatch = kCells * kCellSize / 2;
+
+  image->Resize(height, width, 1);
+  image->Fill(128);
+
+  const Mat3X &X = dataset.X;
+  vector<std::pair<double, int> > points_by_depth;
+  for (int j = 0; j < X.cols(); ++j) {
+    Vec3 camera_point = dataset.R[i] * X.col(j) + dataset.t[i];
+    if (camera_point(2) > 0) {
+      points_by_depth.push_back(std::make_pair(-camera_point(2), j));
+    }
+  }
+  std::sort(points_by_depth.begin(), points_by_depth.end());
+
+  const Mat2X &x = dataset.x[i];
+  for (int k = 0; k < points_by_depth.size(); ++k) {
+    int j = points_by_depth[k].second;
+    Random random(7919 * j + 1);
+    unsigned char cells[kCells * kCells];
+    for (int c = 0; c < kCells * kCells; ++c) {
+      cells[c] = 255 * random.Uniform();
+    }
+    int u0 = static_cast<int>(floor(x(0, j) + 0.5)) - kHalfPatch;
+    int v0 = static_cast<int>(floor(x(1, j) + 0.5)) - kHalfPatch;
+    for (int v = 0; v < kCells * kCellSize; ++v) {
+      for (int u = 0; u < kCells * kCellSize; ++u) {
+        if (image->Contains(v0 + v, u0 + u)) {
+          (*image)(v0 + v, u0 + u) =
+              cells[(v / kCellSize) * kCells + u / kCellSize];
+        }
+      }
+    }
+  }
+}
+
+void MakeFeatureSets(int num_features, int descriptor_size,
+                     FeatureSet *left, FeatureSet *right) {
+  Random random(42);
+  left->features.resize(num_features);
+  for (int i = 0; i < num_features; ++i) {
+    KeypointFeature &feature = left->features[i];
+    feature.coords << 1000 * random.Uniform(), 1000 * random.Uniform();
+    feature.descriptor.coords.resize(descriptor_size);
+    for (int j = 0; j < descriptor_size; ++j) {
+      feature.descriptor.coords(j) = random.Uniform();
+    }
+  }
+  vector<int> order(num_features);
+  for (int i = 0; i < num_features; ++i) {
+    order[i] = i;
+  }
+  for (int i = num_features - 1; i > 0; --i) {
+    std::swap(order[i], order[random.UniformInt(i + 1)]);
+  }
+  right->features.resize(num_features);
+  for (int i = 0; i < num_features; ++i) {
+    KeypointFeature &feature = right->features[i];
+    feature = left->features[order[i]];
+    for (int j = 0; j < descriptor_size; ++j) {
+      feature.descriptor.coords(j) += 0.02 * (random.Uniform() - 0.5);
+    }
+  }
+}
+
+}  // namespace benchmark
+}  // namespace libmv
@@ -0,0 +1,76 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+// Deterministic synthetic inputs for the benchmarks, so that they need no
+// external data and give comparable timings on every machine and commit.
+
+#ifndef LIBMV_BENCHMARKS_SYNTHETIC_DATA_H
+#define LIBMV_BENCHMARKS_SYNTHETIC_DATA_H
+
+#include "libmv/correspondence/feature_matching.h"
+#include "libmv/image/image.h"
+#include "libmv/multiview/test_data_sets.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+namespace benchmark {
+
+// Uniform random numbers (Numerical Recipes LCG), identical on all platforms.
+class Random {
+ public:
+  explicit Random(unsigned int seed) : state_(seed) {}
+  // In [0, 1).
+  double Uniform() {
+    state_ = 1664525u * state_ + 1013904223u;
+    return (state_ >> 8) / double(1 << 24);
+  }
+  // In [0, n).
+  int UniformInt(int n) {
+    return static_cast<int>(Uniform() * n);
+  }
+ private:
+  unsigned int state_;
+};
+
+// A gray image, values in [0, 1], made of a smooth background and random
+// overlapping rectangles which give corners and blobs at all scales. The
+// rectangles are antialiased, so shifting the pattern by a subpixel offset
+// (dx, dy) gives a consistent second frame for trackers.
+void MakeTexturedImage(int width, int height, unsigned int seed,
+                       double dx, double dy, FloatImage *image);
+
+// Same as MakeTexturedImage, quantized to bytes.
+void MakeTexturedImage(int width, int height, unsigned int seed,
+                       double dx, double dy, ByteImage *image);
+
+// Renders view i of a data set: each point is drawn as a small random patch
+// (the same in all views) centered on its projection, far points first.
+void RenderView(const NViewDataSet &dataset, int i, int width, int height,
+                ByteImage *image);
+
+// Keypoints with random descriptors. The features of right are those of left
+// shuffled, with noise added to the descriptors.
+void MakeFeatureSets(int num_features, int descriptor_size,
+                     FeatureSet *left, FeatureSet *right);
+
+}  // namespace benchmark
+}  // namespace libmv
+
+#endif  // LIBMV_BENCHMARKS_SYNTHETIC_DATA_H
@@ -0,0 +1,76 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_BASE_OBJECT_POOL_H
+#define LIBMV_BASE_OBJECT_POOL_H
+
+#include <vector>
+
+namespace libmv {
+
+/**
+ * Storage for many small objects of the same type that are recycled rather
+ * than freed. The objects are allocated in contiguous blocks and keep their
+ * address until the pool is destroyed. Clear() makes all of them available
+ * again without running their destructors, so an object that holds a buffer
+ * (an Eigen vector, say) keeps it for its next use.
+ *
+ * New() returns a default constructed object the first time a slot is used,
+ * and the object left by the previous user afterwards; the caller assigns it.
+ */
+template<typename T>
+class ObjectPool {
+ public:
+  ObjectPool(int block_size = 1024) : block_size_(block_size), size_(0) {}
+  ~ObjectPool() {
+    for (int i = 0; i < blocks_.size(); ++i) {
+      delete [] blocks_[i];
+    }
+  }
+
+  T *New() {
+    const int block = size_ / block_size_;
+    if (block == blocks_.size()) {
+      blocks_.push_back(new T[block_size_]);
+    }
+    return &blocks_[block][size_++ % block_size_];
+  }
+
+  // Makes all the objects available again.
+  void Clear() { size_ = 0; }
+
+  // Number of objects in use.
+  int size() const { return size_; }
+  // Number of objects allocated.
+  int capacity() const { return blocks_.size() * block_size_; }
+
+ private:
+  // No copying allowed.
+  ObjectPool(const ObjectPool &);
+  ObjectPool &operator=(const ObjectPool &);
+
+  std::vector<T *> blocks_;
+  int block_size_;
+  int size_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_BASE_OBJECT_POOL_H
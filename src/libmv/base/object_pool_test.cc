@@ -0,0 +1,55 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/base/object_pool.h"
+#include "testing/testing.h"
+
+namespace {
+
+using libmv::ObjectPool;
+
+TEST(ObjectPool, AddressesAreStable) {
+  ObjectPool<int> pool(4);
+  int *first = pool.New();
+  *first = 7;
+  for (int i = 0; i < 10; ++i) {
+    *pool.New() = i;
+  }
+  EXPECT_EQ(11, pool.size());
+  EXPECT_EQ(12, pool.capacity());
+  EXPECT_EQ(7, *first);
+}
+
+TEST(ObjectPool, ClearRecyclesTheObjects) {
+  ObjectPool<int> pool(4);
+  int *a = pool.New();
+  int *b = pool.New();
+  *a = 1;
+  *b = 2;
+  pool.Clear();
+  EXPECT_EQ(0, pool.size());
+  EXPECT_EQ(a, pool.New());
+  EXPECT_EQ(b, pool.New());
+  // The objects are handed back as they were left.
+  EXPECT_EQ(2, *b);
+  EXPECT_EQ(4, pool.capacity());
+}
+
+}  // namespace
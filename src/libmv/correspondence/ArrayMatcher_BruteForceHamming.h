@@ -0,0 +1,139 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_CORRESPONDENCE_ARRAYMATCHER_BRUTE_FORCE_HAMMING_H_
+#define LIBMV_CORRESPONDENCE_ARRAYMATCHER_BRUTE_FORCE_HAMMING_H_
+
+#include <vector>
+
+#include "libmv/correspondence/ArrayMatcher.h"
+#include "libmv/correspondence/kdtree.h"
+#include "libmv/descriptor/binary_descriptor.h"
+
+namespace libmv {
+namespace correspondence  {
+
+using descriptor::BinaryWord;
+
+/// Implement ArrayMatcher as a linear scan over packed binary descriptors.
+/// Rows are made of dimension BinaryWord and compared with the Hamming
+/// distance (popcount of the xor); returned distances are bit counts.
+class ArrayMatcher_BruteForceHamming : public ArrayMatcher<BinaryWord>
+{
+  public:
+  ArrayMatcher_BruteForceHamming() : _nbRows(0), _dimension(0) {}
+
+  ~ArrayMatcher_BruteForceHamming() {}
+
+  /**
+   * Build the matching structure
+   *
+   * \param[in] dataset   Input data.
+   * \param[in] nbRows    The number of component.
+   * \param[in] dimension Number of words of each row of the dataset.
+   *
+   * \return True if success.
+   */
+  bool build( const BinaryWord * dataset, int nbRows, int dimension)  {
+    _data.assign(dataset, dataset + nbRows * dimension);
+    _nbRows = nbRows;
+    _dimension = dimension;
+    return true;
+  }
+
+  /**
+   * Search the nearest Neighbour of the scalar array query.
+   *
+   * \param[in]   query     The query array
+   * \param[out]  indice    The indice of array in the dataset that
+   *  have been computed as the nearest array.
+   * \param[out]  distance  The distance between the two arrays.
+   *
+   * \return True if success.
+   */
+  bool searchNeighbour( const BinaryWord * query, int * indice,
+                        BinaryWord * distance)
+  {
+    if (_nbRows == 0)  {
+      return false;
+    }
+    KnnSortedList<int, int> knn(1);
+    Search(query, &knn);
+    *indice = knn.Neighbor(0);
+    *distance = knn.Distance(0);
+    return true;
+  }
+
+  /**
+   * Search the N nearest Neighbour of the scalar array query.
+   *
+   * \param[in]   query     The query array
+   * \param[in]   nbQuery   The number of query rows
+   * \param[out]  indice    The indices of arrays in the dataset that
+   *  have been computed as the nearest arrays.
+   * \param[out]  distance  The distances between the matched arrays.
+   *
+   * \return True if success.
+   */
+  bool searchNeighbours( const BinaryWord * query, int nbQuery,
+    vector<int> * indice, vector<BinaryWord> * distance, int NN)
+  {
+    if (_nbRows < NN || NN < 1)  {
+      return false;
+    }
+    indice->resize(nbQuery * NN);
+    distance->resize(nbQuery * NN);
+#ifdef _OPENMP
+#pragma omp parallel if (nbQuery > 64)
+#endif
+    {
+      KnnSortedList<int, int> knn(NN);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (int i = 0; i < nbQuery; ++i) {
+        knn.Clear();
+        Search(query + i * _dimension, &knn);
+        for (int j = 0; j < NN; ++j) {
+          (*indice)[i * NN + j] = knn.Neighbor(j);
+          (*distance)[i * NN + j] = knn.Distance(j);
+        }
+      }
+    }
+    return true;
+  }
+
+  private :
+  void Search(const BinaryWord * query, KnnSortedList<int, int> *knn) const {
+    const BinaryWord * row = &_data[0];
+    for (int i = 0; i < _nbRows; ++i, row += _dimension) {
+      knn->AddNeighbor(i, descriptor::HammingDistance(query, row, _dimension));
+    }
+  }
+
+  std::vector<BinaryWord> _data;
+  int _nbRows;
+  int _dimension;
+};
+
+} // namespace correspondence
+} // namespace libmv
+
+#endif // LIBMV_CORRESPONDENCE_ARRAYMATCHER_BRUTE_FORCE_HAMMING_H_
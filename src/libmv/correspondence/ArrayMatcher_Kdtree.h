@@ -48,6 +48,8 @@ class ArrayMatcher_Kdtree : public ArrayMatcher<Scalar>
    */
   bool build( const Scalar * dataset, int nbRows, int dimension)  {
 
+    // The tree copies the data, so dataset can be released after build.
+    _tree = KdTree<Scalar>();
     _tree.SetDimensions(dimension);
     const Scalar * ptrDataset = dataset;
     for (int i=0; i < nbRows; ++i)  {
@@ -70,11 +72,15 @@ class ArrayMatcher_Kdtree : public ArrayMatcher<Scalar>
    */
   bool searchNeighbour( const Scalar * query, int * indice, Scalar * distance)
   {
-    Scalar distanceToQuery;
-    int nni;
-    _tree.ApproximateNearestNeighborBestBinFirst(query, 1000, &nni, &distanceToQuery);
-    *indice = nni;
-    *distance = distanceToQuery;
+    PriorityQueue<int, Scalar> queue;
+    typename KdTree<Scalar>::SearchResults knn(1);
+    _tree.ApproximateKnnBestBinFirst(query, kMaxLeafs, kMaxChecks,
+                                     &queue, &knn);
+    if (knn.Size() == 0)  {
+      return false;
+    }
+    *indice = knn.Neighbor(0);
+    *distance = knn.Distance(0);
     return true;
   }
 
@@ -93,25 +99,25 @@ class ArrayMatcher_Kdtree : public ArrayMatcher<Scalar>
   bool searchNeighbours( const Scalar * query, int nbQuery,
     vector<int> * indice, vector<Scalar> * distance, int NN)
   {
-    if (NN==1)  {
-      const Scalar * ptrQuery =  query;
-      for (int i=0; i < nbQuery; ++i) {
-        Scalar distanceToQuery;
-        int nni;
-        _tree.ApproximateNearestNeighborBestBinFirst(ptrQuery, 1000, &nni, &distanceToQuery);
-        distance->push_back(distanceToQuery);
-        indice->push_back(nni);
-        ptrQuery+=_tree.NumDimension();
-      }
-      return true;
-    }
-    else  {
-      //-- Not yet implemented
+    if (NN < 1)  {
       return false;
     }
+    indice->resize(nbQuery * NN);
+    distance->resize(nbQuery * NN);
+    if (nbQuery == 0)  {
+      return true;
+    }
+    // Queries are processed in parallel, results are stored in query order.
+    _tree.ApproximateKnnBestBinFirstBatch(query, nbQuery, NN,
+      kMaxLeafs, kMaxChecks, &(*indice)[0], &(*distance)[0]);
+    return true;
   }
 
   private :
+  // Search budget: maximum number of explored leafs and of compared points.
+  static const int kMaxLeafs = 1000;
+  static const int kMaxChecks = 2048;
+
   KdTree<Scalar> _tree;
 
 };
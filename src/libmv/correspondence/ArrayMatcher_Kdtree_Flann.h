@@ -53,6 +53,12 @@ class ArrayMatcher_Kdtree_Flann : public ArrayMatcher<Scalar>
    */
   bool build( const Scalar * dataset, int nbRows, int dimension)  {
 
+    // A rebuild (e.g. once per frame when tracking) replaces the index.
+    if (_index_id) {
+      flann_free_index(_index_id, &_p);
+      _index_id = NULL;
+    }
+
     _p.log_destination = NULL;
     _p.log_level = LOG_WARN;//LOG_INFO;
 
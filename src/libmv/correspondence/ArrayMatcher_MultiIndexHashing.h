@@ -0,0 +1,242 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_CORRESPONDENCE_ARRAYMATCHER_MULTI_INDEX_HASHING_H_
+#define LIBMV_CORRESPONDENCE_ARRAYMATCHER_MULTI_INDEX_HASHING_H_
+
+#include <vector>
+
+#include "libmv/correspondence/ArrayMatcher.h"
+#include "libmv/correspondence/kdtree.h"
+#include "libmv/descriptor/binary_descriptor.h"
+
+namespace libmv {
+namespace correspondence  {
+
+using descriptor::BinaryWord;
+
+/// Implement ArrayMatcher with Multi-Index Hashing for packed binary
+/// descriptors (Hamming distance).
+// M. Norouzi, A. Punjani, D. J. Fleet. Fast Search in Hamming Space with
+// Multi-Index Hashing. In CVPR, 2012.
+//
+// Each code is cut in m substrings of 16 bits, and every substring indexes a
+// hash table (direct addressing, 2^16 buckets).  Two codes at distance d have
+// at least one substring at distance <= d / m, so probing the buckets at
+// substring distance 0, 1, ... finds all the codes at distance < m * (r + 1)
+// after the radius r pass.  The search stops as soon as the current k-th
+// neighbor is guaranteed; past max_radius the remaining rows are scanned
+// linearly, so the results are exactly those of the brute force matcher.
+class ArrayMatcher_MultiIndexHashing : public ArrayMatcher<BinaryWord>
+{
+  public:
+  /// max_radius is the largest probed substring radius (at most 3).
+  ArrayMatcher_MultiIndexHashing(int max_radius = 2)
+    : _nbRows(0), _dimension(0), _nbTables(0),
+      _maxRadius(std::min(max_radius, 3)) {}
+
+  ~ArrayMatcher_MultiIndexHashing() {}
+
+  /**
+   * Build the matching structure
+   *
+   * \param[in] dataset   Input data.
+   * \param[in] nbRows    The number of component.
+   * \param[in] dimension Number of words of each row of the dataset.
+   *
+   * \return True if success.
+   */
+  bool build( const BinaryWord * dataset, int nbRows, int dimension)  {
+    _data.assign(dataset, dataset + nbRows * dimension);
+    _nbRows = nbRows;
+    _dimension = dimension;
+    _nbTables = dimension * kSubstringsPerWord;
+
+    // Fill the tables with a counting sort of the rows by substring value.
+    _offsets.assign(_nbTables * (kNumBuckets + 1), 0);
+    _ids.resize(_nbTables * nbRows);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (nbRows > 1024)
+#endif
+    for (int t = 0; t < _nbTables; ++t) {
+      int *offsets = &_offsets[t * (kNumBuckets + 1)];
+      for (int i = 0; i < nbRows; ++i) {
+        ++offsets[Substring(&_data[i * dimension], t) + 1];
+      }
+      for (int b = 0; b < kNumBuckets; ++b) {
+        offsets[b + 1] += offsets[b];
+      }
+      std::vector<int> position(offsets, offsets + kNumBuckets);
+      int *ids = nbRows ? &_ids[t * nbRows] : NULL;
+      for (int i = 0; i < nbRows; ++i) {
+        ids[position[Substring(&_data[i * dimension], t)]++] = i;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Search the nearest Neighbour of the scalar array query.
+   *
+   * \param[in]   query     The query array
+   * \param[out]  indice    The indice of array in the dataset that
+   *  have been computed as the nearest array.
+   * \param[out]  distance  The distance between the two arrays.
+   *
+   * \return True if success.
+   */
+  bool searchNeighbour( const BinaryWord * query, int * indice,
+                        BinaryWord * distance)
+  {
+    if (_nbRows == 0)  {
+      return false;
+    }
+    KnnSortedList<int, int> knn(1);
+    std::vector<int> visited(_nbRows, -1);
+    Search(query, 0, &visited, &knn);
+    *indice = knn.Neighbor(0);
+    *distance = knn.Distance(0);
+    return true;
+  }
+
+  /**
+   * Search the N nearest Neighbour of the scalar array query.
+   *
+   * \param[in]   query     The query array
+   * \param[in]   nbQuery   The number of query rows
+   * \param[out]  indice    The indices of arrays in the dataset that
+   *  have been computed as the nearest arrays.
+   * \param[out]  distance  The distances between the matched arrays.
+   *
+   * \return True if success.
+   */
+  bool searchNeighbours( const BinaryWord * query, int nbQuery,
+    vector<int> * indice, vector<BinaryWord> * distance, int NN)
+  {
+    if (_nbRows < NN || NN < 1)  {
+      return false;
+    }
+    indice->resize(nbQuery * NN);
+    distance->resize(nbQuery * NN);
+#ifdef _OPENMP
+#pragma omp parallel if (nbQuery > 64)
+#endif
+    {
+      // Per thread scratch space; visited[i] is the last query that saw row i.
+      KnnSortedList<int, int> knn(NN);
+      std::vector<int> visited(_nbRows, -1);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 32)
+#endif
+      for (int i = 0; i < nbQuery; ++i) {
+        knn.Clear();
+        Search(query + i * _dimension, i, &visited, &knn);
+        for (int j = 0; j < NN; ++j) {
+          (*indice)[i * NN + j] = knn.Neighbor(j);
+          (*distance)[i * NN + j] = knn.Distance(j);
+        }
+      }
+    }
+    return true;
+  }
+
+  private :
+  static const int kSubstringBits = 16;
+  static const int kSubstringsPerWord = 2;
+  static const int kNumBuckets = 1 << 16;
+
+  static int Substring(const BinaryWord * code, int t) {
+    return (code[t / kSubstringsPerWord] >>
+            (kSubstringBits * (t % kSubstringsPerWord))) & (kNumBuckets - 1);
+  }
+
+  void VisitBucket(const BinaryWord * query, int stamp, int t, int key,
+                   std::vector<int> *visited,
+                   KnnSortedList<int, int> *knn) const {
+    const int *offsets = &_offsets[t * (kNumBuckets + 1)];
+    const int *ids = &_ids[t * _nbRows];
+    for (int j = offsets[key]; j < offsets[key + 1]; ++j) {
+      int id = ids[j];
+      if ((*visited)[id] != stamp) {
+        (*visited)[id] = stamp;
+        knn->AddNeighbor(id, descriptor::HammingDistance(
+            query, &_data[id * _dimension], _dimension));
+      }
+    }
+  }
+
+  void Search(const BinaryWord * query, int stamp,
+              std::vector<int> *visited,
+              KnnSortedList<int, int> *knn) const {
+    for (int radius = 0; radius <= _maxRadius; ++radius) {
+      for (int t = 0; t < _nbTables; ++t) {
+        int key = Substring(query, t);
+        // Probe all the keys at exactly radius bits from key (radius <= 3).
+        if (radius == 0) {
+          VisitBucket(query, stamp, t, key, visited, knn);
+        }
+        for (int a = 0; radius >= 1 && a < kSubstringBits; ++a) {
+          int key_a = key ^ (1 << a);
+          if (radius == 1) {
+            VisitBucket(query, stamp, t, key_a, visited, knn);
+            continue;
+          }
+          for (int b = a + 1; b < kSubstringBits; ++b) {
+            int key_b = key_a ^ (1 << b);
+            if (radius == 2) {
+              VisitBucket(query, stamp, t, key_b, visited, knn);
+              continue;
+            }
+            for (int c = b + 1; c < kSubstringBits; ++c) {
+              VisitBucket(query, stamp, t, key_b ^ (1 << c), visited, knn);
+            }
+          }
+        }
+      }
+      // All the rows closer than _nbTables * (radius + 1) have been seen.
+      if (knn->Full() &&
+          knn->FarthestDistance() < _nbTables * (radius + 1)) {
+        return;
+      }
+    }
+    // Not guaranteed yet: complete with the rows never visited.
+    for (int id = 0; id < _nbRows; ++id) {
+      if ((*visited)[id] != stamp) {
+        (*visited)[id] = stamp;
+        knn->AddNeighbor(id, descriptor::HammingDistance(
+            query, &_data[id * _dimension], _dimension));
+      }
+    }
+  }
+
+  std::vector<BinaryWord> _data;
+  // Per table: kNumBuckets + 1 offsets in _ids, then the row ids by bucket.
+  std::vector<int> _offsets;
+  std::vector<int> _ids;
+  int _nbRows;
+  int _dimension;
+  int _nbTables;
+  int _maxRadius;
+};
+
+} // namespace correspondence
+} // namespace libmv
+
+#endif // LIBMV_CORRESPONDENCE_ARRAYMATCHER_MULTI_INDEX_HASHING_H_
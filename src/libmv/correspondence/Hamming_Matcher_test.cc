@@ -0,0 +1,190 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/correspondence/ArrayMatcher.h"
+#include "libmv/correspondence/ArrayMatcher_BruteForceHamming.h"
+#include "libmv/correspondence/ArrayMatcher_MultiIndexHashing.h"
+#include "libmv/correspondence/feature_matching.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/descriptor/binary_descriptor.h"
+#include "testing/testing.h"
+using testing::Types;
+
+namespace {
+
+using namespace libmv;
+using namespace libmv::descriptor;
+using namespace libmv::correspondence;
+
+// Deterministic pseudo random words.
+BinaryWord NextWord(unsigned int *state) {
+  *state = 1664525u * *state + 1013904223u;
+  BinaryWord high = *state >> 16;
+  *state = 1664525u * *state + 1013904223u;
+  return (high << 16) | (*state >> 16);
+}
+
+template <class Kernel>
+struct HammingMatcherTest : public testing::Test {
+};
+
+typedef Types< ArrayMatcher_BruteForceHamming,
+               ArrayMatcher_MultiIndexHashing
+               > HammingMatcherImpl;
+
+TYPED_TEST_CASE(HammingMatcherTest, HammingMatcherImpl);
+
+TYPED_TEST(HammingMatcherTest, FindsNoisyCopies)
+{
+  // 500 random codes of 256 bits, and queries made of a few of them with some
+  // bits flipped.
+  const int kNumWords = 8;
+  const int kNumRows = 500;
+  unsigned int state = 1;
+  std::vector<BinaryWord> dataset(kNumRows * kNumWords);
+  for (int i = 0; i < dataset.size(); ++i) {
+    dataset[i] = NextWord(&state);
+  }
+  const int kNumQueries = 50;
+  std::vector<BinaryWord> queries(kNumQueries * kNumWords);
+  for (int i = 0; i < kNumQueries; ++i) {
+    int row = (i * 7) % kNumRows;
+    for (int j = 0; j < kNumWords; ++j) {
+      queries[i * kNumWords + j] = dataset[row * kNumWords + j];
+    }
+    // Flip i % 20 bits.
+    for (int b = 0; b < i % 20; ++b) {
+      queries[i * kNumWords + (b * 3) % kNumWords] ^= 1u << (b * 5 % 32);
+    }
+  }
+
+  ArrayMatcher<BinaryWord> * matcher = new TypeParam;
+  ASSERT_TRUE(matcher->build(&dataset[0], kNumRows, kNumWords));
+  libmv::vector<int> indices;
+  libmv::vector<BinaryWord> distances;
+  const int NN = 2;
+  ASSERT_TRUE(matcher->searchNeighbours(&queries[0], kNumQueries,
+                                        &indices, &distances, NN));
+  ASSERT_EQ(kNumQueries * NN, indices.size());
+  for (int i = 0; i < kNumQueries; ++i) {
+    EXPECT_EQ((i * 7) % kNumRows, indices[i * NN]);
+    EXPECT_GE(i % 20, distances[i * NN]);
+    // Random codes are about 128 bits apart.
+    EXPECT_LT(80, distances[i * NN + 1]);
+  }
+
+  int indice;
+  BinaryWord distance;
+  ASSERT_TRUE(matcher->searchNeighbour(&dataset[3 * kNumWords],
+                                       &indice, &distance));
+  EXPECT_EQ(3, indice);
+  EXPECT_EQ(0, distance);
+  delete matcher;
+}
+
+TEST(HammingMatcher, MultiIndexHashingIsExact)
+{
+  // Far queries need the linear completion; results must match brute force.
+  const int kNumWords = 4;
+  const int kNumRows = 300;
+  unsigned int state = 7;
+  std::vector<BinaryWord> dataset(kNumRows * kNumWords);
+  for (int i = 0; i < dataset.size(); ++i) {
+    dataset[i] = NextWord(&state);
+  }
+  const int kNumQueries = 40;
+  std::vector<BinaryWord> queries(kNumQueries * kNumWords);
+  for (int i = 0; i < queries.size(); ++i) {
+    queries[i] = NextWord(&state);
+  }
+
+  ArrayMatcher_BruteForceHamming linear;
+  ArrayMatcher_MultiIndexHashing mih(1);
+  linear.build(&dataset[0], kNumRows, kNumWords);
+  mih.build(&dataset[0], kNumRows, kNumWords);
+  libmv::vector<int> indices_linear, indices_mih;
+  libmv::vector<BinaryWord> distances_linear, distances_mih;
+  const int NN = 3;
+  linear.searchNeighbours(&queries[0], kNumQueries,
+                          &indices_linear, &distances_linear, NN);
+  mih.searchNeighbours(&queries[0], kNumQueries,
+                       &indices_mih, &distances_mih, NN);
+  for (int i = 0; i < kNumQueries * NN; ++i) {
+    EXPECT_EQ(distances_linear[i], distances_mih[i]);
+  }
+}
+
+TEST(HammingMatcher, FindBinaryCorrespondences)
+{
+  libmv::vector<Descriptor *> left, right;
+  unsigned int state = 3;
+  for (int i = 0; i < 20; ++i) {
+    BinaryDescriptor *descriptor = new BinaryDescriptor(256);
+    for (int j = 0; j < descriptor->NumWords(); ++j) {
+      descriptor->words[j] = NextWord(&state);
+    }
+    right.push_back(descriptor);
+  }
+  // Left is right in the reverse order.
+  for (int i = 19; i >= 0; --i) {
+    left.push_back(new BinaryDescriptor(
+        *static_cast<BinaryDescriptor *>(right[i])));
+  }
+  std::map<size_t, size_t> correspondences;
+  FindBinaryCorrespondences(left, right, &correspondences);
+  EXPECT_EQ(20, correspondences.size());
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(19 - i, correspondences[i]);
+  }
+  DeleteElements(&left);
+  DeleteElements(&right);
+}
+
+
+TEST(HammingMatcher, FindBinaryCorrespondencesSkipsNullRight)
+{
+  // A sparse descriptor is as close to the zero rows as to its match, so the
+  // missing right descriptors must not take part in the ratio test.
+  libmv::vector<Descriptor *> left, right;
+  unsigned int state = 5;
+  for (int i = 0; i < 10; ++i) {
+    BinaryDescriptor *descriptor = new BinaryDescriptor(256);
+    for (int j = 0; j < descriptor->NumWords(); ++j) {
+      descriptor->words[j] = NextWord(&state);
+    }
+    right.push_back(descriptor);
+    right.push_back(NULL);
+  }
+  BinaryDescriptor *sparse = new BinaryDescriptor(256);
+  sparse->words[0] = 3;
+  right.push_back(sparse);
+  BinaryDescriptor *query = new BinaryDescriptor(256);
+  query->words[0] = 1;
+  left.push_back(query);
+
+  std::map<size_t, size_t> correspondences;
+  FindBinaryCorrespondences(left, right, &correspondences);
+  EXPECT_EQ(1, correspondences.size());
+  EXPECT_EQ(right.size() - 1, correspondences[0]);
+  DeleteElements(&left);
+  DeleteElements(&right);
+}
+
+}  // namespace
@@ -49,23 +49,11 @@ class BipartiteGraph {
   }
   
   int NumLeftLeft(T left) const { 
-    int n = 0;
-    typename EdgeMap::const_iterator it;
-    for (it = left_to_right_.begin(); it != left_to_right_.end(); ++it) {
-      if (it->first.first == left)
-        n++;
-    }
-    return n;
+    return Count(ToLeft(left));
   }
   
   int NumLeftRight(T right) const { 
-    int n = 0;
-    typename EdgeMap::const_iterator it;
-    for (it = left_to_right_.begin(); it != left_to_right_.end(); ++it) {
-      if (it->first.second == right)
-        n++;
-    }
-    return n;
+    return Count(ToRight(right));
   }
   
   // Erases all the elements.  
@@ -130,6 +118,14 @@ class BipartiteGraph {
   std::pair<T, T> Upper(T first) const {
     return std::make_pair(first, std::numeric_limits<T>::max());
   }
+  // Only walks the edges of one vertex.
+  static int Count(Range range) {
+    int n = 0;
+    for (; range; ++range) {
+      n++;
+    }
+    return n;
+  }
   EdgeMap left_to_right_;
   EdgeMap right_to_left_;
 };
@@ -0,0 +1,122 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_CORRESPONDENCE_FEATURE_ARENA_H_
+#define LIBMV_CORRESPONDENCE_FEATURE_ARENA_H_
+
+#include <vector>
+
+#include "libmv/base/object_pool.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/vector_descriptor.h"
+
+namespace libmv {
+
+// The features and descriptors of one frame.  A detector or a describer given
+// an arena (see Detector::set_arena and Describer::set_arena) allocates its
+// results here instead of with new: the vector<Feature *> and
+// vector<Descriptor *> they fill are views on the arena, which owns the
+// objects.  Clear() recycles all of them at once for another frame.
+class FeatureArena {
+ public:
+  PointFeature *NewPointFeature(float x, float y) {
+    PointFeature *feature = points_.New();
+    *feature = PointFeature(x, y);
+    return feature;
+  }
+
+  // The coefficients of the descriptor are left uninitialized.
+  descriptor::VecfDescriptor *NewVecfDescriptor(int size) {
+    descriptor::VecfDescriptor *descriptor = descriptors_.New();
+    descriptor->coords.resize(size);
+    return descriptor;
+  }
+
+  void Clear() {
+    points_.Clear();
+    descriptors_.Clear();
+  }
+
+  int NumPointFeatures() const { return points_.size(); }
+  int NumVecfDescriptors() const { return descriptors_.size(); }
+
+ private:
+  ObjectPool<PointFeature> points_;
+  ObjectPool<descriptor::VecfDescriptor> descriptors_;
+};
+
+// Arenas for the frames of a tracking window: a frame acquires an arena and
+// releases it when it leaves the window; the arena and all its storage are
+// then reused by a later frame.
+class FeatureArenaPool {
+ public:
+  FeatureArenaPool() {}
+  ~FeatureArenaPool() {
+    for (int i = 0; i < arenas_.size(); ++i) {
+      delete arenas_[i];
+    }
+  }
+
+  // Returns an empty arena, owned by the pool.
+  FeatureArena *Acquire() {
+    if (free_.empty()) {
+      arenas_.push_back(new FeatureArena);
+      return arenas_.back();
+    }
+    FeatureArena *arena = free_.back();
+    free_.pop_back();
+    return arena;
+  }
+
+  // Clears the arena and makes it available again.
+  void Release(FeatureArena *arena) {
+    if (arena) {
+      arena->Clear();
+      free_.push_back(arena);
+    }
+  }
+
+  // Number of arenas allocated, in use or not.
+  int NumArenas() const { return arenas_.size(); }
+
+ private:
+  // No copying allowed.
+  FeatureArenaPool(const FeatureArenaPool &);
+  FeatureArenaPool &operator=(const FeatureArenaPool &);
+
+  std::vector<FeatureArena *> arenas_;
+  std::vector<FeatureArena *> free_;
+};
+
+// Allocates in arena, or with new if arena is NULL.
+inline PointFeature *NewPointFeature(FeatureArena *arena, float x, float y) {
+  return arena ? arena->NewPointFeature(x, y) : new PointFeature(x, y);
+}
+
+inline descriptor::VecfDescriptor *NewVecfDescriptor(FeatureArena *arena,
+                                                     int size) {
+  return arena ? arena->NewVecfDescriptor(size)
+               : new descriptor::VecfDescriptor(size);
+}
+
+}  // namespace libmv
+
+#endif  // LIBMV_CORRESPONDENCE_FEATURE_ARENA_H_
@@ -0,0 +1,69 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/correspondence/feature_arena.h"
+#include "testing/testing.h"
+
+namespace {
+
+using namespace libmv;
+
+TEST(FeatureArena, ClearRecyclesTheObjects) {
+  FeatureArena arena;
+  PointFeature *point = arena.NewPointFeature(1, 2);
+  point->scale = 3;
+  descriptor::VecfDescriptor *descriptor = arena.NewVecfDescriptor(64);
+  const float *coords = descriptor->coords.data();
+  EXPECT_EQ(1, arena.NumPointFeatures());
+  EXPECT_EQ(1, arena.NumVecfDescriptors());
+
+  arena.Clear();
+  EXPECT_EQ(0, arena.NumPointFeatures());
+  EXPECT_EQ(point, arena.NewPointFeature(4, 5));
+  EXPECT_EQ(4, point->x());
+  EXPECT_EQ(5, point->y());
+  EXPECT_EQ(0, point->scale);
+  // A descriptor of the same size keeps its buffer.
+  EXPECT_EQ(descriptor, arena.NewVecfDescriptor(64));
+  EXPECT_EQ(coords, descriptor->coords.data());
+}
+
+TEST(FeatureArenaPool, ReleasedArenasAreReused) {
+  FeatureArenaPool pool;
+  FeatureArena *a = pool.Acquire();
+  FeatureArena *b = pool.Acquire();
+  EXPECT_NE(a, b);
+  a->NewPointFeature(1, 2);
+  pool.Release(a);
+  EXPECT_EQ(0, a->NumPointFeatures());
+  EXPECT_EQ(a, pool.Acquire());
+  EXPECT_EQ(2, pool.NumArenas());
+}
+
+TEST(FeatureArena, NewWithoutArena) {
+  PointFeature *point = NewPointFeature(NULL, 1, 2);
+  EXPECT_EQ(2, point->y());
+  delete point;
+  descriptor::VecfDescriptor *descriptor = NewVecfDescriptor(NULL, 8);
+  EXPECT_EQ(8, descriptor->coords.size());
+  delete descriptor;
+}
+
+}  // namespace
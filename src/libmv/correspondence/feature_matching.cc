@@ -24,6 +24,10 @@
 #include "libmv/correspondence/ArrayMatcher_BruteForce.h"
 #include "libmv/correspondence/ArrayMatcher_Kdtree_Flann.h"
 #include "libmv/correspondence/ArrayMatcher_Kdtree.h"
+#include "libmv/correspondence/ArrayMatcher_BruteForceHamming.h"
+#include "libmv/correspondence/ArrayMatcher_MultiIndexHashing.h"
+#include "libmv/descriptor/binary_descriptor.h"
+#include "libmv/logging/tracing.h"
 
 // Compute candidate matches between 2 sets of features.  Two features A and B
 // are a candidate match if A is the nearest neighbor of B and B is the nearest
@@ -32,6 +36,7 @@ void FindCandidateMatches(const FeatureSet &left,
                           const FeatureSet &right,
                           Matches *matches,
                           eLibmvMatchMethod eMatchMethod) {
+  LIBMV_TRACE_SCOPE("match");
   if (left.features.size() == 0 ||
       right.features.size() == 0 )  {
     return;
@@ -137,6 +142,7 @@ void FindCandidateMatches_Ratio(const FeatureSet &left,
                           Matches *matches,
                           eLibmvMatchMethod eMatchMethod,
                           float fRatio) {
+  LIBMV_TRACE_SCOPE("match");
 
   if (left.features.size() == 0 ||
       right.features.size() == 0 )  {
@@ -221,6 +227,7 @@ void FindCorrespondences(const FeatureSet &left,
                          std::map<size_t, size_t> *correspondences,
                          eLibmvMatchMethod eMatchMethod,
                          float fRatio) {
+  LIBMV_TRACE_SCOPE("match");
   if (left.features.size() == 0 ||
       right.features.size() == 0 )  {
     return;
@@ -291,3 +298,81 @@ void FindCorrespondences(const FeatureSet &left,
     LOG(INFO) << "[FindCandidateMatches_Ratio] Unknow input match method.";
   }
 }
+
+// Compute correspondences between 2 sets of binary descriptors with a ratio.
+void FindBinaryCorrespondences(
+    const libmv::vector<descriptor::Descriptor *> &left,
+    const libmv::vector<descriptor::Descriptor *> &right,
+    std::map<size_t, size_t> *correspondences,
+    eLibmvBinaryMatchMethod eMatchMethod,
+    float fRatio) {
+  LIBMV_TRACE_SCOPE("match");
+  const int NN = 2;
+  // Leave the missing right descriptors out of the index, so that their zero
+  // rows do not compete in the ratio test, and keep their original indices.
+  libmv::vector<descriptor::Descriptor *> right_valid;
+  libmv::vector<size_t> right_indices;
+  for (size_t i = 0; i < right.size(); ++i) {
+    if (right[i] != NULL) {
+      right_valid.push_back(right[i]);
+      right_indices.push_back(i);
+    }
+  }
+  if (left.size() == 0 || right_valid.size() < NN)  {
+    return;
+  }
+
+  // Paste the necessary data in contiguous arrays.
+  int num_words_left = 0, num_words_right = 0;
+  descriptor::BinaryWord * arrayA =
+    descriptor::BinaryDescriptorsToContiguousArray(left, &num_words_left);
+  descriptor::BinaryWord * arrayB =
+    descriptor::BinaryDescriptorsToContiguousArray(right_valid,
+                                                   &num_words_right);
+  if (arrayA == NULL || arrayB == NULL || num_words_left != num_words_right) {
+    LOG(INFO) << "[FindBinaryCorrespondences] Invalid binary descriptors.";
+    delete [] arrayA;
+    delete [] arrayB;
+    return;
+  }
+
+  correspondence::ArrayMatcher<descriptor::BinaryWord> * pArrayMatcherA = NULL;
+  switch (eMatchMethod)
+  {
+  case eMATCH_HAMMING_LINEAR:
+    pArrayMatcherA = new correspondence::ArrayMatcher_BruteForceHamming;
+    break;
+  case eMATCH_HAMMING_MIH:
+    pArrayMatcherA = new correspondence::ArrayMatcher_MultiIndexHashing;
+    break;
+  };
+
+  libmv::vector<int> indices;
+  libmv::vector<descriptor::BinaryWord> distances;
+  bool breturn = false;
+  if (pArrayMatcherA != NULL &&
+      pArrayMatcherA->build(arrayB, right_valid.size(), num_words_right))  {
+    breturn = pArrayMatcherA->searchNeighbours(arrayA, left.size(),
+                                               &indices, &distances, NN);
+  }
+  delete pArrayMatcherA;
+  delete [] arrayA;
+  delete [] arrayB;
+
+  // From putative matches get matches that fit the "Ratio" heuristic.
+  if (breturn)  {
+    for (size_t i = 0; i < left.size(); ++i) {
+      if (left[i] == NULL) {
+        continue;
+      }
+      float distance0 = distances[i*NN];
+      float distance1 = distances[i*NN+NN-1];
+      if (distance0 < fRatio * distance1) {
+        (*correspondences)[i] = right_indices[indices[i*NN]];
+      }
+    }
+  }
+  else  {
+    LOG(INFO) << "[FindBinaryCorrespondences] Cannot compute matches.";
+  }
+}
@@ -88,4 +88,20 @@ void FindCorrespondences(const FeatureSet &left,
                          eLibmvMatchMethod eMatchMethod = eMATCH_KDTREE_FLANN,
                          float fRatio = 0.8f);
 
+enum eLibmvBinaryMatchMethod
+{
+  eMATCH_HAMMING_LINEAR,
+  eMATCH_HAMMING_MIH
+};
+
+// Compute correspondences between 2 sets of binary descriptors (see
+// descriptor/binary_descriptor.h) with the Hamming distance and Lowe's ratio.
+// NULL descriptors never match.
+void FindBinaryCorrespondences(
+    const libmv::vector<descriptor::Descriptor *> &left,
+    const libmv::vector<descriptor::Descriptor *> &right,
+    std::map<size_t, size_t> *correspondences,
+    eLibmvBinaryMatchMethod eMatchMethod = eMATCH_HAMMING_MIH,
+    float fRatio = 0.8f);
+
 #endif //LIBMV_CORRESPONDENCE_FEATURE_MATCHING_H_
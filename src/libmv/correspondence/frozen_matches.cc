@@ -0,0 +1,228 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/frozen_matches.h"
+#include "libmv/logging/tracing.h"
+
+namespace libmv {
+
+namespace {
+
+// First index in [lo, hi) whose track is not less than track.  The steps
+// double from lo before the binary search, so that walking a list by
+// increasing tracks costs the logarithm of the skipped gaps rather than of
+// the list.
+int Gallop(const Matches::TrackID *tracks, int lo, int hi,
+           Matches::TrackID track) {
+  if (lo >= hi || tracks[lo] >= track) {
+    return lo;
+  }
+  int below = lo;  // tracks[below] < track.
+  int step = 1;
+  while (lo + step < hi && tracks[lo + step] < track) {
+    below = lo + step;
+    step *= 2;
+  }
+  const int last = std::min(lo + step, hi);
+  return std::lower_bound(tracks + below + 1, tracks + last, track) - tracks;
+}
+
+// Orders lists by size.
+struct SmallerList {
+  SmallerList(const std::vector<int> &sizes) : sizes_(&sizes) {}
+  bool operator()(int a, int b) const { return (*sizes_)[a] < (*sizes_)[b]; }
+  const std::vector<int> *sizes_;
+};
+
+}  // namespace
+
+void FrozenMatches::Freeze(const Matches &matches) {
+  LIBMV_TRACE_SCOPE("matches.freeze");
+  images_.clear();
+  offsets_.clear();
+  tracks_.clear();
+  xs_.clear();
+  ys_.clear();
+  // The edges come sorted by image then track, so the arrays are filled in
+  // one pass.
+  for (Matches::Points r = matches.All<PointFeature>(); r; ++r) {
+    if (images_.empty() || images_.back() != r.image()) {
+      images_.push_back(r.image());
+      offsets_.push_back(tracks_.size());
+    }
+    tracks_.push_back(r.track());
+    xs_.push_back(r.feature()->x());
+    ys_.push_back(r.feature()->y());
+  }
+  offsets_.push_back(tracks_.size());
+
+  track_ids_.clear();
+  track_offsets_.clear();
+  track_images_.clear();
+  track_xs_.clear();
+  track_ys_.clear();
+  for (Matches::Points r = matches.AllReversed<PointFeature>(); r; ++r) {
+    if (track_ids_.empty() || track_ids_.back() != r.track()) {
+      track_ids_.push_back(r.track());
+      track_offsets_.push_back(track_images_.size());
+    }
+    track_images_.push_back(r.image());
+    track_xs_.push_back(r.feature()->x());
+    track_ys_.push_back(r.feature()->y());
+  }
+  track_offsets_.push_back(track_images_.size());
+}
+
+int FrozenMatches::ImageIndex(ImageID image) const {
+  std::vector<ImageID>::const_iterator it =
+      std::lower_bound(images_.begin(), images_.end(), image);
+  if (it == images_.end() || *it != image) {
+    return -1;
+  }
+  return it - images_.begin();
+}
+
+FrozenMatches::PointSpan FrozenMatches::InImage(ImageID image) const {
+  PointSpan span = { 0, NULL, NULL, NULL };
+  const int i = ImageIndex(image);
+  if (i >= 0) {
+    span.size = end(i) - begin(i);
+    span.ids = &tracks_[begin(i)];
+    span.xs = &xs_[begin(i)];
+    span.ys = &ys_[begin(i)];
+  }
+  return span;
+}
+
+FrozenMatches::PointSpan FrozenMatches::InTrack(TrackID track) const {
+  PointSpan span = { 0, NULL, NULL, NULL };
+  std::vector<TrackID>::const_iterator it =
+      std::lower_bound(track_ids_.begin(), track_ids_.end(), track);
+  if (it != track_ids_.end() && *it == track) {
+    const int t = it - track_ids_.begin();
+    const int first = track_offsets_[t];
+    span.size = track_offsets_[t + 1] - first;
+    span.ids = &track_images_[first];
+    span.xs = &track_xs_[first];
+    span.ys = &track_ys_[first];
+  }
+  return span;
+}
+
+bool FrozenMatches::Intersect(const vector<ImageID> &images,
+                              vector<TrackID> *tracks,
+                              std::vector<vector<int> > *entries) const {
+  tracks->resize(0);
+  const int num_images = images.size();
+  entries->resize(num_images);
+  std::vector<int> indices(num_images);
+  for (int i = 0; i < num_images; ++i) {
+    (*entries)[i].resize(0);
+    indices[i] = ImageIndex(images[i]);
+    if (indices[i] < 0) {
+      return false;
+    }
+  }
+  if (num_images == 0) {
+    return true;
+  }
+  // The smallest list drives the merge; the others are galloped through,
+  // the smaller ones first since they reject the most candidates.
+  std::vector<int> order(num_images);
+  std::vector<int> sizes(num_images);
+  for (int i = 0; i < num_images; ++i) {
+    order[i] = i;
+    sizes[i] = end(indices[i]) - begin(indices[i]);
+  }
+  std::sort(order.begin(), order.end(), SmallerList(sizes));
+  const TrackID *all_tracks = this->tracks();
+  std::vector<int> positions(num_images);
+  for (int k = 0; k < num_images; ++k) {
+    positions[k] = begin(indices[order[k]]);
+  }
+  const int first = order[0];
+  const int first_end = end(indices[first]);
+  for (int p = positions[0]; p < first_end; ++p) {
+    const TrackID track = all_tracks[p];
+    bool in_all = true;
+    for (int k = 1; k < num_images; ++k) {
+      const int hi = end(indices[order[k]]);
+      positions[k] = Gallop(all_tracks, positions[k], hi, track);
+      if (positions[k] == hi) {
+        return true;
+      }
+      if (all_tracks[positions[k]] != track) {
+        in_all = false;
+        break;
+      }
+    }
+    if (in_all) {
+      tracks->push_back(track);
+      (*entries)[first].push_back(p);
+      for (int k = 1; k < num_images; ++k) {
+        (*entries)[order[k]].push_back(positions[k]);
+      }
+    }
+  }
+  return true;
+}
+
+void FrozenMatches::TracksInAllImages(const vector<ImageID> &images,
+                                      vector<TrackID> *tracks) const {
+  std::vector<vector<int> > entries;
+  Intersect(images, tracks, &entries);
+}
+
+void FrozenMatches::PointMatchMatrices(const vector<ImageID> &images,
+                                       vector<TrackID> *tracks,
+                                       vector<Mat> *xs) const {
+  std::vector<vector<int> > entries;
+  Intersect(images, tracks, &entries);
+  xs->resize(images.size());
+  Mat2X x;
+  for (int i = 0; i < images.size(); ++i) {
+    Gather(entries[i], &x);
+    (*xs)[i] = x;
+  }
+}
+
+void FrozenMatches::TwoViewPointMatchMatrices(ImageID image1,
+                                              ImageID image2,
+                                              vector<Mat> *xs) const {
+  vector<TrackID> tracks;
+  vector<ImageID> images;
+  images.push_back(image1);
+  images.push_back(image2);
+  PointMatchMatrices(images, &tracks, xs);
+}
+
+void FrozenMatches::Gather(const vector<int> &entries, Mat2X *x) const {
+  const int n = entries.size();
+  x->resize(2, n);
+  for (int j = 0; j < n; ++j) {
+    (*x)(0, j) = xs_[entries[j]];
+    (*x)(1, j) = ys_[entries[j]];
+  }
+}
+
+}  // namespace libmv
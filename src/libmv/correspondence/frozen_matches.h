@@ -0,0 +1,122 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_CORRESPONDENCE_FROZEN_MATCHES_H_
+#define LIBMV_CORRESPONDENCE_FROZEN_MATCHES_H_
+
+#include <vector>
+
+#include "libmv/base/vector.h"
+#include "libmv/correspondence/matches.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+// A read-only copy of the point features of a Matches, laid out for the
+// queries of the reconstruction: for every image, its tracks in increasing
+// order and the coordinates of their features in parallel arrays.  Once
+// frozen, the intersections and gathers walk these arrays only; there is no
+// map lookup nor dynamic_cast.  The snapshot does not follow later changes of
+// the Matches, and const methods may be called from several threads.
+class FrozenMatches {
+ public:
+  typedef Matches::ImageID ImageID;
+  typedef Matches::TrackID TrackID;
+
+  // Contiguous point features: feature i has the coordinates (xs[i], ys[i])
+  // and is in the track (or the image) ids[i], in increasing order.
+  struct PointSpan {
+    int size;
+    const int *ids;
+    const float *xs;
+    const float *ys;
+  };
+
+  FrozenMatches() {}
+  explicit FrozenMatches(const Matches &matches) { Freeze(matches); }
+
+  // Replaces the snapshot by the point features of matches.
+  void Freeze(const Matches &matches);
+
+  int NumImages() const { return images_.size(); }
+  int NumFeatures() const { return tracks_.size(); }
+
+  // Index of the image in the snapshot, or -1 if it has no point feature.
+  int ImageIndex(ImageID image) const;
+  ImageID image(int image_index) const { return images_[image_index]; }
+
+  // The features of an image are the entries [begin, end) of the arrays
+  // below, sorted by track.  The arrays are NULL if the snapshot is empty.
+  int begin(int image_index) const { return offsets_[image_index]; }
+  int end(int image_index) const { return offsets_[image_index + 1]; }
+  const TrackID *tracks() const {
+    return tracks_.empty() ? NULL : &tracks_[0];
+  }
+  const float *xs() const { return xs_.empty() ? NULL : &xs_[0]; }
+  const float *ys() const { return ys_.empty() ? NULL : &ys_[0]; }
+
+  // The point features of an image, by track, and of a track, by image; the
+  // counterparts of Matches::InImage and Matches::InTrack.  The spans are
+  // empty for unknown images and tracks.
+  PointSpan InImage(ImageID image) const;
+  PointSpan InTrack(TrackID track) const;
+
+  // Tracks observed in all the images, in increasing order.
+  void TracksInAllImages(const vector<ImageID> &images,
+                         vector<TrackID> *tracks) const;
+
+  // As the free function PointMatchMatrices: xs[i] holds the coordinates in
+  // images[i] of the tracks observed in all the images.
+  void PointMatchMatrices(const vector<ImageID> &images,
+                          vector<TrackID> *tracks,
+                          vector<Mat> *xs) const;
+
+  void TwoViewPointMatchMatrices(ImageID image1,
+                                 ImageID image2,
+                                 vector<Mat> *xs) const;
+
+  // Gathers the coordinates of the given entries of the arrays above into the
+  // columns of x.
+  void Gather(const vector<int> &entries, Mat2X *x) const;
+
+ private:
+  // Intersects the track lists of the images; fills the entries of every
+  // image matching the common tracks.  Returns false if an image is missing.
+  bool Intersect(const vector<ImageID> &images,
+                 vector<TrackID> *tracks,
+                 std::vector<vector<int> > *entries) const;
+
+  std::vector<ImageID> images_;
+  std::vector<int> offsets_;
+  std::vector<TrackID> tracks_;
+  std::vector<float> xs_;
+  std::vector<float> ys_;
+
+  // The same features by track.
+  std::vector<TrackID> track_ids_;
+  std::vector<int> track_offsets_;
+  std::vector<ImageID> track_images_;
+  std::vector<float> track_xs_;
+  std::vector<float> track_ys_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_CORRESPONDENCE_FROZEN_MATCHES_H_
@@ -0,0 +1,201 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdlib>
+#include <vector>
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/frozen_matches.h"
+#include "libmv/correspondence/matches.h"
+#include "testing/testing.h"
+
+namespace {
+
+using namespace libmv;
+
+// A feature which is not a point, that the snapshot must skip.
+struct OtherFeature : public Feature {
+  virtual ~OtherFeature() {}
+};
+
+TEST(FrozenMatches, Layout) {
+  Matches matches;
+  PointFeature p1(1, 10), p2(2, 20), p3(3, 30);
+  OtherFeature other;
+  matches.Insert(4, 2, &p2);
+  matches.Insert(4, 1, &p1);
+  matches.Insert(1, 3, &p3);
+  matches.Insert(1, 5, &other);
+  matches.Insert(9, 5, &other);
+
+  FrozenMatches frozen(matches);
+  ASSERT_EQ(2, frozen.NumImages());
+  ASSERT_EQ(3, frozen.NumFeatures());
+  EXPECT_EQ(0, frozen.ImageIndex(1));
+  EXPECT_EQ(1, frozen.ImageIndex(4));
+  EXPECT_EQ(-1, frozen.ImageIndex(9));
+  EXPECT_EQ(4, frozen.image(1));
+
+  int i = frozen.ImageIndex(4);
+  ASSERT_EQ(2, frozen.end(i) - frozen.begin(i));
+  EXPECT_EQ(1, frozen.tracks()[frozen.begin(i)]);
+  EXPECT_EQ(2, frozen.tracks()[frozen.begin(i) + 1]);
+  EXPECT_EQ(1, frozen.xs()[frozen.begin(i)]);
+  EXPECT_EQ(20, frozen.ys()[frozen.begin(i) + 1]);
+}
+
+TEST(FrozenMatches, Empty) {
+  Matches matches;
+  FrozenMatches frozen(matches);
+  EXPECT_EQ(0, frozen.NumImages());
+  EXPECT_EQ(0, frozen.NumFeatures());
+  EXPECT_TRUE(frozen.tracks() == NULL);
+  EXPECT_TRUE(frozen.xs() == NULL);
+  EXPECT_TRUE(frozen.ys() == NULL);
+}
+
+TEST(FrozenMatches, Spans) {
+  Matches matches;
+  PointFeature p1(1, 10), p2(2, 20), p3(3, 30);
+  matches.Insert(4, 2, &p2);
+  matches.Insert(4, 1, &p1);
+  matches.Insert(1, 2, &p3);
+
+  FrozenMatches frozen(matches);
+  FrozenMatches::PointSpan image = frozen.InImage(4);
+  ASSERT_EQ(2, image.size);
+  EXPECT_EQ(1, image.ids[0]);
+  EXPECT_EQ(2, image.ids[1]);
+  EXPECT_EQ(1, image.xs[0]);
+  EXPECT_EQ(20, image.ys[1]);
+
+  FrozenMatches::PointSpan track = frozen.InTrack(2);
+  ASSERT_EQ(2, track.size);
+  EXPECT_EQ(1, track.ids[0]);
+  EXPECT_EQ(4, track.ids[1]);
+  EXPECT_EQ(3, track.xs[0]);
+  EXPECT_EQ(20, track.ys[1]);
+
+  EXPECT_EQ(0, frozen.InImage(2).size);
+  EXPECT_EQ(0, frozen.InTrack(3).size);
+}
+
+TEST(FrozenMatches, PointMatchMatrices) {
+  Matches matches;
+  matches.Insert(1, 1, new PointFeature( 1,  10));
+  matches.Insert(1, 2, new PointFeature( 2,  20));
+  matches.Insert(1, 3, new PointFeature( 3,  30));
+
+  matches.Insert(4, 1, new PointFeature( 4,  40));
+  matches.Insert(4, 2, new PointFeature( 5,  50));
+  matches.Insert(4, 3, new PointFeature( 6,  60));
+  matches.Insert(4, 6, new PointFeature( 7,  70));
+
+  matches.Insert(7, 2, new PointFeature( 8,  80));
+  matches.Insert(7, 3, new PointFeature( 9,  90));
+  matches.Insert(7, 6, new PointFeature(10, 100));
+
+  vector<Mat> xse(3);
+  xse[0].resize(2, 2); xse[0] <<  2,  3,
+                                 20, 30;
+  xse[1].resize(2, 2); xse[1] <<  5,  6,
+                                 50, 60;
+  xse[2].resize(2, 2); xse[2] <<  8,  9,
+                                 80, 90;
+
+  vector<Matches::ImageID> images;
+  images.push_back(1);
+  images.push_back(4);
+  images.push_back(7);
+  vector<Matches::TrackID> tracks;
+  vector<Mat> xs;
+  FrozenMatches frozen(matches);
+  frozen.PointMatchMatrices(images, &tracks, &xs);
+
+  ASSERT_EQ(2, tracks.size());
+  EXPECT_EQ(2, tracks[0]);
+  EXPECT_EQ(3, tracks[1]);
+  ASSERT_EQ(3, xs.size());
+  for (int i = 0; i < xse.size(); ++i) {
+    EXPECT_MATRIX_EQ(xse[i], xs[i]);
+  }
+}
+
+TEST(FrozenMatches, MissingImage) {
+  Matches matches;
+  PointFeature p(1, 1);
+  matches.Insert(1, 1, &p);
+  matches.Insert(2, 1, &p);
+
+  FrozenMatches frozen(matches);
+  vector<Mat> xs;
+  frozen.TwoViewPointMatchMatrices(1, 3, &xs);
+  ASSERT_EQ(2, xs.size());
+  EXPECT_EQ(0, xs[0].cols());
+  EXPECT_EQ(0, xs[1].cols());
+
+  frozen.TwoViewPointMatchMatrices(2, 1, &xs);
+  ASSERT_EQ(1, xs[0].cols());
+}
+
+// Compares the galloping intersection with the set intersection of Matches on
+// lists of very different densities.
+TEST(FrozenMatches, SameAsMatches) {
+  srand(5);
+  const int kNumImages = 6;
+  const int kNumTracks = 2000;
+  std::vector<PointFeature> features(kNumImages * kNumTracks);
+  Matches matches;
+  for (int i = 0; i < kNumImages; ++i) {
+    // Image i sees about one track in 2^i.
+    for (int t = 0; t < kNumTracks; ++t) {
+      if (rand() % (1 << i) == 0) {
+        PointFeature &f = features[i * kNumTracks + t];
+        f.coords << rand() % 640, rand() % 480;
+        matches.Insert(i, t, &f);
+      }
+    }
+  }
+  FrozenMatches frozen(matches);
+  for (int a = 0; a < kNumImages; ++a) {
+    for (int b = 0; b < kNumImages; ++b) {
+      vector<Matches::ImageID> images;
+      images.push_back(a);
+      images.push_back(b);
+      images.push_back((a + b) % kNumImages);
+
+      vector<Matches::TrackID> tracks, expected_tracks;
+      vector<Mat> xs, expected_xs;
+      PointMatchMatrices(matches, images, &expected_tracks, &expected_xs);
+      frozen.PointMatchMatrices(images, &tracks, &xs);
+
+      ASSERT_EQ(expected_tracks.size(), tracks.size());
+      for (int i = 0; i < tracks.size(); ++i) {
+        EXPECT_EQ(expected_tracks[i], tracks[i]);
+      }
+      ASSERT_EQ(expected_xs.size(), xs.size());
+      for (int i = 0; i < xs.size(); ++i) {
+        EXPECT_MATRIX_EQ(expected_xs[i], xs[i]);
+      }
+    }
+  }
+}
+
+}  // namespace
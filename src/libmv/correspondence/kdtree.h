@@ -26,13 +26,16 @@
 #include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <cstdio>
+#include <limits>
 
 #include "libmv/numeric/numeric.h"
 
 namespace libmv {
 
-// A simple priority cue used to sort the nodes to explore for A-knn.  Low
-// priority values are popped first.
+// A binary min-heap used to sort the nodes to explore for A-knn.  Low
+// priority values are popped first.  The storage is kept between uses (see
+// Clear) so that a search loop does not allocate once it has warmed up.
 // TODO(pau): if we are going to use this anywhere else, put it on a separate
 // file.
 template<typename Value, typename Priority>
@@ -41,27 +44,58 @@ class PriorityQueue {
   struct Node {
     Value value;
     Priority priority;
+    Node() {}
     Node(Value v, Priority p) : value(v), priority(p) {}
-    bool operator<(const Node &b) {
-      return priority > b.priority;
-    }
   };
 
   bool IsEmpty() const { return nodes_.empty(); }
   size_t Size() const { return nodes_.size(); }
+  void Clear() { nodes_.clear(); }
+  void Reserve(size_t n) { nodes_.reserve(n); }
+
+  Value Top() const { return nodes_.front().value; }
+  Priority TopPriority() const { return nodes_.front().priority; }
 
-  Value Top() { return nodes_.front().value; }
-  Priority TopPriority() { return nodes_.front().priority; }
-  
   void Push(Value v, Priority p) {
-    nodes_.push_back(Node(v,p));
-    std::push_heap(nodes_.begin(), nodes_.end());
+    // Sift the hole up from the last position.
+    size_t i = nodes_.size();
+    nodes_.push_back(Node());
+    while (i > 0) {
+      size_t parent = (i - 1) / 2;
+      if (!(p < nodes_[parent].priority)) {
+        break;
+      }
+      nodes_[i] = nodes_[parent];
+      i = parent;
+    }
+    nodes_[i] = Node(v, p);
   }
 
   Value Pop() {
     Value top = Top();
-    std::pop_heap(nodes_.begin(), nodes_.end());
+    Node last = nodes_.back();
     nodes_.pop_back();
+    size_t n = nodes_.size();
+    if (n > 0) {
+      // Sift the hole left by the top down, then drop the last node into it.
+      size_t i = 0;
+      for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) {
+          break;
+        }
+        if (child + 1 < n &&
+            nodes_[child + 1].priority < nodes_[child].priority) {
+          ++child;
+        }
+        if (!(nodes_[child].priority < last.priority)) {
+          break;
+        }
+        nodes_[i] = nodes_[child];
+        i = child;
+      }
+      nodes_[i] = last;
+    }
     return top;
   }
 
@@ -74,7 +108,10 @@ class PriorityQueue {
 template<typename Scalar, typename Id>
 class KnnSortedList {
  public:
-  KnnSortedList(int k) : k_(k) {}
+  KnnSortedList(int k) : k_(k) {
+    ids_.reserve(k);
+    distances_.reserve(k);
+  }
 
   // Adds a point into the sorted list of neighbors
   void AddNeighbor(const Id &p, Scalar distance) {
@@ -84,6 +121,8 @@ class KnnSortedList {
     } else if (distance < distances_.back()) {
       ids_.back() = p;
       distances_.back() = distance;
+    } else {
+      return;
     }
 
     int i = Size() - 2;
@@ -94,12 +133,19 @@ class KnnSortedList {
     }
   }
 
-  int K() { return k_; }
-  int Size() { return ids_.size(); }
-  bool Full() { return Size() >= K(); }
-  Id Neighbor(int i) { return ids_[i]; }
-  Scalar Distance(int i) { return distances_[i]; }
-  Scalar FarthestDistance() { return Distance(Size() - 1); }
+  // Empties the list, keeping its capacity, so it can be reused for a new
+  // query.
+  void Clear() {
+    ids_.clear();
+    distances_.clear();
+  }
+
+  int K() const { return k_; }
+  int Size() const { return ids_.size(); }
+  bool Full() const { return Size() >= K(); }
+  Id Neighbor(int i) const { return ids_[i]; }
+  Scalar Distance(int i) const { return distances_[i]; }
+  Scalar FarthestDistance() const { return Distance(Size() - 1); }
 
  private:
   int k_;
@@ -109,37 +155,42 @@ class KnnSortedList {
 
 
 // A simple Kd-tree for fast approximate nearest neighbor search.
+//
+// The points given with AddPoint are copied at Build time into a single
+// contiguous array, reordered so that the points of every leaf are adjacent in
+// memory.  The caller's data is not referenced once the tree is built.  The
+// nodes of each level are built in parallel (OpenMP) and batched queries are
+// spread over all the cores; the results do not depend on the number of
+// threads.
 template <typename Scalar, typename Id = int>
 class KdTree {
  public:
   typedef KnnSortedList<Scalar, Id> SearchResults;
  private:
-  struct Point {
-    Point(const Scalar *d, Id i) : data(d), id(i) {}
-    Scalar operator[](int i) const { return data[i]; }
-    const Scalar *data;
-    Id id;
-  };
-
   struct KdNode {
     int axis;
     Scalar cut_value;
     Scalar min_value;
     Scalar max_value;
-    Point *begin;
-    Point *end;
+    // Range of the node points in points_ (and in the build permutation).
+    int begin;
+    int end;
   };
 
+  // Orders point indices along one axis of the caller data.
   struct AxisComparison {
-    AxisComparison(int axis) : axis_(axis) {}
-    bool operator()(const Point &x, const Point &y) const {
-      return x[axis_] < y[axis_];
+    AxisComparison(const std::vector<const Scalar *> &data, int axis)
+        : data_(data), axis_(axis) {}
+    bool operator()(int x, int y) const {
+      return data_[x][axis_] < data_[y][axis_];
     }
    private:
+    const std::vector<const Scalar *> &data_;
     int axis_;
   };
 
  public:
+  KdTree() : num_dims_(0), num_levels_(0) {}
 
   void SetDimensions(int num_dims) {
     num_dims_ = num_dims;
@@ -151,11 +202,13 @@ class KdTree {
    *  \param data A pointer to the raw point data.
    *  \param id   The id of the point.  Used to identify the search results.
    *
-   * Points can not be added once the tree is built.
+   * Points can not be added once the tree is built.  The data must stay valid
+   * until Build is called.
    */
   void AddPoint(const Scalar *data, Id id) {
     assert(nodes_.size() == 0);
-    points_.push_back(Point(data, id));
+    input_points_.push_back(data);
+    ids_.push_back(id);
   }
 
   /**
@@ -163,22 +216,59 @@ class KdTree {
    * AddPoint.
    */
   void Build(int max_levels) {
+    int num_points = ids_.size();
+    if (num_points == 0) {
+      num_levels_ = 0;
+      return;
+    }
     // Compute the number of levels such that any leaf has at least 1 point.
     // This is num_leafs <= num_points, with num_leafs = 2**(num_levels - 1).
-    int l = int(floor(log((double)points_.size()) / log(2.))) + 1;
+    int l = int(floor(log((double)num_points) / log(2.))) + 1;
     num_levels_ = std::min(l, max_levels);
 
     // Allocate room for all the nodes at once.
     nodes_.resize((1 << num_levels_) - 1);
 
-    // Recursively create the nodes.
-    CreateNode(0, &points_.front(), &points_.back() + 1);
+    // Create the nodes top-down.  The nodes of a level own disjoint ranges of
+    // the permutation, so they can be split concurrently.
+    std::vector<int> order(num_points);
+    for (int i = 0; i < num_points; ++i) {
+      order[i] = i;
+    }
+    nodes_[0].begin = 0;
+    nodes_[0].end = num_points;
+    for (int level = 0; level < num_levels_; ++level) {
+      int first = (1 << level) - 1;
+      int last = (1 << (level + 1)) - 1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) if (last - first > 1)
+#endif
+      for (int i = first; i < last; ++i) {
+        CreateNode(i, &order);
+      }
+    }
+
+    // Copy the points in leaf order so that each leaf is a contiguous block.
+    points_.resize(num_points * num_dims_);
+    std::vector<Id> ids(num_points);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (num_points > 4096)
+#endif
+    for (int i = 0; i < num_points; ++i) {
+      std::copy(input_points_[order[i]],
+                input_points_[order[i]] + num_dims_,
+                &points_[i * num_dims_]);
+      ids[i] = ids_[order[i]];
+    }
+    ids_.swap(ids);
+    std::vector<const Scalar *>().swap(input_points_);
   }
 
   int NumNodes() const { return nodes_.size(); }
   int NumLeafs() const { return (NumNodes() + 1) / 2; }
   int NumLevels() const { return num_levels_; }
   int NumDimension() const { return num_dims_; }
+  int NumPoints() const { return ids_.size(); }
 
   void PrintNodes() const {
     for (int i = 0; i < nodes_.size(); ++i) {
@@ -198,6 +288,9 @@ class KdTree {
                                              Scalar *distance) const {
     SearchResults knn(1);
     int leafs = ApproximateKnnBestBinFirst(query, max_leafs, &knn);
+    if (knn.Size() == 0) {
+      return leafs;
+    }
     *nearest_neigbor_id = knn.Neighbor(0);
     *distance = knn.Distance(0);
     return leafs;
@@ -208,55 +301,124 @@ class KdTree {
    * It stops searching when the knn are found, or when it has explored
    * max_leafs leafs.  Returns the number of explored leafs.
    */
+  int ApproximateKnnBestBinFirst(const Scalar *query,
+                                 int max_leafs,
+                                 SearchResults *neighbors) const {
+    PriorityQueue<int, Scalar> queue;
+    return ApproximateKnnBestBinFirst(query, max_leafs, 0, &queue, neighbors);
+  }
+
+  /**
+   * Same as above, but the search also stops once max_checks points have been
+   * compared with the query (0 means no limit).  The queue is only used as
+   * scratch space; passing the same one to consecutive searches avoids
+   * reallocating it.
+   */
   // TODO(pau): put a reference to Mount's paper.
   int ApproximateKnnBestBinFirst(const Scalar *query,
                                  int max_leafs,
+                                 int max_checks,
+                                 PriorityQueue<int, Scalar> *queue,
                                  SearchResults *neighbors) const {
+    if (nodes_.empty()) {
+      return 0;
+    }
     int num_explored_leafs = 0;
-    PriorityQueue<int, Scalar> queue;
-    queue.Push(0, 0); // Push root node.
+    int num_checks = 0;
+    queue->Clear();
+    queue->Push(0, 0); // Push root node.
 
-    while (!queue.IsEmpty() && num_explored_leafs < max_leafs) {
+    while (!queue->IsEmpty() && num_explored_leafs < max_leafs &&
+           (max_checks <= 0 || num_checks < max_checks)) {
       // Stop if best node is farther than worst neighbor found so far.
-      float old_distance = queue.TopPriority();
+      Scalar old_distance = queue->TopPriority();
       if (neighbors->Full() && old_distance >= neighbors->FarthestDistance()) {
         break;
       }
 
-      int i = queue.Pop();
+      int i = queue->Pop();
 
       // Go down to leaf.
       while (!IsLeaf(i)) {
-        int axis = nodes_[i].axis;
-        Scalar cut_value = nodes_[i].cut_value;
-        Scalar min_value = nodes_[i].min_value;
-        Scalar max_value = nodes_[i].max_value;
+        const KdNode &node = nodes_[i];
+        int axis = node.axis;
 
-        Scalar new_offset = query[axis] - cut_value;
+        Scalar new_offset = query[axis] - node.cut_value;
         if (new_offset < 0) {
-          Scalar old_offset = std::min(Scalar(0.0), query[axis] - min_value);
+          Scalar old_offset = std::min(Scalar(0.0),
+                                       query[axis] - node.min_value);
           Scalar new_distance = old_distance - old_offset * old_offset
                               + new_offset * new_offset;
-          queue.Push(RightChild(i), new_distance);
+          queue->Push(RightChild(i), new_distance);
           i = LeftChild(i);
         } else {
-          Scalar old_offset = std::max(Scalar(0.0), query[axis] - max_value);
+          Scalar old_offset = std::max(Scalar(0.0),
+                                       query[axis] - node.max_value);
           Scalar new_distance = old_distance - old_offset * old_offset
                               + new_offset * new_offset;
-          queue.Push(LeftChild(i), new_distance);
+          queue->Push(LeftChild(i), new_distance);
           i = RightChild(i);
         }
       }
-      // Explore leaf.
-      for (Point *p = nodes_[i].begin; p < nodes_[i].end; ++p) {
-        Scalar distance = L2Distance2(p->data, query);
-        neighbors->AddNeighbor(p->id, distance);
+      // Explore leaf.  Its points are contiguous in points_.
+      const Scalar *p = &points_[nodes_[i].begin * num_dims_];
+      for (int j = nodes_[i].begin; j < nodes_[i].end; ++j, p += num_dims_) {
+        Scalar distance = L2Distance2(p, query);
+        neighbors->AddNeighbor(ids_[j], distance);
       }
+      num_checks += nodes_[i].end - nodes_[i].begin;
       num_explored_leafs++;
     }
     return num_explored_leafs;
   }
 
+  /**
+   * Finds the k nearest neighbors of a batch of queries.
+   *
+   *  \param queries     num_queries rows of NumDimension() values.
+   *  \param ids         Output, num_queries * k ids (row i for query i).
+   *  \param distances   Output, num_queries * k squared distances.
+   *
+   * Queries are spread over all the threads.  Each query writes its own
+   * output row, so the result is the same as running them one by one.  When
+   * less than k neighbors are found the remaining slots are set to Id(-1) and
+   * the largest Scalar.
+   */
+  void ApproximateKnnBestBinFirstBatch(const Scalar *queries,
+                                       int num_queries,
+                                       int k,
+                                       int max_leafs,
+                                       int max_checks,
+                                       Id *ids,
+                                       Scalar *distances) const {
+#ifdef _OPENMP
+#pragma omp parallel if (num_queries > 64)
+#endif
+    {
+      // Per thread scratch space, reused for all the queries of the thread.
+      PriorityQueue<int, Scalar> queue;
+      queue.Reserve(2 * num_levels_ + 16);
+      SearchResults knn(k);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 32)
+#endif
+      for (int q = 0; q < num_queries; ++q) {
+        knn.Clear();
+        ApproximateKnnBestBinFirst(queries + q * num_dims_, max_leafs,
+                                   max_checks, &queue, &knn);
+        for (int j = 0; j < k; ++j) {
+          if (j < knn.Size()) {
+            ids[q * k + j] = knn.Neighbor(j);
+            distances[q * k + j] = knn.Distance(j);
+          } else {
+            ids[q * k + j] = Id(-1);
+            distances[q * k + j] = std::numeric_limits<Scalar>::max();
+          }
+        }
+      }
+    }
+  }
+
  private:
   int LeftChild(int i) const {
     return 2 * i + 1;
@@ -271,34 +433,37 @@ class KdTree {
     return i >= NumNodes() / 2; // Note NumNodes() is odd.
   }
 
-  void CreateNode(int i, Point *begin, Point *end) {
-    int num_points = end - begin;
-    assert(num_points > 0);
-
-    // Create the node.
+  // Splits node i, whose range has already been set by its parent, and sets
+  // the ranges of its children.
+  void CreateNode(int i, std::vector<int> *order) {
     KdNode &node = nodes_[i];
-    node.begin = begin;
-    node.end = end;
+    int num_points = node.end - node.begin;
+    assert(num_points > 0);
 
     if (!IsLeaf(i)) {
       assert(num_points >= 2);
+      int *begin = &(*order)[0] + node.begin;
+      int *end = &(*order)[0] + node.end;
 
       // Partition points.
       node.axis = MoreVariantAxis(begin, end, &node.min_value, &node.max_value);
 
-      AxisComparison comp(node.axis);
-      Point *pivot = begin + num_points / 2;
+      AxisComparison comp(input_points_, node.axis);
+      int *pivot = begin + num_points / 2;
       std::nth_element(begin, pivot, end, comp);
-      node.cut_value = (*pivot)[node.axis];
-
-      // Create sub-trees.
-      CreateNode(LeftChild(i), begin, pivot);
-      CreateNode(RightChild(i), pivot, end);
+      node.cut_value = input_points_[*pivot][node.axis];
+
+      // Sub-trees are created by the next level.
+      int middle = node.begin + num_points / 2;
+      nodes_[LeftChild(i)].begin = node.begin;
+      nodes_[LeftChild(i)].end = middle;
+      nodes_[RightChild(i)].begin = middle;
+      nodes_[RightChild(i)].end = node.end;
     }
   }
 
-  int MoreVariantAxis(Point *begin, Point *end,
-                      Scalar *min_val, Scalar *max_val) {
+  int MoreVariantAxis(const int *begin, const int *end,
+                      Scalar *min_val, Scalar *max_val) const {
 
     // Compute variances.
     Vec mean = Vec::Zero(num_dims_);
@@ -307,9 +472,10 @@ class KdTree {
                                    std::numeric_limits<Scalar>::max());
     std::vector<Scalar> max_values(num_dims_,
                                    -std::numeric_limits<Scalar>::max());
-    for (Point *p = begin; p < end; ++p) {
+    for (const int *p = begin; p < end; ++p) {
+      const Scalar *point = input_points_[*p];
       for (int i = 0; i < num_dims_; ++i) {
-        Scalar x = (*p)[i];
+        Scalar x = point[i];
         mean[i] += x;
         mean2[i] += x * x;
         if (x < min_values[i]) min_values[i] = x;
@@ -341,7 +507,12 @@ class KdTree {
 
  private:
   std::vector<KdNode> nodes_;
-  std::vector<Point> points_;
+  // Caller data, only used until the tree is built.
+  std::vector<const Scalar *> input_points_;
+  // Point coordinates, num_dims_ per point, in leaf order.
+  std::vector<Scalar> points_;
+  // Point ids, in the same order as points_.
+  std::vector<Id> ids_;
   int num_dims_;
   int num_levels_;
 };
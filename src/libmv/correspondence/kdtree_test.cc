@@ -187,4 +187,115 @@ TEST(KdTree, ApproximateKnnBestBinFirstBig) {
                              // 13 has been found by testing the code itself :(
 }
 
+TEST(PriorityQueue, PopInterleavedWithPush) {
+  PriorityQueue<int, float> queue;
+  queue.Push(5, 5.0f);
+  queue.Push(3, 3.0f);
+  EXPECT_EQ(3, queue.Pop());
+  queue.Push(1, 1.0f);
+  queue.Push(4, 4.0f);
+  EXPECT_EQ(1, queue.Pop());
+  EXPECT_EQ(4, queue.Pop());
+  EXPECT_EQ(5, queue.Pop());
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(KdTree, DataIsCopiedAtBuild) {
+  Vec2 points[4];
+  points[0] << 1, 1;
+  points[1] << 1, 2;
+  points[2] << 2, 1;
+  points[3] << 2, 2;
+
+  KdTree<double> tree;
+  tree.SetDimensions(2);
+  for (int i = 0; i < 4; ++i) tree.AddPoint(points[i].data(), i);
+  tree.Build(10);
+  EXPECT_EQ(4, tree.NumPoints());
+
+  // The tree must not look at the original points anymore.
+  for (int i = 0; i < 4; ++i) points[i] << 100, 100;
+
+  Vec2 query;
+  query << 2.1, 0.9;
+  int nni;
+  double distance;
+  tree.ApproximateNearestNeighborBestBinFirst(query.data(), 1000, &nni,
+                                              &distance);
+  EXPECT_EQ(2, nni);
+  EXPECT_NEAR(0.1 * 0.1 + 0.1 * 0.1, distance, 1e-10);
+}
+
+TEST(KdTree, ApproximateKnnBestBinFirstBatch) {
+  const int N = 20;
+  Vec2 points[N * N];
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < N; ++j) {
+      points[i * N + j] << i, j;
+    }
+  }
+  KdTree<double> tree;
+  tree.SetDimensions(2);
+  for (int i = 0; i < N * N; ++i) tree.AddPoint(points[i].data(), i);
+  tree.Build(10);
+
+  // Query slightly off every grid point; the nearest is the grid point itself.
+  Mat queries(2, N * N);
+  for (int i = 0; i < N * N; ++i) {
+    queries.col(i) = points[i] + Vec2(0.1, 0.2);
+  }
+  const int k = 2;
+  std::vector<int> ids(N * N * k);
+  std::vector<double> distances(N * N * k);
+  tree.ApproximateKnnBestBinFirstBatch(queries.data(), N * N, k,
+                                       tree.NumLeafs(), 0,
+                                       &ids[0], &distances[0]);
+  for (int i = 0; i < N * N; ++i) {
+    EXPECT_EQ(i, ids[i * k]);
+    EXPECT_NEAR(0.1 * 0.1 + 0.2 * 0.2, distances[i * k], 1e-10);
+    EXPECT_LE(distances[i * k], distances[i * k + 1]);
+
+    // The batch gives the same answer as a single query.
+    KdTree<double>::SearchResults knn(k);
+    tree.ApproximateKnnBestBinFirst(queries.col(i).data(), tree.NumLeafs(),
+                                    &knn);
+    EXPECT_EQ(knn.Neighbor(1), ids[i * k + 1]);
+  }
+}
+
+TEST(KdTree, MaxChecksBudget) {
+  const int N = 20;
+  Vec2 points[N * N];
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < N; ++j) {
+      points[i * N + j] << i, j;
+    }
+  }
+  KdTree<double> tree;
+  tree.SetDimensions(2);
+  for (int i = 0; i < N * N; ++i) tree.AddPoint(points[i].data(), i);
+  tree.Build(3);
+
+  // With 4 leafs of 100 points, a budget of one point stops after one leaf.
+  Vec2 query;
+  query << 9.5, 9.5;
+  PriorityQueue<int, double> queue;
+  KdTree<double>::SearchResults knn(1);
+  int num_explored_leafs =
+      tree.ApproximateKnnBestBinFirst(query.data(), 1000, 1, &queue, &knn);
+  EXPECT_EQ(1, num_explored_leafs);
+  EXPECT_EQ(1, knn.Size());
+}
+
+TEST(KdTree, EmptyTree) {
+  KdTree<double> tree;
+  tree.SetDimensions(2);
+  tree.Build(10);
+  Vec2 query;
+  query << 1, 1;
+  KdTree<double>::SearchResults knn(1);
+  EXPECT_EQ(0, tree.ApproximateKnnBestBinFirst(query.data(), 1000, &knn));
+  EXPECT_EQ(0, knn.Size());
+}
+
 }  // namespace
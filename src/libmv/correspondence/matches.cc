@@ -23,6 +23,19 @@
 
 namespace libmv {
 
+int KindOfFeature(const Feature *feature) {
+  if (!feature) {
+    return 0;
+  }
+  if (dynamic_cast<const PointFeature *>(feature)) {
+    return POINT_FEATURE_KIND;
+  }
+  if (dynamic_cast<const LineFeature *>(feature)) {
+    return LINE_FEATURE_KIND;
+  }
+  return OTHER_FEATURE_KIND;
+}
+
 Matches::~Matches() {}
 
 void DeleteMatchFeatures(Matches *matches) {
@@ -33,15 +33,46 @@
 
 namespace libmv {
 
-class Feature;
-class PointFeature;
-class LineFeature;
+// The kind of a feature, found once when it is inserted in a Matches so that
+// the typed iterators filter the edges without a dynamic_cast.  The kinds are
+// bits, and a NULL feature has no kind.
+enum FeatureKind {
+  OTHER_FEATURE_KIND = 1,
+  POINT_FEATURE_KIND = 2,
+  LINE_FEATURE_KIND  = 4
+};
+
+int KindOfFeature(const Feature *feature);
+
+// The kinds of features an iterator on FeatureT accepts.  Other types than
+// these have no mask and are filtered with a dynamic_cast.
+template<typename FeatureT>
+struct FeatureKindMask { static const int kMask = 0; };
+template<>
+struct FeatureKindMask<Feature> {
+  static const int kMask =
+      OTHER_FEATURE_KIND | POINT_FEATURE_KIND | LINE_FEATURE_KIND;
+};
+template<>
+struct FeatureKindMask<PointFeature> {
+  static const int kMask = POINT_FEATURE_KIND;
+};
+template<>
+struct FeatureKindMask<LineFeature> {
+  static const int kMask = LINE_FEATURE_KIND;
+};
 
 class Matches {
  public:
   typedef int ImageID;
   typedef int TrackID;
-  typedef BipartiteGraph<int, const Feature *> Graph;
+
+  // A feature with its kind.
+  struct Edge {
+    const Feature *feature;
+    int kind;
+  };
+  typedef BipartiteGraph<int, Edge> Graph;
 
   ~Matches();
 
@@ -53,7 +84,7 @@ class Matches {
     ImageID           image()    const { return r_.left();  }
     TrackID           track()    const { return r_.right(); }
     const FeatureT *feature()  const {
-      return static_cast<const FeatureT *>(r_.edge());
+      return static_cast<const FeatureT *>(r_.edge().feature);
     }
     operator bool() const { return r_; }
     void operator++() { ++r_; Skip(); }
@@ -61,7 +92,12 @@ class Matches {
 
    private:
     void Skip() {
-      while (r_ && !dynamic_cast<const FeatureT *>(r_.edge())) ++r_;
+      const int mask = FeatureKindMask<FeatureT>::kMask;
+      if (mask) {
+        while (r_ && !(r_.edge().kind & mask)) ++r_;
+      } else {
+        while (r_ && !dynamic_cast<const FeatureT *>(r_.edge().feature)) ++r_;
+      }
     }
     Graph::Range r_;
   };
@@ -86,7 +122,7 @@ class Matches {
 
   // Does not take ownership of feature.
   void Insert(ImageID image, TrackID track, const Feature *feature) {
-    graph_.Insert(image, track, feature);
+    InsertEdge(image, track, feature);
     images_.insert(image);
     tracks_.insert(track);
   }
@@ -132,7 +168,7 @@ class Matches {
         const Feature * feature = matches.Get(*iter_image, *iter_track);
         image_id = new_image_ids[*iter_image];
         track_id = new_track_ids[*iter_track];
-        graph_.Insert(image_id, track_id, feature);
+        InsertEdge(image_id, track_id, feature);
       }
     }
   }
@@ -159,14 +195,14 @@ class Matches {
           tracks_.insert(*iter_track);
         }      
         const Feature * feature = matches.Get(*iter_image, *iter_track);
-        graph_.Insert(*iter_image, *iter_track, feature);
+        InsertEdge(*iter_image, *iter_track, feature);
       }
     }
   }
   
   const Feature *Get(ImageID image, TrackID track) const {
-    const Feature *const *f = graph_.Edge(image, track);
-    return f ? *f : NULL;
+    const Edge *edge = graph_.Edge(image, track);
+    return edge ? edge->feature : NULL;
   }
   
   ImageID GetMaxImageID() const {
@@ -208,6 +244,13 @@ class Matches {
   size_t NumImages() const { return images_.size(); }
 
  private:
+  void InsertEdge(ImageID image, TrackID track, const Feature *feature) {
+    Edge edge;
+    edge.feature = feature;
+    edge.kind = KindOfFeature(feature);
+    graph_.Insert(image, track, edge);
+  }
+
   Graph graph_;
   std::set<ImageID> images_;
   std::set<TrackID> tracks_;
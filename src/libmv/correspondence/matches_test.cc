@@ -63,6 +63,46 @@ TEST(Matches, Views) {
   EXPECT_EQ(2,  r.track());
 }
 
+// A point feature of a derived type is iterated as a point.
+struct DerivedPoint : public PointFeature {
+  virtual ~DerivedPoint() {}
+};
+
+TEST(Matches, KindViews) {
+  Matches matches;
+  PointFeature point;
+  DerivedPoint derived;
+  SiblingTestFeature sibling;
+  matches.Insert(1, 1, &sibling);
+  matches.Insert(1, 2, &point);
+  matches.Insert(1, 3, NULL);
+  matches.Insert(1, 4, &derived);
+  matches.Insert(2, 2, &sibling);
+
+  Matches::Points p = matches.InImage<PointFeature>(1);
+  ASSERT_TRUE(p);
+  EXPECT_EQ(2, p.track());
+  EXPECT_EQ(&point, p.feature());
+  ++p;
+  ASSERT_TRUE(p);
+  EXPECT_EQ(4, p.track());
+  EXPECT_EQ(&derived, p.feature());
+  ++p;
+  EXPECT_FALSE(p);
+
+  int num_features = 0;
+  for (Matches::Features<Feature> f = matches.All<Feature>(); f; ++f) {
+    num_features++;
+  }
+  EXPECT_EQ(4, num_features);
+
+  EXPECT_FALSE(matches.InTrack<PointFeature>(1));
+  EXPECT_FALSE(matches.All<LineFeature>());
+  Matches::Features<DerivedPoint> d = matches.All<DerivedPoint>();
+  ASSERT_TRUE(d);
+  EXPECT_EQ(4, d.track());
+}
+
 TEST(Matches, InsertMatches) {
   Matches matches_insert;
   matches_insert.Insert(1, 1, new PointFeature( 1,  10));
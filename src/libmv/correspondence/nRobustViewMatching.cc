@@ -29,6 +29,7 @@
 #include "libmv/image/image.h"
 #include "libmv/image/image_io.h"
 #include "libmv/image/image_converter.h"
+#include "libmv/logging/tracing.h"
 #include "libmv/multiview/robust_fundamental.h"
 
 using namespace libmv;
@@ -74,10 +75,17 @@ bool nRobustViewMatching::computeData(const string & filename)
     Image im(img_array);
 
     libmv::vector<libmv::Feature *> features;
-    m_pDetector->Detect( im, &features, NULL);
+    {
+      LIBMV_TRACE_SCOPE("detect");
+      m_pDetector->Detect( im, &features, NULL);
+    }
+    LIBMV_TRACE_COUNTER("detect.features", features.size());
 
     libmv::vector<descriptor::Descriptor *> descriptors;
-    m_pDescriber->Describe(features, im, NULL, &descriptors);
+    {
+      LIBMV_TRACE_SCOPE("describe");
+      m_pDescriber->Describe(features, im, NULL, &descriptors);
+    }
 
     // Copy data.
     m_ViewData.insert( make_pair(filename,FeatureSet()) );
@@ -18,50 +18,115 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
+#include <set>
+
 #include "tracker.h"
-#include "libmv/base/vector_utils.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/logging/tracing.h"
 
 using namespace libmv;
 using namespace tracker;
  
+namespace {
+
+// Ratio of the distances to the first and the second nearest neighbors
+// under which a match is kept, as in FindCorrespondences.
+const float kStreamMatchRatio = 0.8f;
+
+// Copies the rows of the descriptors of a feature set in a contiguous array.
+void DescriptorRows(const FeatureSet &feature_set, std::vector<float> *rows) {
+  const int num_features = feature_set.features.size();
+  const int dimension =
+      num_features ? feature_set.features[0].descriptor.coords.size() : 0;
+  rows->resize(num_features * dimension);
+  for (int i = 0; i < num_features; ++i) {
+    const Vecf &coords = feature_set.features[i].descriptor.coords;
+    std::copy(coords.data(), coords.data() + dimension,
+              rows->begin() + i * dimension);
+  }
+}
+
+// Copies the described features in feature_set; the features without a
+// descriptor (e.g. on the border of the image) are skipped.
+void CopyDescribedFeatures(const vector<Feature *> &features,
+                           const vector<descriptor::Descriptor *> &descriptors,
+                           FeatureSet *feature_set) {
+  feature_set->features.clear();
+  feature_set->features.reserve(descriptors.size());
+  for (size_t i = 0; i < descriptors.size(); i++) {
+    if (!descriptors[i]) {
+      continue;
+    }
+    feature_set->features.push_back(KeypointFeature());
+    KeypointFeature& feature = feature_set->features.back();
+    feature.descriptor = *(descriptor::VecfDescriptor*) descriptors[i];
+    *(PointFeature*)(&feature) = *(PointFeature*)features[i];
+  }
+}
+
+// Matches the num_queries rows of queries to the rows indexed by matcher.
+void MatchAgainstIndex(correspondence::ArrayMatcher<float> *matcher,
+                       const std::vector<float> &queries,
+                       int num_queries,
+                       std::map<size_t, size_t> *correspondences) {
+  LIBMV_TRACE_SCOPE("match");
+  const int NN = 2;
+  libmv::vector<int> indices;
+  libmv::vector<float> distances;
+  if (!matcher->searchNeighbours(&queries[0], num_queries,
+                                 &indices, &distances, NN)) {
+    return;
+  }
+  for (int i = 0; i < num_queries; ++i) {
+    if (distances[i * NN] < kStreamMatchRatio * distances[i * NN + NN - 1]) {
+      (*correspondences)[i] = indices[i * NN];
+    }
+  }
+}
+
+}  // namespace
+
+void Tracker::DetectAndDescribe(const Image &image,
+                                FeatureArena *arena,
+                                vector<Feature *> *features,
+                                vector<descriptor::Descriptor *> *descriptors) {
+  {
+    LIBMV_TRACE_SCOPE("detect");
+    detector_->set_arena(arena);
+    detector_->Detect(image, features, NULL);
+    detector_->set_arena(NULL);
+  }
+  LIBMV_TRACE_COUNTER("detect.features", features->size());
+  {
+    LIBMV_TRACE_SCOPE("describe");
+    describer_->set_arena(arena);
+    describer_->Describe(*features, image, NULL, descriptors);
+    describer_->set_arena(NULL);
+  }
+}
+
 bool Tracker::Track(const Image &image1,
                     const Image &image2, 
                     FeaturesGraph *new_features_graph,
                     bool keep_single_feature) {
-  // we detect good features to track
-  detector::DetectorData **data = NULL;
+  // we detect good features to track and compute their descriptors
+  FeatureArena *arena1 = arenas_.Acquire();
+  FeatureArena *arena2 = arenas_.Acquire();
   vector<Feature *> features1;
-  detector_->Detect(image1, &features1, data);
-        
   vector<Feature *> features2;
-  detector_->Detect(image2, &features2, data);
-
-  // we compute the feature descriptors on every feature
-  detector::DetectorData *detector_data = NULL;
   vector<descriptor::Descriptor *> descriptors1;
-  
-  describer_->Describe(features1, image1, detector_data, &descriptors1);
   vector<descriptor::Descriptor *> descriptors2;
-  describer_->Describe(features2, image2, detector_data, &descriptors2);
+  DetectAndDescribe(image1, arena1, &features1, &descriptors1);
+  DetectAndDescribe(image2, arena2, &features2, &descriptors2);
   
   // Copy data form generic feature to Keypoints since the matcher is
   // a point matcher
   FeatureSet *feature_set1 = new_features_graph->CreateNewFeatureSet();
-  feature_set1->features.resize(descriptors1.size());
-  for (size_t i = 0; i < descriptors1.size(); i++) {
-    KeypointFeature& feature = feature_set1->features[i];
-    feature.descriptor = *(descriptor::VecfDescriptor*) descriptors1[i];
-    *(PointFeature*)(&feature) = *(PointFeature*)features1[i];
-  }
+  CopyDescribedFeatures(features1, descriptors1, feature_set1);
   
   FeatureSet *feature_set2 = new_features_graph->CreateNewFeatureSet();
-  feature_set2->features.resize(descriptors2.size());
-  for (size_t i = 0; i < descriptors2.size(); i++) {
-    KeypointFeature& feature = feature_set2->features[i];
-    feature.descriptor = *(descriptor::VecfDescriptor*) descriptors2[i];
-    *(PointFeature*)(&feature) = *(PointFeature*)features2[i];
-  }
+  CopyDescribedFeatures(features2, descriptors2, feature_set2);
   
   // we match them
   //TODO (jmichot) use the matcher_ to match and not the generic function
@@ -109,10 +174,8 @@ bool Tracker::Track(const Image &image1,
     }
   }
   
-  DeleteElements(&descriptors1);
-  DeleteElements(&descriptors2);
-  DeleteElements(&features1);
-  DeleteElements(&features2);
+  arenas_.Release(arena1);
+  arenas_.Release(arena2);
   
   return true;
 }
@@ -122,25 +185,16 @@ bool Tracker::Track(const Image &image,
                     FeaturesGraph *new_features_graph,
                     Matches::ImageID *image_id,
                     bool keep_single_feature) {
-  // we detect good features to track
-  detector::DetectorData **data = NULL;
+  // we detect good features to track and compute their descriptors
+  FeatureArena *arena = arenas_.Acquire();
   vector<Feature *> features;
-  detector_->Detect(image, &features, data);
-  
-  // we compute the feature descriptors on every feature
-  detector::DetectorData *detector_data = NULL;
   vector<descriptor::Descriptor *> descriptors;
-  describer_->Describe(features, image, detector_data, &descriptors);
+  DetectAndDescribe(image, arena, &features, &descriptors);
   
   // Copy data form generic feature to Keypoints since the matcher is
   // a point matcher
   FeatureSet *feature_set = new_features_graph->CreateNewFeatureSet();
-  feature_set->features.resize(descriptors.size());
-  for (size_t i = 0; i < descriptors.size(); i++) {
-    KeypointFeature& feature = feature_set->features[i];
-    feature.descriptor = *(descriptor::VecfDescriptor*) descriptors[i];
-    *(PointFeature*)(&feature) = *(PointFeature*)features[i];
-  }
+  CopyDescribedFeatures(features, descriptors, feature_set);
   if (known_features_graph.matches_.NumImages() == 0)
     *image_id = 0;
   else
@@ -208,8 +262,144 @@ bool Tracker::Track(const Image &image,
     }
   }
   
-  DeleteElements(&descriptors);
-  DeleteElements(&features);  
+  arenas_.Release(arena);
   
   return true;
 }
+
+Matches::ImageID Tracker::PushFrame(const Image &image,
+                                    FeaturesGraph *graph,
+                                    bool keyframe) {
+  LIBMV_TRACE_SCOPE("track.push_frame");
+  if (!previous_.features) {
+    const Matches &matches = graph->matches_;
+    next_image_id_ = matches.NumImages() ? matches.GetMaxImageID() + 1 : 0;
+    next_track_id_ = matches.NumTracks() ? matches.GetMaxTrackID() + 1 : 0;
+  }
+  const Matches::ImageID image_id = next_image_id_++;
+
+  // The only detection and description of the frame.
+  FeatureArena *arena = arenas_.Acquire();
+  vector<Feature *> features;
+  vector<descriptor::Descriptor *> descriptors;
+  DetectAndDescribe(image, arena, &features, &descriptors);
+  FeatureSet *feature_set = graph->CreateNewFeatureSet();
+  CopyDescribedFeatures(features, descriptors, feature_set);
+
+  const int num_features = feature_set->features.size();
+  StreamFrame current;
+  current.features = feature_set;
+  current.arena = arena;
+  current.tracks.resize(num_features, -1);
+  std::vector<float> current_descriptors;
+  DescriptorRows(*feature_set, &current_descriptors);
+
+  // Extends the tracks of the previous frame. A feature of the previous
+  // frame extends its track once; the other features matched to it start
+  // new tracks.
+  const int num_previous = previous_.tracks.size();
+  std::set<Matches::TrackID> frame_tracks;
+  if (num_features > 0 && num_previous >= 2) {
+    std::map<size_t, size_t> correspondences;
+    if (matcher_.get()) {
+      MatchAgainstIndex(matcher_.get(), current_descriptors, num_features,
+                        &correspondences);
+    } else {
+      FindCorrespondences(*feature_set, *previous_.features, &correspondences);
+    }
+    std::map<size_t, size_t>::const_iterator it = correspondences.begin();
+    for (; it != correspondences.end(); ++it) {
+      const Matches::TrackID track = previous_.tracks[it->second];
+      if (frame_tracks.insert(track).second) {
+        current.tracks[it->first] = track;
+      }
+    }
+  }
+
+  // Recovers the tracks of the keyframes, from the most recent one.
+  std::list<StreamFrame>::reverse_iterator keyframe_it = keyframes_.rbegin();
+  for (; keyframe_it != keyframes_.rend() && num_features > 0;
+       ++keyframe_it) {
+    if (keyframe_it->features == previous_.features ||
+        keyframe_it->tracks.size() < 2) {
+      continue;
+    }
+    std::map<size_t, size_t> correspondences;
+    FindCorrespondences(*feature_set, *keyframe_it->features,
+                        &correspondences);
+    std::map<size_t, size_t>::const_iterator it = correspondences.begin();
+    for (; it != correspondences.end(); ++it) {
+      const Matches::TrackID track = keyframe_it->tracks[it->second];
+      if (current.tracks[it->first] < 0 && frame_tracks.insert(track).second) {
+        current.tracks[it->first] = track;
+      }
+    }
+  }
+
+  int num_extended = 0;
+  for (int i = 0; i < num_features; ++i) {
+    if (current.tracks[i] < 0) {
+      current.tracks[i] = next_track_id_++;
+    } else {
+      num_extended++;
+    }
+    graph->matches_.Insert(image_id, current.tracks[i],
+                           &feature_set->features[i]);
+  }
+  LIBMV_TRACE_COUNTER("track.extended", num_extended);
+
+  // Indexes the frame for the next one.
+  previous_descriptors_.swap(current_descriptors);
+  if (matcher_.get() && num_features >= 2) {
+    LIBMV_TRACE_SCOPE("match.build");
+    matcher_->build(&previous_descriptors_[0], num_features,
+                    previous_descriptors_.size() / num_features);
+  }
+  // Slides the window; the arenas of the frames that leave it are released.
+  std::vector<FeatureArena *> evicted;
+  evicted.push_back(previous_.arena);
+  previous_ = current;
+  if (keyframe && max_keyframes_ > 0) {
+    keyframes_.push_back(current);
+    while (int(keyframes_.size()) > max_keyframes_) {
+      if (keyframes_.front().arena != evicted[0]) {
+        evicted.push_back(keyframes_.front().arena);
+      }
+      keyframes_.pop_front();
+    }
+  }
+  for (int i = 0; i < evicted.size(); ++i) {
+    ReleaseOutOfWindow(evicted[i]);
+  }
+  return image_id;
+}
+
+void Tracker::ReleaseOutOfWindow(FeatureArena *arena) {
+  if (!arena || arena == previous_.arena) {
+    return;
+  }
+  std::list<StreamFrame>::const_iterator it = keyframes_.begin();
+  for (; it != keyframes_.end(); ++it) {
+    if (it->arena == arena) {
+      return;
+    }
+  }
+  arenas_.Release(arena);
+}
+
+void Tracker::ResetStream() {
+  std::vector<FeatureArena *> window;
+  window.push_back(previous_.arena);
+  std::list<StreamFrame>::const_iterator it = keyframes_.begin();
+  for (; it != keyframes_.end(); ++it) {
+    if (it->arena != previous_.arena) {
+      window.push_back(it->arena);
+    }
+  }
+  previous_ = StreamFrame();
+  previous_descriptors_.clear();
+  keyframes_.clear();
+  for (int i = 0; i < window.size(); ++i) {
+    ReleaseOutOfWindow(window[i]);
+  }
+}
@@ -23,10 +23,12 @@
 
 #include <map>
 #include <list>
+#include <vector>
 
 #include "libmv/base/scoped_ptr.h"
 #include "libmv/base/vector.h"
 #include "libmv/correspondence/ArrayMatcher.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/correspondence/feature_matching.h"
 #include "libmv/correspondence/matches.h"
 #include "libmv/descriptor/descriptor.h"
@@ -82,7 +84,10 @@ class Tracker {
           correspondence::ArrayMatcher<float> *matcher) : 
            detector_(detector),
            describer_(describer),
-           matcher_(matcher) {
+           matcher_(matcher),
+           max_keyframes_(1),
+           next_image_id_(0),
+           next_track_id_(0) {
     //TODO(jmichot) Do a copy of the classes so that the Tracker class will have
     // its own Detector, Describer & Matcher.
   };
@@ -102,10 +107,67 @@ class Tracker {
                      Matches::ImageID *image_id,
                      bool keep_single_feature = true); 
 
+  // Tracks the next frame of a stream. The frame is detected and described
+  // once and matched against the previous frame only, whose track IDs and
+  // matcher index are kept from the previous call. A feature matched to a
+  // feature of the previous frame extends its track; the others start new
+  // tracks. The features are stored in a new FeatureSet of graph and their
+  // tracks are inserted in graph->matches_. The frames are numbered from 0,
+  // or from the last image of graph, in the order of the calls.
+  //
+  // If keyframe is true, the frame is also kept as a keyframe: the features
+  // of the following frames that do not match the previous frame are matched
+  // against the last max_keyframes() keyframes, which recovers the tracks
+  // lost for a few frames.
+  //
+  // The same graph must be given to every call until ResetStream(), and it
+  // must keep the FeatureSets of the keyframes.
+  // Returns the image ID of the frame.
+  Matches::ImageID PushFrame(const Image &image,
+                             FeaturesGraph *graph,
+                             bool keyframe = false);
+
+  // Forgets the frames pushed so far; the next frame starts new tracks.
+  void ResetStream();
+
+  int max_keyframes() const { return max_keyframes_; }
+  void set_max_keyframes(int max_keyframes) { max_keyframes_ = max_keyframes; }
+
  protected:
+   // Detects and describes the features of an image in arena, which owns
+   // them; the descriptors are in the order of the features.
+   void DetectAndDescribe(const Image &image,
+                          FeatureArena *arena,
+                          vector<Feature *> *features,
+                          vector<descriptor::Descriptor *> *descriptors);
+
    scoped_ptr<detector::Detector> detector_;
    scoped_ptr<descriptor::Describer> describer_;
    scoped_ptr<correspondence::ArrayMatcher<float> > matcher_;
+   // Storage of the detections and descriptors of the frames.  Track releases
+   // its arenas at the end of the call; PushFrame keeps the arena of a frame
+   // while the frame is in the window (the previous frame or a keyframe) and
+   // releases it when the frame leaves the window.
+   FeatureArenaPool arenas_;
+
+   // A frame of the stream kept to match the next frames: its features, owned
+   // by the graph, their tracks, and the arena of its detections.
+   struct StreamFrame {
+     StreamFrame() : features(NULL), arena(NULL) {}
+     const FeatureSet *features;
+     std::vector<Matches::TrackID> tracks;
+     FeatureArena *arena;
+   };
+   // Releases the arena unless a frame of the window still uses it.
+   void ReleaseOutOfWindow(FeatureArena *arena);
+
+   StreamFrame previous_;
+   // The descriptors of the previous frame, in the rows indexed by matcher_.
+   std::vector<float> previous_descriptors_;
+   std::list<StreamFrame> keyframes_;
+   int max_keyframes_;
+   Matches::ImageID next_image_id_;
+   Matches::TrackID next_track_id_;
 };
 
 } // using namespace tracker
@@ -0,0 +1,240 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdlib>
+#include <set>
+
+#include "libmv/correspondence/ArrayMatcher_Kdtree.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/tracker.h"
+#include "libmv/descriptor/simpliest_descriptor.h"
+#include "libmv/detector/fast_detector.h"
+#include "libmv/image/image.h"
+#include "testing/testing.h"
+
+namespace {
+
+using namespace libmv;
+using namespace libmv::tracker;
+
+// A crop of a noise texture, whose top left corner is (x, y) in the texture.
+Image *MakeFrame(const Array3Du &texture, int x, int y) {
+  const int size = 100;
+  Array3Du *frame = new Array3Du(size, size);
+  for (int r = 0; r < size; ++r) {
+    for (int c = 0; c < size; ++c) {
+      (*frame)(r, c) = texture(r + y, c + x);
+    }
+  }
+  return new Image(frame);
+}
+
+Tracker *MakeTracker() {
+  return new Tracker(detector::CreateFastDetector(9, 30),
+                     descriptor::CreateSimpliestDescriber(),
+                     new correspondence::ArrayMatcher_Kdtree<float>);
+}
+
+// Counts the steps of the tracks from a frame to the next one that follow the
+// motion of the camera, and the others.
+void CountTrackSteps(const Matches &matches, int dx, int dy,
+                     int *num_good, int *num_bad) {
+  *num_good = *num_bad = 0;
+  std::set<Matches::TrackID>::const_iterator track =
+      matches.get_tracks().begin();
+  for (; track != matches.get_tracks().end(); ++track) {
+    Matches::Points p = matches.InTrack<PointFeature>(*track);
+    Matches::ImageID image = p.image();
+    float x = p.feature()->x(), y = p.feature()->y();
+    for (++p; p; ++p) {
+      if (p.image() == image + 1 &&
+          p.feature()->x() == x - dx && p.feature()->y() == y - dy) {
+        (*num_good)++;
+      } else {
+        (*num_bad)++;
+      }
+      image = p.image();
+      x = p.feature()->x();
+      y = p.feature()->y();
+    }
+  }
+}
+
+TEST(Tracker, PushFrame) {
+  srand(3);
+  Array3Du texture(130, 130);
+  for (int r = 0; r < texture.Height(); ++r) {
+    for (int c = 0; c < texture.Width(); ++c) {
+      texture(r, c) = rand() % 256;
+    }
+  }
+  scoped_ptr<Tracker> tracker(MakeTracker());
+  FeaturesGraph graph;
+  const int kNumFrames = 4, dx = 3, dy = 2;
+  for (int i = 0; i < kNumFrames; ++i) {
+    scoped_ptr<Image> frame(MakeFrame(texture, i * dx, i * dy));
+    EXPECT_EQ(i, tracker->PushFrame(*frame, &graph));
+  }
+  EXPECT_EQ(kNumFrames, graph.matches_.NumImages());
+  EXPECT_EQ(kNumFrames, graph.features_sets_.size());
+
+  // Matching noise patches makes a few mistakes.
+  int num_good, num_bad;
+  CountTrackSteps(graph.matches_, dx, dy, &num_good, &num_bad);
+  EXPECT_GT(num_good, 100);
+  EXPECT_LT(num_bad, num_good / 10);
+  graph.DeleteAndClear();
+}
+
+TEST(Tracker, PushFrameRecoversKeyframeTracks) {
+  srand(4);
+  Array3Du texture(130, 130);
+  for (int r = 0; r < texture.Height(); ++r) {
+    for (int c = 0; c < texture.Width(); ++c) {
+      texture(r, c) = rand() % 256;
+    }
+  }
+  Array3Du blank(130, 130);
+  blank.fill(0);
+  scoped_ptr<Tracker> tracker(MakeTracker());
+  FeaturesGraph graph;
+  scoped_ptr<Image> frame0(MakeFrame(texture, 0, 0));
+  scoped_ptr<Image> frame1(MakeFrame(blank, 0, 0));
+  scoped_ptr<Image> frame2(MakeFrame(texture, 0, 0));
+  tracker->PushFrame(*frame0, &graph, true);
+  // Nothing is seen in the second frame.
+  tracker->PushFrame(*frame1, &graph);
+  EXPECT_EQ(0, graph.matches_.NumFeatureImage(1));
+  tracker->PushFrame(*frame2, &graph);
+
+  // The third frame continues the tracks of the keyframe.
+  int num_features = graph.matches_.NumFeatureImage(2);
+  EXPECT_GT(num_features, 50);
+  EXPECT_EQ(num_features, graph.matches_.NumTracks());
+
+  // Without the keyframe, they would start new tracks.
+  tracker->ResetStream();
+  FeaturesGraph other_graph;
+  tracker->PushFrame(*frame0, &other_graph);
+  tracker->PushFrame(*frame1, &other_graph);
+  tracker->PushFrame(*frame2, &other_graph);
+  EXPECT_EQ(2 * num_features, other_graph.matches_.NumTracks());
+  graph.DeleteAndClear();
+  other_graph.DeleteAndClear();
+}
+
+// Exposes the arenas of the frames.
+class WindowTracker : public Tracker {
+ public:
+  WindowTracker()
+      : Tracker(detector::CreateFastDetector(9, 30),
+                descriptor::CreateSimpliestDescriber(),
+                new correspondence::ArrayMatcher_Kdtree<float>) {}
+  int NumArenas() const { return arenas_.NumArenas(); }
+};
+
+TEST(Tracker, PushFrameReusesTheArenasOfTheEvictedFrames) {
+  srand(5);
+  Array3Du texture(130, 130);
+  for (int r = 0; r < texture.Height(); ++r) {
+    for (int c = 0; c < texture.Width(); ++c) {
+      texture(r, c) = rand() % 256;
+    }
+  }
+  WindowTracker tracker;
+  tracker.set_max_keyframes(2);
+  FeaturesGraph graph;
+  for (int i = 0; i < 8; ++i) {
+    scoped_ptr<Image> frame(MakeFrame(texture, i, i));
+    tracker.PushFrame(*frame, &graph, true);
+  }
+  // The window holds the previous frame and 2 keyframes (the previous frame
+  // is one of them); a new frame needs one more arena.
+  EXPECT_EQ(3, tracker.NumArenas());
+
+  // All the arenas are free again after a reset.
+  tracker.ResetStream();
+  for (int i = 0; i < 3; ++i) {
+    scoped_ptr<Image> frame(MakeFrame(texture, i, i));
+    tracker.PushFrame(*frame, &graph);
+  }
+  EXPECT_EQ(3, tracker.NumArenas());
+  graph.DeleteAndClear();
+}
+
+// Describes only the features at least kBorder pixels away from the border
+// of the image, as DAISY does; the others get a NULL descriptor.
+class BorderDescriber : public descriptor::Describer {
+ public:
+  enum { kBorder = 10 };
+  BorderDescriber() : describer_(descriptor::CreateSimpliestDescriber()) {}
+  virtual void Describe(const vector<Feature *> &features,
+                        const Image &image,
+                        const detector::DetectorData *detector_data,
+                        vector<descriptor::Descriptor *> *descriptors) {
+    describer_->set_arena(arena_);
+    describer_->Describe(features, image, detector_data, descriptors);
+    describer_->set_arena(NULL);
+    const Array3Du &gray = *image.AsGrayArray3Du();
+    for (int i = 0; i < features.size(); ++i) {
+      const PointFeature *point = static_cast<PointFeature *>(features[i]);
+      if (point->x() < kBorder || point->y() < kBorder ||
+          point->x() >= gray.Width() - kBorder ||
+          point->y() >= gray.Height() - kBorder) {
+        if (!arena_) {
+          delete (*descriptors)[i];
+        }
+        (*descriptors)[i] = NULL;
+      }
+    }
+  }
+ private:
+  scoped_ptr<descriptor::Describer> describer_;
+};
+
+TEST(Tracker, PushFrameSkipsTheFeaturesWithoutDescriptor) {
+  srand(6);
+  Array3Du texture(130, 130);
+  for (int r = 0; r < texture.Height(); ++r) {
+    for (int c = 0; c < texture.Width(); ++c) {
+      texture(r, c) = rand() % 256;
+    }
+  }
+  Tracker tracker(detector::CreateFastDetector(9, 30),
+                  new BorderDescriber,
+                  new correspondence::ArrayMatcher_Kdtree<float>);
+  FeaturesGraph graph;
+  for (int i = 0; i < 2; ++i) {
+    scoped_ptr<Image> frame(MakeFrame(texture, i, i));
+    tracker.PushFrame(*frame, &graph);
+  }
+  ASSERT_EQ(2, graph.matches_.NumImages());
+  int num_features = 0;
+  Matches::Points p = graph.matches_.All<PointFeature>();
+  for (; p; ++p) {
+    EXPECT_GE(p.feature()->x(), BorderDescriber::kBorder);
+    EXPECT_GE(p.feature()->y(), BorderDescriber::kBorder);
+    num_features++;
+  }
+  EXPECT_GT(num_features, 50);
+  graph.DeleteAndClear();
+}
+
+}  // namespace
@@ -0,0 +1,214 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cmath>
+
+#include "libmv/base/vector.h"
+#include "libmv/logging/logging.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/binary_descriptor.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/image/convolve.h"
+#include "libmv/image/image.h"
+#include "libmv/image/sample.h"
+
+namespace libmv {
+namespace descriptor {
+
+namespace {
+
+// A binary intensity test: bit is set if I(first) > I(second).
+struct BinaryTest {
+  BinaryTest(int first = 0, int second = 0) : first(first), second(second) {}
+  int first;
+  int second;
+};
+
+// Largest number of sampled points of a pattern.
+const int kMaxPatternPoints = 512;
+
+// Describes features by comparing the smoothed intensity at pairs of points
+// of a fixed sampling pattern.  The pattern is expressed in units of the
+// feature scale and is rotated by the feature orientation.
+class PointPairDescriber : public Describer {
+ public:
+  PointPairDescriber(const vector<Vec2f> &pattern,
+                     const vector<BinaryTest> &tests,
+                     double smoothing_sigma)
+      : pattern_(pattern), tests_(tests), smoothing_sigma_(smoothing_sigma) {
+    assert(pattern_.size() <= kMaxPatternPoints);
+  }
+
+  virtual void Describe(const vector<Feature *> &features,
+                        const Image &image,
+                        const detector::DetectorData *detector_data,
+                        vector<Descriptor *> *descriptors) {
+    (void) detector_data;  // There is no matching detector.
+
+    // Binary tests are sensitive to noise; always sample a smoothed image.
+    const FloatImage *float_image = image.AsGrayArray3Df();
+    if (!float_image) {
+      LOG(ERROR) << "Invalid input image type for binary describer";
+      descriptors->resize(features.size());
+      for (int i = 0; i < features.size(); ++i) {
+        (*descriptors)[i] = NULL;
+      }
+      return;
+    }
+    FloatImage smoothed;
+    ConvolveGaussian(*float_image, smoothing_sigma_, &smoothed);
+
+    const int num_points = pattern_.size();
+    const int num_tests = tests_.size();
+    descriptors->resize(features.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < features.size(); ++i) {
+      PointFeature *point = dynamic_cast<PointFeature *>(features[i]);
+      BinaryDescriptor *descriptor = NULL;
+      if (point) {
+        descriptor = new BinaryDescriptor(num_tests);
+        // Rotate and scale the pattern once per feature.
+        const float c = cos(point->orientation) * point->scale;
+        const float s = sin(point->orientation) * point->scale;
+        float samples[kMaxPatternPoints];
+        for (int j = 0; j < num_points; ++j) {
+          const Vec2f &p = pattern_[j];
+          float x = point->x() + c * p(0) - s * p(1);
+          float y = point->y() + s * p(0) + c * p(1);
+          // SampleLinear clamps the coordinates to the image border.
+          samples[j] = SampleLinear(smoothed, y, x);
+        }
+        for (int j = 0; j < num_tests; ++j) {
+          if (samples[tests_[j].first] > samples[tests_[j].second]) {
+            descriptor->SetBit(j);
+          }
+        }
+      }
+      (*descriptors)[i] = descriptor;
+    }
+  }
+
+ private:
+  vector<Vec2f> pattern_;
+  vector<BinaryTest> tests_;
+  double smoothing_sigma_;
+};
+
+// Deterministic uniform random numbers in [0, 1) (Numerical Recipes LCG), so
+// that BRIEF patterns are the same on every platform and run.
+class PatternRandom {
+ public:
+  PatternRandom(unsigned int seed) : state_(seed) {}
+  double Uniform() {
+    state_ = 1664525u * state_ + 1013904223u;
+    return (state_ >> 8) / double(1 << 24);
+  }
+  // Box-Muller transform.
+  double Gaussian(double sigma) {
+    double u1 = std::max(Uniform(), 1e-12);
+    double u2 = Uniform();
+    return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+  }
+ private:
+  unsigned int state_;
+};
+
+}  // namespace
+
+// The binary dipole samples 4 rings of 16 points (radii 0.5, 1, 1.5 and 2
+// times the scale, as the lambda1 +/- lambda2 circles of the dipole
+// descriptor) and keeps the sign of 256 dissociated dipoles:
+//  - 32 opposite dipoles across each ring (first order dipoles),
+//  - 48 radial dipoles between consecutive rings (second order dipoles),
+//  - 64 + 64 angular dipoles between neighbor and quarter-turn points,
+//  - 48 diagonal dipoles between consecutive rings.
+Describer *CreateBinaryDipoleDescriber() {
+  const int kRings = 4;
+  const int kAngles = 16;
+  vector<Vec2f> pattern;
+  for (int r = 0; r < kRings; ++r) {
+    float radius = 0.5f * (r + 1);
+    for (int i = 0; i < kAngles; ++i) {
+      double angle = 2.0 * M_PI * i / kAngles;
+      pattern.push_back(Vec2f(radius * cos(angle), radius * sin(angle)));
+    }
+  }
+#define DIPOLE_POINT(r, i) ((r) * kAngles + ((i) % kAngles))
+  vector<BinaryTest> tests;
+  for (int r = 0; r < kRings; ++r) {
+    for (int i = 0; i < kAngles / 2; ++i) {
+      tests.push_back(BinaryTest(DIPOLE_POINT(r, i),
+                                 DIPOLE_POINT(r, i + kAngles / 2)));
+    }
+  }
+  for (int r = 0; r + 1 < kRings; ++r) {
+    for (int i = 0; i < kAngles; ++i) {
+      tests.push_back(BinaryTest(DIPOLE_POINT(r, i), DIPOLE_POINT(r + 1, i)));
+    }
+  }
+  for (int r = 0; r < kRings; ++r) {
+    for (int i = 0; i < kAngles; ++i) {
+      tests.push_back(BinaryTest(DIPOLE_POINT(r, i), DIPOLE_POINT(r, i + 1)));
+    }
+  }
+  for (int r = 0; r < kRings; ++r) {
+    for (int i = 0; i < kAngles; ++i) {
+      tests.push_back(BinaryTest(DIPOLE_POINT(r, i),
+                                 DIPOLE_POINT(r, i + kAngles / 4)));
+    }
+  }
+  for (int r = 0; r + 1 < kRings; ++r) {
+    for (int i = 0; i < kAngles; ++i) {
+      tests.push_back(BinaryTest(DIPOLE_POINT(r, i),
+                                 DIPOLE_POINT(r + 1, i + 1)));
+    }
+  }
+#undef DIPOLE_POINT
+  assert(tests.size() == 256);
+  return new PointPairDescriber(pattern, tests, 1.0);
+}
+
+// BRIEF, with the pattern G II of the paper: both points of a test are drawn
+// from an isotropic Gaussian of standard deviation S / 5 over a patch of size
+// S.  Here S is 10 times the feature scale (31 pixels for FAST features).
+Describer *CreateBriefDescriber() {
+  const int kNumTests = 256;
+  const float kPatchSize = 10.0f;
+  const float kHalfPatch = kPatchSize / 2.0f;
+  PatternRandom random(42);
+  vector<Vec2f> pattern;
+  vector<BinaryTest> tests;
+  for (int i = 0; i < kNumTests; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      float x = random.Gaussian(kPatchSize / 5.0);
+      float y = random.Gaussian(kPatchSize / 5.0);
+      x = std::min(std::max(x, -kHalfPatch), kHalfPatch);
+      y = std::min(std::max(y, -kHalfPatch), kHalfPatch);
+      pattern.push_back(Vec2f(x, y));
+    }
+    tests.push_back(BinaryTest(2 * i, 2 * i + 1));
+  }
+  return new PointPairDescriber(pattern, tests, 2.0);
+}
+
+}  // namespace descriptor
+}  // namespace libmv
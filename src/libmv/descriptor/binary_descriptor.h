@@ -0,0 +1,137 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_DESCRIPTOR_BINARY_DESCRIPTOR_H
+#define LIBMV_DESCRIPTOR_BINARY_DESCRIPTOR_H
+
+#include <cassert>
+
+#include "libmv/base/vector.h"
+#include "libmv/descriptor/descriptor.h"
+
+namespace libmv {
+namespace descriptor {
+
+// Binary descriptors are stored as packed 32 bits words; bit i of the
+// descriptor is bit (i % 32) of word (i / 32).
+typedef unsigned int BinaryWord;
+static const int kBitsPerBinaryWord = 32;
+
+inline int NumBinaryWords(int num_bits) {
+  return (num_bits + kBitsPerBinaryWord - 1) / kBitsPerBinaryWord;
+}
+
+struct BinaryDescriptor : public Descriptor {
+  virtual ~BinaryDescriptor() {}
+  BinaryDescriptor() : num_bits(0) {}
+  BinaryDescriptor(int num_bits)
+      : num_bits(num_bits), words(NumBinaryWords(num_bits), 0) {}
+
+  int NumWords() const { return words.size(); }
+
+  bool Bit(int i) const {
+    return (words[i / kBitsPerBinaryWord] >> (i % kBitsPerBinaryWord)) & 1;
+  }
+  void SetBit(int i) {
+    words[i / kBitsPerBinaryWord] |= BinaryWord(1) << (i % kBitsPerBinaryWord);
+  }
+
+  int num_bits;
+  vector<BinaryWord> words;
+};
+
+// Number of set bits in a word.
+inline int PopCount(BinaryWord x) {
+#if defined(__GNUC__)
+  return __builtin_popcount(x);
+#else
+  // Counts bits in parallel, see "Bit Twiddling Hacks" by Sean Anderson.
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  return (((x + (x >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+#endif
+}
+
+// Number of differing bits between two packed descriptors.
+inline int HammingDistance(const BinaryWord *a,
+                           const BinaryWord *b,
+                           int num_words) {
+  int distance = 0;
+  for (int i = 0; i < num_words; ++i) {
+    distance += PopCount(a[i] ^ b[i]);
+  }
+  return distance;
+}
+
+inline int HammingDistance(const BinaryDescriptor &a,
+                           const BinaryDescriptor &b) {
+  assert(a.NumWords() == b.NumWords());
+  return HammingDistance(a.words.begin(), b.words.begin(), a.NumWords());
+}
+
+/**
+ * Packs binary descriptors in a contiguous array, one row of num_words words
+ * per descriptor.  NULL descriptors (features that could not be described)
+ * give a row of zeros.  Returns NULL if there is no valid descriptor.  The
+ * array must be deleted with [].
+ */
+inline BinaryWord *BinaryDescriptorsToContiguousArray(
+    const vector<Descriptor *> &descriptors, int *num_words) {
+  *num_words = 0;
+  for (int i = 0; i < descriptors.size() && *num_words == 0; ++i) {
+    const BinaryDescriptor *descriptor =
+        dynamic_cast<const BinaryDescriptor *>(descriptors[i]);
+    if (descriptor) {
+      *num_words = descriptor->NumWords();
+    }
+  }
+  if (*num_words == 0) {
+    return NULL;
+  }
+  BinaryWord *array = new BinaryWord[descriptors.size() * *num_words];
+  for (int i = 0; i < descriptors.size(); ++i) {
+    const BinaryDescriptor *descriptor =
+        dynamic_cast<const BinaryDescriptor *>(descriptors[i]);
+    for (int j = 0; j < *num_words; ++j) {
+      array[i * *num_words + j] = descriptor ? descriptor->words[j] : 0;
+    }
+  }
+  return array;
+}
+
+/**
+ * Creates a binarized DIPOLE describer: the signs of 256 dissociated dipoles
+ * sampled on 4 rings around the feature, packed as a BinaryDescriptor.
+ * See the DIPOLE describer for the original (float) descriptor.
+ */
+Describer *CreateBinaryDipoleDescriber();
+
+/**
+ * Creates a BRIEF describer (256 bits), steered by the feature orientation.
+ * Implementation of :
+ * [1] M. Calonder, V. Lepetit, C. Strecha, P. Fua. BRIEF: Binary Robust
+ * Independent Elementary Features. In ECCV, 2010.
+ */
+Describer *CreateBriefDescriber();
+
+}  // namespace descriptor
+}  // namespace libmv
+
+#endif  // LIBMV_DESCRIPTOR_BINARY_DESCRIPTOR_H
@@ -0,0 +1,128 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/descriptor/binary_descriptor.h"
+#include "libmv/descriptor/descriptor_factory.h"
+#include "libmv/image/image.h"
+#include "libmv/numeric/numeric.h"
+#include "testing/testing.h"
+
+namespace libmv {
+namespace descriptor {
+namespace {
+
+TEST(BinaryDescriptor, SetBit) {
+  BinaryDescriptor descriptor(40);
+  EXPECT_EQ(2, descriptor.NumWords());
+  descriptor.SetBit(0);
+  descriptor.SetBit(33);
+  EXPECT_TRUE(descriptor.Bit(0));
+  EXPECT_FALSE(descriptor.Bit(1));
+  EXPECT_TRUE(descriptor.Bit(33));
+  EXPECT_EQ(1u, descriptor.words[0]);
+  EXPECT_EQ(2u, descriptor.words[1]);
+}
+
+TEST(BinaryDescriptor, PopCount) {
+  EXPECT_EQ(0, PopCount(0u));
+  EXPECT_EQ(1, PopCount(1u));
+  EXPECT_EQ(8, PopCount(0xFF000000u));
+  EXPECT_EQ(32, PopCount(0xFFFFFFFFu));
+  EXPECT_EQ(16, PopCount(0x55555555u));
+}
+
+TEST(BinaryDescriptor, HammingDistance) {
+  BinaryDescriptor a(64), b(64);
+  EXPECT_EQ(0, HammingDistance(a, b));
+  a.SetBit(3);
+  a.SetBit(40);
+  b.SetBit(40);
+  b.SetBit(63);
+  EXPECT_EQ(2, HammingDistance(a, b));
+}
+
+// A smooth image with texture in all directions.
+ByteImage *MakeTexturedImage(int width, int height, float shift_x) {
+  ByteImage *image = new ByteImage(height, width);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      float u = x - shift_x;
+      float value = 128 + 60 * sin(u * 0.35) * cos(y * 0.23)
+                        + 40 * sin((u + y) * 0.17);
+      (*image)(y, x) = static_cast<unsigned char>(value);
+    }
+  }
+  return image;
+}
+
+void DescribeGrid(eDescriber edescriber, float shift_x,
+                  vector<Descriptor *> *descriptors) {
+  Image image(MakeTexturedImage(100, 64, shift_x));
+  vector<Feature *> features;
+  for (int y = 20; y <= 44; y += 12) {
+    for (int x = 20; x <= 44; x += 12) {
+      PointFeature *feature = new PointFeature(x + shift_x, y);
+      feature->scale = 3.0;
+      features.push_back(feature);
+    }
+  }
+  Describer *describer = describerFactory(edescriber);
+  describer->Describe(features, image, NULL, descriptors);
+  delete describer;
+  DeleteElements(&features);
+}
+
+void TestTranslationInvariance(eDescriber edescriber) {
+  vector<Descriptor *> reference, shifted;
+  DescribeGrid(edescriber, 0, &reference);
+  DescribeGrid(edescriber, 5, &shifted);
+  ASSERT_EQ(9, reference.size());
+  ASSERT_EQ(9, shifted.size());
+  for (int i = 0; i < reference.size(); ++i) {
+    BinaryDescriptor *a = dynamic_cast<BinaryDescriptor *>(reference[i]);
+    BinaryDescriptor *b = dynamic_cast<BinaryDescriptor *>(shifted[i]);
+    ASSERT_TRUE(a != NULL);
+    ASSERT_TRUE(b != NULL);
+    EXPECT_EQ(256, a->num_bits);
+    // The same patch gives the same bits wherever it is in the image.
+    EXPECT_EQ(0, HammingDistance(*a, *b));
+    // Different patches give different bits.
+    for (int j = 0; j < i; ++j) {
+      BinaryDescriptor *c = dynamic_cast<BinaryDescriptor *>(reference[j]);
+      EXPECT_LT(10, HammingDistance(*a, *c));
+    }
+  }
+  DeleteElements(&reference);
+  DeleteElements(&shifted);
+}
+
+TEST(BinaryDipoleDescriber, TranslationInvariance) {
+  TestTranslationInvariance(BINARY_DIPOLE_DESCRIBER);
+}
+
+TEST(BriefDescriber, TranslationInvariance) {
+  TestTranslationInvariance(BRIEF_DESCRIBER);
+}
+
+}  // namespace
+}  // namespace descriptor
+}  // namespace libmv
@@ -18,17 +18,155 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "libmv/logging/logging.h"
+#include "libmv/descriptor/daisy_descriptor.h"
 #include "libmv/descriptor/descriptor.h"
 #include "libmv/descriptor/vector_descriptor.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/image/image.h"
 #include "third_party/daisy/include/daisy/daisy.h"
 
 namespace libmv {
 namespace descriptor {
 
-// TODO(keir): This is utterly untested!
+namespace {
+
+// Defaults from README.
+const double kDaisyRadius = 15;
+const int kDaisyRadiusQuantization = 3;
+const int kDaisyAngleQuantization = 8;
+const int kDaisyHistogramQuantization = 8;
+
+// Dense mode is used when there are at least this many features per pixel.
+const double kDenseModeFeaturesPerPixel = 0.5;
+
+// DAISY grids are tabulated for integer orientations in [0, 360).
+int OrientationInDegrees(float orientation) {
+  int degrees = static_cast<int>(floor(orientation * 180.0 / M_PI + 0.5));
+  degrees %= 360;
+  return degrees < 0 ? degrees + 360 : degrees;
+}
+
+}  // namespace
+
+DaisyEngine::DaisyEngine() : daisy_(NULL), width_(0), height_(0) {}
+
+DaisyEngine::~DaisyEngine() {
+  // The workspace and dense buffers are owned by the engine, not by daisy.
+  delete daisy_;
+}
+
+void DaisyEngine::SetImage(const ByteImage &image) {
+  if (daisy_ && image.Width() == width_ && image.Height() == height_) {
+    // Releases the previous frame; the layers workspace is kept.
+    daisy_->reset();
+    daisy_->set_image(image.Data(), height_, width_);
+  } else {
+    delete daisy_;
+    daisy_ = new daisy;
+    daisy_->verbose(0);
+    width_ = image.Width();
+    height_ = image.Height();
+    daisy_->set_image(image.Data(), height_, width_);
+    // TODO(keir): DAISY has extensive configuration options; consider
+    // exposing them via some sort of config system.
+    daisy_->set_parameters(kDaisyRadius,
+                           kDaisyRadiusQuantization,
+                           kDaisyAngleQuantization,
+                           kDaisyHistogramQuantization);
+    workspace_.resize(daisy_->compute_workspace_memory());
+    daisy_->set_workspace_memory(&workspace_[0], workspace_.size());
+    dense_descriptors_.clear();
+  }
+  // Computes the gradient layers and their convolutions, once per frame.
+  daisy_->initialize_single_descriptor_mode();
+}
+
+int DaisyEngine::DescriptorSize() const {
+  if (!daisy_) {
+    return kDaisyHistogramQuantization *
+        (kDaisyRadiusQuantization * kDaisyAngleQuantization + 1);
+  }
+  return daisy_->descriptor_size();
+}
+
+bool DaisyEngine::CanDescribe(const Feature *feature) const {
+  const PointFeature *point = dynamic_cast<const PointFeature *>(feature);
+  return daisy_ && point &&
+         point->x() >= 0 && point->x() < width_ &&
+         point->y() >= 0 && point->y() < height_;
+}
+
+bool DaisyEngine::UseDenseMode(const vector<Feature *> &features) const {
+  if (features.size() < kDenseModeFeaturesPerPixel * width_ * height_) {
+    return false;
+  }
+  // Dense descriptors are computed with the upright grid.
+  for (int i = 0; i < features.size(); ++i) {
+    const PointFeature *point = dynamic_cast<const PointFeature *>(features[i]);
+    if (point && OrientationInDegrees(point->orientation) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void DaisyEngine::Describe(const vector<Feature *> &features,
+                           float *descriptors) {
+  const int size = DescriptorSize();
+  // DAISY leaves the petals falling outside of the image untouched.
+  std::fill(descriptors, descriptors + features.size() * size, 0.0f);
+  if (!daisy_) {
+    LOG(ERROR) << "DaisyEngine::Describe called before SetImage";
+    return;
+  }
+
+  if (UseDenseMode(features)) {
+    if (dense_descriptors_.empty()) {
+      dense_descriptors_.resize(daisy_->compute_descriptor_memory());
+      daisy_->set_descriptor_memory(&dense_descriptors_[0],
+                                    dense_descriptors_.size());
+    }
+    daisy_->compute_descriptors();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < features.size(); ++i) {
+      if (!CanDescribe(features[i])) {
+        continue;
+      }
+      const PointFeature *point = static_cast<PointFeature *>(features[i]);
+      int x = std::min(static_cast<int>(point->x() + 0.5f), width_ - 1);
+      int y = std::min(static_cast<int>(point->y() + 0.5f), height_ - 1);
+      const float *dense = &dense_descriptors_[(y * width_ + x) * size];
+      float *descriptor = descriptors + i * size;
+      std::copy(dense, dense + size, descriptor);
+      daisy_->normalize_descriptor(descriptor);
+    }
+    return;
+  }
+
+  // The smoothed layers are only read, so the features are independent.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+  for (int i = 0; i < features.size(); ++i) {
+    if (!CanDescribe(features[i])) {
+      continue;
+    }
+    const PointFeature *point = static_cast<PointFeature *>(features[i]);
+    daisy_->get_descriptor(point->y(),
+                           point->x(),
+                           OrientationInDegrees(point->orientation),
+                           descriptors + i * size);
+  }
+}
+
 class DaisyDescriber : public Describer {
  public:
   virtual void Describe(const vector<Feature *> &features,
@@ -37,38 +175,36 @@ class DaisyDescriber : public Describer {
                         vector<Descriptor *> *descriptors) {
     (void) detector_data;  // There is no matching detector for DAISY.
 
-    daisy desc;
-
-    // TODO(keir): DAISY has extensive configuration options; consider exposing
-    // them via some sort of config system.
-
-    // Defaults from README.
-    desc.set_parameters(15, 3, 8, 8);
-    //desc.scale_invariant(true);
-
-    // Push the image into daisy. This will make a copy and convert to float.
-    ByteImage *byte_image = image.AsArray3Du();
-    desc.set_image(byte_image->Data(),
-                   byte_image->Height(),
-                   byte_image->Width());
-
-    // Only use sparse descriptors; the default is dense.
-    desc.initialize_single_descriptor_mode();
-
+    const ByteImage *byte_image = image.AsGrayArray3Du();
     descriptors->resize(features.size());
+    if (!byte_image) {
+      LOG(ERROR) << "Invalid input image type for DAISY describer";
+      for (int i = 0; i < features.size(); ++i) {
+        (*descriptors)[i] = NULL;
+      }
+      return;
+    }
+
+    // Reuses the buffers of the previous frame when the size is the same.
+    engine_.SetImage(*byte_image);
+    const int size = engine_.DescriptorSize();
+    block_.resize(features.size() * size);
+    if (features.size() > 0) {
+      engine_.Describe(features, &block_[0]);
+    }
     for (int i = 0; i < features.size(); ++i) {
-      PointFeature *point = dynamic_cast<PointFeature *>(features[i]);
       VecfDescriptor *descriptor = NULL;
-      if (point) {
-        descriptor = new VecfDescriptor(desc.descriptor_size());
-        desc.get_descriptor(point->y(),
-                            point->x(),
-                            point->orientation * 180.0 / 3.14159f,
-                            descriptor->coords.data());
+      if (engine_.CanDescribe(features[i])) {
+        descriptor = NewVecfDescriptor(arena_, size);
+        descriptor->coords = Map<Vecf>(&block_[i * size], size);
       }
       (*descriptors)[i] = descriptor;
     }
   }
+
+ private:
+  DaisyEngine engine_;
+  std::vector<float> block_;
 };
 
 Describer *CreateDaisyDescriber() {
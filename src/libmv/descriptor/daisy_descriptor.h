@@ -21,11 +21,59 @@
 #ifndef LIBMV_DESCRIPTOR_DAISY_DESCRIPTOR_H
 #define LIBMV_DESCRIPTOR_DAISY_DESCRIPTOR_H
 
+#include <vector>
+
+#include "libmv/base/vector.h"
+#include "libmv/image/image.h"
+
+class daisy;
+
 namespace libmv {
+
+class Feature;
+
 namespace descriptor {
 
 class Describer;
 
+/**
+ * Computes DAISY descriptors for a sequence of frames.
+ *
+ * The DAISY object and its smoothed orientation layers are kept between
+ * frames of the same size, so a new frame only recomputes the layers (in
+ * parallel when OpenMP is enabled).  When the features cover a large part of
+ * the image and are all upright, the descriptors of every pixel are computed
+ * at once (dense mode) and each feature takes the one of its nearest pixel.
+ */
+class DaisyEngine {
+ public:
+  DaisyEngine();
+  ~DaisyEngine();
+
+  // Computes the orientation layers of a new (grayscale) frame.
+  void SetImage(const ByteImage &image);
+
+  // Number of floats of a descriptor.
+  int DescriptorSize() const;
+
+  // True if the feature is a point feature inside the current frame.
+  bool CanDescribe(const Feature *feature) const;
+
+  // Writes the normalized descriptors of the features of the current frame
+  // to a contiguous block of features.size() * DescriptorSize() floats.  The
+  // rows of the features that cannot be described are set to zero.
+  void Describe(const vector<Feature *> &features, float *descriptors);
+
+ private:
+  bool UseDenseMode(const vector<Feature *> &features) const;
+
+  daisy *daisy_;
+  int width_;
+  int height_;
+  std::vector<float> workspace_;
+  std::vector<float> dense_descriptors_;
+};
+
 /**
  * Creates a DAISY describer.
  *
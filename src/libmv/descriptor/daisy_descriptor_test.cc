@@ -18,16 +18,121 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <cmath>
+#include <vector>
+
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
 #include "libmv/descriptor/daisy_descriptor.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/vector_descriptor.h"
 #include "libmv/image/image.h"
 #include "testing/testing.h"
 
 namespace libmv {
+namespace descriptor {
 namespace {
 
-TEST(DaisyDescriptor, DescribesStuff) {
-  // Does it blend? Stay tuned to find out!
+void MakeTexturedImage(int width, int height, int phase, ByteImage *image) {
+  image->Resize(height, width);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      float value = 128 + 60 * sin((x + phase) * 0.35) * cos(y * 0.23)
+                        + 40 * sin((x + y) * 0.17);
+      (*image)(y, x) = static_cast<unsigned char>(value);
+    }
+  }
+}
+
+TEST(DaisyEngine, ReusedAcrossFramesOfTheSameSize) {
+  ByteImage first, second;
+  MakeTexturedImage(64, 48, 0, &first);
+  MakeTexturedImage(64, 48, 5, &second);
+  vector<Feature *> features;
+  for (int i = 0; i < 6; ++i) {
+    PointFeature *feature = new PointFeature(10 + 8 * i, 8 + 6 * i);
+    feature->orientation = -1.0 + 0.7 * i;
+    features.push_back(feature);
+  }
+
+  DaisyEngine engine, fresh_engine;
+  const int size = engine.DescriptorSize();
+  EXPECT_EQ(200, size);
+  std::vector<float> reused(features.size() * size);
+  std::vector<float> expected(features.size() * size);
+  engine.SetImage(first);
+  engine.Describe(features, &reused[0]);
+  engine.SetImage(second);
+  engine.Describe(features, &reused[0]);
+  fresh_engine.SetImage(second);
+  fresh_engine.Describe(features, &expected[0]);
+
+  for (int i = 0; i < reused.size(); ++i) {
+    EXPECT_EQ(expected[i], reused[i]);
+  }
+  // Histograms are normalized one by one.
+  for (int i = 0; i < features.size() * size / 8; ++i) {
+    float norm = 0;
+    for (int j = 0; j < 8; ++j) {
+      norm += reused[i * 8 + j] * reused[i * 8 + j];
+    }
+    EXPECT_TRUE(norm == 0 || fabs(norm - 1) < 1e-4);
+  }
+  DeleteElements(&features);
+}
+
+TEST(DaisyEngine, DenseModeMatchesSparseMode) {
+  ByteImage image;
+  MakeTexturedImage(40, 40, 0, &image);
+  // Enough upright features to switch to dense mode.
+  vector<Feature *> features, sparse_features;
+  for (int y = 0; y < 40; ++y) {
+    for (int x = 0; x < 40; x += 2) {
+      features.push_back(new PointFeature(x, y));
+      if (y % 8 == 3 && x % 8 == 4) {
+        sparse_features.push_back(features.back());
+      }
+    }
+  }
+
+  DaisyEngine engine;
+  engine.SetImage(image);
+  const int size = engine.DescriptorSize();
+  std::vector<float> dense(features.size() * size);
+  std::vector<float> sparse(sparse_features.size() * size);
+  engine.Describe(features, &dense[0]);
+  engine.Describe(sparse_features, &sparse[0]);
+
+  for (int i = 0, k = 0; i < features.size(); ++i) {
+    if (k < sparse_features.size() && features[i] == sparse_features[k]) {
+      for (int j = 0; j < size; ++j) {
+        EXPECT_NEAR(sparse[k * size + j], dense[i * size + j], 1e-5);
+      }
+      ++k;
+    }
+  }
+  DeleteElements(&features);
+}
+
+TEST(DaisyDescriber, SkipsFeaturesOutsideTheImage) {
+  ByteImage *byte_image = new ByteImage;
+  MakeTexturedImage(64, 48, 0, byte_image);
+  Image image(byte_image);
+  vector<Feature *> features;
+  features.push_back(new PointFeature(20, 20));
+  features.push_back(new PointFeature(80, 20));
+
+  Describer *describer = CreateDaisyDescriber();
+  vector<Descriptor *> descriptors;
+  describer->Describe(features, image, NULL, &descriptors);
+  ASSERT_EQ(2, descriptors.size());
+  EXPECT_TRUE(dynamic_cast<VecfDescriptor *>(descriptors[0]) != NULL);
+  EXPECT_TRUE(descriptors[1] == NULL);
+  delete describer;
+  DeleteElements(&descriptors);
+  DeleteElements(&features);
 }
 
 }  // namespace
+}  // namespace descriptor
 }  // namespace libmv
@@ -21,11 +21,14 @@
 #ifndef LIBMV_DESCRIPTOR_DESCRIPTOR_H
 #define LIBMV_DESCRIPTOR_DESCRIPTOR_H
 
+#include <cstddef>
+
 #include "libmv/base/vector.h"
 
 namespace libmv {
 
 class Feature;
+class FeatureArena;
 class Image;
 
 namespace detector {
@@ -46,6 +49,7 @@ public:
  */
 class Describer {
  public:
+  Describer() : arena_(NULL) {}
   virtual ~Describer() {};
   /**
    * Describes features in an image, in preparation for matching.
@@ -69,6 +73,18 @@ class Describer {
                         const Image &image,
                         const detector::DetectorData *detector_data,
                         vector<Descriptor *> *descriptors) = 0;
+
+  /**
+   * Makes Describe allocate the descriptors in arena rather than with new;
+   * the arena then owns them and the caller must not delete them. NULL (the
+   * default) restores the allocation with new. Describers whose descriptors
+   * are not VecfDescriptor ignore the arena.
+   */
+  void set_arena(FeatureArena *arena) { arena_ = arena; }
+  FeatureArena *arena() const { return arena_; }
+
+ protected:
+  FeatureArena *arena_;
 };
 
 }  // namespace descriptor
@@ -31,7 +31,9 @@ enum eDescriber
   SIMPLEST_DESCRIBER,
   DIPOLE_DESCRIBER,
   SURF_DESCRIBER,
-  DAISY_DESCRIBER
+  DAISY_DESCRIBER,
+  BINARY_DIPOLE_DESCRIBER,
+  BRIEF_DESCRIBER
 };
 /**
  * Creates the corresponding describer (descriptor computing interface).
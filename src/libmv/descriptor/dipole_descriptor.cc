@@ -21,73 +21,197 @@
 #include "libmv/base/vector.h"
 #include "libmv/logging/logging.h"
 #include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/dipole_descriptor.h"
 #include "libmv/descriptor/vector_descriptor.h"
 #include "libmv/correspondence/feature.h"
-#include "libmv/image/convolve.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/image/image.h"
-#include "libmv/image/sample.h"
+#include <algorithm>
 #include <cmath>
 
 namespace libmv {
 namespace descriptor {
 
-//
+namespace {
+
+const int kDipoleSamples = 12;
+
+// The orientation is quantized in kOrientationBuckets buckets, a multiple of
+// the 12 sampling directions so that sample i of bucket b is the direction of
+// bucket b + i * kBucketsPerSample.
+const int kOrientationBuckets = 360;
+const int kBucketsPerSample = kOrientationBuckets / kDipoleSamples;
+
+// Sampling pattern shared by all the dipole describers: the sincos table of
+// the quantized orientations and the first order dipole projection.
+class DipolePattern {
+ public:
+  DipolePattern() {
+    for (int b = 0; b < kOrientationBuckets; ++b) {
+      double angle = 2.0 * M_PI * b / kOrientationBuckets;
+      cos_[b] = cos(angle);
+      sin_[b] = sin(angle);
+    }
+    // First order dipoles: differences of opposite samples of the circle.
+    A_ <<  0, 0, 0, 1, 0, 0, 0, 0, 0,-1, 0, 0,
+           0,-1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,
+           0, 0, 0, 0, 0,-1, 0, 0, 0, 0, 0, 1,
+           0, 0, 0, 0, 1, 0, 0,-1, 0, 0, 0, 0,
+           0, 0, 0, 0, 0, 0, 1, 0, 0,-1, 0, 0,
+           0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,-1,
+           0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0,
+           1, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0;
+  }
+
+  int Bucket(double angle) const {
+    int b = int(floor(angle * kOrientationBuckets / (2.0 * M_PI) + 0.5));
+    b %= kOrientationBuckets;
+    return b < 0 ? b + kOrientationBuckets : b;
+  }
+  // Direction of sample i for orientation bucket b.
+  float Cos(int b, int i) const {
+    return cos_[(b + i * kBucketsPerSample) % kOrientationBuckets];
+  }
+  float Sin(int b, int i) const {
+    return sin_[(b + i * kBucketsPerSample) % kOrientationBuckets];
+  }
+  const Matrix<float, 8, kDipoleSamples> &A() const { return A_; }
+
+ private:
+  float cos_[kOrientationBuckets];
+  float sin_[kOrientationBuckets];
+  Matrix<float, 8, kDipoleSamples> A_;
+};
+
+const DipolePattern &GetDipolePattern() {
+  // Built on first use; Describe() calls it before spawning threads.
+  static const DipolePattern pattern;
+  return pattern;
+}
+
+// Bilinear interpolation of n points at once.  The coordinates are split in
+// integer and fractional parts in a first pass and the pixels are blended in
+// a second one, so both loops are free of branches and vectorizable.
+// Coordinates are clamped to the image, and on an image one pixel wide (or
+// tall) the second sample of the axis is the first one.  Points for which
+// inside[i] is false give 0.
+template <int n>
+void SampleLinearBatch(const ByteImage &image,
+                       const float *x, const float *y, const bool *inside,
+                       float *values) {
+  const int width = image.Width();
+  const int height = image.Height();
+  if (width < 1 || height < 1) {
+    std::fill(values, values + n, 0.0f);
+    return;
+  }
+  const unsigned char *data = image.Data();
+  const int step_x = width < 2 ? 0 : 1;
+  const int step_y = height < 2 ? 0 : width;
+  int offset[n];
+  float dx[n], dy[n];
+  for (int i = 0; i < n; ++i) {
+    float xi = std::min(std::max(x[i], 0.0f), float(width - 1));
+    float yi = std::min(std::max(y[i], 0.0f), float(height - 1));
+    int x0 = std::max(0, std::min(int(xi), width - 2));
+    int y0 = std::max(0, std::min(int(yi), height - 2));
+    dx[i] = xi - x0;
+    dy[i] = yi - y0;
+    offset[i] = y0 * width + x0;
+  }
+  for (int i = 0; i < n; ++i) {
+    const unsigned char *p = data + offset[i];
+    const unsigned char *q = p + step_y;
+    float top = p[0] + dx[i] * (float(p[step_x]) - p[0]);
+    float bottom = q[0] + dx[i] * (float(q[step_x]) - q[0]);
+    values[i] = inside[i] ? top + dy[i] * (bottom - top) : 0.0f;
+  }
+}
+
+// Same test as Array3D::Contains on the truncated coordinates.
+inline bool Contains(const ByteImage &image, float x, float y) {
+  return image.Contains(int(y), int(x));
+}
+
+// Computes the dipole descriptor of one point.
 // Note :
 // - Angle is in radian.
-// - data the output array (must be allocated to 20 values).
-template <typename TImage,typename T>
-void PickDipole(const TImage & image, float x, float y, float scale,
-                double angle, T * data) {
-
-  // Setup the rotation center.
-  float & cx = x, & cy = y;
-
-  double lambda1 = scale;
-  double lambda2 = lambda1 / 2.0;
-  double angleSubdiv = 2.0 * M_PI / 12.0;
-
-  Vecf dipoleF1(12);
-  for (int i = 0; i < 12; ++i)  {
-    float xi = cx + lambda1 * cos(angle + i * angleSubdiv);
-    float yi = cy + lambda1 * sin(angle + i * angleSubdiv);
-    float s1 = 0.0f;
-    if (image.Contains(yi,xi) ) {
-      // Bilinear interpolation
-      s1 = SampleLinear(image, yi, xi);
-    }
-    dipoleF1(i) = s1;
+// - data the output array (kDipoleDescriptorSize values).
+void PickDipole(const DipolePattern &pattern, const ByteImage &image,
+                float x, float y, float scale, double angle, float *data) {
+  const float lambda1 = scale;
+  const float lambda2 = lambda1 / 2.0f;
+  const int bucket = pattern.Bucket(angle);
+
+  // Samples 0..11 are on the lambda1 circle, 12..23 on the outer circle
+  // (lambda1 + lambda2) and 24..35 on the inner one (lambda1 - lambda2).
+  const int kNumPoints = 3 * kDipoleSamples;
+  float px[kNumPoints], py[kNumPoints], values[kNumPoints];
+  bool inside[kNumPoints];
+  for (int i = 0; i < kDipoleSamples; ++i) {
+    float c = pattern.Cos(bucket, i);
+    float s = pattern.Sin(bucket, i);
+    px[i] = x + lambda1 * c;
+    py[i] = y + lambda1 * s;
+    px[i + kDipoleSamples] = x + (lambda1 + lambda2) * c;
+    py[i + kDipoleSamples] = y + (lambda1 + lambda2) * s;
+    px[i + 2 * kDipoleSamples] = x + (lambda1 - lambda2) * c;
+    py[i + 2 * kDipoleSamples] = y + (lambda1 - lambda2) * s;
   }
-  Matf A(8,12);
-  A <<  0, 0, 0, 1, 0, 0, 0, 0, 0,-1, 0, 0,
-        0,-1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,
-        0, 0, 0, 0, 0,-1, 0, 0, 0, 0, 0, 1,
-        0, 0, 0, 0, 1, 0, 0,-1, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 1, 0, 0,-1, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,-1,
-        0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0,
-        1, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0;
-
-  // Add the second order F2 dipole
-  Vecf dipoleF2(12);
-  for (int i = 0; i < 12; ++i)  {
-    double angleSample = i * angleSubdiv;
-    float xi = cx + (lambda1 + lambda2) * cos(angle + angleSample);
-    float yi = cy + (lambda1 + lambda2) * sin(angle + angleSample);
-
-    float xii = cx + (lambda1 - lambda2) * cos(angle + angleSample);
-    float yii = cy + (lambda1 - lambda2) * sin(angle + angleSample);
-
-    float s1 = 0.0f;
-    if (image.Contains(yi,xi) && image.Contains(yii,xii)) {
-      // Bilinear interpolation
-      s1 = SampleLinear(image, yi, xi) - SampleLinear(image, yii, xii);
-    }
-    dipoleF2(i) = s1;
+  for (int i = 0; i < kDipoleSamples; ++i) {
+    inside[i] = Contains(image, px[i], py[i]);
+    // Second order dipoles need both of their samples.
+    bool both = Contains(image, px[i + kDipoleSamples],
+                                py[i + kDipoleSamples]) &&
+                Contains(image, px[i + 2 * kDipoleSamples],
+                                py[i + 2 * kDipoleSamples]);
+    inside[i + kDipoleSamples] = both;
+    inside[i + 2 * kDipoleSamples] = both;
   }
+  SampleLinearBatch<kNumPoints>(image, px, py, inside, values);
+
+  Map<Matrix<float, kDipoleSamples, 1> > dipoleF1(values);
+  Map<Matrix<float, kDipoleSamples, 1> > outer(values + kDipoleSamples);
+  Map<Matrix<float, kDipoleSamples, 1> > inner(values + 2 * kDipoleSamples);
+  Map<Matrix<float, 8, 1> > F1(data);
+  Map<Matrix<float, kDipoleSamples, 1> > F2(data + 8);
+  F1 = pattern.A() * dipoleF1;
+  F2 = outer - inner;
 
-  (*data).template block<8,1>(0,0) = (A * dipoleF1).normalized();
-  (*data).template block<12,1>(8,0) = dipoleF2.normalized();
   // Normalize to be affine luminance invariant (a*I(x,y)+b).
+  float norm1 = F1.norm(), norm2 = F2.norm();
+  if (norm1 > 0) F1 /= norm1;
+  if (norm2 > 0) F2 /= norm2;
+}
+
+// Describes a feature in data; the row of a non point feature is zero.
+void DescribeFeature(const DipolePattern &pattern,
+                     const ByteImage &image,
+                     const Feature *feature,
+                     float *data) {
+  const PointFeature *point = dynamic_cast<const PointFeature *>(feature);
+  if (point) {
+    PickDipole(pattern, image, point->x(), point->y(), point->scale,
+               point->orientation, data);
+  } else {
+    std::fill(data, data + kDipoleDescriptorSize, 0.0f);
+  }
+}
+
+}  // namespace
+
+void DescribeDipoleBatch(const ByteImage &image,
+                         const vector<Feature *> &features,
+                         float *descriptors) {
+  const DipolePattern &pattern = GetDipolePattern();
+  const int num_features = features.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (num_features > 256)
+#endif
+  for (int i = 0; i < num_features; ++i) {
+    DescribeFeature(pattern, image, features[i],
+                    descriptors + i * kDipoleDescriptorSize);
+  }
 }
 
 class DipoleDescriber : public Describer {
@@ -98,26 +222,46 @@ class DipoleDescriber : public Describer {
                         vector<Descriptor *> *descriptors) {
     (void) detector_data; // There is no matching detector for DipoleDescriptor.
 
-    const int DIPOLE_DESC_SIZE = 20;
+    const ByteImage *byte_image = image.AsGrayArray3Du();
     descriptors->resize(features.size());
-    for (int i = 0; i < features.size(); ++i) {
-      PointFeature *point = dynamic_cast<PointFeature *>(features[i]);
+    if (!byte_image) {
+      LOG(ERROR) << "Invalid input image type for DIPOLE describer";
+      for (int i = 0; i < features.size(); ++i) {
+        (*descriptors)[i] = NULL;
+      }
+      return;
+    }
+    // The descriptors are taken from the arena, whose recycled descriptors
+    // keep their coefficients, so that a frame allocates nothing once the
+    // arena has grown; without an arena the caller owns and deletes each of
+    // them.  The arena is not thread safe: the descriptors are allocated
+    // first, then the features are described in place in parallel.
+    const int num_features = features.size();
+    for (int i = 0; i < num_features; ++i) {
       VecfDescriptor *descriptor = NULL;
-      if (point) {
-        descriptor = new VecfDescriptor(DIPOLE_DESC_SIZE);
-        PickDipole( *(image.AsArray3Du()),
-                  point->x(),
-                  point->y(),
-                  point->scale,
-                  point->orientation,
-                  &(descriptor->coords));
+      if (dynamic_cast<PointFeature *>(features[i])) {
+        descriptor = NewVecfDescriptor(arena_, kDipoleDescriptorSize);
       }
       (*descriptors)[i] = descriptor;
     }
+    const DipolePattern &pattern = GetDipolePattern();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (num_features > 256)
+#endif
+    for (int i = 0; i < num_features; ++i) {
+      VecfDescriptor *descriptor =
+          static_cast<VecfDescriptor *>((*descriptors)[i]);
+      if (descriptor) {
+        DescribeFeature(pattern, *byte_image, features[i],
+                        descriptor->coords.data());
+      }
+    }
   }
 };
 
 Describer *CreateDipoleDescriber() {
+  // Build the shared pattern before any parallel use.
+  GetDipolePattern();
   return new DipoleDescriber;
 }
 
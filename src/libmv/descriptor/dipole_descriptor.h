@@ -21,11 +21,20 @@
 #ifndef LIBMV_DESCRIPTOR_DIPOLE_DESCRIPTOR_H
 #define LIBMV_DESCRIPTOR_DIPOLE_DESCRIPTOR_H
 
+#include "libmv/base/vector.h"
+#include "libmv/image/image.h"
+
 namespace libmv {
+
+class Feature;
+
 namespace descriptor {
 
 class Describer;
 
+// Number of floats of a DIPOLE descriptor.
+const int kDipoleDescriptorSize = 20;
+
 /**
  * Creates a DIPOLE describer.
  * Implementation of :
@@ -35,6 +44,21 @@ class Describer;
  */
 Describer *CreateDipoleDescriber();
 
+/**
+ * Computes the DIPOLE descriptors of a batch of features.
+ *
+ * \param[in]  image       The (grayscale) image to describe.
+ * \param[in]  features    The features; rows of non point features are zero.
+ * \param[out] descriptors A contiguous block of
+ *                         features.size() * kDipoleDescriptorSize floats.
+ *
+ * The sampling pattern is shared by all the calls and the features are
+ * described in parallel.
+ */
+void DescribeDipoleBatch(const ByteImage &image,
+                         const vector<Feature *> &features,
+                         float *descriptors);
+
 }  // namespace descriptor
 }  // namespace libmv
 
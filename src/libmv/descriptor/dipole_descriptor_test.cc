@@ -0,0 +1,182 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cmath>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/dipole_descriptor.h"
+#include "libmv/descriptor/vector_descriptor.h"
+#include "libmv/image/image.h"
+#include "libmv/image/sample.h"
+#include "testing/testing.h"
+
+namespace libmv {
+namespace descriptor {
+namespace {
+
+ByteImage *MakeTexturedImage(int width, int height) {
+  ByteImage *image = new ByteImage(height, width);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      float value = 128 + 60 * sin(x * 0.35) * cos(y * 0.23)
+                        + 40 * sin((x + y) * 0.17);
+      (*image)(y, x) = static_cast<unsigned char>(value);
+    }
+  }
+  return image;
+}
+
+// Straightforward version of the descriptor, with float interpolation.
+float Sample(const ByteImage &image, float x, float y) {
+  FloatImage float_image(image.Height(), image.Width());
+  for (int r = 0; r < image.Height(); ++r) {
+    for (int c = 0; c < image.Width(); ++c) {
+      float_image(r, c) = image(r, c);
+    }
+  }
+  return SampleLinear(float_image, y, x);
+}
+
+void ReferenceDipole(const ByteImage &image, float x, float y, float scale,
+                     double angle, Vecf *data) {
+  double lambda1 = scale, lambda2 = scale / 2.0;
+  Vecf f1(12), f2(12);
+  for (int i = 0; i < 12; ++i) {
+    double a = angle + i * 2.0 * M_PI / 12.0;
+    f1(i) = Sample(image, x + lambda1 * cos(a), y + lambda1 * sin(a));
+    f2(i) = Sample(image, x + (lambda1 + lambda2) * cos(a),
+                          y + (lambda1 + lambda2) * sin(a))
+          - Sample(image, x + (lambda1 - lambda2) * cos(a),
+                          y + (lambda1 - lambda2) * sin(a));
+  }
+  Vecf F1(8);
+  F1 << f1(3) - f1(9), f1(7) - f1(1), f1(11) - f1(5), f1(4) - f1(7),
+        f1(6) - f1(9), f1(8) - f1(11), f1(10) - f1(1), f1(0) - f1(3);
+  data->resize(20);
+  data->head<8>() = F1.normalized();
+  data->tail<12>() = f2.normalized();
+}
+
+TEST(DipoleDescriber, BatchMatchesReference) {
+  ByteImage *byte_image = MakeTexturedImage(64, 48);
+  Image image(byte_image);
+  vector<Feature *> features;
+  for (int i = 0; i < 5; ++i) {
+    PointFeature *feature = new PointFeature(15 + 7 * i, 12 + 5 * i);
+    feature->scale = 3.0 + i;
+    // Orientations on the 1 degree grid of the sincos table.
+    feature->orientation = i * 37 * M_PI / 180.0;
+    features.push_back(feature);
+  }
+
+  std::vector<float> block(features.size() * kDipoleDescriptorSize);
+  DescribeDipoleBatch(*byte_image, features, &block[0]);
+
+  vector<Descriptor *> descriptors;
+  Describer *describer = CreateDipoleDescriber();
+  describer->Describe(features, image, NULL, &descriptors);
+  delete describer;
+  ASSERT_EQ(features.size(), descriptors.size());
+
+  for (int i = 0; i < features.size(); ++i) {
+    PointFeature *point = static_cast<PointFeature *>(features[i]);
+    Vecf expected;
+    ReferenceDipole(*byte_image, point->x(), point->y(), point->scale,
+                    point->orientation, &expected);
+    VecfDescriptor *descriptor = dynamic_cast<VecfDescriptor *>(
+        descriptors[i]);
+    ASSERT_TRUE(descriptor != NULL);
+    for (int j = 0; j < kDipoleDescriptorSize; ++j) {
+      EXPECT_NEAR(expected(j), block[i * kDipoleDescriptorSize + j], 1e-4);
+      EXPECT_EQ(block[i * kDipoleDescriptorSize + j], descriptor->coords(j));
+    }
+  }
+  DeleteElements(&descriptors);
+  DeleteElements(&features);
+}
+
+TEST(DipoleDescriber, BatchOnOnePixelWideImages) {
+  // On an image one pixel wide (or tall) the interpolation has a single
+  // column (or row) to read from.
+  const int kSizes[2][2] = {{1, 32}, {32, 1}};
+  for (int k = 0; k < 2; ++k) {
+    scoped_ptr<ByteImage> image(MakeTexturedImage(kSizes[k][0], kSizes[k][1]));
+    PointFeature *feature = new PointFeature(kSizes[k][0] / 2,
+                                             kSizes[k][1] / 2);
+    feature->scale = 0.4;
+    feature->orientation = 0;
+    vector<Feature *> features;
+    features.push_back(feature);
+
+    float block[kDipoleDescriptorSize];
+    DescribeDipoleBatch(*image, features, block);
+    Vecf expected;
+    ReferenceDipole(*image, feature->x(), feature->y(), feature->scale,
+                    feature->orientation, &expected);
+    for (int j = 0; j < kDipoleDescriptorSize; ++j) {
+      EXPECT_NEAR(expected(j), block[j], 1e-4);
+    }
+    DeleteElements(&features);
+  }
+}
+
+TEST(DipoleDescriber, ReusesTheDescriptorsOfTheArena) {
+  ByteImage *byte_image = MakeTexturedImage(64, 48);
+  Image image(byte_image);
+  vector<Feature *> features;
+  for (int i = 0; i < 5; ++i) {
+    features.push_back(new PointFeature(15 + 7 * i, 12 + 5 * i));
+  }
+  std::vector<float> block(features.size() * kDipoleDescriptorSize);
+  DescribeDipoleBatch(*byte_image, features, &block[0]);
+
+  FeatureArena arena;
+  scoped_ptr<Describer> describer(CreateDipoleDescriber());
+  describer->set_arena(&arena);
+  vector<Descriptor *> descriptors;
+  describer->Describe(features, image, NULL, &descriptors);
+  ASSERT_EQ(features.size(), descriptors.size());
+  std::vector<const float *> coefficients;
+  for (int i = 0; i < descriptors.size(); ++i) {
+    coefficients.push_back(
+        static_cast<VecfDescriptor *>(descriptors[i])->coords.data());
+  }
+
+  // The next frame describes in the same descriptors and coefficients.
+  arena.Clear();
+  describer->Describe(features, image, NULL, &descriptors);
+  EXPECT_EQ(features.size(), arena.NumVecfDescriptors());
+  for (int i = 0; i < descriptors.size(); ++i) {
+    const Vecf &coords = static_cast<VecfDescriptor *>(descriptors[i])->coords;
+    EXPECT_EQ(coefficients[i], coords.data());
+    for (int j = 0; j < kDipoleDescriptorSize; ++j) {
+      EXPECT_EQ(block[i * kDipoleDescriptorSize + j], coords(j));
+    }
+  }
+  DeleteElements(&features);
+}
+
+}  // namespace
+}  // namespace descriptor
+}  // namespace libmv
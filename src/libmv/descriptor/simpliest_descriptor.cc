@@ -23,6 +23,7 @@
 #include "libmv/descriptor/descriptor.h"
 #include "libmv/descriptor/vector_descriptor.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/image/image.h"
 #include "libmv/image/sample.h"
 #include <cmath>
@@ -115,8 +116,8 @@ class SimpliestDescriber : public Describer {
       PointFeature *point = dynamic_cast<PointFeature *>(features[i]);
       VecfDescriptor *descriptor = NULL;
       if (point) {
-        descriptor = new VecfDescriptor(SIMPLIEST_DESC_SIZE);
-        PickPatch( *(image.AsArray3Du()),
+        descriptor = NewVecfDescriptor(arena_, SIMPLIEST_DESC_SIZE);
+        PickPatch( *image.AsGrayArray3Du(),
                   point->x(),
                   point->y(),
                   point->scale,
@@ -19,6 +19,7 @@
 // IN THE SOFTWARE.
 
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/descriptor/descriptor.h"
 #include "libmv/descriptor/vector_descriptor.h"
 #include "libmv/image/convolve.h"
@@ -163,14 +164,14 @@ class SurfDescriber : public Describer {
     (void) detector_data;
 
     Matu integral_image;
-    IntegralImage(*(image.AsArray3Du()), &integral_image);
+    IntegralImage(*image.AsGrayArray3Du(), &integral_image);
 
     descriptors->resize(features.size());
     for (int i = 0; i < features.size(); ++i) {
       PointFeature *point = dynamic_cast<PointFeature *>(features[i]);
       VecfDescriptor *descriptor = NULL;
       if (point) {
-        descriptor = new VecfDescriptor(64);
+        descriptor = NewVecfDescriptor(arena_, 64);
         MSURFDescriptor<4, 9>(integral_image, *point, &descriptor->coords);
       }
       (*descriptors)[i] = descriptor;
@@ -21,12 +21,15 @@
 #ifndef LIBMV_DETECTOR_DETECTOR_H
 #define LIBMV_DETECTOR_DETECTOR_H
 
+#include <cstddef>
+
 #include "libmv/base/vector.h"
 
 namespace libmv {
 
 class Image;
 class Feature;
+class FeatureArena;
 
 namespace detector {
 
@@ -44,6 +47,7 @@ class DetectorData {
  */
 class Detector {
  public:
+  Detector() : arena_(NULL) {}
   virtual ~Detector() {};
   /**
    * Detects features in an image.
@@ -68,6 +72,17 @@ class Detector {
   virtual void Detect(const Image &image,
                       vector<Feature *> *features,
                       DetectorData **data) = 0;
+
+  /**
+   * Makes Detect allocate the features in arena rather than with new; the
+   * arena then owns them and the caller must not delete them. NULL (the
+   * default) restores the allocation with new.
+   */
+  void set_arena(FeatureArena *arena) { arena_ = arena; }
+  FeatureArena *arena() const { return arena_; }
+
+ protected:
+  FeatureArena *arena_;
 };
 
 }  // namespace detector
@@ -21,6 +21,7 @@
 #include "libmv/detector/detector.h"
 #include "libmv/detector/detector_factory.h"
 #include "libmv/detector/fast_detector.h"
+#include "libmv/detector/fast_grid_detector.h"
 #include "libmv/detector/star_detector.h"
 #include "libmv/detector/surf_detector.h"
 #include "libmv/logging/logging.h"
@@ -38,6 +39,9 @@ Detector *detectorFactory(eDetector edetector)  {
   case FAST_LIMITED_DETECTOR:
     return detector::CreateFastDetectorLimited();
     break;
+  case FAST_GRID_DETECTOR:
+    return detector::CreateFastGridDetector();
+    break;
   case SURF_DETECTOR:
     return detector::CreateSURFDetector();
     break;
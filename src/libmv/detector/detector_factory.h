@@ -30,6 +30,7 @@ enum eDetector
 {
   FAST_DETECTOR,
   FAST_LIMITED_DETECTOR,
+  FAST_GRID_DETECTOR,
   SURF_DETECTOR,
   STAR_DETECTOR,
   MSER_DETECTOR
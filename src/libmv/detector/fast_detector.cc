@@ -19,6 +19,7 @@
 // IN THE SOFTWARE.
 
 
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/correspondence/feature.h"
 #include "libmv/detector/detector.h"
 #include "libmv/detector/fast_detector.h"
@@ -45,14 +46,15 @@ class FastDetector : public Detector {
                       vector<Feature *> *features,
                       DetectorData **data) {
     int num_corners = 0;
-    ByteImage *byte_image = image.AsArray3Du();
+    const ByteImage *byte_image = image.AsGrayArray3Du();
     if (byte_image) {
       xy* detections = detector_(byte_image->Data(),
           byte_image->Width(), byte_image->Height(), byte_image->Width(),
           threshold_, &num_corners);
 
       for (int i = 0; i < num_corners; ++i) {
-        PointFeature *f = new PointFeature(detections[i].x, detections[i].y);
+        PointFeature *f = NewPointFeature(arena_, detections[i].x,
+                                         detections[i].y);
         f->scale = 3.0;
         f->orientation = 0.0;
         features->push_back(f);
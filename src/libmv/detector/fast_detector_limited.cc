@@ -19,6 +19,7 @@
 // IN THE SOFTWARE.
 
 
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/correspondence/feature.h"
 #include "libmv/detector/detector.h"
 #include "libmv/detector/fast_detector.h"
@@ -90,7 +91,7 @@ class FastDetectorLimited : public Detector {
                       vector<Feature *> *features,
                       DetectorData **data) {
     int num_corners = 0;
-    ByteImage *byte_image = image.AsArray3Du();
+    const ByteImage *byte_image = image.AsGrayArray3Du();
     if (byte_image) {
       // Algorithm :
       // a. Detect.
@@ -118,8 +119,8 @@ class FastDetectorLimited : public Detector {
 
       for (int i = 0; i < std::min(expectedFeatureNumber_,ret_num_corners);
           ++i) {
-        PointFeature *f = new PointFeature(ptScores[i].first->x,
-                            ptScores[i].first->y);
+        PointFeature *f = NewPointFeature(arena_, ptScores[i].first->x,
+                                          ptScores[i].first->y);
         f->scale = 3.0;
         f->orientation = 0.0;
         features->push_back(f);
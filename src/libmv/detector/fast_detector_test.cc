@@ -22,6 +22,7 @@
 #include "libmv/base/vector.h"
 #include "libmv/base/vector_utils.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/detector/fast_detector.h"
 #include "libmv/detector/detector.h"
 #include "libmv/image/image.h"
@@ -98,6 +99,34 @@ TEST(FastDetector, Localisation2) {
   DeleteElements(&features);
 }
 
+TEST(FastDetector, Arena) {
+  Array3Du image(20,20);
+  image.fill(0);
+  DrawRing(15, 15, &image);
+  DrawRing(12, 12, &image);
+  Image im(new Array3Du(image));
+
+  scoped_ptr<Detector> detector(CreateFastDetector(9, 20));
+  vector<Feature *> expected;
+  detector->Detect(im, &expected, NULL);
+
+  FeatureArena arena;
+  detector->set_arena(&arena);
+  vector<Feature *> features;
+  detector->Detect(im, &features, NULL);
+  EXPECT_EQ(expected.size(), arena.NumPointFeatures());
+  ASSERT_EQ(expected.size(), features.size());
+  for (int i = 0; i < features.size(); ++i) {
+    PointFeature *a = static_cast<PointFeature *>(expected[i]);
+    PointFeature *b = static_cast<PointFeature *>(features[i]);
+    EXPECT_EQ(a->x(), b->x());
+    EXPECT_EQ(a->y(), b->y());
+    EXPECT_EQ(a->scale, b->scale);
+  }
+  // The arena owns the features.
+  DeleteElements(&expected);
+}
+
 }  // namespace
 }  // namespace detector
 }  // namespace libmv
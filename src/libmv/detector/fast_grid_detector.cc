@@ -0,0 +1,302 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <vector>
+
+#include "libmv/correspondence/feature_arena.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/fast_grid_detector.h"
+#include "libmv/detector/orientation_detector.h"
+#include "libmv/image/image.h"
+#include "libmv/logging/logging.h"
+
+namespace libmv {
+namespace detector {
+
+namespace {
+
+// The Bresenham circle of radius 3 of FAST, in the order of make_offsets.
+const int kRingX[16] = { 0,  1,  2,  3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+const int kRingY[16] = { 3,  3,  2,  1, 0, -1, -2, -3, -3, -3, -2, -1, 0, 1, 2, 3};
+
+// FAST needs the full circle inside the image.
+const int kBorder = 3;
+
+// Number of rows processed together, and unit of the parallel loop.
+const int kBandRows = 32;
+
+// True if the 16 bits ring mask contains 9 contiguous set bits.
+inline bool HasArc9(unsigned int mask) {
+  mask |= mask << 16;  // Unrolls the ring.
+  unsigned int run = mask & (mask >> 1);  // Runs of 2.
+  run &= run >> 2;  // Runs of 4.
+  run &= run >> 4;  // Runs of 8.
+  run &= mask >> 8;  // Runs of 9.
+  return (run & 0xFFFF) != 0;
+}
+
+// The FAST score is the largest barrier b for which 9 contiguous pixels of
+// the ring are all brighter than p + b or all darker than p - b.  It is the
+// closed form of the binary search of fast9_corner_score.
+int Fast9Score(const unsigned char *p, const int *offsets, int threshold) {
+  int d[16];
+  for (int k = 0; k < 16; ++k) {
+    d[k] = p[offsets[k]] - p[0];
+  }
+  int score = threshold;
+  for (int start = 0; start < 16; ++start) {
+    int lowest = d[start], highest = d[start];
+    for (int k = 1; k < 9; ++k) {
+      int value = d[(start + k) & 15];
+      lowest = std::min(lowest, value);
+      highest = std::max(highest, value);
+    }
+    score = std::max(score, std::max(lowest - 1, -highest - 1));
+  }
+  return std::min(score, 254);
+}
+
+// Scratch buffers of a band.
+struct BandBuffers {
+  BandBuffers(int width) : brighter(width), darker(width) {
+    for (int i = 0; i < 3; ++i) {
+      scores[i].resize(width);
+    }
+  }
+  std::vector<unsigned int> brighter;
+  std::vector<unsigned int> darker;
+  std::vector<int> scores[3];
+};
+
+// Computes the FAST scores of a row; non corners score 0.
+void ScoreRow(const ByteImage &image, int y, int threshold,
+              const int *offsets, BandBuffers *buffers, int *scores) {
+  const int width = image.Width();
+  std::fill(scores, scores + width, 0);
+  if (y < kBorder || y >= image.Height() - kBorder) {
+    return;
+  }
+  const unsigned char *row = &image(y, 0);
+  const int begin = kBorder, end = width - kBorder;
+  unsigned int *brighter = &buffers->brighter[0];
+  unsigned int *darker = &buffers->darker[0];
+  std::fill(brighter + begin, brighter + end, 0u);
+  std::fill(darker + begin, darker + end, 0u);
+
+  // Segment test on the whole row, one ring pixel at a time; the inner loop
+  // has no branches so that the compiler can vectorize it.
+  for (int k = 0; k < 16; ++k) {
+    const unsigned char *ring = row + offsets[k];
+    const unsigned int bit = 1u << k;
+    for (int x = begin; x < end; ++x) {
+      const int p = row[x];
+      const int v = ring[x];
+      brighter[x] |= (v > p + threshold) ? bit : 0u;
+      darker[x]   |= (v < p - threshold) ? bit : 0u;
+    }
+  }
+  for (int x = begin; x < end; ++x) {
+    if (HasArc9(brighter[x]) || HasArc9(darker[x])) {
+      scores[x] = Fast9Score(row + x, offsets, threshold);
+    }
+  }
+}
+
+// Detects the corners of the rows [y_begin, y_end) with a 3x3 non maximum
+// suppression; a corner is kept if its score is strictly the largest of its
+// neighborhood, as in nonmax_suppression.
+void DetectBand(const ByteImage &image, int threshold, const int *offsets,
+                int y_begin, int y_end, std::vector<FastCorner> *corners) {
+  const int width = image.Width();
+  BandBuffers buffers(width);
+  int *above = &buffers.scores[0][0];
+  int *center = &buffers.scores[1][0];
+  int *below = &buffers.scores[2][0];
+  ScoreRow(image, y_begin - 1, threshold, offsets, &buffers, above);
+  ScoreRow(image, y_begin, threshold, offsets, &buffers, center);
+  for (int y = y_begin; y < y_end; ++y) {
+    ScoreRow(image, y + 1, threshold, offsets, &buffers, below);
+    for (int x = kBorder; x < width - kBorder; ++x) {
+      const int s = center[x];
+      if (s > 0 &&
+          s > center[x - 1] && s > center[x + 1] &&
+          s > above[x - 1] && s > above[x] && s > above[x + 1] &&
+          s > below[x - 1] && s > below[x] && s > below[x + 1]) {
+        corners->push_back(FastCorner(x, y, s));
+      }
+    }
+    std::swap(above, center);
+    std::swap(center, below);
+  }
+}
+
+struct ByDecreasingScore {
+  bool operator()(const FastCorner &a, const FastCorner &b) const {
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+  }
+};
+
+}  // namespace
+
+void DetectFast9NonMax(const ByteImage &image,
+                       int threshold,
+                       vector<FastCorner> *corners) {
+  corners->clear();
+  const int width = image.Width(), height = image.Height();
+  if (width <= 2 * kBorder || height <= 2 * kBorder) {
+    return;
+  }
+  int offsets[16];
+  for (int k = 0; k < 16; ++k) {
+    offsets[k] = kRingX[k] + kRingY[k] * (&image(1, 0) - &image(0, 0));
+  }
+
+  const int num_bands = (height - 2 * kBorder + kBandRows - 1) / kBandRows;
+  std::vector<std::vector<FastCorner> > bands(num_bands);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int b = 0; b < num_bands; ++b) {
+    int y_begin = kBorder + b * kBandRows;
+    int y_end = std::min(y_begin + kBandRows, height - kBorder);
+    DetectBand(image, threshold, offsets, y_begin, y_end, &bands[b]);
+  }
+  // Bands are concatenated in order, so the corners are in raster order.
+  for (int b = 0; b < num_bands; ++b) {
+    for (int i = 0; i < bands[b].size(); ++i) {
+      corners->push_back(bands[b][i]);
+    }
+  }
+}
+
+void DetectFastGrid(const ByteImage &image,
+                    const FastGridOptions &options,
+                    vector<FastCorner> *corners) {
+  vector<FastCorner> candidates;
+  DetectFast9NonMax(image, options.min_threshold, &candidates);
+
+  corners->clear();
+  if (candidates.size() <= options.max_features) {
+    for (int i = 0; i < candidates.size(); ++i) {
+      corners->push_back(candidates[i]);
+    }
+    std::sort(corners->begin(), corners->end(), ByDecreasingScore());
+    return;
+  }
+
+  // Distributes the candidates in the cells of the grid.
+  const int cell_size = std::max(options.cell_size, 1);
+  const int cells_x = (image.Width() + cell_size - 1) / cell_size;
+  const int cells_y = (image.Height() + cell_size - 1) / cell_size;
+  const int num_cells = cells_x * cells_y;
+  std::vector<std::vector<FastCorner> > cells(num_cells);
+  for (int i = 0; i < candidates.size(); ++i) {
+    const FastCorner &corner = candidates[i];
+    cells[(corner.y / cell_size) * cells_x + corner.x / cell_size]
+        .push_back(corner);
+  }
+
+  // Each cell keeps its best corners, whatever their score above
+  // min_threshold: the threshold of the cells without enough corners is
+  // lowered.
+  const int cell_budget = std::max(options.max_features / num_cells, 1);
+  std::vector<FastCorner> remaining;
+  for (int c = 0; c < num_cells; ++c) {
+    std::vector<FastCorner> &cell = cells[c];
+    int kept = std::min(cell_budget, static_cast<int>(cell.size()));
+    std::partial_sort(cell.begin(), cell.begin() + kept, cell.end(),
+                      ByDecreasingScore());
+    for (int i = 0; i < cell.size(); ++i) {
+      if (i < kept) {
+        corners->push_back(cell[i]);
+      } else if (cell[i].score >= options.threshold) {
+        remaining.push_back(cell[i]);
+      }
+    }
+  }
+
+  // The budget left by the sparse cells goes to the strongest corners.
+  std::sort(corners->begin(), corners->end(), ByDecreasingScore());
+  if (corners->size() > options.max_features) {
+    corners->resize(options.max_features);
+  }
+  int left = options.max_features - corners->size();
+  if (left > 0 && !remaining.empty()) {
+    left = std::min(left, static_cast<int>(remaining.size()));
+    std::partial_sort(remaining.begin(), remaining.begin() + left,
+                      remaining.end(), ByDecreasingScore());
+    for (int i = 0; i < left; ++i) {
+      corners->push_back(remaining[i]);
+    }
+    std::sort(corners->begin(), corners->end(), ByDecreasingScore());
+  }
+}
+
+class FastGridDetector : public Detector {
+ public:
+  virtual ~FastGridDetector() {}
+  FastGridDetector(const FastGridOptions &options, bool bRotationInvariant)
+    : options_(options), bRotationInvariant_(bRotationInvariant) {}
+
+  virtual void Detect(const Image &image,
+                      vector<Feature *> *features,
+                      DetectorData **data) {
+    const ByteImage *byte_image = image.AsGrayArray3Du();
+    if (byte_image) {
+      DetectFastGrid(*byte_image, options_, &corners_);
+      for (int i = 0; i < corners_.size(); ++i) {
+        PointFeature *f = NewPointFeature(arena_, corners_[i].x,
+                                         corners_[i].y);
+        f->scale = 3.0;
+        f->orientation = 0.0;
+        features->push_back(f);
+      }
+      if (bRotationInvariant_) {
+        fastRotationEstimation(*byte_image, *features);
+      }
+    } else {
+      LOG(ERROR) << "Invalid input image type for FastGridDetector detector";
+    }
+
+    // FAST doesn't have a corresponding descriptor, so there's no extra data
+    // to export.
+    if (data) {
+      *data = NULL;
+    }
+  }
+
+ private:
+  FastGridOptions options_;
+  bool bRotationInvariant_;
+  vector<FastCorner> corners_;  // Kept to reuse its memory between frames.
+};
+
+Detector *CreateFastGridDetector(const FastGridOptions &options,
+                                 bool bRotationInvariant) {
+  return new FastGridDetector(options, bRotationInvariant);
+}
+
+}  // namespace detector
+}  // namespace libmv
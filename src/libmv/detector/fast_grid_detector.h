@@ -0,0 +1,96 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_DETECTOR_FAST_GRID_DETECTOR_H
+#define LIBMV_DETECTOR_FAST_GRID_DETECTOR_H
+
+#include "libmv/base/vector.h"
+#include "libmv/image/image.h"
+
+namespace libmv {
+namespace detector {
+
+class Detector;
+
+// A FAST-9 corner; score is the FAST score, that is the largest barrier for
+// which the pixel is still a corner (see fast9_corner_score).
+struct FastCorner {
+  FastCorner() : x(0), y(0), score(0) {}
+  FastCorner(int x, int y, int score) : x(x), y(y), score(score) {}
+  int x;
+  int y;
+  int score;
+};
+
+struct FastGridOptions {
+  FastGridOptions()
+      : threshold(30), min_threshold(10), max_features(256), cell_size(64) {}
+
+  // Barrier of the corners used to fill the budget left by sparse cells.
+  int threshold;
+  // Lowest barrier a cell can fall back to when it has too few corners.
+  int min_threshold;
+  // Budget of corners over the whole image.
+  int max_features;
+  // Side of the square grid cells, in pixels.
+  int cell_size;
+};
+
+/**
+ * Detects FAST-9 corners and spreads a corner budget over the image.
+ *
+ * The segment test, the scores and the 3x3 non maximum suppression are done
+ * in a single pass over bands of rows (in parallel when OpenMP is enabled).
+ * Each cell of the grid then gets an equal share of the budget: it keeps its
+ * best corners, going down to min_threshold if it has too few corners. The
+ * share left by sparse cells goes to the best remaining corners above
+ * threshold.
+ *
+ * \param[in]  image   The grayscale image.
+ * \param[in]  options Thresholds, budget and grid size.
+ * \param[out] corners The corners, by decreasing score.
+ */
+void DetectFastGrid(const ByteImage &image,
+                    const FastGridOptions &options,
+                    vector<FastCorner> *corners);
+
+/**
+ * Detects all the FAST-9 corners with a score of at least threshold, after
+ * 3x3 non maximum suppression, in raster order.  This is the first stage of
+ * DetectFastGrid.
+ */
+void DetectFast9NonMax(const ByteImage &image,
+                       int threshold,
+                       vector<FastCorner> *corners);
+
+/**
+ * Creates a detector returning the corners of DetectFastGrid.
+ *
+ * \param bRotationInvariant Tell if orientation of detected features must
+ *                            be estimated.
+ */
+Detector *CreateFastGridDetector(const FastGridOptions &options =
+                                     FastGridOptions(),
+                                 bool bRotationInvariant = false);
+
+}  // namespace detector
+}  // namespace libmv
+
+#endif  // LIBMV_DETECTOR_FAST_GRID_DETECTOR_H
@@ -0,0 +1,156 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstdlib>
+#include <set>
+#include <utility>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/fast_grid_detector.h"
+#include "libmv/image/image.h"
+#include "testing/testing.h"
+#include "third_party/fast/fast.h"
+
+namespace libmv {
+namespace detector {
+namespace {
+
+// Blocks of pseudo random intensities in [128 - amplitude, 128 + amplitude].
+void MakeNoiseImage(int width, int height, int amplitude_left,
+                    int amplitude_right, ByteImage *image) {
+  image->Resize(height, width);
+  unsigned int state = 12345;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      state = 1664525u * state + 1013904223u;
+      int amplitude = x < width / 2 ? amplitude_left : amplitude_right;
+      int noise = static_cast<int>((state >> 24) % (2 * amplitude + 1));
+      (*image)(y, x) = 128 - amplitude + noise;
+    }
+  }
+}
+
+TEST(FastGridDetector, SameCornersAsReferenceFast) {
+  ByteImage image;
+  MakeNoiseImage(97, 61, 60, 25, &image);
+  const int threshold = 20;
+
+  int num_corners = 0, num_nonmax = 0;
+  xy *corners = fast9_detect(image.Data(), image.Width(), image.Height(),
+                             image.Width(), threshold, &num_corners);
+  int *scores = fast9_score(image.Data(), image.Width(), corners,
+                            num_corners, threshold);
+  xy *nonmax = nonmax_suppression(corners, scores, num_corners, &num_nonmax);
+  std::set<std::pair<int, int> > expected;
+  for (int i = 0; i < num_nonmax; ++i) {
+    expected.insert(std::make_pair(nonmax[i].y, nonmax[i].x));
+  }
+  free(corners);
+  free(scores);
+  free(nonmax);
+
+  vector<FastCorner> detected;
+  DetectFast9NonMax(image, threshold, &detected);
+  ASSERT_GT(expected.size(), 10);
+  ASSERT_EQ(expected.size(), detected.size());
+  for (int i = 0; i < detected.size(); ++i) {
+    EXPECT_EQ(1, expected.count(std::make_pair(detected[i].y,
+                                               detected[i].x)));
+    if (i > 0) {
+      // Raster order.
+      EXPECT_TRUE(detected[i - 1].y < detected[i].y ||
+                  (detected[i - 1].y == detected[i].y &&
+                   detected[i - 1].x < detected[i].x));
+    }
+  }
+
+  // The scores are those of the binary search of fast9_corner_score.
+  int offsets[16];
+  const int ring_x[16] = {0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+  const int ring_y[16] = {3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1, 0, 1, 2, 3};
+  for (int k = 0; k < 16; ++k) {
+    offsets[k] = ring_x[k] + ring_y[k] * image.Width();
+  }
+  for (int i = 0; i < detected.size(); ++i) {
+    const unsigned char *p = &image(detected[i].y, detected[i].x);
+    EXPECT_EQ(fast9_corner_score(p, offsets, threshold), detected[i].score);
+  }
+}
+
+bool ByScore(const FastCorner &a, const FastCorner &b) {
+  return a.score > b.score;
+}
+
+TEST(FastGridDetector, BudgetIsSpreadOverTheGrid) {
+  // Strong corners on the left half, weak corners on the right half.
+  ByteImage image;
+  MakeNoiseImage(256, 128, 100, 20, &image);
+
+  FastGridOptions options;
+  options.threshold = 30;
+  options.min_threshold = 8;
+  options.max_features = 64;
+  options.cell_size = 64;
+  vector<FastCorner> corners;
+  DetectFastGrid(image, options, &corners);
+
+  ASSERT_EQ(64, corners.size());
+  int right = 0;
+  for (int i = 0; i < corners.size(); ++i) {
+    EXPECT_GE(corners[i].score, options.min_threshold);
+    if (i > 0) {
+      EXPECT_GE(corners[i - 1].score, corners[i].score);
+    }
+    right += corners[i].x >= 128;
+  }
+  // Each of the 4 right cells gets its share of 8 corners, although all of
+  // them are weaker than the corners on the left.
+  EXPECT_EQ(32, right);
+
+  // A global top-N only keeps corners on the left.
+  vector<FastCorner> all;
+  DetectFast9NonMax(image, options.min_threshold, &all);
+  ASSERT_GT(all.size(), 64);
+  std::sort(all.begin(), all.end(), ByScore);
+  for (int i = 0; i < 64; ++i) {
+    EXPECT_LT(all[i].x, 128);
+  }
+}
+
+TEST(FastGridDetector, Detector) {
+  ByteImage *image = new ByteImage;
+  MakeNoiseImage(64, 64, 60, 60, image);
+  FastGridOptions options;
+  options.max_features = 20;
+  scoped_ptr<Detector> detector(CreateFastGridDetector(options));
+  vector<Feature *> features;
+  detector->Detect(Image(image), &features, NULL);
+  EXPECT_EQ(20, features.size());
+  DeleteElements(&features);
+}
+
+}  // namespace
+}  // namespace detector
+}  // namespace libmv
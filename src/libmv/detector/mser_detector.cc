@@ -18,44 +18,443 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
+#include <cmath>
 
 #include "libmv/base/vector.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/correspondence/feature.h"
 #include "libmv/detector/detector.h"
+#include "libmv/detector/mser_detector.h"
 #include "libmv/detector/orientation_detector.h"
 #include "libmv/image/image.h"
-#include "third_party/MserDetector/cvMserDetector.h"
-#include "libmv/numeric/numeric.h"
-#include <Eigen/QR>
-#include "libmv/image/image_io.h"
+#include "libmv/logging/logging.h"
 
 namespace libmv {
 namespace detector {
 
+namespace {
+
+// Area and raw moments of a region.
+struct RegionMoments {
+  void Clear() {
+    area = 0;
+    sx = sy = sxx = sxy = syy = 0;
+  }
+  void Set(int x, int y) {
+    area = 1;
+    sx = x;
+    sy = y;
+    sxx = x * x;
+    sxy = x * y;
+    syy = y * y;
+  }
+  void Add(const RegionMoments &other) {
+    area += other.area;
+    sx += other.sx;
+    sy += other.sy;
+    sxx += other.sxx;
+    sxy += other.sxy;
+    syy += other.syy;
+  }
+  int area;
+  double sx, sy, sxx, sxy, syy;
+};
+
+// The component tree of the lower level sets of an image, with one node per
+// pixel. The parent of a node has a greater or equal level; the nodes whose
+// parent has a greater level (or which are the root) are the "level roots"
+// and stand for the extremal regions. Only the moments of the level roots
+// are meaningful.
+class ComponentTree {
+ public:
+  ComponentTree(int width, int height)
+      : width_(width), height_(height),
+        level_(width * height), parent_(width * height),
+        moments_(width * height), shortcut_(width * height),
+        top_(width * height) {}
+
+  // Sets the levels from the image gray levels, inverted for MSER+.
+  void SetLevels(const ByteImage &image, bool bright) {
+    const unsigned char *data = image.Data();
+    for (int p = 0; p < width_ * height_; ++p) {
+      level_[p] = bright ? 255 - data[p] : data[p];
+    }
+  }
+
+  // Builds the tree of the pixels of the rectangle [x0, x1) x [y0, y1), as
+  // if the rest of the image did not exist. pixels are the pixels of the
+  // rectangle sorted by increasing level (decreasing if reverse).
+  void BuildTile(const int *pixels, int num_pixels, bool reverse,
+                 int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; ++y) {
+      std::fill(&shortcut_[y * width_ + x0], &shortcut_[y * width_ + x1], -1);
+    }
+    for (int i = 0; i < num_pixels; ++i) {
+      const int p = pixels[reverse ? num_pixels - 1 - i : i];
+      const int x = p % width_;
+      const int y = p / width_;
+      parent_[p] = p;
+      shortcut_[p] = p;
+      top_[p] = p;
+      moments_[p].Set(x, y);
+      int neighbors[4];
+      int num_neighbors = 0;
+      if (x > x0)     neighbors[num_neighbors++] = p - 1;
+      if (x + 1 < x1) neighbors[num_neighbors++] = p + 1;
+      if (y > y0)     neighbors[num_neighbors++] = p - width_;
+      if (y + 1 < y1) neighbors[num_neighbors++] = p + width_;
+      int root = p;
+      for (int j = 0; j < num_neighbors; ++j) {
+        if (shortcut_[neighbors[j]] < 0) {
+          continue;  // Not reached yet.
+        }
+        const int other = Find(neighbors[j]);
+        if (other == root) {
+          continue;
+        }
+        // p is the top node of its own component: the top nodes of the
+        // components of the processed neighbors become its children.
+        const int child = top_[other];
+        const bool smaller = moments_[p].area < moments_[child].area;
+        parent_[child] = p;
+        moments_[p].Add(moments_[child]);
+        // Union by size; the top node is kept apart from the set root.
+        if (smaller) {
+          shortcut_[root] = other;
+          root = other;
+        } else {
+          shortcut_[other] = root;
+        }
+        top_[root] = p;
+      }
+    }
+    // Point every node to its level root (parents come later in the order).
+    for (int i = num_pixels - 1; i >= 0; --i) {
+      const int p = pixels[reverse ? num_pixels - 1 - i : i];
+      const int q = parent_[p];
+      if (level_[parent_[q]] == level_[q]) {
+        parent_[p] = parent_[q];
+      }
+    }
+  }
+
+  // Merges the trees of two neighbor pixels of different tiles, by merging
+  // the chains of level roots above them in the order of their levels.
+  void Connect(int a, int b) {
+    int p = LevelRoot(a);
+    int q = LevelRoot(b);
+    // The moments the last passed node of a chain had before the merge, to
+    // be added to the nodes of the other chain.
+    RegionMoments last_p, last_q;
+    last_p.Clear();
+    last_q.Clear();
+    int previous = -1;
+    while (p != q) {
+      int node;
+      if (q < 0 || (p >= 0 && level_[p] < level_[q])) {
+        node = p;
+        last_p = moments_[p];
+        moments_[p].Add(last_q);
+        p = Up(p);
+      } else if (p < 0 || level_[q] < level_[p]) {
+        node = q;
+        last_q = moments_[q];
+        moments_[q].Add(last_p);
+        q = Up(q);
+      } else {
+        // Same level: the two regions are fused into p.
+        node = p;
+        last_p = moments_[p];
+        last_q = moments_[q];
+        moments_[p].Add(last_q);
+        const int up_p = Up(p);
+        const int up_q = Up(q);
+        parent_[q] = p;
+        p = up_p;
+        q = up_q;
+      }
+      if (previous >= 0) {
+        parent_[previous] = node;
+      }
+      previous = node;
+    }
+    if (previous >= 0 && p >= 0) {
+      parent_[previous] = p;  // The common ancestor.
+    }
+  }
+
+  bool IsLevelRoot(int p) const {
+    return parent_[p] == p || level_[parent_[p]] != level_[p];
+  }
+
+  // The level root of the region of p at the level of p.
+  int LevelRoot(int p) {
+    int root = p;
+    while (parent_[root] != root && level_[parent_[root]] == level_[root]) {
+      root = parent_[root];
+    }
+    while (p != root) {
+      int next = parent_[p];
+      parent_[p] = root;
+      p = next;
+    }
+    return root;
+  }
+
+  // The level root of the parent region of the level root p, or -1.
+  int Up(int p) {
+    return parent_[p] == p ? -1 : LevelRoot(parent_[p]);
+  }
+
+  int Level(int p) const { return level_[p]; }
+  const RegionMoments &Moments(int p) const { return moments_[p]; }
+
+  // The index of the pixels, reusing the union-find storage.
+  int *Index() { return &shortcut_[0]; }
+
+ private:
+  int Find(int p) {
+    while (shortcut_[p] != p) {
+      shortcut_[p] = shortcut_[shortcut_[p]];
+      p = shortcut_[p];
+    }
+    return p;
+  }
+
+  int width_, height_;
+  vector<unsigned char> level_;
+  vector<int> parent_;
+  vector<RegionMoments> moments_;
+  // Union-find of the pixels being processed.
+  vector<int> shortcut_;
+  // The top node of the tree of each set.
+  vector<int> top_;
+};
+
+struct ExtremalRegion {
+  int pixel;
+  int parent;
+  int level;
+  int area;
+  float variation;
+  bool stable;
+};
+
+// Finds the MSER of one polarity in a built tree. sorted are all the pixels
+// by increasing level (decreasing if reverse).
+void ExtractMaximallyStableRegions(const vector<int> &sorted,
+                                   bool reverse,
+                                   const MserOptions &options,
+                                   ComponentTree *tree,
+                                   vector<MserRegion> *regions) {
+  const int num_pixels = sorted.size();
+  int *index = tree->Index();
+
+  // The extremal regions, by increasing level: parents come after children.
+  vector<ExtremalRegion> ers;
+  for (int i = 0; i < num_pixels; ++i) {
+    const int p = sorted[reverse ? num_pixels - 1 - i : i];
+    if (tree->IsLevelRoot(p)) {
+      index[p] = ers.size();
+      ExtremalRegion er;
+      er.pixel = p;
+      er.level = tree->Level(p);
+      er.area = tree->Moments(p).area;
+      er.stable = true;
+      ers.push_back(er);
+    }
+  }
+  const int num_ers = ers.size();
+  for (int i = 0; i < num_ers; ++i) {
+    const int up = tree->Up(ers[i].pixel);
+    ers[i].parent = up < 0 ? -1 : index[up];
+  }
+
+  // Variation of the area over delta levels.
+  for (int i = 0; i < num_ers; ++i) {
+    const int max_level = ers[i].level + options.delta;
+    int top = i;
+    while (ers[top].parent >= 0 && ers[ers[top].parent].level <= max_level) {
+      top = ers[top].parent;
+    }
+    ers[i].variation = float(ers[top].area - ers[i].area) / ers[i].area;
+  }
+
+  // Keep the local minima of the variation along the tree; on ties, the
+  // smaller region.
+  for (int i = 0; i < num_ers; ++i) {
+    const int parent = ers[i].parent;
+    if (parent >= 0) {
+      if (ers[i].variation <= ers[parent].variation) {
+        ers[parent].stable = false;
+      } else {
+        ers[i].stable = false;
+      }
+    }
+  }
+  for (int i = 0; i < num_ers; ++i) {
+    if (ers[i].area < options.min_area || ers[i].area > options.max_area ||
+        ers[i].variation > options.max_variation) {
+      ers[i].stable = false;
+    }
+  }
+
+  // Drop the regions too similar to their closest stable ancestor.
+  for (int i = 0; i < num_ers; ++i) {
+    if (!ers[i].stable) {
+      continue;
+    }
+    int ancestor = ers[i].parent;
+    while (ancestor >= 0 && !ers[ancestor].stable) {
+      ancestor = ers[ancestor].parent;
+    }
+    if (ancestor >= 0 && ers[ancestor].area - ers[i].area <
+                         options.min_diversity * ers[ancestor].area) {
+      continue;
+    }
+    const RegionMoments &m = tree->Moments(ers[i].pixel);
+    MserRegion region;
+    region.x = m.sx / m.area;
+    region.y = m.sy / m.area;
+    region.xx = m.sxx / m.area - double(region.x) * region.x;
+    region.xy = m.sxy / m.area - double(region.x) * region.y;
+    region.yy = m.syy / m.area - double(region.y) * region.y;
+    region.area = m.area;
+    region.level = reverse ? 255 - ers[i].level : ers[i].level;
+    region.bright = reverse;
+    regions->push_back(region);
+  }
+}
+
+}  // namespace
+
+void DetectMserRegions(const ByteImage &image,
+                       const MserOptions &options,
+                       vector<MserRegion> *regions) {
+  const int width = image.Width();
+  const int height = image.Height();
+  const int num_pixels = width * height;
+  if (num_pixels == 0) {
+    return;
+  }
+
+  // Counting sort of the pixels by gray level.
+  vector<int> sorted(num_pixels);
+  {
+    const unsigned char *data = image.Data();
+    int first[257] = { 0 };
+    for (int p = 0; p < num_pixels; ++p) {
+      ++first[data[p] + 1];
+    }
+    for (int i = 1; i < 257; ++i) {
+      first[i] += first[i - 1];
+    }
+    for (int p = 0; p < num_pixels; ++p) {
+      sorted[first[data[p]]++] = p;
+    }
+  }
+
+  // Split the sorted pixels by tile, keeping them sorted.
+  const int tile_size = options.tile_size > 0 ?
+      options.tile_size : std::max(width, height);
+  const int tiles_x = (width + tile_size - 1) / tile_size;
+  const int tiles_y = (height + tile_size - 1) / tile_size;
+  const int num_tiles = tiles_x * tiles_y;
+  vector<int> tiled(num_pixels);
+  vector<int> tile_start(num_tiles + 1);
+  std::fill(tile_start.begin(), tile_start.end(), 0);
+  for (int i = 0; i < num_pixels; ++i) {
+    const int p = sorted[i];
+    ++tile_start[(p / width / tile_size) * tiles_x +
+                 (p % width) / tile_size + 1];
+  }
+  for (int t = 0; t < num_tiles; ++t) {
+    tile_start[t + 1] += tile_start[t];
+  }
+  {
+    vector<int> next(num_tiles);
+    std::copy(tile_start.begin(), tile_start.begin() + num_tiles,
+              next.begin());
+    for (int i = 0; i < num_pixels; ++i) {
+      const int p = sorted[i];
+      tiled[next[(p / width / tile_size) * tiles_x +
+                 (p % width) / tile_size]++] = p;
+    }
+  }
+
+  ComponentTree tree(width, height);
+  for (int pass = 0; pass < 2; ++pass) {
+    const bool bright = pass == 1;
+    if ((bright && !options.detect_bright) ||
+        (!bright && !options.detect_dark)) {
+      continue;
+    }
+    tree.SetLevels(image, bright);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int t = 0; t < num_tiles; ++t) {
+      const int x0 = (t % tiles_x) * tile_size;
+      const int y0 = (t / tiles_x) * tile_size;
+      tree.BuildTile(&tiled[tile_start[t]], tile_start[t + 1] - tile_start[t],
+                     bright, x0, y0, std::min(x0 + tile_size, width),
+                     std::min(y0 + tile_size, height));
+    }
+    // Merge the trees of the tiles across the seams.
+    for (int x = tile_size; x < width; x += tile_size) {
+      for (int y = 0; y < height; ++y) {
+        tree.Connect(y * width + x - 1, y * width + x);
+      }
+    }
+    for (int y = tile_size; y < height; y += tile_size) {
+      for (int x = 0; x < width; ++x) {
+        tree.Connect((y - 1) * width + x, y * width + x);
+      }
+    }
+    ExtractMaximallyStableRegions(sorted, bright, options, &tree, regions);
+  }
+}
+
 class MserDetector : public Detector {
  public:
-  MserDetector(bool bRotationInvariant):bRotationInvariant_(bRotationInvariant) {}
+  MserDetector(const MserOptions &options, bool bRotationInvariant)
+      : options_(options), bRotationInvariant_(bRotationInvariant) {}
   virtual ~MserDetector() {}
 
   virtual void Detect(const Image &image,
                       vector<Feature *> *vec_features,
                       DetectorData **data) {
+    const ByteImage *byte_image = image.AsGrayArray3Du();
+    if (!byte_image) {
+      LOG(ERROR) << "Invalid input image type for MSER detector";
+      if (data) {
+        *data = NULL;
+      }
+      return;
+    }
 
-    ByteImage *byte_image = image.AsArray3Du();
-
-    vector<sMserProperties> vec_ellipses;
-    detectPoints(*byte_image, vec_ellipses);
+    vector<MserRegion> regions;
+    DetectMserRegions(*byte_image, options_, &regions);
 
     // Build the output Keypoints :
-    for (size_t i = 0; i < vec_ellipses.size(); ++i)  {
-      const sMserProperties & ellipse = vec_ellipses[i];
-      PointFeature *f = new PointFeature(ellipse._x, ellipse._y);
+    for (int i = 0; i < regions.size(); ++i)  {
+      const MserRegion &region = regions[i];
+      PointFeature *f = NewPointFeature(arena_, region.x, region.y);
+      // Eigen values of the covariance, i.e. the squared half axes.
+      const double half_trace = 0.5 * (region.xx + region.yy);
+      const double d = 0.5 * (region.xx - region.yy);
+      const double root = sqrt(d * d + region.xy * region.xy);
+      const double l1 = half_trace + root;
+      const double l2 = std::max(half_trace - root, 0.0);
       //Use square approximation since we do not have affine PointFeature.
-      f->scale = sqrt(ellipse._l1*ellipse._l2);
-      if (bRotationInvariant_)
-        f->orientation = ellipse._alpha;
-      else
+      f->scale = 2.0 * sqrt(sqrt(l1 * l2));
+      if (bRotationInvariant_) {
+        f->orientation = getCoterminalAngle(
+            0.5 * atan2(2.0 * region.xy, double(region.xx - region.yy)));
+      } else {
         f->orientation = 0.0f;
+      }
       vec_features->push_back(f);
     }
 
@@ -67,12 +466,17 @@ class MserDetector : public Detector {
   }
 
  private:
- bool bRotationInvariant_;
+  MserOptions options_;
+  bool bRotationInvariant_;
 };
 
-Detector *CreateMserDetector(bool bRotationInvariant = false)
-{
-  return new MserDetector(bRotationInvariant);
+Detector *CreateMserDetector(bool bRotationInvariant) {
+  return new MserDetector(MserOptions(), bRotationInvariant);
+}
+
+Detector *CreateMserDetector(const MserOptions &options,
+                             bool bRotationInvariant) {
+  return new MserDetector(options, bRotationInvariant);
 }
 
 } //namespace detector
@@ -21,21 +21,90 @@
 #ifndef LIBMV_DETECTOR_MSER_DETECTOR_H
 #define LIBMV_DETECTOR_MSER_DETECTOR_H
 
+#include "libmv/base/vector.h"
+#include "libmv/image/image.h"
+
 namespace libmv {
 namespace detector {
 
 class Detector;
 
+/// Parameters of the MSER detection, with the usual (OpenCV) defaults.
+struct MserOptions {
+  MserOptions()
+      : delta(5),
+        min_area(60),
+        max_area(14400),
+        max_variation(0.25f),
+        min_diversity(0.2f),
+        detect_dark(true),
+        detect_bright(true),
+        tile_size(256) {}
+
+  /// The stability of a region at level l compares its area with the area of
+  /// its ancestor at level l + delta.
+  int delta;
+  /// Regions out of [min_area, max_area] pixels are discarded.
+  int min_area;
+  int max_area;
+  /// Regions whose relative area variation is above this are discarded.
+  float max_variation;
+  /// A region is discarded if its closest larger MSER is less than
+  /// min_diversity times bigger.
+  float min_diversity;
+  /// MSER- (dark regions on a bright background).
+  bool detect_dark;
+  /// MSER+ (bright regions on a dark background).
+  bool detect_bright;
+  /// The component trees are built in parallel on tiles of this size and
+  /// then merged across the seams; the result does not depend on it. Zero
+  /// builds them on the whole image.
+  int tile_size;
+};
+
+/// A maximally stable extremal region, summarized by its ellipse.
+struct MserRegion {
+  /// Centroid.
+  float x, y;
+  /// Second order central moments, i.e. the covariance of the pixel
+  /// coordinates: [xx xy; xy yy].
+  float xx, xy, yy;
+  int area;
+  /// Gray level at which the region is extracted.
+  int level;
+  /// True for MSER+ (the region is brighter than its border).
+  bool bright;
+};
+
+/**
+ * Extracts the MSER+ and MSER- of an image.
+ *
+ * The component trees of the level sets are built with union-find over the
+ * pixels sorted once by gray level (a counting sort), the MSER- going up and
+ * the MSER+ going down the same array. The area and the moments of the
+ * regions are accumulated as components merge, so that no pixel list is ever
+ * built.
+ *
+ * See: J. Matas, O. Chum, M. Urban and T. Pajdla, "Robust wide baseline
+ *      stereo from maximally stable extremal regions", BMVC 2002, and
+ *      D. Nister and H. Stewenius, "Linear time maximally stable extremal
+ *      regions", ECCV 2008.
+ */
+void DetectMserRegions(const ByteImage &image,
+                       const MserOptions &options,
+                       vector<MserRegion> *regions);
+
 /**
  * Creates a detector that uses the MSER detection algorithm.
- * Implementation of .
- * TODO(pmoulon) Add biblio...
+ * The scale of the features is the geometric mean of the ellipse axes.
  * \param bRotationInvariant Tell if orientation of detected features must
- *                            be estimated.
+ *                            be estimated (from the ellipse major axis).
  */
 Detector *CreateMserDetector(bool bRotationInvariant = true);
+Detector *CreateMserDetector(const MserOptions &options,
+                             bool bRotationInvariant = true);
 
 } // namespace detector
 } // namespace libmv
 
-#endif //LIBMV_DETECTOR_STAR_DETECTOR_H
+#endif //LIBMV_DETECTOR_MSER_DETECTOR_H
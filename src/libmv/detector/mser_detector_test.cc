@@ -0,0 +1,155 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/mser_detector.h"
+#include "libmv/image/image.h"
+#include "testing/testing.h"
+
+namespace libmv {
+namespace detector {
+namespace {
+
+bool RegionLess(const MserRegion &a, const MserRegion &b) {
+  if (a.bright != b.bright) return a.bright < b.bright;
+  if (a.level != b.level) return a.level < b.level;
+  if (a.area != b.area) return a.area < b.area;
+  if (a.x != b.x) return a.x < b.x;
+  return a.y < b.y;
+}
+
+TEST(MserDetector, DarkSquare) {
+  ByteImage image(64, 64);
+  image.Fill(200);
+  for (int y = 22; y < 42; ++y) {
+    for (int x = 22; x < 42; ++x) {
+      image(y, x) = 50;
+    }
+  }
+  MserOptions options;
+  options.detect_bright = false;
+  vector<MserRegion> regions;
+  DetectMserRegions(image, options, &regions);
+
+  ASSERT_EQ(1, regions.size());
+  EXPECT_FALSE(regions[0].bright);
+  EXPECT_EQ(400, regions[0].area);
+  EXPECT_EQ(50, regions[0].level);
+  EXPECT_NEAR(31.5, regions[0].x, 1e-5);
+  EXPECT_NEAR(31.5, regions[0].y, 1e-5);
+  // The variance of a uniform distribution over 20 pixels.
+  EXPECT_NEAR((20 * 20 - 1) / 12.0, regions[0].xx, 1e-3);
+  EXPECT_NEAR(0, regions[0].xy, 1e-3);
+  EXPECT_NEAR((20 * 20 - 1) / 12.0, regions[0].yy, 1e-3);
+}
+
+TEST(MserDetector, BrightEllipse) {
+  ByteImage image(60, 80);
+  image.Fill(30);
+  for (int y = 0; y < 60; ++y) {
+    for (int x = 0; x < 80; ++x) {
+      double dx = (x - 40) / 20.0, dy = (y - 25) / 8.0;
+      if (dx * dx + dy * dy <= 1) {
+        image(y, x) = 220;
+      }
+    }
+  }
+  MserOptions options;
+  options.detect_dark = false;
+  vector<MserRegion> regions;
+  DetectMserRegions(image, options, &regions);
+
+  ASSERT_EQ(1, regions.size());
+  EXPECT_TRUE(regions[0].bright);
+  EXPECT_EQ(220, regions[0].level);
+  EXPECT_NEAR(40, regions[0].x, 1e-3);
+  EXPECT_NEAR(25, regions[0].y, 1e-3);
+  EXPECT_GT(regions[0].xx, 4 * regions[0].yy);
+}
+
+TEST(MserDetector, TilesGiveTheSameRegions) {
+  ByteImage image(90, 100);
+  unsigned int state = 1;
+  for (int y = 0; y < 90; ++y) {
+    for (int x = 0; x < 100; ++x) {
+      state = 1664525u * state + 1013904223u;
+      int noise = (state >> 24) % 16;
+      image(y, x) = 120 + 50 * sin(x / 6.0) * cos(y / 9.0) + noise;
+    }
+  }
+  MserOptions options;
+  options.min_area = 10;
+  options.tile_size = 0;
+  vector<MserRegion> expected;
+  DetectMserRegions(image, options, &expected);
+  EXPECT_GT(expected.size(), 5);
+  std::sort(expected.begin(), expected.end(), RegionLess);
+
+  int tile_sizes[3] = { 7, 16, 33 };
+  for (int k = 0; k < 3; ++k) {
+    options.tile_size = tile_sizes[k];
+    vector<MserRegion> regions;
+    DetectMserRegions(image, options, &regions);
+    std::sort(regions.begin(), regions.end(), RegionLess);
+    ASSERT_EQ(expected.size(), regions.size());
+    for (int i = 0; i < regions.size(); ++i) {
+      EXPECT_EQ(expected[i].bright, regions[i].bright);
+      EXPECT_EQ(expected[i].level, regions[i].level);
+      EXPECT_EQ(expected[i].area, regions[i].area);
+      EXPECT_NEAR(expected[i].x, regions[i].x, 1e-4);
+      EXPECT_NEAR(expected[i].y, regions[i].y, 1e-4);
+      EXPECT_NEAR(expected[i].xx, regions[i].xx, 1e-2);
+      EXPECT_NEAR(expected[i].xy, regions[i].xy, 1e-2);
+      EXPECT_NEAR(expected[i].yy, regions[i].yy, 1e-2);
+    }
+  }
+}
+
+TEST(MserDetector, Detect) {
+  Array3Du image(64, 64);
+  image.Fill(200);
+  for (int y = 10; y < 30; ++y) {
+    for (int x = 20; x < 50; ++x) {
+      image(y, x) = 40;
+    }
+  }
+  scoped_ptr<Detector> detector(CreateMserDetector(true));
+  vector<Feature *> features;
+  Image im(new Array3Du(image));
+  detector->Detect(im, &features, NULL);
+
+  ASSERT_GE(features.size(), 1);
+  PointFeature *feature = static_cast<PointFeature *>(features[0]);
+  EXPECT_NEAR(34.5, feature->x(), 1e-4);
+  EXPECT_NEAR(19.5, feature->y(), 1e-4);
+  // The major axis is horizontal.
+  EXPECT_NEAR(0, feature->orientation, 1e-4);
+  DeleteElements(&features);
+}
+
+}  // namespace
+}  // namespace detector
+}  // namespace libmv
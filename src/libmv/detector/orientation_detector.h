@@ -23,6 +23,7 @@
 
 #include "libmv/base/vector.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/detector/orientation_histogram.h"
 
 namespace libmv {
 
@@ -61,6 +62,9 @@ void fastRotationEstimation(const Image & ima, vector<Feature *> & features)
   const int indY[16] = {0,1,2,3,3,3,2,1,0,-1,-2,-3,-3,-3,-2,-1};
 
   // For each feature estimate the rotation angle.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (int j=0; j < features.size(); ++j) {
     double dx = 0.0;
     double dy = 0.0;
@@ -85,56 +89,21 @@ void fastRotationEstimation(const Image & ima, vector<Feature *> & features)
 
 /// Detect the orientation of a given feature.
 /// A simplified scheme as done in SIFT :
-/// Magnitude and direction of the gradient are computed for every pixel
-///   in a neighboring circular region around the keypoint.
-/// Each sample give an orientation and a weight that are added in an
-///   orientation histogram of 36 bins is formed (each bin covering 10 deg).
+/// Magnitude and direction of the gradient are computed once for every pixel
+///   of the image (see GradientMaps).
+/// The samples of a neighboring circular region around each keypoint give an
+///   orientation and a weight that are added in an orientation histogram of
+///   36 bins (each bin covering 10 deg).
 /// Dominating orientation is detected as the maximum peak location.
+/// Use AssignOrientations directly to keep the secondary peaks.
 ///
 template<class Image>
-void gradientBoxesRotationEstimation(const Image & ima, vector<Feature *> & features)
+void gradientBoxesRotationEstimation(const Image & ima, vector<Feature *> & features,
+                                     FeatureArena *arena = NULL)
 {
-  vector<float> histogram(36);
-
-  // Sum up direction weighted (gradient value).
-  for (int j = 0; j < features.size(); ++j) {
-    const int x = ((PointFeature*)features[j])->x(),
-              y = ((PointFeature*)features[j])->y();
-    const int offset = 3*((PointFeature*)features[j])->scale;
-    std::fill(histogram.begin(),histogram.end(),0.0f);
-    for (int r = y-offset; r <= y+offset; ++r)  {
-      for (int c = x-offset; c <= x+offset; ++c)  {
-        if (c > 0 && r > 0 && (c<ima.Width()-1) && (r<ima.Height()-1))  {
-
-          double offsetX = c - x;
-          double offsetY = r - y;
-          double circularW = sqrt(offsetX*offsetX + offsetY*offsetY)/ offset;
-
-          if (circularW <= 1.0)  {
-
-            double tmpX = ima(r,c+1) - ima(r,c-1);
-            double tmpY = ima(r+1,c) - ima(r-1,c);
-            double magnit = sqrt(tmpX*tmpX + tmpY*tmpY);
-            double orient = getCoterminalAngle(atan2(tmpY, tmpX));
-
-            double value = magnit * circularW;
-            int histindex = (int)(orient* 180.0 / M_PI)/10;
-            histogram[histindex] += value;
-          }
-        }
-      }
-    }
-    // Locate peak in the weighted angle histogram.
-    int index = 0;
-    for (int k = 1; k < 36; ++k) {
-      if (histogram[index] < histogram[k])
-        index = k;
-    }
-    // Todo(pmoulon) subpixel angle according histogram value.
-    // http://people.equars.com/~marco/poli/phd/node47.html
-    ((PointFeature*)features[j])->orientation =
-        getCoterminalAngle(index*10.0 * M_PI / 180.0);
-  }
+  GradientMaps maps;
+  maps.Compute(ima);
+  AssignOrientations(maps, OrientationOptions(), &features, arena);
 }
 
 
@@ -0,0 +1,194 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
+#include "libmv/detector/orientation_histogram.h"
+
+namespace libmv {
+namespace detector {
+
+namespace {
+
+template<typename T>
+void ComputeGradientMaps(const Array3D<T> &image,
+                         FloatImage *magnitude,
+                         FloatImage *orientation) {
+  const int width = image.Width();
+  const int height = image.Height();
+  magnitude->Resize(height, width);
+  orientation->Resize(height, width);
+  magnitude->Fill(0);
+  orientation->Fill(0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int y = 1; y < height - 1; ++y) {
+    for (int x = 1; x < width - 1; ++x) {
+      double dx = double(image(y, x + 1)) - image(y, x - 1);
+      double dy = double(image(y + 1, x)) - image(y - 1, x);
+      double angle = atan2(dy, dx);
+      if (angle < 0) {
+        angle += 2 * M_PI;
+      }
+      (*magnitude)(y, x) = sqrt(dx * dx + dy * dy);
+      (*orientation)(y, x) = angle;
+    }
+  }
+}
+
+}  // namespace
+
+void GradientMaps::Compute(const ByteImage &image) {
+  ComputeGradientMaps(image, &magnitude_, &orientation_);
+}
+
+void GradientMaps::Compute(const FloatImage &image) {
+  ComputeGradientMaps(image, &magnitude_, &orientation_);
+}
+
+void ComputeOrientationHistogram(const GradientMaps &maps,
+                                 const PointFeature &feature,
+                                 const OrientationOptions &options,
+                                 float *histogram) {
+  const int num_bins = options.num_bins;
+  std::fill(histogram, histogram + num_bins, 0.0f);
+
+  const int x = feature.x();
+  const int y = feature.y();
+  const int radius = options.window_scale * feature.scale;
+  if (radius <= 0) {
+    return;
+  }
+  const float radius2 = radius * radius;
+  const float inverse_two_sigma2 = 1.0f / (2 * 0.25f * radius2);
+  const float bins_per_radian = num_bins / (2 * M_PI);
+  const int r0 = std::max(y - radius, 0);
+  const int r1 = std::min(y + radius, maps.Height() - 1);
+  const int c0 = std::max(x - radius, 0);
+  const int c1 = std::min(x + radius, maps.Width() - 1);
+  for (int r = r0; r <= r1; ++r) {
+    const float dy2 = (r - y) * (r - y);
+    for (int c = c0; c <= c1; ++c) {
+      const float d2 = dy2 + (c - x) * (c - x);
+      if (d2 > radius2) {
+        continue;
+      }
+      int bin = static_cast<int>(maps.Orientation(r, c) * bins_per_radian);
+      bin = std::min(bin, num_bins - 1);
+      histogram[bin] += maps.Magnitude(r, c) * exp(-d2 * inverse_two_sigma2);
+    }
+  }
+}
+
+void FindOrientationPeaks(const float *histogram,
+                          const OrientationOptions &options,
+                          vector<float> *orientations) {
+  const int num_bins = options.num_bins;
+  orientations->clear();
+  int highest = 0;
+  for (int i = 1; i < num_bins; ++i) {
+    if (histogram[i] > histogram[highest]) {
+      highest = i;
+    }
+  }
+  // Local maxima, the highest one first.
+  vector<std::pair<float, int> > peaks;
+  peaks.push_back(std::make_pair(-histogram[highest], highest));
+  if (options.max_orientations > 1) {
+    const float threshold = options.peak_ratio * histogram[highest];
+    for (int i = 0; i < num_bins; ++i) {
+      float previous = histogram[(i + num_bins - 1) % num_bins];
+      float next = histogram[(i + 1) % num_bins];
+      if (i != highest && histogram[i] >= threshold && histogram[i] > 0 &&
+          histogram[i] > previous && histogram[i] > next) {
+        peaks.push_back(std::make_pair(-histogram[i], i));
+      }
+    }
+    std::sort(peaks.begin() + 1, peaks.end());
+  }
+  const float radians_per_bin = 2 * M_PI / num_bins;
+  for (int k = 0; k < peaks.size() && k < options.max_orientations; ++k) {
+    const int i = peaks[k].second;
+    float bin = i;
+    if (options.interpolate_peaks) {
+      float previous = histogram[(i + num_bins - 1) % num_bins];
+      float next = histogram[(i + 1) % num_bins];
+      float curvature = previous - 2 * histogram[i] + next;
+      if (curvature < 0) {
+        bin += 0.5f * (previous - next) / curvature;
+      }
+    }
+    float orientation = bin * radians_per_bin;
+    if (orientation < 0) {
+      orientation += 2 * M_PI;
+    } else if (orientation >= 2 * M_PI) {
+      orientation -= 2 * M_PI;
+    }
+    orientations->push_back(orientation);
+  }
+}
+
+void AssignOrientations(const GradientMaps &maps,
+                        const OrientationOptions &options,
+                        vector<Feature *> *features,
+                        FeatureArena *arena) {
+  const int num_features = features->size();
+  vector<vector<float> > secondary(
+      options.max_orientations > 1 ? num_features : 0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    vector<float> histogram(options.num_bins);
+    vector<float> orientations;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+    for (int i = 0; i < num_features; ++i) {
+      PointFeature *feature = dynamic_cast<PointFeature *>((*features)[i]);
+      if (!feature) {
+        continue;
+      }
+      ComputeOrientationHistogram(maps, *feature, options, &histogram[0]);
+      FindOrientationPeaks(&histogram[0], options, &orientations);
+      feature->orientation = orientations[0];
+      if (orientations.size() > 1) {
+        secondary[i].resize(orientations.size() - 1);
+        std::copy(orientations.begin() + 1, orientations.end(),
+                  secondary[i].begin());
+      }
+    }
+  }
+  for (int i = 0; i < secondary.size(); ++i) {
+    for (int j = 0; j < secondary[i].size(); ++j) {
+      PointFeature *copy = NewPointFeature(arena, 0, 0);
+      *copy = *static_cast<PointFeature *>((*features)[i]);
+      copy->orientation = secondary[i][j];
+      features->push_back(copy);
+    }
+  }
+}
+
+}  // namespace detector
+}  // namespace libmv
@@ -0,0 +1,113 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_DETECTOR_ORIENTATION_HISTOGRAM_H
+#define LIBMV_DETECTOR_ORIENTATION_HISTOGRAM_H
+
+#include "libmv/base/vector.h"
+#include "libmv/image/image.h"
+
+namespace libmv {
+
+class Feature;
+class FeatureArena;
+class PointFeature;
+
+namespace detector {
+
+/**
+ * Gradient magnitude and orientation of every pixel of an image.  They are
+ * computed once per image (or pyramid level) and shared by all the features,
+ * instead of calling atan2 and sqrt again for each pixel of each feature
+ * window.  Gradients are central differences; they are zero on the border.
+ */
+class GradientMaps {
+ public:
+  void Compute(const ByteImage &image);
+  void Compute(const FloatImage &image);
+
+  int Width() const { return magnitude_.Width(); }
+  int Height() const { return magnitude_.Height(); }
+
+  float Magnitude(int y, int x) const { return magnitude_(y, x); }
+  // In [0, 2 pi).
+  float Orientation(int y, int x) const { return orientation_(y, x); }
+
+ private:
+  FloatImage magnitude_;
+  FloatImage orientation_;
+};
+
+struct OrientationOptions {
+  OrientationOptions()
+      : num_bins(36),
+        window_scale(3),
+        max_orientations(1),
+        peak_ratio(0.8f),
+        interpolate_peaks(false) {}
+
+  // Bin i covers [i, i + 1) * 2 pi / num_bins.
+  int num_bins;
+  // Radius of the circular window, in units of the feature scale.
+  float window_scale;
+  // More than 1 keeps the secondary peaks, as SIFT does.
+  int max_orientations;
+  // Secondary peaks must reach this fraction of the highest peak.
+  float peak_ratio;
+  // Refines the peaks with a parabola through the neighbor bins.
+  bool interpolate_peaks;
+};
+
+/**
+ * Accumulates the gradient orientations of the circular window around the
+ * feature, weighted by the gradient magnitude and a Gaussian of half the
+ * window radius.  histogram must have options.num_bins entries.
+ */
+void ComputeOrientationHistogram(const GradientMaps &maps,
+                                 const PointFeature &feature,
+                                 const OrientationOptions &options,
+                                 float *histogram);
+
+/**
+ * Orientations (radians) of the peaks of a histogram, strongest first: the
+ * highest bin, then at most options.max_orientations - 1 other local maxima
+ * above options.peak_ratio times the highest bin.
+ */
+void FindOrientationPeaks(const float *histogram,
+                          const OrientationOptions &options,
+                          vector<float> *orientations);
+
+/**
+ * Sets the orientation of the point features to their dominant gradient
+ * orientation; the other features are left unchanged.  Features are
+ * processed in parallel.  With several orientations per feature, a copy of
+ * the feature is appended to features for each secondary peak, in the order
+ * of the features.  The copies are allocated in arena, or with new if arena
+ * is NULL, as the detectors allocate their features.
+ */
+void AssignOrientations(const GradientMaps &maps,
+                        const OrientationOptions &options,
+                        vector<Feature *> *features,
+                        FeatureArena *arena = NULL);
+
+}  // namespace detector
+}  // namespace libmv
+
+#endif  // LIBMV_DETECTOR_ORIENTATION_HISTOGRAM_H
@@ -0,0 +1,158 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
+#include "libmv/detector/orientation_histogram.h"
+#include "testing/testing.h"
+
+namespace libmv {
+namespace detector {
+namespace {
+
+TEST(GradientMaps, MatchesCentralDifferences) {
+  FloatImage image(5, 6);
+  for (int y = 0; y < 5; ++y) {
+    for (int x = 0; x < 6; ++x) {
+      image(y, x) = 2 * x - 3 * y + x * y;
+    }
+  }
+  GradientMaps maps;
+  maps.Compute(image);
+  EXPECT_EQ(6, maps.Width());
+  EXPECT_EQ(5, maps.Height());
+  EXPECT_EQ(0, maps.Magnitude(0, 2));
+  EXPECT_EQ(0, maps.Magnitude(2, 5));
+  for (int y = 1; y < 4; ++y) {
+    for (int x = 1; x < 5; ++x) {
+      double dx = image(y, x + 1) - image(y, x - 1);
+      double dy = image(y + 1, x) - image(y - 1, x);
+      double angle = atan2(dy, dx);
+      if (angle < 0) {
+        angle += 2 * M_PI;
+      }
+      EXPECT_NEAR(sqrt(dx * dx + dy * dy), maps.Magnitude(y, x), 1e-5);
+      EXPECT_NEAR(angle, maps.Orientation(y, x), 1e-5);
+    }
+  }
+}
+
+TEST(FindOrientationPeaks, KeepsSecondaryPeaksStrongestFirst) {
+  float histogram[36] = {0};
+  histogram[4] = 10;
+  histogram[20] = 9;
+  histogram[21] = 8.5;  // Not a local maximum.
+  histogram[30] = 7;    // Below the peak ratio.
+  OrientationOptions options;
+  vector<float> orientations;
+  FindOrientationPeaks(histogram, options, &orientations);
+  ASSERT_EQ(1, orientations.size());
+  EXPECT_NEAR(4 * M_PI / 18, orientations[0], 1e-6);
+
+  options.max_orientations = 4;
+  FindOrientationPeaks(histogram, options, &orientations);
+  ASSERT_EQ(2, orientations.size());
+  EXPECT_NEAR(4 * M_PI / 18, orientations[0], 1e-6);
+  EXPECT_NEAR(20 * M_PI / 18, orientations[1], 1e-6);
+}
+
+TEST(FindOrientationPeaks, InterpolatesAcrossTheWrapAround) {
+  float histogram[36] = {0};
+  histogram[35] = 3;
+  histogram[0] = 4;
+  histogram[1] = 1;
+  OrientationOptions options;
+  options.interpolate_peaks = true;
+  vector<float> orientations;
+  FindOrientationPeaks(histogram, options, &orientations);
+  ASSERT_EQ(1, orientations.size());
+  // The parabola through bins 35, 0 and 1 peaks at bin -0.25.
+  EXPECT_NEAR(2 * M_PI - 0.25 * M_PI / 18, orientations[0], 1e-5);
+}
+
+TEST(AssignOrientations, AppendsCopiesForSecondaryPeaks) {
+  // A vertical ridge: gradients point left on one side, right on the other.
+  ByteImage image(15, 15);
+  image.Fill(0);
+  for (int y = 0; y < 15; ++y) {
+    image(y, 7) = 255;
+  }
+  GradientMaps maps;
+  maps.Compute(image);
+
+  PointFeature *feature = new PointFeature(7, 7);
+  feature->scale = 2;
+  vector<Feature *> features;
+  features.push_back(feature);
+  OrientationOptions options;
+  options.max_orientations = 2;
+  AssignOrientations(maps, options, &features);
+
+  ASSERT_EQ(2, features.size());
+  PointFeature *copy = static_cast<PointFeature *>(features[1]);
+  EXPECT_EQ(feature->x(), copy->x());
+  EXPECT_EQ(feature->y(), copy->y());
+  float orientations[2] = { feature->orientation, copy->orientation };
+  std::sort(orientations, orientations + 2);
+  EXPECT_NEAR(0, orientations[0], 1e-6);
+  EXPECT_NEAR(M_PI, orientations[1], 1e-6);
+  DeleteElements(&features);
+}
+
+// A feature which is not a point.
+class OtherFeature : public Feature {
+};
+
+TEST(AssignOrientations, AllocatesCopiesInTheArena) {
+  ByteImage image(15, 15);
+  image.Fill(0);
+  for (int y = 0; y < 15; ++y) {
+    image(y, 7) = 255;
+  }
+  GradientMaps maps;
+  maps.Compute(image);
+
+  FeatureArena arena;
+  PointFeature *feature = arena.NewPointFeature(7, 7);
+  feature->scale = 2;
+  OtherFeature other;
+  vector<Feature *> features;
+  features.push_back(&other);
+  features.push_back(feature);
+  OrientationOptions options;
+  options.max_orientations = 2;
+  AssignOrientations(maps, options, &features, &arena);
+
+  // Other features are skipped, the copy of the point is in the arena.
+  ASSERT_EQ(3, features.size());
+  EXPECT_EQ(2, arena.NumPointFeatures());
+  PointFeature *copy = static_cast<PointFeature *>(features[2]);
+  EXPECT_EQ(feature->x(), copy->x());
+  EXPECT_EQ(feature->scale, copy->scale);
+  EXPECT_NE(feature->orientation, copy->orientation);
+}
+
+}  // namespace
+}  // namespace detector
+}  // namespace libmv
@@ -38,7 +38,7 @@ class StarDetector : public Detector {
                       vector<Feature *> *features,
                       DetectorData **data) {
 
-    ByteImage *byte_image = image.AsArray3Du();
+    const ByteImage *byte_image = image.AsGrayArray3Du();
 
     FloatImage responses( byte_image->Height(), byte_image->Width(), 1 );
     ShortImage sizes( byte_image->Height(), byte_image->Width(), 1 );
@@ -46,12 +46,13 @@ class StarDetector : public Detector {
     int iBorder = icvStarDetectorComputeResponses( *byte_image, &responses, &sizes, 45 );
 
     if (iBorder >= 0)
-        icvStarDetectorSuppressNonmax( responses, sizes, features, iBorder);
+        icvStarDetectorSuppressNonmax( responses, sizes, features, arena_,
+                                       iBorder);
 
     if (bRotationInvariant_)
     {
       // rotation response is more stable on response image
-      gradientBoxesRotationEstimation(responses,*features);
+      gradientBoxesRotationEstimation(responses,*features,arena_);
     }
 
     // STAR doesn't have a corresponding descriptor, so there's no extra data
@@ -21,6 +21,7 @@
 #include "libmv/logging/logging.h"
 #include "libmv/detector/detector.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_arena.h"
 #include "libmv/image/image.h"
 #include "libmv/image/surf.h"
 
@@ -36,7 +37,7 @@ class SurfDetector : public Detector {
   virtual void Detect(const Image &image,
                       vector<Feature *> *features,
                       DetectorData **data) {
-    ByteImage *byte_image = image.AsArray3Du();
+    const ByteImage *byte_image = image.AsGrayArray3Du();
     //TODO(pmoulon) Assert that byte_image is valid.
 
     Matu integral_image;
@@ -47,7 +48,8 @@ class SurfDetector : public Detector {
                            &detections);
 
     for (int i = 0; i < detections.size(); ++i) {
-      PointFeature *f = new PointFeature(detections[i].x(), detections[i].y());
+      PointFeature *f = NewPointFeature(arena_, detections[i].x(),
+                                        detections[i].y());
       f->scale = detections[i].scale;
       f->orientation = detections[i].orientation;
       features->push_back(f);
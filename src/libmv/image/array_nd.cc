@@ -21,6 +21,7 @@
 #include <iostream>
 
 #include "libmv/image/image.h"
+#include "libmv/image/pixel_kernels.h"
 
 namespace libmv {
 
@@ -28,21 +29,20 @@ void FloatArrayToScaledByteArray(const Array3Df &float_array,
                                  Array3Du *byte_array,
                                  bool automatic_range_detection
                                 ) {
+  if (!automatic_range_detection) {
+    ConvertImage(float_array, byte_array);
+    return;
+  }
   byte_array->ResizeLike(float_array);
   float minval =  HUGE_VAL;
   float maxval = -HUGE_VAL;
-  if (automatic_range_detection) {
-    for (int i = 0; i < float_array.Height(); ++i) {
-      for (int j = 0; j < float_array.Width(); ++j) {
-        for (int k = 0; k < float_array.Depth(); ++k) {
-          minval = std::min(minval, float_array(i,j,k));
-          maxval = std::max(maxval, float_array(i,j,k));
-        }
+  for (int i = 0; i < float_array.Height(); ++i) {
+    for (int j = 0; j < float_array.Width(); ++j) {
+      for (int k = 0; k < float_array.Depth(); ++k) {
+        minval = std::min(minval, float_array(i,j,k));
+        maxval = std::max(maxval, float_array(i,j,k));
       }
     }
-  } else {
-    minval = 0;
-    maxval = 1;
   }
   for (int i = 0; i < float_array.Height(); ++i) {
     for (int j = 0; j < float_array.Width(); ++j) {
@@ -56,14 +56,7 @@ void FloatArrayToScaledByteArray(const Array3Df &float_array,
 
 void ByteArrayToScaledFloatArray(const Array3Du &byte_array,
                                  Array3Df *float_array) {
-  float_array->ResizeLike(byte_array);
-  for (int i = 0; i < byte_array.Height(); ++i) {
-    for (int j = 0; j < byte_array.Width(); ++j) {
-      for (int k = 0; k < byte_array.Depth(); ++k) {
-	      (*float_array)(i,j,k) = float(byte_array(i,j,k)) / 255.0f;
-      }
-    }
-  }
+  ConvertImage(byte_array, float_array);
 }
 
 void SplitChannels(const Array3Df &input,
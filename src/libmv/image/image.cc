@@ -21,9 +21,138 @@
 #include <iostream>
 
 #include "libmv/image/image.h"
+#include "libmv/image/pixel_kernels.h"
 
 namespace libmv {
 
-// TODO(keir): put something useful here!
+int Image::MemorySizeInBytes() {
+  int size;
+  switch (array_type_)
+  {
+    case BYTE:
+      size = As<unsigned char>()->MemorySizeInBytes();
+    break;
+    case FLOAT:
+      size = As<float>()->MemorySizeInBytes();
+    break;
+    case INT:
+      size = As<int>()->MemorySizeInBytes();
+    break;
+    case SHORT:
+      size = As<short>()->MemorySizeInBytes();
+    break;
+  default :
+    size = 0;
+    assert(0);
+  }
+  if (gray_bytes_) size += gray_bytes_->MemorySizeInBytes();
+  if (scaled_floats_) size += scaled_floats_->MemorySizeInBytes();
+  if (gray_floats_) size += gray_floats_->MemorySizeInBytes();
+  size += sizeof(*this);
+  return size;
+}
+
+Image::~Image() {
+  DeleteArray();
+  InvalidateConversions();
+}
+
+Image& Image::operator= (const Image& f)  {
+  if (this != &f) {
+    DeleteArray();
+    InvalidateConversions();
+    array_type_ = f.array_type_;
+    switch (array_type_)
+    {
+      case BYTE:
+        array_ = new Array3Du(*f.As<unsigned char>());
+      break;
+      case FLOAT:
+        array_ = new Array3Df(*f.As<float>());
+      break;
+      case INT:
+        array_ = new Array3Di(*f.As<int>());
+      break;
+      case SHORT:
+        array_ = new Array3Ds(*f.As<short>());
+      break;
+      default:
+        assert(0);
+    }
+  }
+  return *this;
+}
+
+void Image::DeleteArray() {
+  switch (array_type_)
+    {
+      case BYTE:
+        delete As<unsigned char>();
+      break;
+      case FLOAT:
+        delete As<float>();
+      break;
+      case INT:
+        delete As<int>();
+      break;
+      case SHORT:
+        delete As<short>();
+      break;
+      default:
+      break;
+    }
+  array_ = NULL;
+}
+
+namespace {
+
+// Converts an array to a new array of another format.
+template<typename In, typename Out>
+Array3D<Out> *ConvertedArray(const Array3D<In> &in, bool gray) {
+  Array3D<Out> *out = new Array3D<Out>;
+  if (gray) {
+    ConvertToGray(in, out);
+  } else {
+    ConvertImage(in, out);
+  }
+  return out;
+}
+
+}  // namespace
+
+// Returns the view of an image in the format Out, computing it in cache if
+// the image has another format.
+template<typename Out>
+const Array3D<Out> *Image::Converted(bool gray, Array3D<Out> **cache) const {
+  if (As<Out>() && (!gray || As<Out>()->Depth() == 1)) {
+    return As<Out>();
+  }
+#ifdef _OPENMP
+#pragma omp critical(image_conversion)
+#endif
+  {
+    if (!*cache) {
+      if (As<unsigned char>()) {
+        *cache = ConvertedArray<unsigned char, Out>(*As<unsigned char>(),
+                                                    gray);
+      } else if (As<float>()) {
+        *cache = ConvertedArray<float, Out>(*As<float>(), gray);
+      }
+    }
+  }
+  return *cache;
+}
+
+const Array3Du *Image::AsGrayArray3Du() const {
+  return Converted(true, &gray_bytes_);
+}
+
+const Array3Df *Image::AsScaledArray3Df() const {
+  return Converted(false, &scaled_floats_);
+}
+
+const Array3Df *Image::AsGrayArray3Df() const {
+  return Converted(true, &gray_floats_);
+}
 
 }  // namespace libmv
@@ -34,17 +34,31 @@ typedef Array3Df FloatImage;
 typedef Array3Di IntImage;
 typedef Array3Ds ShortImage;
 
+class Image;
+
+// The DataType of the arrays of a pixel type.
+template<typename T> struct ImageDataType;
+
 // An image class that is a thin wrapper around Array3D's of various types.
+//
+// Consumers which need a given format (e.g. gray bytes for the detectors)
+// should use the AsGray* / AsScaled* views: the conversion is done on the
+// first request and shared by the following ones.
 // TODO(keir): Decide if we should add reference counting semantics... Maybe it
 // is the best solution after all.
 class Image {
  public:
 
   // Create an image from an array. The image takes ownership of the array.
-  Image(Array3Du *array) : array_type_(BYTE), array_(array) {}
-  Image(Array3Df *array) : array_type_(FLOAT), array_(array) {}
+  Image(Array3Du *array) : array_type_(BYTE), array_(array) {
+    ClearConversions();
+  }
+  Image(Array3Df *array) : array_type_(FLOAT), array_(array) {
+    ClearConversions();
+  }
 
   Image(const Image &img): array_type_(NONE), array_(NULL) {
+    ClearConversions();
     *this = img;
   }
 
@@ -54,104 +68,90 @@ class Image {
     BYTE,
     FLOAT,
     INT,
-    SHORT,
+    SHORT
   };
 
-  // Size in bytes that the image takes in memory.
-  int MemorySizeInBytes() {
-    int size;
-    switch (array_type_)
-    {
-      case BYTE:
-        size = reinterpret_cast<Array3Du *>(array_)->MemorySizeInBytes();
-      break;
-      case FLOAT:
-        size = reinterpret_cast<Array3Df *>(array_)->MemorySizeInBytes();
-      break;
-      case INT:
-        size = reinterpret_cast<Array3Di *>(array_)->MemorySizeInBytes();
-      break;
-      case SHORT:
-        size = reinterpret_cast<Array3Ds *>(array_)->MemorySizeInBytes();
-      break;
-    default :
-      size = 0;
-      assert(0);
-    }
-    size += sizeof(*this);
-    return size;
-  }
+  // Size in bytes that the image takes in memory, conversions included.
+  int MemorySizeInBytes();
 
-  ~Image() {
-    switch (array_type_)
-      {
-        case BYTE:
-          delete reinterpret_cast<Array3Du *>(array_);
-
-        break;
-        case FLOAT:
-          delete reinterpret_cast<Array3Df *>(array_);
+  ~Image();
 
-        break;
-        case INT:
-          delete reinterpret_cast<Array3Di *>(array_);
+  Image& operator= (const Image& f);
 
-        break;
-        case SHORT:
-          delete reinterpret_cast<Array3Ds *>(array_);
-
-        break;
-        default:
-          assert(0);
-      }
-  }
-
-  Image& operator= (const Image& f)  {
-    if (this != &f) {
-      array_type_ = f.array_type_;
-      switch (array_type_)
-      {
-        case BYTE:
-          delete reinterpret_cast<Array3Du *>(array_);
-          array_ = new Array3Du( *(Array3Du *)f.array_);
-        break;
-        case FLOAT:
-          delete reinterpret_cast<Array3Df *>(array_);
-          array_ = new Array3Df( *(Array3Df *)f.array_);
-        break;
-        case INT:
-          delete reinterpret_cast<Array3Di *>(array_);
-          array_ = new Array3Di( *(Array3Di *)f.array_);
-        break;
-        case SHORT:
-          delete reinterpret_cast<Array3Ds *>(array_);
-          array_ = new Array3Ds( *(Array3Ds *)f.array_);
-        break;
-        default:
-          assert(0);
-      }
-    }
-    return *this;
-  }
-
-  Array3Du *AsArray3Du() const {
-    if (array_type_ == BYTE) {
-      return reinterpret_cast<Array3Du *>(array_);
+  // The array of the image if its pixels are of type T, NULL otherwise.
+  template<typename T>
+  Array3D<T> *As() const {
+    if (array_type_ == ImageDataType<T>::value) {
+      return reinterpret_cast<Array3D<T> *>(array_);
     }
     return NULL;
   }
 
-  Array3Df *AsArray3Df() const {
-    if (array_type_ == FLOAT) {
-      return reinterpret_cast<Array3Df *>(array_);
-    }
-    return NULL;
+  Array3Du *AsArray3Du() const;
+  Array3Df *AsArray3Df() const;
+
+  // The image as one channel of bytes in [0, 255].  Color images are
+  // converted to gray levels, float images in [0, 1] are scaled.  Returns
+  // NULL for the other pixel types.
+  const Array3Du *AsGrayArray3Du() const;
+
+  // The image as floats in [0, 1], with the channels of the image.
+  const Array3Df *AsScaledArray3Df() const;
+
+  // The image as one channel of floats in [0, 1].
+  const Array3Df *AsGrayArray3Df() const;
+
+  // Drops the converted views.  The views are computed once, so code that
+  // writes to the pixels through As() / AsArray3Du() / AsArray3Df() after a
+  // view was requested must call it for the next request to see the change.
+  void InvalidateConversions() {
+    delete gray_bytes_;
+    delete scaled_floats_;
+    delete gray_floats_;
+    ClearConversions();
   }
 
  private:
+  void ClearConversions() {
+    gray_bytes_ = NULL;
+    scaled_floats_ = NULL;
+    gray_floats_ = NULL;
+  }
+
+  void DeleteArray();
+
+  template<typename Out>
+  const Array3D<Out> *Converted(bool gray, Array3D<Out> **cache) const;
+
   DataType array_type_;
   BaseArray *array_;
+
+  // Cached conversions, NULL until requested.
+  mutable Array3Du *gray_bytes_;
+  mutable Array3Df *scaled_floats_;
+  mutable Array3Df *gray_floats_;
+};
+
+template<> struct ImageDataType<unsigned char> {
+  static const Image::DataType value = Image::BYTE;
+};
+template<> struct ImageDataType<float> {
+  static const Image::DataType value = Image::FLOAT;
 };
+template<> struct ImageDataType<int> {
+  static const Image::DataType value = Image::INT;
+};
+template<> struct ImageDataType<short> {
+  static const Image::DataType value = Image::SHORT;
+};
+
+inline Array3Du *Image::AsArray3Du() const {
+  return As<unsigned char>();
+}
+
+inline Array3Df *Image::AsArray3Df() const {
+  return As<float>();
+}
 
 }  // namespace libmv
 
@@ -22,6 +22,7 @@
 #define LIBMV_IMAGE_IMAGE_CONVERTER_H
 
 #include "libmv/image/array_nd.h"
+#include "libmv/image/pixel_kernels.h"
 
 namespace libmv{
 
@@ -55,6 +56,13 @@ void Rgb2Gray(const ImageIn & imaIn, ImageOut * imaOut) {
   }
 }
 
+// 8 bits RGB to gray conversion, with fixed point weights.
+inline void Rgb2Gray(const Array3Du &imaIn, Array3Du *imaOut) {
+  assert(imaIn.Depth() == 3);
+  imaOut->Resize(imaIn.Height(), imaIn.Width(), 1);
+  RgbToGray(imaIn.Data(), imaOut->Data(), imaOut->Size());
+}
+
 } // namespace libmv
 
 #endif  // LIBMV_IMAGE_IMAGE_CONVERTER_H
@@ -29,6 +29,7 @@ extern "C" {
 
 #include "libmv/image/image_io.h"
 #include "libmv/logging/logging.h"
+#include "libmv/logging/tracing.h"
 
 namespace libmv {
 
@@ -61,6 +62,7 @@ Format GetFormat(const char *c) {
 }
 
 int ReadImage(const char *filename, ByteImage *im){
+  LIBMV_TRACE_SCOPE("decode");
   Format f = GetFormat(filename);
 
   switch (f) {
@@ -76,6 +78,7 @@ int ReadImage(const char *filename, ByteImage *im){
 }
 
 int ReadImage(const char *filename, FloatImage *im){
+  LIBMV_TRACE_SCOPE("decode");
   Format f = GetFormat(filename);
 
   switch (f) {
@@ -551,4 +554,163 @@ int WritePnmStream(const ByteImage &im, FILE *file) {
   return 1;
 }
 
+struct ImageRowWriter::Encoder {
+  Encoder() : file(NULL), png(NULL), png_info(NULL) {}
+
+  Format format;
+  FILE *file;
+  int width, height, depth;
+  int rows_written;
+
+  struct jpeg_compress_struct jpeg;
+  struct jpeg_error_mgr jpeg_error;
+
+  png_structp png;
+  png_infop png_info;
+};
+
+ImageRowWriter::ImageRowWriter() : encoder_(NULL) {}
+
+ImageRowWriter::~ImageRowWriter() {
+  if (encoder_) {
+    Close();
+  }
+}
+
+int ImageRowWriter::Open(const char *filename,
+                         int width, int height, int depth,
+                         int quality) {
+  if (encoder_) {
+    Close();
+  }
+  if (depth != 1 && depth != 3) {
+    LOG(ERROR) << "Error: Unsupported number of channels " << depth;
+    return 0;
+  }
+  Format format = GetFormat(filename);
+  if (format == Unknown) {
+    return 0;
+  }
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    LOG(ERROR) << "Error: Couldn't open " << filename;
+    return 0;
+  }
+  encoder_ = new Encoder;
+  encoder_->format = format;
+  encoder_->file = file;
+  encoder_->width = width;
+  encoder_->height = height;
+  encoder_->depth = depth;
+  encoder_->rows_written = 0;
+
+  switch (format) {
+    case Pnm:
+      fprintf(file, "%s\n%d %d %d\n", depth == 1 ? "P5" : "P6",
+              width, height, 255);
+      break;
+    case Jpg: {
+      struct jpeg_compress_struct &cinfo = encoder_->jpeg;
+      cinfo.err = jpeg_std_error(&encoder_->jpeg_error);
+      jpeg_create_compress(&cinfo);
+      jpeg_stdio_dest(&cinfo, file);
+      cinfo.image_width = width;
+      cinfo.image_height = height;
+      cinfo.input_components = depth;
+      cinfo.in_color_space = depth == 3 ? JCS_RGB : JCS_GRAYSCALE;
+      jpeg_set_defaults(&cinfo);
+      jpeg_set_quality(&cinfo, quality, TRUE);
+      jpeg_start_compress(&cinfo, TRUE);
+      break;
+    }
+    case Png: {
+      encoder_->png =
+          png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+      if (encoder_->png) {
+        encoder_->png_info = png_create_info_struct(encoder_->png);
+      }
+      if (!encoder_->png_info || setjmp(png_jmpbuf(encoder_->png))) {
+        Close();
+        return 0;
+      }
+      png_init_io(encoder_->png, file);
+      png_set_IHDR(encoder_->png, encoder_->png_info, width, height, 8,
+                   depth == 3 ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_GRAY,
+                   PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
+                   PNG_FILTER_TYPE_BASE);
+      png_write_info(encoder_->png, encoder_->png_info);
+      break;
+    }
+    default:
+      break;
+  }
+  return 1;
+}
+
+int ImageRowWriter::WriteRows(const ByteImage &rows) {
+  if (!encoder_ || rows.Width() != encoder_->width ||
+      rows.Depth() != encoder_->depth ||
+      encoder_->rows_written + rows.Height() > encoder_->height) {
+    LOG(ERROR) << "Error: Invalid rows for the image being written";
+    return 0;
+  }
+  const int row_bytes = encoder_->width * encoder_->depth;
+  for (int y = 0; y < rows.Height(); ++y) {
+    unsigned char *row = const_cast<unsigned char *>(&rows(y, 0, 0));
+    switch (encoder_->format) {
+      case Pnm:
+        if (fwrite(row, 1, row_bytes, encoder_->file) != row_bytes) {
+          return 0;
+        }
+        break;
+      case Jpg:
+        jpeg_write_scanlines(&encoder_->jpeg, &row, 1);
+        break;
+      case Png:
+        if (setjmp(png_jmpbuf(encoder_->png))) {
+          return 0;
+        }
+        png_write_row(encoder_->png, row);
+        break;
+      default:
+        break;
+    }
+  }
+  encoder_->rows_written += rows.Height();
+  return 1;
+}
+
+int ImageRowWriter::Close() {
+  if (!encoder_) {
+    return 0;
+  }
+  const bool complete = encoder_->rows_written == encoder_->height;
+  switch (encoder_->format) {
+    case Jpg:
+      if (complete) {
+        jpeg_finish_compress(&encoder_->jpeg);
+      }
+      jpeg_destroy_compress(&encoder_->jpeg);
+      break;
+    case Png:
+      if (encoder_->png) {
+        if (complete && !setjmp(png_jmpbuf(encoder_->png))) {
+          png_write_end(encoder_->png, NULL);
+        }
+        png_destroy_write_struct(&encoder_->png, &encoder_->png_info);
+      }
+      break;
+    default:
+      break;
+  }
+  fclose(encoder_->file);
+  delete encoder_;
+  encoder_ = NULL;
+  if (!complete) {
+    LOG(ERROR) << "Error: Image closed before all its rows were written";
+    return 0;
+  }
+  return 1;
+}
+
 }  // namespace libmv
@@ -59,6 +59,30 @@ int WritePnm(const ByteImage &im, const char *filename);
 int WritePnm(const FloatImage &im, const char *filename);
 int WritePnmStream(const ByteImage &im, FILE *file);
 
+/**
+ * Writes an image a few rows at a time, for images too large to be held in
+ * memory.  The format (PNM, PNG or JPEG) is deduced from the file name.
+ * As for the other functions, methods return 0 on failure.
+ */
+class ImageRowWriter {
+ public:
+  ImageRowWriter();
+  // Closes the file if it is still open.
+  ~ImageRowWriter();
+
+  int Open(const char *filename, int width, int height, int depth,
+           int quality = 90);
+  // Appends rows to the image; rows must have the width and depth given to
+  // Open.
+  int WriteRows(const ByteImage &rows);
+  // Finishes the file; fails if less rows than announced were written.
+  int Close();
+
+ private:
+  struct Encoder;
+  Encoder *encoder_;
+};
+
 }  // namespace libmv
 
 #endif  // LIBMV_IMAGE_IMAGE_IMAGE_IO_H
@@ -23,6 +23,7 @@
 #include "libmv/image/image_pyramid.h"
 #include "libmv/image/convolve.h"
 #include "libmv/image/sample.h"
+#include "libmv/logging/tracing.h"
 
 namespace libmv {
 
@@ -40,6 +41,7 @@ class ConcreteImagePyramid : public ImagePyramid {
   }
 
   void Init(const FloatImage &image, int num_levels, double sigma = 0.9) {
+    LIBMV_TRACE_SCOPE("pyramid");
     assert(image.Depth() == 1);
 
     levels_.resize(num_levels);
@@ -21,6 +21,7 @@
 #include "libmv/image/image_transform_linear.h"
 
 #include "libmv/image/image_drawing.h"
+#include "libmv/image/image_warp.h"
 #include "libmv/image/sample.h"
 #include "libmv/logging/logging.h"
 
@@ -143,26 +144,8 @@ void WarpImage(const FloatImage &image_in,
   Mat3 Hbis = H;
   if (adapt_img_size) {
     ResizeImage(image_size, H, image_out, &Hbis, &bbox);
-  } else {
-    ComputeBoundingBox(image_size, H, &bbox);
   }
-  const Mat3 Hinv = Hbis.inverse();
-  //-- (Backward mapping. For the destination pixel search which pixel
-  //    contribute ?).
-  Vec3 qi, qm;
-  for (int j = bbox(2); j <= bbox(3); ++j)
-    for (int i = bbox(0); i <= bbox(1); ++i)
-      if (image_out->Contains(j, i)) {
-        qm << i, j, 1.0;
-        qi = Hinv * qm;
-        qi /= qi(2);
-        const int xImage = static_cast<int>(qi(0));
-        const int yImage = static_cast<int>(qi(1));
-        if (image_in.Contains(yImage, xImage)) {
-          for (int d = 0; d < image_out->Depth(); ++d) 
-            (*image_out)(j, i, d) = SampleLinear(image_in, qi(1), qi(0), d);
-        }
-      }
+  WarpHomography(image_in, Hbis, WARP_BILINEAR, image_out);
 }
 
 /**
@@ -174,51 +157,7 @@ void WarpImageBlend(const FloatImage &image_in,
                     float blending_ratio) {
   assert(image_out != NULL);
   assert(image_in.Depth() == image_out->Depth());
-  Vec4i bbox;
-  const Mat3 Hinv = H.inverse();
-  Vec2u image_size;
-  image_size << image_in.Width(), image_in.Height();
-  ComputeBoundingBox(image_size, H, &bbox);
-  
-  //-- Fill destination image
-  //-- (Backward mapping. For the destination pixel search which pixel
-  //    contribute ?).
-  Vec3 qi, qm;
-  bool bOutContrib=false;
-  for (int j = bbox(2); j <= bbox(3); ++j)
-    for (int i = bbox(0); i <= bbox(1); ++i)
-      if (image_out->Contains(j, i)) {
-        //- Algo :
-        // For the destination pixel (i,j) search which pixel from image_in
-        //  and image_out contribute.
-        // Perform a mean blending in the overlap zone, transfert original
-        //  value in the other part.
-        qm << i, j, 1.0;
-        qi = Hinv * qm;
-        qi /= qi(2);
-        const int xImage = static_cast<int>(qi(0));
-        const int yImage = static_cast<int>(qi(1));
-        if (image_in.Contains(yImage, xImage)) {
-          bOutContrib = false;
-          for (int d = 0; d < image_out->Depth(); ++d) 
-            if ((*image_out)(j, i, d) > 0) {
-              bOutContrib = true;
-              break;
-            }
-          if(bOutContrib) { //mean blending between image_out and image_in
-            for (int d = 0; d < image_out->Depth(); ++d) {
-              // Let's fade the previous frames
-              (*image_out)(j, i, d) = 
-                 (1 - blending_ratio) * (*image_out)(j, i, d) +
-                 blending_ratio * SampleLinear(image_in, qi(1), qi(0), d);
-            }
-            continue;
-          } else { //only image_in contrib
-            for (int d = 0; d < image_out->Depth(); ++d) 
-              (*image_out)(j, i, d) = SampleLinear(image_in, qi(1), qi(0), d);
-            continue;
-          }
-        }
-      }
+  WarpHomographyBlend(image_in, H, WARP_BILINEAR, blending_ratio, image_out);
 }
+
 } // namespace libmv 
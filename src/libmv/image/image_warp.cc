@@ -0,0 +1,447 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "libmv/image/image_warp.h"
+
+namespace libmv {
+
+namespace {
+
+// Side of the output tiles, the unit of work of the parallel loops.
+const int kTileSize = 64;
+
+// A source sample exists if its truncated coordinates are inside the image,
+// which is the test of WarpImage.
+inline bool InSource(float x, float y, int width, int height) {
+  return x > -1 && y > -1 && x < width && y < height;
+}
+
+template<typename T>
+inline T FromFloat(float value);
+
+template<>
+inline float FromFloat<float>(float value) {
+  return value;
+}
+
+template<>
+inline unsigned char FromFloat<unsigned char>(float value) {
+  return static_cast<unsigned char>(std::min(std::max(value + 0.5f, 0.0f),
+                                             255.0f));
+}
+
+inline int Clamp(int i, int size) {
+  return std::min(std::max(i, 0), size - 1);
+}
+
+template<typename T>
+struct NearestSampler {
+  static void Sample(const Array3D<T> &image, float x, float y,
+                     float *values) {
+    const int depth = image.Depth();
+    const int i = Clamp(static_cast<int>(floor(y + 0.5f)), image.Height());
+    const int j = Clamp(static_cast<int>(floor(x + 0.5f)), image.Width());
+    const T *p = &image(i, j, 0);
+    for (int d = 0; d < depth; ++d) {
+      values[d] = p[d];
+    }
+  }
+};
+
+// Same conventions as LinearInitAxis: no interpolation past the last pixel.
+inline void LinearAxis(float f, int size, int *i1, int *i2, float *w2) {
+  const int i = static_cast<int>(f);
+  if (i < 0) {
+    *i1 = *i2 = 0;
+    *w2 = 0;
+  } else if (i > size - 2) {
+    *i1 = *i2 = size - 1;
+    *w2 = 0;
+  } else {
+    *i1 = i;
+    *i2 = i + 1;
+    *w2 = f - i;
+  }
+}
+
+template<typename T>
+struct BilinearSampler {
+  static void Sample(const Array3D<T> &image, float x, float y,
+                     float *values) {
+    int x1, x2, y1, y2;
+    float wx, wy;
+    LinearAxis(x, image.Width(), &x1, &x2, &wx);
+    LinearAxis(y, image.Height(), &y1, &y2, &wy);
+    const float w11 = (1 - wx) * (1 - wy), w12 = wx * (1 - wy);
+    const float w21 = (1 - wx) * wy,       w22 = wx * wy;
+    const T *p11 = &image(y1, x1, 0), *p12 = &image(y1, x2, 0);
+    const T *p21 = &image(y2, x1, 0), *p22 = &image(y2, x2, 0);
+    const int depth = image.Depth();
+    for (int d = 0; d < depth; ++d) {
+      values[d] = w11 * p11[d] + w12 * p12[d] + w21 * p21[d] + w22 * p22[d];
+    }
+  }
+};
+
+// Catmull-Rom weights of the 4 samples around t in [0, 1).
+inline void CubicWeights(float t, float *w) {
+  const float t2 = t * t, t3 = t2 * t;
+  w[0] = 0.5f * (-t3 + 2 * t2 - t);
+  w[1] = 0.5f * (3 * t3 - 5 * t2 + 2);
+  w[2] = 0.5f * (-3 * t3 + 4 * t2 + t);
+  w[3] = 0.5f * (t3 - t2);
+}
+
+template<typename T>
+struct BicubicSampler {
+  static void Sample(const Array3D<T> &image, float x, float y,
+                     float *values) {
+    const int depth = image.Depth();
+    const int x0 = static_cast<int>(floor(x)), y0 = static_cast<int>(floor(y));
+    float wx[4], wy[4];
+    CubicWeights(x - x0, wx);
+    CubicWeights(y - y0, wy);
+    int xs[4];
+    for (int k = 0; k < 4; ++k) {
+      xs[k] = Clamp(x0 - 1 + k, image.Width());
+    }
+    for (int d = 0; d < depth; ++d) {
+      values[d] = 0;
+    }
+    for (int r = 0; r < 4; ++r) {
+      const int i = Clamp(y0 - 1 + r, image.Height());
+      for (int k = 0; k < 4; ++k) {
+        const T *p = &image(i, xs[k], 0);
+        const float w = wy[r] * wx[k];
+        for (int d = 0; d < depth; ++d) {
+          values[d] += w * p[d];
+        }
+      }
+    }
+  }
+};
+
+template<typename T>
+struct OverwriteWriter {
+  void operator()(const float *values, int depth, T *out) const {
+    for (int d = 0; d < depth; ++d) {
+      out[d] = FromFloat<T>(values[d]);
+    }
+  }
+};
+
+// The blending of WarpImageBlend.
+template<typename T>
+struct BlendWriter {
+  BlendWriter(float ratio) : ratio(ratio) {}
+  void operator()(const float *values, int depth, T *out) const {
+    bool has_content = false;
+    for (int d = 0; d < depth; ++d) {
+      has_content = has_content || out[d] > 0;
+    }
+    for (int d = 0; d < depth; ++d) {
+      out[d] = FromFloat<T>(has_content ?
+                            (1 - ratio) * out[d] + ratio * values[d] :
+                            values[d]);
+    }
+  }
+  float ratio;
+};
+
+// True if the tile [x0, x1) x [y0, y1) may have a source pixel.  The image of
+// a tile is convex when it is in front of the camera, so its bounding box is
+// the one of its corners.
+bool TileMayHaveSource(const Mat3 &Hinv, int x0, int x1, int y0, int y1,
+                       int width, int height) {
+  const double xs[2] = {double(x0), double(x1 - 1)};
+  const double ys[2] = {double(y0), double(y1 - 1)};
+  double min_x = HUGE_VAL, max_x = -HUGE_VAL;
+  double min_y = HUGE_VAL, max_y = -HUGE_VAL;
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      Vec3 q = Hinv * Vec3(xs[i], ys[j], 1.0);
+      if (q(2) <= 0) {
+        return true;  // Conservative.
+      }
+      min_x = std::min(min_x, q(0) / q(2));
+      max_x = std::max(max_x, q(0) / q(2));
+      min_y = std::min(min_y, q(1) / q(2));
+      max_y = std::max(max_y, q(1) / q(2));
+    }
+  }
+  return max_x > -1 && min_x < width && max_y > -1 && min_y < height;
+}
+
+template<typename T, class Sampler, class Writer>
+void WarpTiles(const Array3D<T> &image_in,
+               const Mat3 &H,
+               const Writer &writer,
+               Array3D<T> *image_out) {
+  assert(image_in.Depth() == image_out->Depth());
+  const Mat3 Hinv = H.inverse();
+  const int width = image_out->Width(), height = image_out->Height();
+  const int depth = image_out->Depth();
+  const int tiles_x = (width + kTileSize - 1) / kTileSize;
+  const int tiles_y = (height + kTileSize - 1) / kTileSize;
+  const int num_tiles = tiles_x * tiles_y;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    const int x0 = (tile % tiles_x) * kTileSize;
+    const int y0 = (tile / tiles_x) * kTileSize;
+    const int x1 = std::min(x0 + kTileSize, width);
+    const int y1 = std::min(y0 + kTileSize, height);
+    if (!TileMayHaveSource(Hinv, x0, x1, y0, y1,
+                           image_in.Width(), image_in.Height())) {
+      continue;
+    }
+    std::vector<float> values(depth);
+    for (int y = y0; y < y1; ++y) {
+      // Homogeneous source coordinates, updated along the row.
+      Vec3 q = Hinv * Vec3(x0, y, 1.0);
+      const Vec3 dq = Hinv.col(0);
+      T *out = &(*image_out)(y, x0, 0);
+      for (int x = x0; x < x1; ++x, q += dq, out += depth) {
+        const double inverse_w = 1.0 / q(2);
+        const float sx = q(0) * inverse_w, sy = q(1) * inverse_w;
+        if (InSource(sx, sy, image_in.Width(), image_in.Height())) {
+          Sampler::Sample(image_in, sx, sy, &values[0]);
+          writer(&values[0], depth, out);
+        }
+      }
+    }
+  }
+}
+
+template<typename T, class Writer>
+void Warp(const Array3D<T> &image_in,
+          const Mat3 &H,
+          WarpInterpolation interpolation,
+          const Writer &writer,
+          Array3D<T> *image_out) {
+  switch (interpolation) {
+    case WARP_NEAREST:
+      WarpTiles<T, NearestSampler<T> >(image_in, H, writer, image_out);
+      break;
+    case WARP_BILINEAR:
+      WarpTiles<T, BilinearSampler<T> >(image_in, H, writer, image_out);
+      break;
+    case WARP_BICUBIC:
+      WarpTiles<T, BicubicSampler<T> >(image_in, H, writer, image_out);
+      break;
+  }
+}
+
+template<typename T, class Sampler>
+void RemapRows(const Array3D<T> &image_in,
+               const RemapGrid &grid,
+               Array3D<T> *image_out) {
+  const int depth = image_in.Depth();
+  OverwriteWriter<T> writer;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int y = 0; y < grid.height; ++y) {
+    std::vector<float> values(depth);
+    const float *xs = &grid.xs[y * grid.width];
+    const float *ys = &grid.ys[y * grid.width];
+    T *out = &(*image_out)(y, 0, 0);
+    for (int x = 0; x < grid.width; ++x, out += depth) {
+      if (InSource(xs[x], ys[x], image_in.Width(), image_in.Height())) {
+        Sampler::Sample(image_in, xs[x], ys[x], &values[0]);
+        writer(&values[0], depth, out);
+      }
+    }
+  }
+}
+
+template<typename T>
+void RemapImage(const Array3D<T> &image_in,
+                const RemapGrid &grid,
+                WarpInterpolation interpolation,
+                Array3D<T> *image_out) {
+  image_out->Resize(grid.height, grid.width, image_in.Depth());
+  if (grid.width == 0 || grid.height == 0) {
+    return;
+  }
+  switch (interpolation) {
+    case WARP_NEAREST:
+      RemapRows<T, NearestSampler<T> >(image_in, grid, image_out);
+      break;
+    case WARP_BILINEAR:
+      RemapRows<T, BilinearSampler<T> >(image_in, grid, image_out);
+      break;
+    case WARP_BICUBIC:
+      RemapRows<T, BicubicSampler<T> >(image_in, grid, image_out);
+      break;
+  }
+}
+
+}  // namespace
+
+void WarpHomography(const FloatImage &image_in,
+                    const Mat3 &H,
+                    WarpInterpolation interpolation,
+                    FloatImage *image_out) {
+  Warp(image_in, H, interpolation, OverwriteWriter<float>(), image_out);
+}
+
+void WarpHomography(const ByteImage &image_in,
+                    const Mat3 &H,
+                    WarpInterpolation interpolation,
+                    ByteImage *image_out) {
+  Warp(image_in, H, interpolation, OverwriteWriter<unsigned char>(),
+       image_out);
+}
+
+void WarpHomographyBlend(const FloatImage &image_in,
+                         const Mat3 &H,
+                         WarpInterpolation interpolation,
+                         float blending_ratio,
+                         FloatImage *image_out) {
+  Warp(image_in, H, interpolation, BlendWriter<float>(blending_ratio),
+       image_out);
+}
+
+void WarpHomographyBlend(const ByteImage &image_in,
+                         const Mat3 &H,
+                         WarpInterpolation interpolation,
+                         float blending_ratio,
+                         ByteImage *image_out) {
+  Warp(image_in, H, interpolation, BlendWriter<unsigned char>(blending_ratio),
+       image_out);
+}
+
+bool WarpMayTouchRegion(const Mat3 &H,
+                        int source_width,
+                        int source_height,
+                        int x0, int y0, int x1, int y1) {
+  return TileMayHaveSource(H.inverse(), x0, x1, y0, y1,
+                           source_width, source_height);
+}
+
+void RemapGrid::Resize(int new_width, int new_height) {
+  width = new_width;
+  height = new_height;
+  xs.resize(width * height);
+  ys.resize(width * height);
+}
+
+void ComputeHomographyRemap(const Mat3 &H,
+                            int source_width,
+                            int source_height,
+                            int width,
+                            int height,
+                            RemapGrid *grid) {
+  grid->Resize(width, height);
+  const Mat3 Hinv = H.inverse();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int y = 0; y < height; ++y) {
+    Vec3 q = Hinv * Vec3(0, y, 1.0);
+    const Vec3 dq = Hinv.col(0);
+    for (int x = 0; x < width; ++x, q += dq) {
+      const float sx = q(0) / q(2), sy = q(1) / q(2);
+      if (InSource(sx, sy, source_width, source_height)) {
+        grid->xs[y * width + x] = sx;
+        grid->ys[y * width + x] = sy;
+      } else {
+        grid->SetInvalid(x, y);
+      }
+    }
+  }
+}
+
+void Remap(const FloatImage &image_in,
+           const RemapGrid &grid,
+           WarpInterpolation interpolation,
+           FloatImage *image_out) {
+  RemapImage(image_in, grid, interpolation, image_out);
+}
+
+void Remap(const ByteImage &image_in,
+           const RemapGrid &grid,
+           WarpInterpolation interpolation,
+           ByteImage *image_out) {
+  RemapImage(image_in, grid, interpolation, image_out);
+}
+
+static const char kRemapGridMagic[8] = {'L', 'M', 'V', 'R', 'E', 'M', 'A', 'P'};
+
+bool WriteRemapGrid(const RemapGrid &grid,
+                    const std::string &key,
+                    const char *filename) {
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  int header[3] = { grid.width, grid.height, static_cast<int>(key.size()) };
+  size_t size = grid.width * grid.height;
+  bool ok = fwrite(kRemapGridMagic, sizeof(kRemapGridMagic), 1, file) == 1 &&
+            fwrite(header, sizeof(header), 1, file) == 1 &&
+            fwrite(key.data(), 1, key.size(), file) == key.size() &&
+            (size == 0 ||
+             (fwrite(&grid.xs[0], sizeof(float), size, file) == size &&
+              fwrite(&grid.ys[0], sizeof(float), size, file) == size));
+  ok = fclose(file) == 0 && ok;
+  if (!ok) {
+    remove(filename);
+  }
+  return ok;
+}
+
+bool ReadRemapGrid(const char *filename,
+                   const std::string &key,
+                   RemapGrid *grid) {
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    return false;
+  }
+  char magic[sizeof(kRemapGridMagic)];
+  int header[3];
+  bool ok = fread(magic, sizeof(magic), 1, file) == 1 &&
+            memcmp(magic, kRemapGridMagic, sizeof(magic)) == 0 &&
+            fread(header, sizeof(header), 1, file) == 1 &&
+            header[0] >= 0 && header[1] >= 0 && header[2] == key.size();
+  if (ok) {
+    std::vector<char> file_key(key.size() + 1);
+    ok = fread(&file_key[0], 1, key.size(), file) == key.size() &&
+         key.compare(0, key.size(), &file_key[0], key.size()) == 0;
+  }
+  if (ok) {
+    grid->Resize(header[0], header[1]);
+    size_t size = grid->width * grid->height;
+    ok = size == 0 ||
+         (fread(&grid->xs[0], sizeof(float), size, file) == size &&
+          fread(&grid->ys[0], sizeof(float), size, file) == size);
+  }
+  fclose(file);
+  return ok;
+}
+
+}  // namespace libmv
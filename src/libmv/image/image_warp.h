@@ -0,0 +1,160 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_IMAGE_IMAGE_WARP_H_
+#define LIBMV_IMAGE_IMAGE_WARP_H_
+
+#include <string>
+
+#include "libmv/base/vector.h"
+#include "libmv/image/image.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+enum WarpInterpolation {
+  WARP_NEAREST,
+  WARP_BILINEAR,
+  WARP_BICUBIC
+};
+
+/**
+ * Warps an image by a homography.
+ *
+ * Output pixels are written only if their source pixel is inside image_in;
+ * the other pixels of image_out are left untouched.  The output is processed
+ * by tiles, in parallel when OpenMP is enabled; the tiles whose source falls
+ * outside of image_in are skipped, and the source coordinates are updated
+ * incrementally along the rows.  All the channels of a pixel are sampled at
+ * once.
+ *
+ * \param image_in      The input image
+ * \param H             The 2D warp matrix, x_warped_img = H * x_img
+ * \param interpolation The interpolation of the source samples
+ * \param image_out     The output image, with the same depth as image_in
+ *
+ * \note image_out SHOULD NOT be the image_in!
+ */
+void WarpHomography(const FloatImage &image_in,
+                    const Mat3 &H,
+                    WarpInterpolation interpolation,
+                    FloatImage *image_out);
+void WarpHomography(const ByteImage &image_in,
+                    const Mat3 &H,
+                    WarpInterpolation interpolation,
+                    ByteImage *image_out);
+
+/**
+ * Warps an image by a homography and blends it with the content of the output
+ * image, as WarpImageBlend: where the output pixel is black it is overwritten,
+ * elsewhere it becomes (1 - blending_ratio) * out + blending_ratio * in.
+ */
+void WarpHomographyBlend(const FloatImage &image_in,
+                         const Mat3 &H,
+                         WarpInterpolation interpolation,
+                         float blending_ratio,
+                         FloatImage *image_out);
+void WarpHomographyBlend(const ByteImage &image_in,
+                         const Mat3 &H,
+                         WarpInterpolation interpolation,
+                         float blending_ratio,
+                         ByteImage *image_out);
+
+/**
+ * Returns false if no pixel of the region [x0, x1) x [y0, y1) of the output
+ * of a warp by H has a source in an image of size (source_width,
+ * source_height).  May return true for regions with no source.
+ */
+bool WarpMayTouchRegion(const Mat3 &H,
+                        int source_width,
+                        int source_height,
+                        int x0, int y0, int x1, int y1);
+
+/**
+ * The source coordinates of every pixel of an output image.  A remap grid
+ * is computed once and reused for all the frames warped by the same
+ * transformation (e.g. a fixed homography or a lens undistortion).
+ */
+struct RemapGrid {
+  RemapGrid() : width(0), height(0) {}
+
+  void Resize(int width, int height);
+
+  // Marks the output pixel (x, y) as having no source.
+  void SetInvalid(int x, int y) {
+    xs[y * width + x] = -1e30f;
+    ys[y * width + x] = -1e30f;
+  }
+
+  int width;
+  int height;
+  // Source coordinates of the output pixel (x, y), at y * width + x.
+  vector<float> xs;
+  vector<float> ys;
+};
+
+/**
+ * Computes the remap grid of a homography for an output image of the given
+ * size; pixels whose source is outside of a source image of size
+ * (source_width, source_height) get no source.
+ */
+void ComputeHomographyRemap(const Mat3 &H,
+                            int source_width,
+                            int source_height,
+                            int width,
+                            int height,
+                            RemapGrid *grid);
+
+/**
+ * Resamples image_in with a remap grid.  image_out is resized to the size of
+ * the grid; the pixels without a source are left untouched (or have
+ * undefined values if the image was resized).
+ */
+void Remap(const FloatImage &image_in,
+           const RemapGrid &grid,
+           WarpInterpolation interpolation,
+           FloatImage *image_out);
+void Remap(const ByteImage &image_in,
+           const RemapGrid &grid,
+           WarpInterpolation interpolation,
+           ByteImage *image_out);
+
+/**
+ * Saves a remap grid, so that expensive grids (e.g. lens undistortion maps)
+ * are computed once per camera.  The key identifies what the grid was
+ * computed from (camera parameters, image size); it is stored in the file and
+ * checked by ReadRemapGrid.  The file is in the native byte order.
+ * Returns false if the file can't be written.
+ */
+bool WriteRemapGrid(const RemapGrid &grid,
+                    const std::string &key,
+                    const char *filename);
+
+/**
+ * Loads a grid saved by WriteRemapGrid.  Returns false if the file can't be
+ * read, is not a remap grid or was saved with another key.
+ */
+bool ReadRemapGrid(const char *filename,
+                   const std::string &key,
+                   RemapGrid *grid);
+
+}  // namespace libmv
+
+#endif  // LIBMV_IMAGE_IMAGE_WARP_H_
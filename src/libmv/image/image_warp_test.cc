@@ -0,0 +1,199 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstdio>
+
+#include "libmv/image/image.h"
+#include "libmv/image/image_warp.h"
+#include "libmv/image/sample.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+void MakeImage(int width, int height, int depth, FloatImage *image) {
+  image->Resize(height, width, depth);
+  for (int i = 0; i < height; ++i) {
+    for (int j = 0; j < width; ++j) {
+      for (int d = 0; d < depth; ++d) {
+        (*image)(i, j, d) = ((i * 7 + j * 13 + d * 31) % 50) / 50.0f;
+      }
+    }
+  }
+}
+
+Mat3 TestHomography() {
+  Mat3 H;
+  H << 0.9,    0.1,  12.0,
+      -0.08,   1.05, -5.0,
+       0.0004, 0.0002, 1.0;
+  return H;
+}
+
+// The per pixel warp of WarpImage, before the tiled engine.
+void ReferenceWarp(const FloatImage &image_in, const Mat3 &H,
+                   FloatImage *image_out) {
+  const Mat3 Hinv = H.inverse();
+  for (int j = 0; j < image_out->Height(); ++j) {
+    for (int i = 0; i < image_out->Width(); ++i) {
+      Vec3 q = Hinv * Vec3(i, j, 1.0);
+      q /= q(2);
+      if (image_in.Contains(int(q(1)), int(q(0)))) {
+        for (int d = 0; d < image_out->Depth(); ++d) {
+          (*image_out)(j, i, d) = SampleLinear(image_in, q(1), q(0), d);
+        }
+      }
+    }
+  }
+}
+
+TEST(ImageWarp, BilinearMatchesReference) {
+  FloatImage image, expected, warped;
+  MakeImage(150, 130, 3, &image);
+  expected.Resize(140, 170, 3);
+  expected.Fill(-1);
+  warped.Resize(140, 170, 3);
+  warped.Fill(-1);
+  const Mat3 H = TestHomography();
+  ReferenceWarp(image, H, &expected);
+  WarpHomography(image, H, WARP_BILINEAR, &warped);
+  int num_written = 0;
+  for (int i = 0; i < warped.Height(); ++i) {
+    for (int j = 0; j < warped.Width(); ++j) {
+      for (int d = 0; d < 3; ++d) {
+        EXPECT_NEAR(expected(i, j, d), warped(i, j, d), 1e-4);
+        num_written += expected(i, j, d) != -1;
+      }
+    }
+  }
+  EXPECT_GT(num_written, 0);
+}
+
+TEST(ImageWarp, IdentityReproducesTheImage) {
+  FloatImage image, warped;
+  MakeImage(70, 90, 1, &image);
+  const WarpInterpolation modes[] = {WARP_NEAREST, WARP_BILINEAR,
+                                     WARP_BICUBIC};
+  for (int m = 0; m < 3; ++m) {
+    warped.Resize(90, 70, 1);
+    warped.Fill(-1);
+    WarpHomography(image, Mat3::Identity(), modes[m], &warped);
+    for (int i = 0; i < image.Height(); ++i) {
+      for (int j = 0; j < image.Width(); ++j) {
+        EXPECT_NEAR(image(i, j), warped(i, j), 1e-5);
+      }
+    }
+  }
+}
+
+TEST(ImageWarp, ByteMatchesFloat) {
+  FloatImage image, warped;
+  MakeImage(100, 80, 1, &image);
+  ByteImage byte_image(80, 100), byte_warped(80, 100);
+  for (int i = 0; i < image.Height(); ++i) {
+    for (int j = 0; j < image.Width(); ++j) {
+      image(i, j) = byte_image(i, j) = (unsigned char)(image(i, j) * 255);
+    }
+  }
+  warped.Resize(80, 100);
+  warped.Fill(0);
+  byte_warped.Fill(0);
+  const Mat3 H = TestHomography();
+  WarpHomography(image, H, WARP_BILINEAR, &warped);
+  WarpHomography(byte_image, H, WARP_BILINEAR, &byte_warped);
+  for (int i = 0; i < warped.Height(); ++i) {
+    for (int j = 0; j < warped.Width(); ++j) {
+      // SampleLinear extrapolates on ]-1, 0[, bytes are saturated.
+      const float expected = std::min(std::max(warped(i, j), 0.0f), 255.0f);
+      EXPECT_NEAR(expected, byte_warped(i, j), 0.5 + 1e-3);
+    }
+  }
+}
+
+TEST(ImageWarp, BlendFadesThePreviousContent) {
+  FloatImage image(20, 20), mosaic(20, 30);
+  image.Fill(1.0);
+  mosaic.Fill(0);
+  for (int i = 0; i < 20; ++i) {
+    mosaic(i, 0) = 0.5;
+  }
+  WarpHomographyBlend(image, Mat3::Identity(), WARP_BILINEAR, 0.25, &mosaic);
+  EXPECT_FLOAT_EQ(0.75 * 0.5 + 0.25, mosaic(3, 0));
+  EXPECT_FLOAT_EQ(1.0, mosaic(3, 5));
+  EXPECT_FLOAT_EQ(0.0, mosaic(3, 25));
+}
+
+TEST(ImageWarp, RemapMatchesDirectWarp) {
+  ByteImage image(120, 110), warped(120, 110), remapped;
+  for (int i = 0; i < image.Height(); ++i) {
+    for (int j = 0; j < image.Width(); ++j) {
+      image(i, j) = (i * 3 + j * 5) % 256;
+    }
+  }
+  warped.Fill(0);
+  const Mat3 H = TestHomography();
+  WarpHomography(image, H, WARP_BICUBIC, &warped);
+
+  RemapGrid grid;
+  ComputeHomographyRemap(H, image.Width(), image.Height(),
+                         warped.Width(), warped.Height(), &grid);
+  remapped.Resize(warped.Height(), warped.Width());
+  remapped.Fill(0);
+  Remap(image, grid, WARP_BICUBIC, &remapped);
+  for (int i = 0; i < warped.Height(); ++i) {
+    for (int j = 0; j < warped.Width(); ++j) {
+      EXPECT_NEAR(warped(i, j), remapped(i, j), 1);
+    }
+  }
+}
+
+TEST(ImageWarp, RemapGridFileRoundTrip) {
+  RemapGrid grid;
+  ComputeHomographyRemap(TestHomography(), 40, 30, 50, 20, &grid);
+  const char *filename = "image_warp_test_grid.map";
+  ASSERT_TRUE(WriteRemapGrid(grid, "camera 1", filename));
+
+  RemapGrid loaded;
+  EXPECT_FALSE(ReadRemapGrid(filename, "camera 2", &loaded));
+  ASSERT_TRUE(ReadRemapGrid(filename, "camera 1", &loaded));
+  remove(filename);
+  EXPECT_EQ(grid.width, loaded.width);
+  EXPECT_EQ(grid.height, loaded.height);
+  for (int i = 0; i < grid.width * grid.height; ++i) {
+    EXPECT_EQ(grid.xs[i], loaded.xs[i]);
+    EXPECT_EQ(grid.ys[i], loaded.ys[i]);
+  }
+}
+
+TEST(ImageWarp, EmptyRemapGridFileRoundTrip) {
+  RemapGrid grid;
+  const char *filename = "image_warp_test_empty_grid.map";
+  ASSERT_TRUE(WriteRemapGrid(grid, "", filename));
+  RemapGrid loaded;
+  loaded.Resize(3, 2);
+  ASSERT_TRUE(ReadRemapGrid(filename, "", &loaded));
+  remove(filename);
+  EXPECT_EQ(0, loaded.width);
+  EXPECT_EQ(0, loaded.height);
+}
+
+}  // namespace
@@ -0,0 +1,189 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "libmv/image/pixel_kernels.h"
+
+namespace libmv {
+
+namespace {
+
+// Truncates a scaled value to an integer pixel type, saturating it.
+template<typename T>
+inline T Saturate(float value) {
+  return static_cast<T>(std::min(std::max(value, 0.0f),
+                                 PixelTraits<T>::Max()));
+}
+
+// Scalar conversion between any pixel types.
+template<typename In, typename Out>
+void ConvertPixelsScalar(const In *in, Out *out, int n) {
+  const float scale = PixelTraits<Out>::Max() / PixelTraits<In>::Max();
+  for (int i = 0; i < n; ++i) {
+    out[i] = Saturate<Out>(in[i] * scale);
+  }
+}
+
+// Gray level weights of RGB2GRAY in 16 bits fixed point; they sum to 65536.
+const int kRedWeight = 13933;
+const int kGreenWeight = 46871;
+const int kBlueWeight = 4732;
+
+}  // namespace
+
+void ConvertPixels(const unsigned char *in, float *out, int n) {
+  int i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 max = _mm_set1_ps(255.0f);
+  for (; i + 16 <= n; i += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    // Divide, rather than multiply by 1 / 255, to match the scalar code.
+    _mm_storeu_ps(out + i, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), max));
+    _mm_storeu_ps(out + i + 4, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), max));
+    _mm_storeu_ps(out + i + 8, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), max));
+    _mm_storeu_ps(out + i + 12, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), max));
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = in[i] / 255.0f;
+  }
+}
+
+void ConvertPixels(const float *in, unsigned char *out, int n) {
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 max = _mm_set1_ps(255.0f);
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 16 <= n; i += 16) {
+    // Clamp before the truncation, the packs saturate signed 16 bits only.
+    __m128i a = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+        _mm_mul_ps(_mm_loadu_ps(in + i), max), zero), max));
+    __m128i b = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+        _mm_mul_ps(_mm_loadu_ps(in + i + 4), max), zero), max));
+    __m128i c = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+        _mm_mul_ps(_mm_loadu_ps(in + i + 8), max), zero), max));
+    __m128i d = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+        _mm_mul_ps(_mm_loadu_ps(in + i + 12), max), zero), max));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                     _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                      _mm_packs_epi32(c, d)));
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = Saturate<unsigned char>(255 * in[i]);
+  }
+}
+
+void ConvertPixels(const unsigned short *in, float *out, int n) {
+  ConvertPixelsScalar(in, out, n);
+}
+
+void ConvertPixels(const float *in, unsigned short *out, int n) {
+  ConvertPixelsScalar(in, out, n);
+}
+
+void ConvertPixels(const unsigned char *in, unsigned short *out, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = in[i] * 257;
+  }
+}
+
+void ConvertPixels(const unsigned short *in, unsigned char *out, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = in[i] / 257;
+  }
+}
+
+void RgbToGray(const unsigned char *rgb, unsigned char *gray, int n) {
+  int i = 0;
+#ifdef __SSE2__
+  // Gather the channels of 8 pixels in 16 bits lanes, then sum the weighted
+  // channels in 32 bits: the weights do not fit in signed 16 bits.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i red_green = _mm_set_epi16(kGreenWeight - 65536, kRedWeight,
+                                          kGreenWeight - 65536, kRedWeight,
+                                          kGreenWeight - 65536, kRedWeight,
+                                          kGreenWeight - 65536, kRedWeight);
+  for (; i + 8 <= n; i += 8) {
+    unsigned short r[8], g[8], b[8];
+    const unsigned char *p = rgb + 3 * i;
+    for (int k = 0; k < 8; ++k) {
+      r[k] = p[3 * k];
+      g[k] = p[3 * k + 1];
+      b[k] = p[3 * k + 2];
+    }
+    __m128i vr = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r));
+    __m128i vg = _mm_loadu_si128(reinterpret_cast<const __m128i *>(g));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    // r * wr + g * (wg - 65536), then add g * 65536 and b * wb.
+    __m128i rg_low = _mm_madd_epi16(_mm_unpacklo_epi16(vr, vg), red_green);
+    __m128i rg_high = _mm_madd_epi16(_mm_unpackhi_epi16(vr, vg), red_green);
+    __m128i g_low = _mm_slli_epi32(_mm_unpacklo_epi16(vg, zero), 16);
+    __m128i g_high = _mm_slli_epi32(_mm_unpackhi_epi16(vg, zero), 16);
+    __m128i blue = _mm_set1_epi32(kBlueWeight);
+    __m128i b_low = _mm_madd_epi16(_mm_unpacklo_epi16(vb, zero), blue);
+    __m128i b_high = _mm_madd_epi16(_mm_unpackhi_epi16(vb, zero), blue);
+    __m128i low = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(rg_low, g_low),
+                                               b_low), 16);
+    __m128i high = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(rg_high,
+                                                              g_high),
+                                                b_high), 16);
+    __m128i words = _mm_packs_epi32(low, high);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(gray + i),
+                     _mm_packus_epi16(words, words));
+  }
+#endif
+  for (; i < n; ++i) {
+    const unsigned char *p = rgb + 3 * i;
+    gray[i] = (kRedWeight * p[0] + kGreenWeight * p[1] +
+               kBlueWeight * p[2]) >> 16;
+  }
+}
+
+void RgbToGray(const unsigned short *rgb, unsigned short *gray, int n) {
+  for (int i = 0; i < n; ++i) {
+    const unsigned short *p = rgb + 3 * i;
+    // At most 65535 * 65536, which fits in 32 bits.
+    gray[i] = (static_cast<unsigned int>(kRedWeight) * p[0] +
+               static_cast<unsigned int>(kGreenWeight) * p[1] +
+               static_cast<unsigned int>(kBlueWeight) * p[2]) >> 16;
+  }
+}
+
+void RgbToGray(const float *rgb, float *gray, int n) {
+  for (int i = 0; i < n; ++i) {
+    const float *p = rgb + 3 * i;
+    gray[i] = 0.2126f * p[0] + 0.7152f * p[1] + 0.0722f * p[2];
+  }
+}
+
+}  // namespace libmv
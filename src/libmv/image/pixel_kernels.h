@@ -0,0 +1,115 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_IMAGE_PIXEL_KERNELS_H_
+#define LIBMV_IMAGE_PIXEL_KERNELS_H_
+
+#include <algorithm>
+#include <cassert>
+
+#include "libmv/image/array_nd.h"
+
+namespace libmv {
+
+// Range of the pixel types: 8 and 16 bits pixels are in [0, Max()], float
+// pixels in [0, 1].
+template<typename T> struct PixelTraits;
+
+template<> struct PixelTraits<unsigned char> {
+  static float Max() { return 255.0f; }
+};
+template<> struct PixelTraits<unsigned short> {
+  static float Max() { return 65535.0f; }
+};
+template<> struct PixelTraits<float> {
+  static float Max() { return 1.0f; }
+};
+
+/**
+ * Converts n pixels between two pixel types, rescaling their range.  Integer
+ * outputs are truncated and saturated, as FloatArrayToScaledByteArray does.
+ * The byte <-> float conversions use SSE2 when it is available.
+ */
+void ConvertPixels(const unsigned char *in, float *out, int n);
+void ConvertPixels(const float *in, unsigned char *out, int n);
+void ConvertPixels(const unsigned short *in, float *out, int n);
+void ConvertPixels(const float *in, unsigned short *out, int n);
+void ConvertPixels(const unsigned char *in, unsigned short *out, int n);
+void ConvertPixels(const unsigned short *in, unsigned char *out, int n);
+
+template<typename T>
+void ConvertPixels(const T *in, T *out, int n) {
+  std::copy(in, in + n, out);
+}
+
+/**
+ * Converts n interleaved RGB pixels to gray levels with the weights of
+ * RGB2GRAY.  The byte version uses 16 bits fixed point weights (and SSE2
+ * when it is available); it keeps gray pixels unchanged.
+ */
+void RgbToGray(const unsigned char *rgb, unsigned char *gray, int n);
+void RgbToGray(const unsigned short *rgb, unsigned short *gray, int n);
+void RgbToGray(const float *rgb, float *gray, int n);
+
+// Converts an image to another pixel type, keeping its channels.
+template<typename In, typename Out>
+void ConvertImage(const Array3D<In> &in, Array3D<Out> *out) {
+  out->Resize(in.Height(), in.Width(), in.Depth());
+  ConvertPixels(in.Data(), out->Data(), in.Size());
+}
+
+// Copies the first depth channels of the pixels of in to out, e.g. to drop
+// the alpha channel of gray + alpha and RGBA images.
+template<typename T>
+void KeepChannels(const Array3D<T> &in, int depth, Array3D<T> *out) {
+  assert(depth <= in.Depth());
+  out->Resize(in.Height(), in.Width(), depth);
+  const int n = in.Height() * in.Width();
+  const T *pixel = in.Data();
+  T *out_pixel = out->Data();
+  for (int i = 0; i < n; ++i) {
+    std::copy(pixel, pixel + depth, out_pixel);
+    pixel += in.Depth();
+    out_pixel += depth;
+  }
+}
+
+// Converts an image to a gray image of another pixel type.  Gray + alpha
+// images use their first channel and RGBA images their first three.
+template<typename In, typename Out>
+void ConvertToGray(const Array3D<In> &in, Array3D<Out> *out) {
+  if (in.Depth() != 1 && in.Depth() != 3) {
+    Array3D<In> opaque;
+    KeepChannels(in, in.Depth() < 3 ? 1 : 3, &opaque);
+    ConvertToGray(opaque, out);
+    return;
+  }
+  if (in.Depth() == 1) {
+    ConvertImage(in, out);
+    return;
+  }
+  Array3D<In> gray(in.Height(), in.Width(), 1);
+  RgbToGray(in.Data(), gray.Data(), gray.Size());
+  ConvertImage(gray, out);
+}
+
+}  // namespace libmv
+
+#endif  // LIBMV_IMAGE_PIXEL_KERNELS_H_
@@ -0,0 +1,170 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/image/image.h"
+#include "libmv/image/image_converter.h"
+#include "libmv/image/pixel_kernels.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+TEST(PixelKernels, ByteToFloatMatchesScalarDivision) {
+  unsigned char bytes[300];
+  for (int i = 0; i < 300; ++i) {
+    bytes[i] = (i * 37) % 256;
+  }
+  float floats[300];
+  ConvertPixels(bytes, floats, 300);
+  for (int i = 0; i < 300; ++i) {
+    EXPECT_EQ(bytes[i] / 255.0f, floats[i]);
+  }
+}
+
+TEST(PixelKernels, FloatToByteTruncatesAndSaturates) {
+  float floats[40];
+  for (int i = 0; i < 40; ++i) {
+    floats[i] = -0.1f + i * 0.03f;
+  }
+  unsigned char bytes[40];
+  ConvertPixels(floats, bytes, 40);
+  for (int i = 0; i < 40; ++i) {
+    const float expected = std::min(std::max(255 * floats[i], 0.0f), 255.0f);
+    EXPECT_EQ(static_cast<unsigned char>(expected), bytes[i]);
+  }
+}
+
+TEST(PixelKernels, ByteRoundTrip) {
+  unsigned char bytes[256], back[256];
+  unsigned short words[256];
+  float floats[256];
+  for (int i = 0; i < 256; ++i) {
+    bytes[i] = i;
+  }
+  ConvertPixels(bytes, words, 256);
+  EXPECT_EQ(65535, words[255]);
+  ConvertPixels(words, back, 256);
+  for (int i = 0; i < 256; ++i) {
+    EXPECT_EQ(i, back[i]);
+  }
+  ConvertPixels(words, floats, 256);
+  ConvertPixels(floats, words, 256);
+  ConvertPixels(words, back, 256);
+  for (int i = 0; i < 256; ++i) {
+    EXPECT_NEAR(i, back[i], 1);
+  }
+}
+
+TEST(PixelKernels, RgbToGrayMatchesRGB2GRAY) {
+  const int n = 37;
+  unsigned char rgb[3 * n], gray[n];
+  for (int i = 0; i < 3 * n; ++i) {
+    rgb[i] = (i * 71 + 13) % 256;
+  }
+  RgbToGray(rgb, gray, n);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(RGB2GRAY<double>(rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2]),
+                gray[i], 1.0);
+  }
+  // Gray levels are kept.
+  for (int i = 0; i < 3 * n; ++i) {
+    rgb[i] = (i / 3) * 7;
+  }
+  RgbToGray(rgb, gray, n);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(i * 7, gray[i]);
+  }
+}
+
+TEST(PixelKernels, ImageConvertsOnceAndSharesTheViews) {
+  Array3Du *color = new Array3Du(4, 20, 3);
+  color->Fill(100);
+  Image image(color);
+  const Array3Du *gray = image.AsGrayArray3Du();
+  ASSERT_TRUE(gray != NULL);
+  EXPECT_EQ(1, gray->Depth());
+  EXPECT_EQ(100, (*gray)(3, 19));
+  EXPECT_EQ(gray, image.AsGrayArray3Du());
+
+  const Array3Df *floats = image.AsScaledArray3Df();
+  EXPECT_EQ(3, floats->Depth());
+  EXPECT_FLOAT_EQ(100 / 255.0f, (*floats)(2, 5, 1));
+  EXPECT_EQ(floats, image.AsScaledArray3Df());
+
+  // A gray byte image is its own gray view.
+  Array3Du *byte_gray = new Array3Du(3, 3);
+  Image gray_image(byte_gray);
+  EXPECT_EQ(byte_gray, gray_image.AsGrayArray3Du());
+
+  Image copy(image);
+  EXPECT_EQ(100, (*copy.AsGrayArray3Du())(0, 0));
+  EXPECT_NE(gray, copy.AsGrayArray3Du());
+}
+
+TEST(PixelKernels, GrayAlphaImageUsesTheGrayChannel) {
+  // Gray + alpha PNG files load as 2 channels images.
+  Array3Du *gray_alpha = new Array3Du(3, 5, 2);
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      (*gray_alpha)(y, x, 0) = 10 * y + x;
+      (*gray_alpha)(y, x, 1) = 200;
+    }
+  }
+  Image image(gray_alpha);
+  const Array3Du *gray = image.AsGrayArray3Du();
+  ASSERT_TRUE(gray != NULL);
+  EXPECT_EQ(1, gray->Depth());
+  const Array3Df *gray_floats = image.AsGrayArray3Df();
+  ASSERT_TRUE(gray_floats != NULL);
+  EXPECT_EQ(1, gray_floats->Depth());
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      EXPECT_EQ(10 * y + x, (*gray)(y, x));
+      EXPECT_FLOAT_EQ((10 * y + x) / 255.0f, (*gray_floats)(y, x));
+    }
+  }
+}
+
+TEST(PixelKernels, RgbaImageIgnoresTheAlphaChannel) {
+  const int n = 21;
+  Array3Du *rgba = new Array3Du(1, n, 4);
+  unsigned char rgb[3 * n], expected[n];
+  for (int i = 0; i < n; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      rgb[3 * i + c] = (i * 71 + c * 29 + 13) % 256;
+      (*rgba)(0, i, c) = rgb[3 * i + c];
+    }
+    (*rgba)(0, i, 3) = (i * 53) % 256;
+  }
+  RgbToGray(rgb, expected, n);
+  Image image(rgba);
+  const Array3Du *gray = image.AsGrayArray3Du();
+  ASSERT_TRUE(gray != NULL);
+  EXPECT_EQ(1, gray->Depth());
+  const Array3Df *gray_floats = image.AsGrayArray3Df();
+  ASSERT_TRUE(gray_floats != NULL);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(expected[i], (*gray)(0, i));
+    EXPECT_FLOAT_EQ(expected[i] / 255.0f, (*gray_floats)(0, i));
+  }
+}
+
+}  // namespace
@@ -0,0 +1,342 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "libmv/image/image_io.h"
+#include "libmv/image/image_warp.h"
+#include "libmv/image/tiled_mosaic.h"
+#include "libmv/logging/logging.h"
+
+namespace libmv {
+
+TiledMosaic::TiledMosaic(int width, int height, int depth,
+                         int tile_size,
+                         int max_resident_tiles,
+                         const std::string &spill_file)
+    : width_(width), height_(height), depth_(depth),
+      tile_size_(tile_size),
+      tiles_x_((width + tile_size - 1) / tile_size),
+      tiles_y_((height + tile_size - 1) / tile_size),
+      max_resident_tiles_(std::max(max_resident_tiles, 1)),
+      spill_file_(spill_file),
+      num_resident_(0),
+      num_spilled_(0),
+      spill_data_(NULL),
+      spill_size_(0),
+      spill_fd_(-1) {
+  const int num_tiles = tiles_x_ * tiles_y_;
+  tiles_.resize(num_tiles);
+  dirty_.resize(num_tiles);
+  spilled_.resize(num_tiles);
+  for (int i = 0; i < num_tiles; ++i) {
+    tiles_[i] = NULL;
+    dirty_[i] = false;
+    spilled_[i] = false;
+  }
+}
+
+TiledMosaic::~TiledMosaic() {
+  for (int i = 0; i < tiles_.size(); ++i) {
+    delete tiles_[i];
+  }
+#ifndef _WIN32
+  if (spill_data_) {
+    munmap(spill_data_, spill_size_);
+    close(spill_fd_);
+    if (!spill_file_.empty()) {
+      unlink(spill_file_.c_str());
+    }
+  }
+#endif
+}
+
+void TiledMosaic::WarpBlend(const ByteImage &frame,
+                            const Mat3 &H,
+                            float blending_ratio) {
+  CHECK_EQ(frame.Depth(), depth_);
+  // The tiles covered by the bounding box of the warped frame; all the tiles
+  // if the frame crosses the line at infinity.
+  int tx0 = 0, tx1 = tiles_x_, ty0 = 0, ty1 = tiles_y_;
+  double min_x = HUGE_VAL, max_x = -HUGE_VAL;
+  double min_y = HUGE_VAL, max_y = -HUGE_VAL;
+  bool in_front = true;
+  for (int i = 0; i < 4; ++i) {
+    Vec3 q = H * Vec3((i & 1) ? frame.Width() : 0,
+                      (i & 2) ? frame.Height() : 0, 1.0);
+    in_front = in_front && q(2) > 0;
+    min_x = std::min(min_x, q(0) / q(2));
+    max_x = std::max(max_x, q(0) / q(2));
+    min_y = std::min(min_y, q(1) / q(2));
+    max_y = std::max(max_y, q(1) / q(2));
+  }
+  if (in_front) {
+    if (max_x < 0 || max_y < 0 || min_x >= width_ || min_y >= height_) {
+      return;
+    }
+    tx0 = static_cast<int>(std::max(min_x, 0.0)) / tile_size_;
+    ty0 = static_cast<int>(std::max(min_y, 0.0)) / tile_size_;
+    tx1 = static_cast<int>(std::min(max_x, width_ - 1.0)) / tile_size_ + 1;
+    ty1 = static_cast<int>(std::min(max_y, height_ - 1.0)) / tile_size_ + 1;
+  }
+  vector<int> touched;
+  for (int ty = ty0; ty < ty1; ++ty) {
+    for (int tx = tx0; tx < tx1; ++tx) {
+      const int x0 = tx * tile_size_, y0 = ty * tile_size_;
+      if (WarpMayTouchRegion(H, frame.Width(), frame.Height(), x0, y0,
+                             std::min(x0 + tile_size_, width_),
+                             std::min(y0 + tile_size_, height_))) {
+        touched.push_back(ty * tiles_x_ + tx);
+      }
+    }
+  }
+  // Load the tiles serially, the cache is not thread safe; then warp them in
+  // parallel.
+  for (int i = 0; i < touched.size(); ++i) {
+    PinTile(touched[i]);
+    dirty_[touched[i]] = true;
+  }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int i = 0; i < touched.size(); ++i) {
+    const int tile = touched[i];
+    Mat3 T;
+    T << 1, 0, -(tile % tiles_x_) * tile_size_,
+         0, 1, -(tile / tiles_x_) * tile_size_,
+         0, 0, 1;
+    WarpHomographyBlend(frame, T * H, WARP_BILINEAR, blending_ratio,
+                        tiles_[tile]);
+  }
+  for (int i = 0; i < touched.size(); ++i) {
+    UnpinTile(touched[i]);
+  }
+  EvictTilesIfNecessary();
+}
+
+void TiledMosaic::GetRows(int y0, ByteImage *rows) {
+  CHECK_EQ(rows->Width(), width_);
+  CHECK_EQ(rows->Depth(), depth_);
+  const size_t tile_bytes = tile_size_ * tile_size_ * depth_;
+  for (int y = 0; y < rows->Height(); ++y) {
+    const int ty = (y0 + y) / tile_size_;
+    const int tile_y = (y0 + y) % tile_size_;
+    for (int tx = 0; tx < tiles_x_; ++tx) {
+      const int tile = ty * tiles_x_ + tx;
+      const int x0 = tx * tile_size_;
+      const int bytes = (std::min(x0 + tile_size_, width_) - x0) * depth_;
+      unsigned char *out = &(*rows)(y, x0, 0);
+      // Spilled tiles are read in place, without making them resident.
+      const unsigned char *in = NULL;
+      if (tiles_[tile]) {
+        in = &(*tiles_[tile])(tile_y, 0, 0);
+      } else if (spilled_[tile]) {
+        in = spill_data_ + tile * tile_bytes + tile_y * tile_size_ * depth_;
+      }
+      if (in) {
+        memcpy(out, in, bytes);
+      } else {
+        memset(out, 0, bytes);
+      }
+    }
+  }
+}
+
+bool TiledMosaic::Write(const char *filename,
+                        int overview_factor,
+                        int num_overviews,
+                        vector<ByteImage> *overviews) {
+  ImageRowWriter writer;
+  if (!writer.Open(filename, width_, height_, depth_)) {
+    return false;
+  }
+  if (!overviews || overview_factor <= 0) {
+    num_overviews = 0;
+  }
+  // Sums of the pixels of the finest overview, accumulated along the rows.
+  // They are doubles (exact up to 2^53) since 255 * factor^2 overflows 32 bits
+  // from a factor of 4096 on.
+  const int ow = (width_ + overview_factor - 1) / std::max(overview_factor, 1);
+  const int oh = (height_ + overview_factor - 1) / std::max(overview_factor, 1);
+  vector<double> sums;
+  if (num_overviews > 0) {
+    sums.resize(ow * oh * depth_);
+    std::fill(sums.begin(), sums.end(), 0);
+  }
+  ByteImage rows;
+  for (int ty = 0; ty < tiles_y_; ++ty) {
+    const int y0 = ty * tile_size_;
+    rows.Resize(std::min(tile_size_, height_ - y0), width_, depth_);
+    GetRows(y0, &rows);
+    if (!writer.WriteRows(rows)) {
+      return false;
+    }
+    for (int y = 0; num_overviews > 0 && y < rows.Height(); ++y) {
+      double *sum = &sums[(y0 + y) / overview_factor * ow * depth_];
+      const unsigned char *pixel = &rows(y, 0, 0);
+      for (int x = 0; x < width_; ++x) {
+        double *s = sum + x / overview_factor * depth_;
+        for (int d = 0; d < depth_; ++d) {
+          s[d] += *pixel++;
+        }
+      }
+    }
+  }
+  if (!writer.Close()) {
+    return false;
+  }
+  if (num_overviews > 0) {
+    overviews->resize(num_overviews);
+    double factor = overview_factor;
+    int level_width = ow, level_height = oh;
+    for (int level = 0; level < num_overviews; ++level) {
+      ByteImage &overview = (*overviews)[level];
+      overview.Resize(level_height, level_width, depth_);
+      for (int y = 0; y < level_height; ++y) {
+        const double area_y = std::min(factor, height_ - y * factor);
+        for (int x = 0; x < level_width; ++x) {
+          const double area = area_y * std::min(factor, width_ - x * factor);
+          for (int d = 0; d < depth_; ++d) {
+            overview(y, x, d) = static_cast<unsigned char>(
+                floor(sums[(y * level_width + x) * depth_ + d] / area + 0.5));
+          }
+        }
+      }
+      // The sums of the next level are sums of 2x2 blocks of this level.
+      const int next_width = (level_width + 1) / 2;
+      const int next_height = (level_height + 1) / 2;
+      vector<double> next_sums(next_width * next_height * depth_);
+      std::fill(next_sums.begin(), next_sums.end(), 0);
+      for (int y = 0; y < level_height; ++y) {
+        for (int x = 0; x < level_width; ++x) {
+          for (int d = 0; d < depth_; ++d) {
+            next_sums[((y / 2) * next_width + x / 2) * depth_ + d] +=
+                sums[(y * level_width + x) * depth_ + d];
+          }
+        }
+      }
+      sums.swap(next_sums);
+      level_width = next_width;
+      level_height = next_height;
+      factor *= 2;
+    }
+  }
+  return true;
+}
+
+ByteImage *TiledMosaic::PinTile(int tile) {
+  if (tiles_[tile]) {
+    if (unpinned_.Contains(tile)) {
+      unpinned_.Remove(tile);
+    }
+    return tiles_[tile];
+  }
+  ByteImage *data = new ByteImage(tile_size_, tile_size_, depth_);
+  if (spilled_[tile]) {
+    const size_t tile_bytes = data->Size();
+    memcpy(data->Data(), spill_data_ + tile * tile_bytes, tile_bytes);
+  } else {
+    data->Fill(0);
+  }
+  tiles_[tile] = data;
+  dirty_[tile] = false;
+  ++num_resident_;
+  EvictTilesIfNecessary();
+  return data;
+}
+
+void TiledMosaic::UnpinTile(int tile) {
+  assert(tiles_[tile] && !unpinned_.Contains(tile));
+  unpinned_.Enqueue(tile);
+}
+
+void TiledMosaic::EvictTilesIfNecessary() {
+  while (num_resident_ > max_resident_tiles_ && !unpinned_.Empty()) {
+    int tile;
+    unpinned_.Dequeue(&tile);
+    if (dirty_[tile]) {
+      SpillTile(tile);
+    }
+    delete tiles_[tile];
+    tiles_[tile] = NULL;
+    --num_resident_;
+  }
+}
+
+void TiledMosaic::SpillTile(int tile) {
+  if (!spill_data_ && !MapSpillFile()) {
+    LOG(FATAL) << "Couldn't create the mosaic spill file";
+  }
+  const size_t tile_bytes = tiles_[tile]->Size();
+  memcpy(spill_data_ + tile * tile_bytes, tiles_[tile]->Data(), tile_bytes);
+  if (!spilled_[tile]) {
+    spilled_[tile] = true;
+    ++num_spilled_;
+  }
+}
+
+bool TiledMosaic::MapSpillFile() {
+#ifdef _WIN32
+  LOG(ERROR) << "Spilling mosaic tiles is not supported on Windows";
+  return false;
+#else
+  spill_size_ = size_t(tiles_x_) * tiles_y_ * tile_size_ * tile_size_ * depth_;
+  if (spill_file_.empty()) {
+    const char *tmp = getenv("TMPDIR");
+    std::string path = std::string(tmp ? tmp : "/tmp") + "/mosaic_XXXXXX";
+    vector<char> name(path.size() + 1);
+    strcpy(&name[0], path.c_str());
+    spill_fd_ = mkstemp(&name[0]);
+    if (spill_fd_ >= 0) {
+      unlink(&name[0]);
+    }
+  } else {
+    spill_fd_ = open(spill_file_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  }
+  if (spill_fd_ < 0) {
+    return false;
+  }
+  // The file is sparse: only the spilled tiles use disk space.
+  if (ftruncate(spill_fd_, spill_size_) != 0) {
+    close(spill_fd_);
+    return false;
+  }
+  void *data = mmap(NULL, spill_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    spill_fd_, 0);
+  if (data == MAP_FAILED) {
+    close(spill_fd_);
+    return false;
+  }
+  spill_data_ = static_cast<unsigned char *>(data);
+  VLOG(1) << "Mosaic tiles spilled to a " << spill_size_ << " bytes file.";
+  return true;
+#endif
+}
+
+}  // namespace libmv
@@ -0,0 +1,118 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_IMAGE_TILED_MOSAIC_H_
+#define LIBMV_IMAGE_TILED_MOSAIC_H_
+
+#include <string>
+
+#include "libmv/base/vector.h"
+#include "libmv/image/image.h"
+#include "libmv/image/lru_cache.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+/**
+ * A large 8 bits image stored as square tiles, for mosaics which do not fit
+ * in memory.
+ *
+ * Only the tiles touched by a warped frame are allocated.  At most
+ * max_resident_tiles tiles are kept in memory; the least recently used ones
+ * are spilled to a memory mapped file and reloaded when touched again.  The
+ * mosaic is written by rows of tiles, so that neither the mosaic nor the
+ * output image is ever held in memory as a whole.
+ */
+class TiledMosaic {
+ public:
+  /**
+   * \param spill_file The file backing the evicted tiles, created on the
+   *                   first eviction.  If empty, an anonymous temporary
+   *                   file is used.
+   */
+  TiledMosaic(int width, int height, int depth,
+              int tile_size = 256,
+              int max_resident_tiles = 256,
+              const std::string &spill_file = "");
+  ~TiledMosaic();
+
+  int Width() const { return width_; }
+  int Height() const { return height_; }
+  int Depth() const { return depth_; }
+  int TileSize() const { return tile_size_; }
+  int NumResidentTiles() const { return num_resident_; }
+  int NumSpilledTiles() const { return num_spilled_; }
+
+  /**
+   * Warps a frame by H (mosaic = H * frame) and blends it into the tiles it
+   * touches, as WarpImageBlend does.
+   */
+  void WarpBlend(const ByteImage &frame, const Mat3 &H, float blending_ratio);
+
+  /**
+   * Copies the rows [y0, y0 + rows->Height()) of the mosaic in rows, which
+   * must have the width and depth of the mosaic.
+   */
+  void GetRows(int y0, ByteImage *rows);
+
+  /**
+   * Writes the mosaic one row of tiles at a time.  If overviews is not NULL,
+   * it receives num_overviews reductions of the mosaic (box filtered) by
+   * overview_factor, 2 * overview_factor, 4 * overview_factor...
+   * Returns false if the file cannot be written.
+   */
+  bool Write(const char *filename,
+             int overview_factor = 0,
+             int num_overviews = 0,
+             vector<ByteImage> *overviews = NULL);
+
+ private:
+  // Makes a tile resident and pins it: pinned tiles are never evicted.
+  ByteImage *PinTile(int tile);
+  void UnpinTile(int tile);
+  void EvictTilesIfNecessary();
+  void SpillTile(int tile);
+  bool MapSpillFile();
+
+  int width_, height_, depth_;
+  int tile_size_;
+  int tiles_x_, tiles_y_;
+  int max_resident_tiles_;
+  std::string spill_file_;
+
+  // Resident tiles, NULL for the others.
+  vector<ByteImage *> tiles_;
+  // Whether a tile was modified since it was loaded, and whether it has a
+  // copy in the spill file.
+  vector<bool> dirty_;
+  vector<bool> spilled_;
+  // Unpinned resident tiles, the least recently used last.
+  lru_cache::SetQueue<int> unpinned_;
+  int num_resident_;
+  int num_spilled_;
+
+  unsigned char *spill_data_;
+  size_t spill_size_;
+  int spill_fd_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_IMAGE_TILED_MOSAIC_H_
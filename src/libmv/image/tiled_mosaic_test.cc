@@ -0,0 +1,108 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdio>
+
+#include "libmv/image/image.h"
+#include "libmv/image/image_io.h"
+#include "libmv/image/image_warp.h"
+#include "libmv/image/tiled_mosaic.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+void MakeFrame(int width, int height, int seed, ByteImage *frame) {
+  frame->Resize(height, width, 3);
+  for (int i = 0; i < height; ++i) {
+    for (int j = 0; j < width; ++j) {
+      for (int d = 0; d < 3; ++d) {
+        (*frame)(i, j, d) = 1 + (i * 7 + j * 3 + d * 50 + seed * 11) % 250;
+      }
+    }
+  }
+}
+
+// Warps the same frames in a tiled mosaic and in a plain image.
+void WarpFrames(TiledMosaic *mosaic, ByteImage *expected) {
+  expected->Resize(mosaic->Height(), mosaic->Width(), 3);
+  expected->Fill(0);
+  for (int i = 0; i < 5; ++i) {
+    ByteImage frame;
+    MakeFrame(60, 40, i, &frame);
+    Mat3 H;
+    H << 1.1, 0.1, 20.0 * i + 3, -0.1, 0.9, 9.0 * i + 2, 0.0, 0.0, 1.0;
+    mosaic->WarpBlend(frame, H, 0.5);
+    WarpHomographyBlend(frame, H, WARP_BILINEAR, 0.5, expected);
+  }
+}
+
+TEST(TiledMosaic, MatchesAPlainImage) {
+  TiledMosaic mosaic(150, 97, 3, 16, 4);
+  ByteImage expected;
+  WarpFrames(&mosaic, &expected);
+  EXPECT_GT(mosaic.NumSpilledTiles(), 0);
+  EXPECT_LE(mosaic.NumResidentTiles(), 4);
+
+  ByteImage rows(97, 150, 3);
+  mosaic.GetRows(0, &rows);
+  for (int i = 0; i < rows.Height(); ++i) {
+    for (int j = 0; j < rows.Width(); ++j) {
+      for (int d = 0; d < 3; ++d) {
+        EXPECT_EQ(expected(i, j, d), rows(i, j, d));
+      }
+    }
+  }
+}
+
+TEST(TiledMosaic, WriteStreamsTheMosaicAndItsOverviews) {
+  TiledMosaic mosaic(150, 97, 3, 32, 2);
+  ByteImage expected;
+  WarpFrames(&mosaic, &expected);
+
+  const char *filename = "tiled_mosaic_test.pnm";
+  vector<ByteImage> overviews;
+  EXPECT_TRUE(mosaic.Write(filename, 4, 2, &overviews));
+  ByteImage written;
+  EXPECT_EQ(1, ReadImage(filename, &written));
+  remove(filename);
+  ASSERT_EQ(97, written.Height());
+  ASSERT_EQ(150, written.Width());
+  for (int i = 0; i < written.Height(); ++i) {
+    for (int j = 0; j < written.Width(); ++j) {
+      EXPECT_EQ(expected(i, j, 1), written(i, j, 1));
+    }
+  }
+
+  ASSERT_EQ(2, overviews.size());
+  EXPECT_EQ(38, overviews[0].Width());
+  EXPECT_EQ(25, overviews[0].Height());
+  EXPECT_EQ(19, overviews[1].Width());
+  EXPECT_EQ(13, overviews[1].Height());
+  // The last overview pixel averages a 6 x 1 block.
+  int sum = 0;
+  for (int j = 144; j < 150; ++j) {
+    sum += expected(96, j, 2);
+  }
+  EXPECT_EQ((sum + 3) / 6, overviews[1](12, 18, 2));
+}
+
+}  // namespace
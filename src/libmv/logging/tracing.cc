@@ -0,0 +1,264 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/logging/tracing.h"
+
+#include <pthread.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <time.h>
+# include <sys/time.h>
+#endif
+
+#if defined(_MSC_VER)
+# define LIBMV_THREAD_LOCAL __declspec(thread)
+#else
+# define LIBMV_THREAD_LOCAL __thread
+#endif
+
+namespace libmv {
+namespace tracing {
+
+bool g_tracing_enabled = false;
+
+namespace {
+
+enum EventType {
+  SCOPE_EVENT,
+  COUNTER_EVENT
+};
+
+struct Event {
+  const char *name;
+  double start_us;
+  // Duration of a scope, value of a counter.
+  double value;
+  EventType type;
+};
+
+// Events of one thread. Only the owner thread writes to it, readers (the
+// writers of the trace and of the summary) must not run concurrently.
+struct ThreadBuffer {
+  ThreadBuffer(int thread_id, int capacity)
+      : thread_id(thread_id), events(capacity), next(0), size(0) {}
+
+  void Push(const Event &event) {
+    if (events.empty()) {
+      return;
+    }
+    events[next] = event;
+    next = (next + 1) % events.size();
+    if (size < static_cast<int>(events.size())) {
+      ++size;
+    }
+  }
+
+  // i-th event, from the oldest one.
+  const Event &At(int i) const {
+    int first = (next - size + events.size()) % events.size();
+    return events[(first + i) % events.size()];
+  }
+
+  void Reset(int capacity) {
+    events.resize(capacity);
+    next = 0;
+    size = 0;
+  }
+
+  int thread_id;
+  std::vector<Event> events;
+  int next;
+  int size;
+};
+
+// All the thread buffers ever created. Buffers are never deleted since the
+// threads keep a pointer to theirs. The registry is guarded by a pthread mutex
+// rather than an OpenMP critical section, since threads which are not OpenMP
+// ones (e.g. the background writers) record events too.
+std::vector<ThreadBuffer *> g_buffers;
+int g_buffer_capacity = 1 << 16;
+pthread_mutex_t g_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+class RegistryLock {
+ public:
+  RegistryLock()  { pthread_mutex_lock(&g_registry_mutex); }
+  ~RegistryLock() { pthread_mutex_unlock(&g_registry_mutex); }
+};
+
+LIBMV_THREAD_LOCAL ThreadBuffer *t_buffer = NULL;
+
+ThreadBuffer *CurrentThreadBuffer() {
+  if (!t_buffer) {
+    RegistryLock lock;
+    t_buffer = new ThreadBuffer(g_buffers.size(), g_buffer_capacity);
+    g_buffers.push_back(t_buffer);
+  }
+  return t_buffer;
+}
+
+void WriteJsonString(const char *s, std::ostream &os) {
+  os << '"';
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\') {
+      os << '\\' << *s;
+    } else if (static_cast<unsigned char>(*s) >= 0x20) {
+      os << *s;
+    }
+  }
+  os << '"';
+}
+
+struct Statistics {
+  Statistics() : count(0), sum(0), max(0) {}
+  int count;
+  double sum;
+  double max;
+};
+
+}  // namespace
+
+void SetEnabled(bool enabled) {
+  g_tracing_enabled = enabled;
+}
+
+void SetBufferCapacity(int num_events) {
+  RegistryLock lock;
+  g_buffer_capacity = num_events;
+  for (int i = 0; i < g_buffers.size(); ++i) {
+    g_buffers[i]->Reset(num_events);
+  }
+}
+
+void Clear() {
+  SetBufferCapacity(g_buffer_capacity);
+}
+
+double NowInMicroseconds() {
+#ifdef _WIN32
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return 1e6 * counter.QuadPart / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return 1e6 * now.tv_sec + 1e-3 * now.tv_nsec;
+#else
+  timeval now;
+  gettimeofday(&now, NULL);
+  return 1e6 * now.tv_sec + now.tv_usec;
+#endif
+}
+
+void RecordScope(const char *name, double start_us, double duration_us) {
+  Event event = { name, start_us, duration_us, SCOPE_EVENT };
+  CurrentThreadBuffer()->Push(event);
+}
+
+void RecordCounter(const char *name, double value) {
+  Event event = { name, NowInMicroseconds(), value, COUNTER_EVENT };
+  CurrentThreadBuffer()->Push(event);
+}
+
+bool WriteChromeTrace(const std::string &filename) {
+  std::ofstream os(filename.c_str());
+  if (!os) {
+    return false;
+  }
+  os << std::fixed << std::setprecision(3);
+  os << "{\"traceEvents\":[\n";
+  bool first = true;
+  {
+    RegistryLock lock;
+    for (int i = 0; i < g_buffers.size(); ++i) {
+      const ThreadBuffer &buffer = *g_buffers[i];
+      for (int j = 0; j < buffer.size; ++j) {
+        const Event &event = buffer.At(j);
+        os << (first ? "" : ",\n") << "{\"name\":";
+        WriteJsonString(event.name, os);
+        os << ",\"cat\":\"libmv\",\"pid\":0,\"tid\":" << buffer.thread_id
+           << ",\"ts\":" << event.start_us;
+        if (event.type == SCOPE_EVENT) {
+          os << ",\"ph\":\"X\",\"dur\":" << event.value << "}";
+        } else {
+          os << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+        }
+        first = false;
+      }
+    }
+  }
+  os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return os.good();
+}
+
+void WriteSummary(std::ostream &os) {
+  std::map<std::string, Statistics> scopes, counters;
+  {
+    RegistryLock lock;
+    for (int i = 0; i < g_buffers.size(); ++i) {
+      const ThreadBuffer &buffer = *g_buffers[i];
+      for (int j = 0; j < buffer.size; ++j) {
+        const Event &event = buffer.At(j);
+        Statistics &stats = event.type == SCOPE_EVENT ? scopes[event.name]
+                                                      : counters[event.name];
+        stats.count++;
+        stats.sum += event.value;
+        if (stats.count == 1 || event.value > stats.max) {
+          stats.max = event.value;
+        }
+      }
+    }
+  }
+  std::ios::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(3);
+  os << std::left << std::setw(28) << "scope" << std::right
+     << std::setw(10) << "calls" << std::setw(14) << "total ms"
+     << std::setw(12) << "mean ms" << std::setw(12) << "max ms" << "\n";
+  std::map<std::string, Statistics>::const_iterator it;
+  for (it = scopes.begin(); it != scopes.end(); ++it) {
+    const Statistics &stats = it->second;
+    os << std::left << std::setw(28) << it->first << std::right
+       << std::setw(10) << stats.count
+       << std::setw(14) << stats.sum / 1000
+       << std::setw(12) << stats.sum / 1000 / stats.count
+       << std::setw(12) << stats.max / 1000 << "\n";
+  }
+  if (!counters.empty()) {
+    os << std::left << std::setw(28) << "counter" << std::right
+       << std::setw(10) << "samples" << std::setw(14) << "sum" << "\n";
+    for (it = counters.begin(); it != counters.end(); ++it) {
+      os << std::left << std::setw(28) << it->first << std::right
+         << std::setw(10) << it->second.count
+         << std::setw(14) << it->second.sum << "\n";
+    }
+  }
+  os.flags(flags);
+}
+
+}  // namespace tracing
+}  // namespace libmv
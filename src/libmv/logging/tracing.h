@@ -0,0 +1,125 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+// Light-weight tracing of the pipeline stages (decode, pyramid, detect,
+// describe, match, ransac, triangulate, resect, bundle adjustment, ...).
+//
+// Instrumented code opens scopes and bumps counters with the macros below:
+//
+//   void Detect(...) {
+//     LIBMV_TRACE_SCOPE("detect");
+//     ...
+//     LIBMV_TRACE_COUNTER("detect.features", features->size());
+//   }
+//
+// Events go to a fixed size ring buffer owned by the calling thread, so
+// recording takes no lock; when a buffer is full the oldest events are
+// overwritten. Tracing is off by default: a disabled scope costs one load of
+// a global flag and does not read the clock. Building with
+// LIBMV_DISABLE_TRACING (cmake -DWITH_TRACING=OFF) removes the macros
+// entirely.
+//
+// Event names are not copied; they must be string literals or otherwise
+// outlive the trace.
+
+#ifndef LIBMV_LOGGING_TRACING_H
+#define LIBMV_LOGGING_TRACING_H
+
+#include <ostream>
+#include <string>
+
+namespace libmv {
+namespace tracing {
+
+extern bool g_tracing_enabled;
+
+// Starts or stops recording. Already recorded events are kept.
+void SetEnabled(bool enabled);
+
+inline bool IsEnabled() {
+  return g_tracing_enabled;
+}
+
+// Maximal number of events kept per thread (default 65536). Changing it drops
+// the recorded events. Must only be called while tracing is idle: the buffers
+// are reset in place, so no thread may be recording events meanwhile.
+void SetBufferCapacity(int num_events);
+
+// Drops all the recorded events. Same restriction as SetBufferCapacity().
+void Clear();
+
+// Monotonic wall clock, in microseconds.
+double NowInMicroseconds();
+
+// Records a complete scope of the calling thread.
+void RecordScope(const char *name, double start_us, double duration_us);
+
+// Records the value of a counter at the current time.
+void RecordCounter(const char *name, double value);
+
+// Writes the recorded events in the Chrome trace event format (JSON), which
+// can be loaded in chrome://tracing or Perfetto. Must not run concurrently
+// with traced code. Returns false if the file cannot be written.
+bool WriteChromeTrace(const std::string &filename);
+
+// Writes one line per scope name (calls, total, mean and max time) and per
+// counter name (samples, sum). Must not run concurrently with traced code.
+void WriteSummary(std::ostream &os);
+
+// Records the time spent between its construction and its destruction.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const char *name)
+      : name_(name), start_us_(IsEnabled() ? NowInMicroseconds() : -1) {}
+  ~ScopedTimer() {
+    if (start_us_ >= 0) {
+      RecordScope(name_, start_us_, NowInMicroseconds() - start_us_);
+    }
+  }
+
+ private:
+  const char *name_;
+  double start_us_;
+};
+
+inline void Count(const char *name, double value) {
+  if (IsEnabled()) {
+    RecordCounter(name, value);
+  }
+}
+
+}  // namespace tracing
+}  // namespace libmv
+
+#define LIBMV_TRACE_CONCAT_(a, b) a ## b
+#define LIBMV_TRACE_CONCAT(a, b) LIBMV_TRACE_CONCAT_(a, b)
+
+#ifdef LIBMV_DISABLE_TRACING
+# define LIBMV_TRACE_SCOPE(name)
+# define LIBMV_TRACE_COUNTER(name, value)
+#else
+# define LIBMV_TRACE_SCOPE(name) \
+    libmv::tracing::ScopedTimer \
+        LIBMV_TRACE_CONCAT(libmv_trace_scope_, __LINE__)(name)
+# define LIBMV_TRACE_COUNTER(name, value) \
+    libmv::tracing::Count((name), (value))
+#endif
+
+#endif  // LIBMV_LOGGING_TRACING_H
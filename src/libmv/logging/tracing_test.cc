@@ -0,0 +1,117 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <pthread.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "libmv/logging/tracing.h"
+#include "testing/testing.h"
+
+namespace libmv {
+namespace tracing {
+namespace {
+
+void *RecordCounters(void *) {
+  for (int i = 0; i < 100; ++i) {
+    RecordCounter("pthread", 1);
+  }
+  return NULL;
+}
+
+std::string ReadFile(const std::string &filename) {
+  std::ifstream is(filename.c_str());
+  std::stringstream contents;
+  contents << is.rdbuf();
+  return contents.str();
+}
+
+TEST(Tracing, DisabledRecordsNothing) {
+  Clear();
+  SetEnabled(false);
+  {
+    LIBMV_TRACE_SCOPE("disabled");
+    LIBMV_TRACE_COUNTER("disabled.counter", 3);
+  }
+  std::ostringstream summary;
+  WriteSummary(summary);
+  EXPECT_EQ(std::string::npos, summary.str().find("disabled"));
+}
+
+TEST(Tracing, SummaryAndChromeTrace) {
+  Clear();
+  SetEnabled(true);
+  for (int i = 0; i < 3; ++i) {
+    LIBMV_TRACE_SCOPE("stage");
+    LIBMV_TRACE_COUNTER("stage.items", 2);
+  }
+  SetEnabled(false);
+
+  std::ostringstream summary;
+  WriteSummary(summary);
+  EXPECT_NE(std::string::npos, summary.str().find("stage "));
+  EXPECT_NE(std::string::npos, summary.str().find("stage.items"));
+
+  std::string filename = "tracing_test.json";
+  EXPECT_TRUE(WriteChromeTrace(filename));
+  std::string trace = ReadFile(filename);
+  remove(filename.c_str());
+  EXPECT_EQ(0, trace.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, trace.find("\"ph\":\"X\""));
+  EXPECT_NE(std::string::npos, trace.find("\"ph\":\"C\""));
+}
+
+TEST(Tracing, RingBufferKeepsTheLatestEvents) {
+  SetBufferCapacity(4);
+  SetEnabled(true);
+  for (int i = 0; i < 10; ++i) {
+    RecordCounter("ring", i);
+  }
+  SetEnabled(false);
+  std::ostringstream summary;
+  WriteSummary(summary);
+  // Only 6, 7, 8 and 9 are kept.
+  EXPECT_NE(std::string::npos, summary.str().find("4        30.000"));
+  SetBufferCapacity(1 << 16);
+}
+
+TEST(Tracing, PlainThreadsRegisterTheirBuffers) {
+  Clear();
+  SetEnabled(true);
+  const int kNumThreads = 8;
+  pthread_t threads[kNumThreads];
+  for (int i = 0; i < kNumThreads; ++i) {
+    pthread_create(&threads[i], NULL, RecordCounters, NULL);
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  SetEnabled(false);
+  std::ostringstream summary;
+  WriteSummary(summary);
+  EXPECT_NE(std::string::npos, summary.str().find("800       800.000"));
+}
+
+}  // namespace
+}  // namespace tracing
+}  // namespace libmv
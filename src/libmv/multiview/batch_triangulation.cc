@@ -0,0 +1,174 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cmath>
+
+#include "libmv/logging/tracing.h"
+#include "libmv/multiview/batch_triangulation.h"
+
+namespace libmv {
+
+namespace {
+
+// HZ 4.4.4 pag.107: isotropic point conditioning, as
+// IsotropicPreconditionerFromPoints.
+void IsotropicPreconditioner(const vector<Vec2> &xs, Mat3 *T) {
+  Vec2 mean = Vec2::Zero();
+  for (int i = 0; i < xs.size(); ++i) {
+    mean += xs[i];
+  }
+  Vec2 variance = Vec2::Zero();
+  if (xs.size() > 0) {
+    mean /= xs.size();
+    for (int i = 0; i < xs.size(); ++i) {
+      Vec2 d = xs[i] - mean;
+      variance += Vec2(d(0) * d(0), d(1) * d(1));
+    }
+    variance /= xs.size();
+  }
+  double var_norm = variance.norm();
+  double factor = sqrt(2.0 / var_norm);
+  if (var_norm < 1e-8) {
+    factor = 1.0;
+    mean.setOnes();
+  }
+  *T << factor, 0,      -factor * mean(0),
+        0,      factor, -factor * mean(1),
+        0,      0,       1;
+}
+
+// The center of a finite camera, or false.
+bool CameraCenter(const Mat34 &P, Vec3 *C) {
+  Mat3 M = P.block<3, 3>(0, 0);
+  double determinant = M.determinant();
+  if (fabs(determinant) < 1e-12) {
+    return false;
+  }
+  *C = -M.inverse() * P.col(3);
+  return true;
+}
+
+// HZ 6.2.3: the sign of the depth of X is the sign of det(M) (P3 X) T.
+double DepthSign(const Mat34 &P) {
+  return P.block<3, 3>(0, 0).determinant() < 0 ? -1 : 1;
+}
+
+}  // namespace
+
+void TriangulateBatch(const TriangulationBatch &batch,
+                      const BatchTriangulationOptions &options,
+                      vector<Vec4> *X,
+                      vector<TriangulationStatus> *status) {
+  LIBMV_TRACE_SCOPE("triangulate_batch");
+  const int num_points = batch.NumPoints();
+  const int num_cameras = batch.Ps.size();
+  X->resize(num_points);
+  status->resize(num_points);
+
+  Mat3 T;
+  IsotropicPreconditioner(batch.xs, &T);
+  vector<Mat34> preconditioned_Ps(num_cameras);
+  vector<Vec3> centers(num_cameras);
+  vector<bool> has_center(num_cameras);
+  vector<double> depth_signs(num_cameras);
+  for (int j = 0; j < num_cameras; ++j) {
+    preconditioned_Ps[j] = T * batch.Ps[j];
+    Vec3 C = Vec3::Zero();
+    has_center[j] = CameraCenter(batch.Ps[j], &C);
+    centers[j] = C;
+    depth_signs[j] = DepthSign(batch.Ps[j]);
+  }
+  const double max_error2 =
+      options.max_reprojection_error * options.max_reprojection_error;
+  const double max_cos_angle = cos(options.min_triangulation_angle);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+  for (int i = 0; i < num_points; ++i) {
+    const int begin = batch.point_offsets[i];
+    const int end = batch.point_offsets[i + 1];
+    if (end - begin < std::max(options.min_num_views, 2)) {
+      (*status)[i] = TRIANGULATION_TOO_FEW_VIEWS;
+      continue;
+    }
+
+    // Normal equations of the algebraic error: each observation gives the
+    // two rows x P3 - P1 and y P3 - P2.
+    Mat4 AtA = Mat4::Zero();
+    for (int k = begin; k < end; ++k) {
+      const Mat34 &P = preconditioned_Ps[batch.cameras[k]];
+      const Vec2 &x = batch.xs[k];
+      const double u = T(0, 0) * x(0) + T(0, 2);
+      const double v = T(1, 1) * x(1) + T(1, 2);
+      Vec4 a = u * P.row(2).transpose() - P.row(0).transpose();
+      Vec4 b = v * P.row(2).transpose() - P.row(1).transpose();
+      AtA += a * a.transpose() + b * b.transpose();
+    }
+    Eigen::SelfAdjointEigenSolver<Mat4> solver(AtA);
+    // The eigen values are sorted in increasing order.
+    Vec4 Xi = solver.eigenvectors().col(0);
+    (*X)[i] = Xi;
+
+    if (libmv::isnan(Xi.sum()) || Xi(3) == 0) {
+      (*status)[i] = TRIANGULATION_DEGENERATE;
+      continue;
+    }
+    TriangulationStatus point_status = TRIANGULATION_OK;
+    for (int k = begin; k < end && point_status == TRIANGULATION_OK; ++k) {
+      const int camera = batch.cameras[k];
+      const Vec3 x = batch.Ps[camera] * Xi;
+      if (options.check_cheirality && depth_signs[camera] * x(2) * Xi(3) <= 0) {
+        point_status = TRIANGULATION_BEHIND_CAMERA;
+      } else if (options.max_reprojection_error > 0) {
+        Vec2 error = x.head<2>() / x(2) - batch.xs[k];
+        if (error.squaredNorm() > max_error2) {
+          point_status = TRIANGULATION_REPROJECTION_ERROR;
+        }
+      }
+    }
+    if (point_status == TRIANGULATION_OK &&
+        options.min_triangulation_angle > 0) {
+      // The largest angle between two viewing rays.
+      const Vec3 X_euclidean = Xi.head<3>() / Xi(3);
+      double min_cos = 1;
+      for (int k = begin; k < end && min_cos > max_cos_angle; ++k) {
+        const int ck = batch.cameras[k];
+        if (!has_center[ck]) {
+          continue;
+        }
+        Vec3 ray_k = (X_euclidean - centers[ck]).normalized();
+        for (int l = k + 1; l < end; ++l) {
+          const int cl = batch.cameras[l];
+          if (has_center[cl]) {
+            Vec3 ray_l = (X_euclidean - centers[cl]).normalized();
+            min_cos = std::min(min_cos, ray_k.dot(ray_l));
+          }
+        }
+      }
+      if (min_cos > max_cos_angle) {
+        point_status = TRIANGULATION_SMALL_ANGLE;
+      }
+    }
+    (*status)[i] = point_status;
+  }
+}
+
+}  // namespace libmv
@@ -0,0 +1,103 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_MULTIVIEW_BATCH_TRIANGULATION_H_
+#define LIBMV_MULTIVIEW_BATCH_TRIANGULATION_H_
+
+#include "libmv/base/vector.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+// The observations of many points, gathered in flat arrays: the observations
+// of the point i are [point_offsets[i], point_offsets[i + 1]).
+struct TriangulationBatch {
+  TriangulationBatch() { point_offsets.push_back(0); }
+
+  // Returns the index of the camera.
+  int AddCamera(const Mat34 &P) {
+    Ps.push_back(P);
+    return Ps.size() - 1;
+  }
+  // Starts a new point; the next observations belong to it. Returns the
+  // index of the point.
+  int AddPoint() {
+    const int end = point_offsets[point_offsets.size() - 1];
+    point_offsets.push_back(end);
+    return NumPoints() - 1;
+  }
+  void AddObservation(int camera, const Vec2 &x) {
+    cameras.push_back(camera);
+    xs.push_back(x);
+    ++point_offsets[point_offsets.size() - 1];
+  }
+  int NumPoints() const { return point_offsets.size() - 1; }
+  int NumObservations(int point) const {
+    return point_offsets[point + 1] - point_offsets[point];
+  }
+
+  vector<Mat34> Ps;
+  vector<int> point_offsets;
+  vector<int> cameras;  // Index in Ps of each observation.
+  vector<Vec2> xs;      // Image coordinates of each observation.
+};
+
+struct BatchTriangulationOptions {
+  BatchTriangulationOptions()
+      : min_num_views(2),
+        check_cheirality(true),
+        max_reprojection_error(4.0),
+        min_triangulation_angle(1.0 * M_PI / 180.0) {}
+
+  int min_num_views;
+  // Rejects the points behind one of the cameras.
+  bool check_cheirality;
+  // Rejects the points whose largest reprojection error is above this (in
+  // pixels). Disabled if not positive.
+  double max_reprojection_error;
+  // Rejects the points whose largest angle between two of the viewing rays
+  // is below this (in radians). Disabled if not positive; it is only
+  // meaningful with metric cameras.
+  double min_triangulation_angle;
+};
+
+enum TriangulationStatus {
+  TRIANGULATION_OK,
+  TRIANGULATION_TOO_FEW_VIEWS,
+  TRIANGULATION_DEGENERATE,           // NaN or at infinity.
+  TRIANGULATION_BEHIND_CAMERA,
+  TRIANGULATION_REPROJECTION_ERROR,
+  TRIANGULATION_SMALL_ANGLE
+};
+
+// Triangulates all the points of the batch, in parallel, and checks them.
+// Each point minimizes the algebraic error, as NViewTriangulateAlgebraic,
+// but by solving its 4x4 normal equations with a fixed size eigen solver.
+// The observations are preconditioned with one isotropic normalization for
+// the whole batch. X gets the homogeneous points (valid only if their status
+// is TRIANGULATION_OK).
+void TriangulateBatch(const TriangulationBatch &batch,
+                      const BatchTriangulationOptions &options,
+                      vector<Vec4> *X,
+                      vector<TriangulationStatus> *status);
+
+}  // namespace libmv
+
+#endif  // LIBMV_MULTIVIEW_BATCH_TRIANGULATION_H_
@@ -0,0 +1,154 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/base/vector.h"
+#include "libmv/multiview/batch_triangulation.h"
+#include "libmv/multiview/nviewtriangulation.h"
+#include "libmv/multiview/projection.h"
+#include "libmv/multiview/test_data_sets.h"
+#include "libmv/numeric/numeric.h"
+#include "testing/testing.h"
+
+namespace {
+
+using namespace libmv;
+
+TriangulationBatch BatchFromDataSet(NViewDataSet &d) {
+  TriangulationBatch batch;
+  for (int j = 0; j < d.n; ++j) {
+    batch.AddCamera(d.P(j));
+  }
+  for (int i = 0; i < d.X.cols(); ++i) {
+    batch.AddPoint();
+    for (int j = 0; j < d.n; ++j) {
+      batch.AddObservation(j, d.x[j].col(i));
+    }
+  }
+  return batch;
+}
+
+TEST(TriangulateBatch, MatchesNViewTriangulateAlgebraic) {
+  int nviews = 5;
+  int npoints = 20;
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+  TriangulationBatch batch = BatchFromDataSet(d);
+  EXPECT_EQ(npoints, batch.NumPoints());
+  EXPECT_EQ(nviews, batch.NumObservations(3));
+
+  vector<Vec4> X;
+  vector<TriangulationStatus> status;
+  TriangulateBatch(batch, BatchTriangulationOptions(), &X, &status);
+  ASSERT_EQ(npoints, X.size());
+
+  vector<Mat34> Ps(nviews);
+  for (int j = 0; j < nviews; ++j) {
+    Ps[j] = d.P(j);
+  }
+  for (int i = 0; i < npoints; ++i) {
+    EXPECT_EQ(TRIANGULATION_OK, status[i]);
+    Vec3 X_euclidean = X[i].head<3>() / X[i](3);
+    EXPECT_NEAR(0, (X_euclidean - d.X.col(i)).norm(), 1e-8);
+
+    Mat2X xs(2, nviews);
+    for (int j = 0; j < nviews; ++j) {
+      xs.col(j) = d.x[j].col(i);
+    }
+    Vec4 X_algebraic;
+    NViewTriangulateAlgebraic(xs, Ps, &X_algebraic);
+    X_algebraic /= X_algebraic(3);
+    EXPECT_NEAR(0, (X_euclidean - X_algebraic.head<3>()).norm(), 1e-8);
+  }
+}
+
+TEST(TriangulateBatch, RejectsBadPoints) {
+  NViewDataSet d = NRealisticCamerasFull(3, 4);
+  TriangulationBatch batch = BatchFromDataSet(d);
+  // A point seen once.
+  batch.AddPoint();
+  batch.AddObservation(0, d.x[0].col(0));
+  // A point with an outlier observation.
+  batch.AddPoint();
+  batch.AddObservation(0, d.x[0].col(1));
+  batch.AddObservation(1, d.x[1].col(1));
+  batch.AddObservation(2, d.x[2].col(2));
+
+  vector<Vec4> X;
+  vector<TriangulationStatus> status;
+  TriangulateBatch(batch, BatchTriangulationOptions(), &X, &status);
+  ASSERT_EQ(6, status.size());
+  EXPECT_EQ(TRIANGULATION_OK, status[0]);
+  EXPECT_EQ(TRIANGULATION_TOO_FEW_VIEWS, status[4]);
+  EXPECT_EQ(TRIANGULATION_REPROJECTION_ERROR, status[5]);
+
+  BatchTriangulationOptions options;
+  options.max_reprojection_error = 0;
+  TriangulateBatch(batch, options, &X, &status);
+  EXPECT_NE(TRIANGULATION_REPROJECTION_ERROR, status[5]);
+}
+
+TEST(TriangulateBatch, RejectsPointsBehindCameras) {
+  NViewDataSet d = NRealisticCamerasFull(2, 1);
+  TriangulationBatch batch;
+  batch.AddCamera(d.P(0));
+  batch.AddCamera(d.P(1));
+  // The point mirrored through the center of the camera 1 projects at the
+  // same place in this camera, but is behind it.
+  Vec3 X_behind = 2 * d.C[1] - d.X.col(0);
+  batch.AddPoint();
+  batch.AddObservation(0, Project(d.P(0), X_behind));
+  batch.AddObservation(1, Project(d.P(1), X_behind));
+
+  vector<Vec4> X;
+  vector<TriangulationStatus> status;
+  TriangulateBatch(batch, BatchTriangulationOptions(), &X, &status);
+  EXPECT_EQ(TRIANGULATION_BEHIND_CAMERA, status[0]);
+}
+
+TEST(TriangulateBatch, RejectsSmallTriangulationAngles) {
+  Mat3 K;
+  K << 1000, 0, 500,
+       0, 1000, 500,
+       0, 0, 1;
+  Mat3 R = Mat3::Identity();
+  Mat34 P1, P2;
+  P_From_KRt(K, R, Vec3(0, 0, 0), &P1);
+  P_From_KRt(K, R, Vec3(-0.01, 0, 0), &P2);
+  Vec3 X_true(0.1, 0.2, 10);
+  TriangulationBatch batch;
+  batch.AddCamera(P1);
+  batch.AddCamera(P2);
+  batch.AddPoint();
+  batch.AddObservation(0, Project(P1, X_true));
+  batch.AddObservation(1, Project(P2, X_true));
+
+  // The baseline of 1cm sees the point at 10m under about 0.06 degrees.
+  BatchTriangulationOptions options;
+  vector<Vec4> X;
+  vector<TriangulationStatus> status;
+  TriangulateBatch(batch, options, &X, &status);
+  EXPECT_EQ(TRIANGULATION_SMALL_ANGLE, status[0]);
+
+  options.min_triangulation_angle = 0.05 * M_PI / 180.0;
+  TriangulateBatch(batch, options, &X, &status);
+  EXPECT_EQ(TRIANGULATION_OK, status[0]);
+  EXPECT_NEAR(0, (X[0].head<3>() / X[0](3) - X_true).norm(), 1e-6);
+}
+
+}  // namespace
@@ -25,6 +25,7 @@
 #include "libmv/multiview/bundle.h"
 #include "libmv/numeric/numeric.h"
 #include "libmv/logging/logging.h"
+#include "libmv/logging/tracing.h"
 #include "third_party/ssba/Math/v3d_linear.h"
 #include "third_party/ssba/Math/v3d_linear_utils.h"
 #include "third_party/ssba/Geometry/v3d_metricbundle.h"
@@ -78,6 +79,7 @@ void EuclideanBAFull(const vector<Mat2X> &x,
                      vector<Vec3> *ts,
                      Mat3X *X,
                      eLibmvBundleType type) {
+  LIBMV_TRACE_SCOPE("bundle_adjustment");
   using namespace V3D;
 
   int mode = ConvertTypeV3D(type);
@@ -235,6 +237,7 @@ double EuclideanBA(const vector<Mat2X> &x,
                    vector<Vec3> *ts,
                    Mat3X *X,
                    eLibmvBundleType type) {
+  LIBMV_TRACE_SCOPE("bundle_adjustment");
   using namespace V3D;
 
   int mode = ConvertTypeV3D(type);
@@ -0,0 +1,176 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+
+#include "libmv/logging/logging.h"
+#include "libmv/multiview/pose_refinement.h"
+
+namespace libmv {
+
+namespace {
+
+typedef Eigen::Matrix<double, 6, 6> Mat6;
+typedef Eigen::Matrix<double, 2, 6> Mat26;
+
+// Robust cost of a squared reprojection error, and the weight of the
+// residual in the iteratively reweighted normal equations.
+void RobustLoss(const PoseRefinementOptions &options, double squared_error,
+                double *cost, double *weight) {
+  const double s = options.loss_scale;
+  switch (options.loss) {
+    case POSE_HUBER_LOSS:
+      if (squared_error <= s * s) {
+        *cost = squared_error;
+        *weight = 1.0;
+      } else {
+        double error = sqrt(squared_error);
+        *cost = 2.0 * s * error - s * s;
+        *weight = s / error;
+      }
+      break;
+    case POSE_CAUCHY_LOSS:
+      *cost = s * s * log(1.0 + squared_error / (s * s));
+      *weight = 1.0 / (1.0 + squared_error / (s * s));
+      break;
+    default:
+      *cost = squared_error;
+      *weight = 1.0;
+  }
+}
+
+// Rotation of angle |w| around w, exact for small angles.
+Mat3 ExpRotation(const Vec3 &w) {
+  double theta = w.norm();
+  if (theta < 1e-12) {
+    return Mat3::Identity() + CrossProductMatrix(w);
+  }
+  return RotationRodrigues(w);
+}
+
+double RobustCost(const Mat2X &x_image, const Mat3X &X_world, const Mat3 &K,
+                  const PoseRefinementOptions &options,
+                  const Mat3 &R, const Vec3 &t, int *num_points) {
+  double total = 0;
+  *num_points = 0;
+  for (int i = 0; i < X_world.cols(); ++i) {
+    Vec3 p = K * (R * X_world.col(i) + t);
+    if (p(2) <= 0) {
+      continue;
+    }
+    Vec2 r(p(0) / p(2) - x_image(0, i), p(1) / p(2) - x_image(1, i));
+    double cost, weight;
+    RobustLoss(options, r.squaredNorm(), &cost, &weight);
+    total += cost;
+    ++*num_points;
+  }
+  return total;
+}
+
+}  // namespace
+
+bool RefineEuclideanPose(const Mat2X &x_image,
+                         const Mat3X &X_world,
+                         const Mat3 &K,
+                         const PoseRefinementOptions &options,
+                         Mat3 *R,
+                         Vec3 *t,
+                         PoseRefinementSummary *summary) {
+  CHECK_EQ(x_image.cols(), X_world.cols());
+  int num_points;
+  double cost = RobustCost(x_image, X_world, K, options, *R, *t, &num_points);
+  if (summary) {
+    summary->num_iterations = 0;
+    summary->initial_cost = summary->final_cost = cost;
+  }
+  if (num_points < 3) {
+    return false;
+  }
+  const Mat2 K2 = K.block<2, 2>(0, 0);
+  double lambda = 1e-4;
+  for (int iteration = 0; iteration < options.max_iterations; ++iteration) {
+    // Normal equations of the pose update R <- exp([w]x) R, t <- t + dt,
+    // with the weights at the current pose.
+    Mat6 JtJ = Mat6::Zero();
+    Vec6 Jtr = Vec6::Zero();
+    for (int i = 0; i < X_world.cols(); ++i) {
+      Vec3 RX = *R * X_world.col(i);
+      Vec3 Xc = RX + *t;
+      if (Xc(2) <= 0) {
+        continue;
+      }
+      const double iz = 1.0 / Xc(2);
+      Vec2 n(Xc(0) * iz, Xc(1) * iz);
+      Vec2 r = K2 * n + K.block<2, 1>(0, 2) - x_image.col(i);
+      double point_cost, weight;
+      RobustLoss(options, r.squaredNorm(), &point_cost, &weight);
+
+      Mat23 dn_dXc;
+      dn_dXc << iz, 0, -n(0) * iz,
+                0, iz, -n(1) * iz;
+      Mat23 dr_dXc = K2 * dn_dXc;
+      Mat26 J;
+      J.block<2, 3>(0, 0) = -dr_dXc * CrossProductMatrix(RX);
+      J.block<2, 3>(0, 3) = dr_dXc;
+      JtJ += weight * J.transpose() * J;
+      Jtr += weight * J.transpose() * r;
+    }
+
+    // Levenberg-Marquardt: grow the damping until the step decreases the
+    // cost.
+    bool accepted = false;
+    double new_cost = cost;
+    while (!accepted && lambda < 1e10) {
+      Mat6 A = JtJ;
+      A.diagonal() *= 1.0 + lambda;
+      Vec6 delta = -A.ldlt().solve(Jtr);
+      Mat3 new_R = ExpRotation(delta.head<3>()) * *R;
+      Vec3 new_t = *t + delta.tail<3>();
+      int new_num_points;
+      new_cost = RobustCost(x_image, X_world, K, options, new_R, new_t,
+                            &new_num_points);
+      if (new_num_points >= 3 && new_cost < cost) {
+        *R = new_R;
+        *t = new_t;
+        accepted = true;
+        lambda = std::max(lambda / 10.0, 1e-12);
+      } else {
+        lambda *= 10.0;
+      }
+    }
+    if (summary) {
+      summary->num_iterations = iteration + 1;
+    }
+    if (!accepted) {
+      break;
+    }
+    double decrease = cost - new_cost;
+    cost = new_cost;
+    if (decrease <= options.min_relative_decrease * cost) {
+      break;
+    }
+  }
+  if (summary) {
+    summary->final_cost = cost;
+  }
+  return true;
+}
+
+}  // namespace libmv
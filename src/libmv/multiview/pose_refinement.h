@@ -0,0 +1,74 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_MULTIVIEW_POSE_REFINEMENT_H_
+#define LIBMV_MULTIVIEW_POSE_REFINEMENT_H_
+
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+enum PoseRefinementLoss {
+  POSE_SQUARED_LOSS,
+  POSE_HUBER_LOSS,
+  POSE_CAUCHY_LOSS
+};
+
+struct PoseRefinementOptions {
+  PoseRefinementOptions()
+      : loss(POSE_HUBER_LOSS),
+        loss_scale(1.0),
+        max_iterations(20),
+        min_relative_decrease(1e-10) {}
+
+  PoseRefinementLoss loss;
+  // Reprojection error (in pixels) above which the robust losses start to
+  // down-weight the residuals.
+  double loss_scale;
+  int max_iterations;
+  // Stops when an accepted step decreases the cost by less than this
+  // fraction.
+  double min_relative_decrease;
+};
+
+struct PoseRefinementSummary {
+  int num_iterations;
+  double initial_cost;
+  double final_cost;
+};
+
+// Refines the pose R, t of a calibrated camera (x ~ K (R X + t)) by
+// Levenberg-Marquardt on the robust reprojection error of the points,
+// starting from the given pose, e.g. the EPnP solution.  Only the 6 pose
+// parameters are optimized; the normal equations are 6x6 and the Jacobians
+// analytic, so it costs a few microseconds per point and iteration.
+// Points behind the camera are ignored.  Returns false (and leaves R, t
+// unchanged) if there are less than 3 points in front of the camera.
+bool RefineEuclideanPose(const Mat2X &x_image,
+                         const Mat3X &X_world,
+                         const Mat3 &K,
+                         const PoseRefinementOptions &options,
+                         Mat3 *R,
+                         Vec3 *t,
+                         PoseRefinementSummary *summary = NULL);
+
+}  // namespace libmv
+
+#endif  // LIBMV_MULTIVIEW_POSE_REFINEMENT_H_
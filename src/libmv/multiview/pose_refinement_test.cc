@@ -0,0 +1,101 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/multiview/pose_refinement.h"
+#include "testing/testing.h"
+
+namespace {
+using namespace libmv;
+
+// Points in front of a camera with a known pose, and their images.
+struct PoseScene {
+  PoseScene(int num_points) : X(3, num_points), x(2, num_points) {
+    K << 800, 0, 320,
+         0, 800, 240,
+         0, 0, 1;
+    R = RotationAroundX(0.1) * RotationAroundY(-0.2) * RotationAroundZ(0.3);
+    t << 0.3, -0.1, 5;
+    Mat3X random = Mat3X::Random(3, num_points);
+    for (int i = 0; i < num_points; ++i) {
+      X.col(i) = R.transpose() * (Vec3(2 * random(0, i), 2 * random(1, i),
+                                       random(2, i)) - t + Vec3(0, 0, 5));
+      Vec3 p = K * (R * X.col(i) + t);
+      x.col(i) << p(0) / p(2), p(1) / p(2);
+    }
+  }
+  Mat3 K, R;
+  Vec3 t;
+  Mat3X X;
+  Mat2X x;
+};
+
+TEST(PoseRefinement, ConvergesFromAPerturbedPose) {
+  PoseScene scene(50);
+  Mat3 R = RotationAroundY(0.05) * scene.R;
+  Vec3 t = scene.t + Vec3(0.1, -0.05, 0.2);
+  PoseRefinementOptions options;
+  PoseRefinementSummary summary;
+  EXPECT_TRUE(RefineEuclideanPose(scene.x, scene.X, scene.K, options,
+                                  &R, &t, &summary));
+  EXPECT_MATRIX_NEAR(scene.R, R, 1e-8);
+  EXPECT_MATRIX_NEAR(scene.t, t, 1e-7);
+  EXPECT_LT(summary.final_cost, 1e-12);
+  EXPECT_GT(summary.initial_cost, 1.0);
+  EXPECT_LE(summary.num_iterations, options.max_iterations);
+}
+
+TEST(PoseRefinement, RobustLossesIgnoreOutliers) {
+  PoseScene scene(60);
+  // Moves 10 image points far away.
+  for (int i = 0; i < 10; ++i) {
+    scene.x.col(i) += Vec2(40 + i, -30);
+  }
+  PoseRefinementLoss losses[] = { POSE_HUBER_LOSS, POSE_CAUCHY_LOSS };
+  for (int l = 0; l < 2; ++l) {
+    Mat3 R = RotationAroundX(0.02) * scene.R;
+    Vec3 t = scene.t + Vec3(0.05, 0, -0.1);
+    PoseRefinementOptions options;
+    options.loss = losses[l];
+    options.max_iterations = 100;
+    EXPECT_TRUE(RefineEuclideanPose(scene.x, scene.X, scene.K, options,
+                                    &R, &t));
+    EXPECT_MATRIX_NEAR(scene.R, R, 1e-3);
+    EXPECT_MATRIX_NEAR(scene.t, t, 1e-2);
+  }
+
+  // The squared loss is pulled away by the outliers.
+  Mat3 R = scene.R;
+  Vec3 t = scene.t;
+  PoseRefinementOptions options;
+  options.loss = POSE_SQUARED_LOSS;
+  EXPECT_TRUE(RefineEuclideanPose(scene.x, scene.X, scene.K, options,
+                                  &R, &t));
+  EXPECT_GT((t - scene.t).norm(), 1e-2);
+}
+
+TEST(PoseRefinement, NeedsThreePointsInFront) {
+  PoseScene scene(2);
+  Mat3 R = scene.R;
+  Vec3 t = scene.t;
+  EXPECT_FALSE(RefineEuclideanPose(scene.x, scene.X, scene.K,
+                                   PoseRefinementOptions(), &R, &t));
+}
+
+}  // namespace
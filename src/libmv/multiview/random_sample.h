@@ -26,6 +26,21 @@
 
 namespace libmv {
 
+/**
+ * Returns a random integer in [0, 2^31) and advances state (xorshift32).
+ * Code which samples from several threads gives each task its own state,
+ * seeded from the task, so that its draws do not depend on the scheduling as
+ * the draws of the shared rand() do.
+ */
+inline int NextRandom(unsigned int *state) {
+  unsigned int x = *state ? *state : 0x9e3779b9u;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return static_cast<int>(x >> 1);
+}
+
 /**
  * Pick a random subset of the integers [0, total), in random order.
  * Note that this can behave badly if num_samples is close to total; runtime
@@ -38,11 +53,14 @@ namespace libmv {
  * \param total_samples The number of samples available.
  * \param samples       num_samples of numbers in [0, total_samples) is placed
  *                      here on return.
+ * \param random_state  The state of NextRandom, or NULL to use rand().
  */
-static void UniformSample(int num_samples, int total_samples, vector<int> *samples) {
+static void UniformSample(int num_samples, int total_samples, vector<int> *samples,
+                          unsigned int *random_state = NULL) {
   samples->resize(0);
   while (samples->size() < num_samples) {
-    int sample = rand() % total_samples;
+    int sample = (random_state ? NextRandom(random_state) : rand())
+        % total_samples;
     bool found = false;
     for (int j = 0; j < samples->size(); ++j) {
       found = (*samples)[j] == sample;
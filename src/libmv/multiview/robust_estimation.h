@@ -25,6 +25,7 @@
 
 #include "libmv/base/vector.h"
 #include "libmv/logging/logging.h"
+#include "libmv/logging/tracing.h"
 #include "libmv/multiview/random_sample.h"
 #include "libmv/numeric/numeric.h"
 
@@ -70,12 +71,17 @@ static uint IterationsRequired(int min_samples,
 // 2. Kernel::MINIMUM_SAMPLES
 // 3. Kernel::Fit(vector<int>, vector<Kernel::Model> *)
 // 4. Kernel::Error(Model, int) -> error
+//
+// The samples are drawn with rand(), or from random_state if it is not NULL
+// (see NextRandom), e.g. for estimations running in parallel.
 template<typename Kernel, typename Scorer>
 typename Kernel::Model Estimate(const Kernel &kernel,
                                 const Scorer &scorer,
                                 vector<int> *best_inliers = NULL,
                                 double *best_score = NULL,
-                                double outliers_probability = 1e-2) {
+                                double outliers_probability = 1e-2,
+                                unsigned int *random_state = NULL) {
+  LIBMV_TRACE_SCOPE("ransac");
   CHECK(outliers_probability < 1.0);
   CHECK(outliers_probability > 0.0);
   size_t iteration = 0;
@@ -108,7 +114,7 @@ typename Kernel::Model Estimate(const Kernel &kernel,
   for (iteration = 0;
        iteration < max_iterations &&
        iteration < really_max_iterations; ++iteration) {
-    UniformSample(min_samples, total_samples, &sample);
+    UniformSample(min_samples, total_samples, &sample, random_state);
 
     vector<typename Kernel::Model> models;
     kernel.Fit(sample, &models);
@@ -142,6 +148,8 @@ typename Kernel::Model Estimate(const Kernel &kernel,
         << max_iterations << "; best inlier ratio: " << best_inlier_ratio;
     }
   }
+  LIBMV_TRACE_COUNTER("ransac.iterations", iteration);
+  LIBMV_TRACE_COUNTER("ransac.inliers", best_num_inliers);
   if (best_score)
     *best_score = best_cost;
   return best_model;
@@ -33,14 +33,16 @@ double EuclideanResectionEPnPRobust(const Mat2X &x_image,
                                     double max_error,
                                     Mat3 *R, Vec3 *t,
                                     vector<int> *inliers,
-                                    double outliers_probability) {
+                                    double outliers_probability,
+                                    unsigned int *random_state) {
   // The threshold is on the sum of the squared errors.
   double threshold = Square(max_error);
   double best_score = HUGE_VAL;
   typedef libmv::euclidean_resection::kernel::Kernel Kernel;
   Kernel kernel(x_image, X_world, K);
   Mat34 P = Estimate(kernel, MLEScorer<Kernel>(threshold), 
-                     inliers, &best_score, outliers_probability);
+                     inliers, &best_score, outliers_probability,
+                     random_state);
   Mat3 K_unused;
   KRt_From_P(P, &K_unused, R, t);
   if (best_score == HUGE_VAL)
@@ -29,6 +29,8 @@ namespace libmv {
 // Estimate robustly the the extrinsic parameters, R and t for a calibrated
 // camera from 4 or more 3D points and their images.
 // The euclidean resection solver relies on the EPnP method.
+// random_state is the state of the random samples (see Estimate), or NULL
+// to use rand().
 // Returns the score associated to the solution (R,t)
 double EuclideanResectionEPnPRobust(const Mat2X &x_image, 
                                     const Mat3X &X_world,
@@ -36,7 +38,8 @@ double EuclideanResectionEPnPRobust(const Mat2X &x_image,
                                     double max_error,
                                     Mat3 *R, Vec3 *t,
                                     vector<int> *inliers = NULL,
-                                    double outliers_probability = 1e-2);
+                                    double outliers_probability = 1e-2,
+                                    unsigned int *random_state = NULL);
 
 } // namespace libmv
 
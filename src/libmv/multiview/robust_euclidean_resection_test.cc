@@ -18,6 +18,8 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <cstdlib>
+
 #include "libmv/logging/logging.h"
 #include "libmv/multiview/projection.h"
 #include "libmv/multiview/robust_euclidean_resection.h"
@@ -59,5 +61,36 @@ TEST(EuclideanResectionRobustKernel, TestSynthetic6FullViews) {
   }
 }
 
+TEST(EuclideanResectionRobustKernel, SeededSamplesDoNotDependOnRand) {
+  int npoints = 50;
+  NViewDataSet d = NRealisticCamerasFull(1, npoints);
+  // Noise and outliers, so that the RANSAC samples matter.
+  Mat2X x = d.x[0];
+  for (int i = 0; i < npoints; ++i) {
+    x(0, i) += (i % 7 - 3) * 0.3;
+    x(1, i) += (i % 5 - 2) * 0.3;
+    if (i % 4 == 0) {
+      x(0, i) += 40;
+    }
+  }
+  Mat3 R, other_R;
+  Vec3 t, other_t;
+  vector<int> inliers, other_inliers;
+  unsigned int random_state = 7;
+  srand(1);
+  EuclideanResectionEPnPRobust(x, d.X, d.K[0], 1.0, &R, &t, &inliers,
+                               1e-2, &random_state);
+  random_state = 7;
+  srand(2);
+  EuclideanResectionEPnPRobust(x, d.X, d.K[0], 1.0, &other_R, &other_t,
+                               &other_inliers, 1e-2, &random_state);
+  EXPECT_MATRIX_EQ(R, other_R);
+  EXPECT_MATRIX_EQ(t, other_t);
+  ASSERT_EQ(inliers.size(), other_inliers.size());
+  for (int i = 0; i < inliers.size(); ++i) {
+    EXPECT_EQ(inliers[i], other_inliers[i]);
+  }
+}
+
 }  // namespace
 }  // namespace libmv
@@ -51,7 +51,8 @@ double FundamentalFromCorrespondences7PointRobust(const Mat &x1,
                                                   double max_error,
                                                   Mat3 * F,
                                                   vector<int> *inliers,
-                                                  double outliers_probability) {
+                                                  double outliers_probability,
+                                                  unsigned int *random_state) {
   // The threshold is on the sum of the squared errors in the two images.
   // Actually, Sampson's approximation of this error.
   double threshold = 2 * Square(max_error);
@@ -59,7 +60,7 @@ double FundamentalFromCorrespondences7PointRobust(const Mat &x1,
   typedef fundamental::kernel::NormalizedSevenPointKernel Kernel;
   Kernel kernel(x1, x2);
   *F = Estimate(kernel, MLEScorer<Kernel>(threshold), inliers, 
-                &best_score, outliers_probability);
+                &best_score, outliers_probability, random_state);
   if (best_score == HUGE_VAL)
     return HUGE_VAL;
   else
@@ -39,6 +39,7 @@ double FundamentalFromCorrespondences8PointRobust(
 
 // Estimate robustly the fundamental matrix between two dataset of 2D point
 // (image coords space). The fundamental solver relies on the 7 point solution.
+// The samples are drawn from random_state if it is not NULL (see Estimate).
 // Returns the score associated to the solution F
 double FundamentalFromCorrespondences7PointRobust(
     const Mat &x1,
@@ -46,7 +47,8 @@ double FundamentalFromCorrespondences7PointRobust(
     double max_error,
     Mat3 * F,
     vector<int> *inliers = NULL,
-    double outliers_probability = 1e-2);
+    double outliers_probability = 1e-2,
+    unsigned int *random_state = NULL);
 
 } // namespace libmv
 
@@ -32,14 +32,15 @@ double Homography2DFromCorrespondences4PointRobust(const Mat &x1,
                                                    double max_error,
                                                    Mat3 *H,
                                                    vector<int> *inliers,
-                                                   double outliers_probability) {
+                                                   double outliers_probability,
+                                                   unsigned int *random_state) {
   // The threshold is on the sum of the squared errors in the two images.
   double threshold = 2 * Square(max_error);
   double best_score = HUGE_VAL;
   typedef homography::homography2D::kernel::Kernel KernelH;
   KernelH kernel(x1, x2);
   *H = Estimate(kernel, MLEScorer<KernelH>(threshold), inliers, 
-                &best_score, outliers_probability);
+                &best_score, outliers_probability, random_state);
   if (best_score == HUGE_VAL)
     return HUGE_VAL;
   else
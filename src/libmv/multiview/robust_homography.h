@@ -50,6 +50,8 @@ namespace libmv {
  * The number of iterations is controlled using the following equation:
  *    n_iter = log(outliers_prob) / log(1.0 - pow(inlier_ratio, min_samples)))
  * The more this value is high, the less the function selects ramdom samples.
+ * \param[in,out] random_state The state of the random samples (see Estimate),
+ *                 or NULL to use rand().
  * 
  * \return the best error found (in pixels), associated to the solution H
  * 
@@ -62,7 +64,8 @@ double Homography2DFromCorrespondences4PointRobust(
     double max_error,
     Mat3 *H,
     vector<int> *inliers = NULL,
-    double outliers_probability = 1e-2);
+    double outliers_probability = 1e-2,
+    unsigned int *random_state = NULL);
 
 } // namespace libmv
 
@@ -34,6 +34,7 @@
 #include "libmv/numeric/numeric.h"
 #include "libmv/numeric/function_derivative.h"
 #include "libmv/logging/logging.h"
+#include "libmv/logging/tracing.h"
 
 namespace libmv {
 
@@ -109,6 +110,7 @@ class LevenbergMarquardt {
   }
 
   Results minimize(const SolverParameters &params, Parameters *x_and_min) {
+    LIBMV_TRACE_SCOPE("lm_minimize");
     Parameters &x = *x_and_min;
     JMatrixType J;
     AMatrixType A;
@@ -124,11 +126,12 @@ class LevenbergMarquardt {
     Parameters dx, x_new;
     int i;
     for (i = 0; results.status == RUNNING && i < params.max_iterations; ++i) {
-      LOG(INFO) << "iteration: " << i;
-      LOG(INFO) << "||f(x)||: " << f_(x).norm();
-      LOG(INFO) << "max(g): " << g.array().abs().maxCoeff();
-      LOG(INFO) << "u: " << u;
-      LOG(INFO) << "v: " << v;
+      // Evaluating f(x) again is costly, only do it when asked to.
+      VLOG(3) << "iteration: " << i
+              << " ||f(x)||: " << f_(x).norm()
+              << " max(g): " << g.array().abs().maxCoeff()
+              << " u: " << u
+              << " v: " << v;
 
       AMatrixType A_augmented = A + u*AMatrixType::Identity(J.cols(), J.cols());
       Solver solver(A_augmented);
@@ -168,6 +171,7 @@ class LevenbergMarquardt {
     results.error_magnitude = error.norm();
     results.gradient_magnitude = g.norm();
     results.iterations = i;
+    LIBMV_TRACE_COUNTER("lm_minimize.iterations", i);
     return results;
   }
 
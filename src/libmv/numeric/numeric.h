@@ -471,7 +471,7 @@ inline Mat3 SkewMat(const Vec3 &x) {
 inline Mat23 SkewMatMinimal(const Vec2 &x) {
   Mat23 skew;
   skew << 0,-1, x(1),
-          1, 0 -x(0);
+          1, 0, -x(0);
   return skew;
 }
 } // namespace libmv
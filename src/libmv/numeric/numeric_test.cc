@@ -290,6 +290,23 @@ TEST(Numeric, CrossProductMatrix) {
   EXPECT_NEAR(0, DistanceLInfinity(yx, Xty), 1e-8);
 }
 
+TEST(Numeric, SkewMatMinimal) {
+  Vec2 x;
+  x << 2, 3;
+  Mat23 skew = SkewMatMinimal(x);
+  Mat23 expected;
+  expected << 0, -1,  3,
+              1,  0, -2;
+  EXPECT_MATRIX_NEAR(expected, skew, 1e-15);
+  // The two rows of the cross product with the homogeneous point.
+  Vec3 y;
+  y << 5, 7, 11;
+  Vec3 xy = CrossProduct(Vec3(x(0), x(1), 1), y);
+  Vec2 skew_y = skew * y;
+  EXPECT_NEAR(xy(0), skew_y(0), 1e-15);
+  EXPECT_NEAR(xy(1), skew_y(1), 1e-15);
+}
+
 TEST(Numeric, MatrixColumn) {
   Mat A2(2,3);
   Vec2 v2;
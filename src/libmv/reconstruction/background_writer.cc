@@ -0,0 +1,120 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdio>
+
+#include "libmv/logging/logging.h"
+#include "libmv/reconstruction/background_writer.h"
+
+namespace libmv {
+
+bool BufferWriteJob::Run() {
+  FILE *file = fopen(filename_.c_str(), "wb");
+  if (!file) {
+    LOG(ERROR) << "Cannot open " << filename_ << " for writing.";
+    return false;
+  }
+  bool ok = fwrite(buffer_.data(), 1, buffer_.size(), file) == buffer_.size();
+  ok = fclose(file) == 0 && ok;
+  if (!ok) {
+    LOG(ERROR) << "Error while writing " << filename_;
+  }
+  return ok;
+}
+
+BackgroundWriter::BackgroundWriter()
+    : thread_started_(false), busy_(false), stopping_(false),
+      num_failures_(0) {
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&job_queued_, NULL);
+  pthread_cond_init(&job_done_, NULL);
+}
+
+BackgroundWriter::~BackgroundWriter() {
+  pthread_mutex_lock(&mutex_);
+  stopping_ = true;
+  pthread_cond_signal(&job_queued_);
+  pthread_mutex_unlock(&mutex_);
+  if (thread_started_) {
+    pthread_join(thread_, NULL);
+  }
+  pthread_cond_destroy(&job_done_);
+  pthread_cond_destroy(&job_queued_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void BackgroundWriter::Queue(WriteJob *job) {
+  pthread_mutex_lock(&mutex_);
+  jobs_.push_back(job);
+  if (!thread_started_) {
+    thread_started_ = pthread_create(&thread_, NULL,
+                                     &BackgroundWriter::ThreadMain, this) == 0;
+  }
+  pthread_cond_signal(&job_queued_);
+  pthread_mutex_unlock(&mutex_);
+  if (!thread_started_) {
+    // No thread available: write in the foreground.
+    LOG(WARNING) << "Cannot start the writer thread, writing synchronously.";
+    RunJobs();
+  }
+}
+
+int BackgroundWriter::Wait() {
+  pthread_mutex_lock(&mutex_);
+  while (!jobs_.empty() || busy_) {
+    pthread_cond_wait(&job_done_, &mutex_);
+  }
+  int num_failures = num_failures_;
+  num_failures_ = 0;
+  pthread_mutex_unlock(&mutex_);
+  return num_failures;
+}
+
+void *BackgroundWriter::ThreadMain(void *writer) {
+  static_cast<BackgroundWriter *>(writer)->RunJobs();
+  return NULL;
+}
+
+// Runs the jobs until the queue is empty, or until the writer is destroyed
+// when running on the writer thread.
+void BackgroundWriter::RunJobs() {
+  pthread_mutex_lock(&mutex_);
+  for (;;) {
+    while (jobs_.empty() && thread_started_ && !stopping_) {
+      pthread_cond_wait(&job_queued_, &mutex_);
+    }
+    if (jobs_.empty()) {
+      break;
+    }
+    WriteJob *job = jobs_.front();
+    jobs_.pop_front();
+    busy_ = true;
+    pthread_mutex_unlock(&mutex_);
+    bool ok = job->Run();
+    delete job;
+    pthread_mutex_lock(&mutex_);
+    busy_ = false;
+    num_failures_ += !ok;
+    pthread_cond_broadcast(&job_done_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+}  // namespace libmv
@@ -0,0 +1,84 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_RECONSTRUCTION_BACKGROUND_WRITER_H_
+#define LIBMV_RECONSTRUCTION_BACKGROUND_WRITER_H_
+
+#include <pthread.h>
+#include <deque>
+#include <string>
+
+namespace libmv {
+
+// A file output that runs in the background.  The job must own all the data
+// it writes, since the caller goes on modifying its own state.
+class WriteJob {
+ public:
+  virtual ~WriteJob() {}
+  // Returns false if the output failed.
+  virtual bool Run() = 0;
+};
+
+// Writes a buffer of bytes in a file.
+class BufferWriteJob : public WriteJob {
+ public:
+  BufferWriteJob(const std::string &filename, const std::string &buffer)
+      : filename_(filename), buffer_(buffer) {}
+  virtual bool Run();
+
+ private:
+  std::string filename_;
+  std::string buffer_;
+};
+
+// Runs the write jobs on a single background thread, in the order they are
+// queued, so that the reconstruction does not wait for the disk.  The thread
+// is started with the first job.  The destructor waits for all the queued
+// jobs.
+class BackgroundWriter {
+ public:
+  BackgroundWriter();
+  ~BackgroundWriter();
+
+  // Takes ownership of job.
+  void Queue(WriteJob *job);
+
+  // Waits until all the queued jobs are done.  Returns the number of jobs
+  // that failed since the last call.
+  int Wait();
+
+ private:
+  static void *ThreadMain(void *writer);
+  void RunJobs();
+
+  pthread_t thread_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t job_queued_;
+  pthread_cond_t job_done_;
+  std::deque<WriteJob *> jobs_;
+  bool thread_started_;
+  bool busy_;
+  bool stopping_;
+  int num_failures_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_RECONSTRUCTION_BACKGROUND_WRITER_H_
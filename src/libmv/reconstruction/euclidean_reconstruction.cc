@@ -18,12 +18,17 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <vector>
+
 #include "libmv/base/vector_utils.h"
 #include "libmv/camera/pinhole_camera.h"
+#include "libmv/correspondence/frozen_matches.h"
 #include "libmv/correspondence/matches.h"
 #include "libmv/logging/logging.h"
+#include "libmv/logging/tracing.h"
 #include "libmv/multiview/five_point.h"
 #include "libmv/multiview/fundamental.h"
+#include "libmv/multiview/pose_refinement.h"
 #include "libmv/multiview/robust_euclidean_resection.h"
 #include "libmv/multiview/robust_fundamental.h"
 #include "libmv/reconstruction/euclidean_reconstruction.h"
@@ -42,8 +47,7 @@ namespace libmv {
 inline bool SetImageSize(Reconstruction &recons,
                          Matches::ImageID image_id, 
                          const Vec2u &image_size) {
-  PinholeCamera *camera = dynamic_cast<PinholeCamera*>(
-    recons.GetCamera(image_id));
+  PinholeCamera *camera = recons.GetPinholeCamera(image_id);
   if (camera) {
     camera->set_image_size(image_size); 
     return true;
@@ -51,39 +55,101 @@ inline bool SetImageSize(Reconstruction &recons,
   return false;
 }
 
-bool CalibratedCameraResection(const Matches &matches, 
-                               Matches::ImageID image_id, 
-                               const Mat3 &K, 
-                               Matches *matches_inliers,
-                               Reconstruction *reconstruction) {
+namespace {
+
+// Resection from a Matches or from a FrozenMatches.
+template <typename MatchesT>
+bool EstimatePose(const MatchesT &matches,
+                  Matches::ImageID image_id,
+                  const Mat3 &K,
+                  const Reconstruction &reconstruction,
+                  Mat3 *R,
+                  Vec3 *t,
+                  vector<StructureID> *structures_ids) {
+  LIBMV_TRACE_SCOPE("resect");
   double rms_inliers_threshold = 1;// in pixels
-  vector<StructureID> structures_ids;
   Mat2X x_image;
   Mat4X X_world;
   // Selects only the reconstructed tracks observed in the image
-  SelectExistingPointStructures(matches, image_id, *reconstruction,
-                                &structures_ids, &x_image);
+  SelectExistingPointStructures(matches, image_id, reconstruction,
+                                structures_ids, &x_image);
  
   // TODO(julien) Also remove structures that are on the same location
-  if (structures_ids.size() < 5) {
+  if (structures_ids->size() < 5) {
     LOG(ERROR) << "Error: there are not enough points to estimate the pose ("
-               << structures_ids.size() << "<5).";
+               << structures_ids->size() << "<5).";
     // We need at least 5 tracks in order to do resection
     return false;
   }
-  MatrixOfPointStructureCoordinates(structures_ids, *reconstruction, &X_world);
+  MatrixOfPointStructureCoordinates(*structures_ids, reconstruction, &X_world);
   CHECK(x_image.cols() == X_world.cols());
  
   Mat3X X;
   HomogeneousToEuclidean(X_world, &X);
-  Mat3 R;
-  Vec3 t;
   vector<int> inliers;
-  
+  // Not the global rand(): the frames are resected in parallel.
+  unsigned int random_state = 1 + image_id;
   EuclideanResectionEPnPRobust(x_image, X, K, rms_inliers_threshold,
-                               &R, &t, &inliers, 1e-3);
+                               R, t, &inliers, 1e-3, &random_state);
+
+  // Refines the EPnP pose on its inliers; the robust loss keeps the
+  // remaining outliers from pulling the camera.
+  if (inliers.size() >= 3) {
+    Mat2X x_inliers(2, inliers.size());
+    Mat3X X_inliers(3, inliers.size());
+    for (int i = 0; i < inliers.size(); ++i) {
+      x_inliers.col(i) = x_image.col(inliers[i]);
+      X_inliers.col(i) = X.col(inliers[i]);
+    }
+    PoseRefinementOptions options;
+    options.loss_scale = rms_inliers_threshold;
+    RefineEuclideanPose(x_inliers, X_inliers, K, options, R, t);
+  }
+  // Keeps only the tracks that are inliers of the resection (the inlier
+  // indices are increasing).
+  for (int i = 0; i < inliers.size(); ++i) {
+    (*structures_ids)[i] = (*structures_ids)[inliers[i]];
+  }
+  structures_ids->resize(inliers.size());
+  return true;
+}
 
-  // TODO(julien) Performs non-linear optimization of the pose.
+}  // namespace
+
+bool EstimateCalibratedCameraPose(const Matches &matches,
+                                  Matches::ImageID image_id,
+                                  const Mat3 &K,
+                                  const Reconstruction &reconstruction,
+                                  Mat3 *R,
+                                  Vec3 *t,
+                                  vector<StructureID> *structures_ids) {
+  return EstimatePose(matches, image_id, K, reconstruction, R, t,
+                      structures_ids);
+}
+
+bool EstimateCalibratedCameraPose(const FrozenMatches &matches,
+                                  Matches::ImageID image_id,
+                                  const Mat3 &K,
+                                  const Reconstruction &reconstruction,
+                                  Mat3 *R,
+                                  Vec3 *t,
+                                  vector<StructureID> *structures_ids) {
+  return EstimatePose(matches, image_id, K, reconstruction, R, t,
+                      structures_ids);
+}
+
+bool CalibratedCameraResection(const Matches &matches, 
+                               Matches::ImageID image_id, 
+                               const Mat3 &K, 
+                               Matches *matches_inliers,
+                               Reconstruction *reconstruction) {
+  Mat3 R;
+  Vec3 t;
+  vector<StructureID> structures_ids;
+  if (!EstimateCalibratedCameraPose(matches, image_id, K, *reconstruction,
+                                    &R, &t, &structures_ids)) {
+    return false;
+  }
   
   // Create a new camera and add it to the reconstruction
   PinholeCamera * camera = new PinholeCamera(K, R, t);
@@ -110,7 +176,8 @@ bool InitialReconstructionTwoViews(const Matches &matches,
                                    const Mat3 &K2,
                                    const Vec2u &image_size1,
                                    const Vec2u &image_size2,
-                                   Reconstruction *recons) {
+                                   Reconstruction *recons,
+                                   ReconstructionDumper *dumper) {
   assert(image1 != image2);
   bool is_good = true;
   uint num_new_points = 0;
@@ -170,7 +237,7 @@ bool InitialReconstructionTwoViews(const Matches &matches,
   Mat3 R;
   Vec3 t;
   PinholeCamera * pcamera = NULL;
-  pcamera = dynamic_cast<PinholeCamera *>(recons->GetCamera(image1));
+  pcamera = recons->GetPinholeCamera(image1);
   // If the first image has no associated camera, we choose the center of the 
   // coordinate frame
   if (!pcamera) {
@@ -220,13 +287,17 @@ bool InitialReconstructionTwoViews(const Matches &matches,
                                                          recons);
   VLOG(2) << num_new_points << " points reconstructed." << std::endl;
   
-  ExportToBlenderScript(*recons, "init.py");
+  if (dumper) {
+    dumper->Dump(*recons, matches_inliers, "init.py");
+  }
   
   // Performs projective bundle adjustment
   if (num_new_points > 0) {
     VLOG(2) << " -- Bundle adjustment --  " << std::endl;
     MetricBundleAdjust(matches_inliers, recons);
-    ExportToBlenderScript(*recons, "init-ba.py");
+    if (dumper) {
+      dumper->Dump(*recons, matches_inliers, "init-ba.py");
+    }
     // TODO(julien) Remove outliers RemoveOutliers() + BA again
   }
   return is_good;
@@ -287,7 +358,8 @@ bool IncrementalReconstructionKeyframes(const Matches &matches,
 bool ReconstructionNonKeyframes(const Matches &matches,
                                 const Mat3 &K,
                                 const Vec2u &image_size,
-                                std::list<Reconstruction *> *reconstructions) {
+                                std::list<Reconstruction *> *reconstructions,
+                                ReconstructionDumper *dumper) {
   bool is_recons_ok = true;
   // Perform a bundle adjustment every X new cameras
   int num_new_cameras_to_proceed_ba = 10; 
@@ -332,9 +404,11 @@ bool ReconstructionNonKeyframes(const Matches &matches,
             // TODO(julien) Remove outliers RemoveOutliers() + BA again
           }
           SetImageSize(**recons_iter, *img_iter, image_size);
-          std::stringstream s;
-          s << "out-noKF-" << cpt_i << ".py";
-          ExportToBlenderScript(**recons_iter, s.str());
+          if (dumper) {
+            std::stringstream s;
+            s << "out-noKF-" << cpt_i << ".py";
+            dumper->Dump(**recons_iter, matches, s.str());
+          }
         } else {
           VLOG(1) << "[Warning] Image " << *img_iter
                   << " cannot be localized!" << std::endl;
@@ -350,12 +424,115 @@ bool ReconstructionNonKeyframes(const Matches &matches,
   return true;
 }
 
+namespace {
+
+// A non-keyframe to localize in a reconstruction, and the result of its
+// resection.
+struct NonKeyframeResection {
+  Matches::ImageID image_id;
+  int reconstruction_index;
+  bool localized;
+  Mat3 R;
+  Vec3 t;
+  vector<StructureID> structures_ids;
+};
+
+}  // namespace
+
+bool ReconstructionNonKeyframesParallel(
+    const Matches &matches,
+    const Mat3 &K,
+    const Vec2u &image_size,
+    std::list<Reconstruction *> *reconstructions,
+    ReconstructionDumper *dumper) {
+  LIBMV_TRACE_SCOPE("resect.non_keyframes");
+  if (reconstructions->empty()) {
+    return true;
+  }
+  std::vector<Reconstruction *> recons(reconstructions->begin(),
+                                       reconstructions->end());
+  // Assigns the frames to the reconstructions as ReconstructionNonKeyframes
+  // does: a frame belongs to the reconstruction of the previous keyframe.
+  std::vector<NonKeyframeResection> resections;
+  int recons_index = 0;
+  std::set<Matches::ImageID>::const_iterator img_iter = 
+    matches.get_images().begin();
+  for (; img_iter != matches.get_images().end(); ++img_iter) {
+    bool is_frame_in_current_recons =
+        recons[recons_index]->ImageHasCamera(*img_iter);
+    bool is_frame_in_next_recons = recons_index + 1 < recons.size() &&
+        recons[recons_index + 1]->ImageHasCamera(*img_iter);
+    if (!is_frame_in_current_recons && !is_frame_in_next_recons) {
+      NonKeyframeResection resection;
+      resection.image_id = *img_iter;
+      resection.reconstruction_index = recons_index;
+      resection.localized = false;
+      resections.push_back(resection);
+    } else if (is_frame_in_next_recons) {
+      recons_index++;
+    }
+  }
+
+  // Resects the frames against the structure as it is now; the
+  // reconstructions are only read until the merge below, and every frame
+  // writes its own result.  The frames share one snapshot of the matches.
+  const FrozenMatches frozen_matches(matches);
+  const int num_resections = resections.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < num_resections; ++i) {
+    NonKeyframeResection &resection = resections[i];
+    resection.localized = EstimateCalibratedCameraPose(
+        frozen_matches, resection.image_id, K,
+        *recons[resection.reconstruction_index],
+        &resection.R, &resection.t, &resection.structures_ids);
+  }
+  LIBMV_TRACE_COUNTER("resect.non_keyframes.frames", num_resections);
+
+  // Merges the new cameras in frame order, so that the result does not
+  // depend on the scheduling.
+  vector<int> num_new_cameras(recons.size(), 0);
+  for (int i = 0; i < num_resections; ++i) {
+    const NonKeyframeResection &resection = resections[i];
+    if (!resection.localized) {
+      VLOG(1) << "[Warning] Image " << resection.image_id
+              << " cannot be localized!" << std::endl;
+      continue;
+    }
+    Reconstruction *reconstruction = recons[resection.reconstruction_index];
+    reconstruction->InsertCamera(resection.image_id,
+                                 new PinholeCamera(K, resection.R,
+                                                   resection.t));
+    SetImageSize(*reconstruction, resection.image_id, image_size);
+    VLOG(1) << "Inliers: " << resection.structures_ids.size() << std::endl;
+    num_new_cameras[resection.reconstruction_index]++;
+  }
+
+  // Refines every updated reconstruction once.
+  for (int r = 0; r < recons.size(); ++r) {
+    if (num_new_cameras[r] == 0) {
+      continue;
+    }
+    VLOG(2) << " -- Bundle adjustment --  " << std::endl;
+    MetricBundleAdjust(matches, recons[r]);
+    if (dumper) {
+      std::stringstream s;
+      s << "out-noKF-" << r << ".py";
+      dumper->Dump(*recons[r], matches, s.str());
+    }
+  }
+  return true;
+}
+
 bool EuclideanReconstructionFromVideo(
     const Matches &matches, 
     int image_width, 
     int image_height,
     double focal,
-    std::list<Reconstruction *> *reconstructions) {
+    std::list<Reconstruction *> *reconstructions,
+    ReconstructionDumper *dumper,
+    bool parallel_non_keyframes) {
   if (matches.NumImages() < 2)
     return false;
   Vec2u image_size;
@@ -389,7 +566,7 @@ bool EuclideanReconstructionFromVideo(
                                               keyframes[keyframe_index + 1],
                                               K,K,
                                               image_size, image_size,
-                                              cur_recons);    
+                                              cur_recons, dumper);    
     keyframe_index++;
     if (recons_ok) {    
       keyframe_index++;
@@ -403,9 +580,11 @@ bool EuclideanReconstructionFromVideo(
                                           K, image_size,
                                           cur_recons,
                                           &keyframe_index);
-      std::stringstream s;
+      if (dumper) {
+        std::stringstream s;
         s << "out-" << keyframe_index << ".py";
-      ExportToBlenderScript(*cur_recons, s.str());
+        dumper->Dump(*cur_recons, matches, s.str());
+      }
     } else {
       // If the initial reconstruction can be estimated between the 
       // 2 first views, we try with the second image and the third (etc.)
@@ -417,9 +596,15 @@ bool EuclideanReconstructionFromVideo(
   // NOTE(julien) are we sure that matches->images is ordered? it's a std:set?
   // if not the following non-keyframes reconstruction should be changed.
   VLOG(2) << " Non-keyframe reconstruction  " << std::endl;
-  ReconstructionNonKeyframes(matches,
-                             K, image_size,
-                             reconstructions);
+  if (parallel_non_keyframes) {
+    ReconstructionNonKeyframesParallel(matches,
+                                       K, image_size,
+                                       reconstructions, dumper);
+  } else {
+    ReconstructionNonKeyframes(matches,
+                               K, image_size,
+                               reconstructions, dumper);
+  }
   return true;
 }
 } // namespace libmv
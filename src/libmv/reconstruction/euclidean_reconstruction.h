@@ -21,14 +21,42 @@
 #ifndef LIBMV_RECONSTRUCTION_EUCLIDEAN_RECONSTRUCTION_H_
 #define LIBMV_RECONSTRUCTION_EUCLIDEAN_RECONSTRUCTION_H_
 
+#include "libmv/correspondence/frozen_matches.h"
 #include "libmv/reconstruction/reconstruction.h"
+#include "libmv/reconstruction/snapshot.h"
 
 namespace libmv {
 
+// Estimates the pose of the camera of the image image_id from the already
+// reconstructed points observed in the image: robust EPnP resection, then a
+// robust non-linear refinement of the pose on the inliers.  It does not
+// modify the reconstruction (it can run concurrently on several images), and
+// its random samples are seeded from image_id.
+// structures_ids receives the reconstructed tracks that are inliers of the
+// resection.
+// Returns false if the number of reconstructed tracks is less than 5.
+bool EstimateCalibratedCameraPose(const Matches &matches,
+                                  Matches::ImageID image_id,
+                                  const Mat3 &K,
+                                  const Reconstruction &reconstruction,
+                                  Mat3 *R,
+                                  Vec3 *t,
+                                  vector<StructureID> *structures_ids);
+
+// Same as above, on a snapshot of the matches.
+bool EstimateCalibratedCameraPose(const FrozenMatches &matches,
+                                  Matches::ImageID image_id,
+                                  const Mat3 &K,
+                                  const Reconstruction &reconstruction,
+                                  Mat3 *R,
+                                  Vec3 *t,
+                                  vector<StructureID> *structures_ids);
+
 // Estimates the pose of the camera using the already reconstructed points.
 // The method:
 //  - selects the tracks that have an already reconstructed structure
 //  - robustly estimates the camera extrinsic parameters (R,t) by resection
+//  - refines (R,t) on the inliers (see RefineEuclideanPose)
 //  - creates and adds the new camera to reconstruction
 //  - inserts only inliers matches into matches_inliers
 // Returns true if the resection has succeed
@@ -54,6 +82,8 @@ bool CalibratedCameraResection(const Matches &matches,
 //  - reconstructs only the inliers matches (point triangulation)
 //  - performs a metric bundle adjusment
 //    TODO(julien) remove outliers from matches or output matches_inliers.
+// If dumper is not NULL, the reconstruction is dumped before and after the
+// bundle adjustment (init.py and init-ba.py).
 // Returns true if the initial reconstruction has succeed
 // Returns false if 
 //  - the number of common matches is less than 7
@@ -65,7 +95,8 @@ bool InitialReconstructionTwoViews(const Matches &matches,
                                    const Mat3 &K2,
                                    const Vec2u &image_size1,
                                    const Vec2u &image_size2,
-                                   Reconstruction *recons);
+                                   Reconstruction *recons,
+                                   ReconstructionDumper *dumper = NULL);
                                
 // Estimates the pose of the keyframes using the already reconstructed points.
 // For every keyframes (starting the first_keyframe_index th):
@@ -93,11 +124,30 @@ bool IncrementalReconstructionKeyframes(const Matches &matches,
 // The method automatically detect the reconstruction the frame may belongs.
 // NOTE: this method works only if the frame in the Matches class are ordered. 
 //       If it is not the case, it will fail.
+// If dumper is not NULL, the reconstruction is dumped after each localized
+// frame (out-noKF-<n>.py).
 // Returns true.
 bool ReconstructionNonKeyframes(const Matches &matches,
                                 const Mat3 &K,
                                 const Vec2u &image_size,
-                                std::list<Reconstruction *> *reconstructions);
+                                std::list<Reconstruction *> *reconstructions,
+                                ReconstructionDumper *dumper = NULL);
+
+// Same as ReconstructionNonKeyframes, but all the frames are localized in
+// parallel against the structure reconstructed from the keyframes, which is
+// not modified until every resection is done.  The new cameras are then
+// merged in frame order and a single bundle adjustment is performed per
+// reconstruction.  This is much faster on long videos, at the cost of not
+// refining the structure while the frames are localized.
+// If dumper is not NULL, each updated reconstruction is dumped after its
+// bundle adjustment (out-noKF-<reconstruction>.py).
+// Returns true.
+bool ReconstructionNonKeyframesParallel(
+    const Matches &matches,
+    const Mat3 &K,
+    const Vec2u &image_size,
+    std::list<Reconstruction *> *reconstructions,
+    ReconstructionDumper *dumper = NULL);
 
 // Computes the trajectory of a camera using matches as input.
 //  - First keyframes are detected according a minimum number of shared tracks
@@ -109,8 +159,12 @@ bool ReconstructionNonKeyframes(const Matches &matches,
 //    TODO(julien) a local bundle adjustment would be sufficient?
 //    TODO(julien) +a global bundle adjusment on all data at the end?
 //  - In a final step, non-keyframes are localized using the resection method.
-//    A bundle adjusment is periodically performed on all the data.
+//    A bundle adjusment is periodically performed on all the data, or once
+//    at the end if parallel_non_keyframes is true (see
+//    ReconstructionNonKeyframesParallel).
 // In the case that the tracking is lost, a new reconstruction is created.
+// The intermediate reconstructions are dumped with dumper if it is not NULL
+// (out-<keyframe>.py after the keyframes of each reconstruction).
 // TODO(julien) Add the calibration matrix K as input?
 // TODO(julien) remove outliers from matches or output inliers matches.
 bool EuclideanReconstructionFromVideo(
@@ -118,7 +172,9 @@ bool EuclideanReconstructionFromVideo(
     int image_width, 
     int image_height,
     double focal,
-    std::list<Reconstruction *> *reconstructions);
+    std::list<Reconstruction *> *reconstructions,
+    ReconstructionDumper *dumper = NULL,
+    bool parallel_non_keyframes = false);
 
 // Computes the poses of all unordered images.
 // TODO(julien) implement me.
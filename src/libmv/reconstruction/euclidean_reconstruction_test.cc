@@ -177,5 +177,82 @@ TEST(CalibratedReconstruction, TestSynthetic6FullViews) {
     delete *features_iter;
   list_features.clear();
 }
+
+TEST(CalibratedReconstruction, ParallelNonKeyframesFromKnownStructure) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+  Matches matches;
+  std::list<Feature *> list_features;
+  GenerateMatchesFromNViewDataSet(d, 0, &matches, &list_features);
+
+  // The keyframes 0 and 1 and the structure are known.
+  Reconstruction *reconstruction = new Reconstruction();
+  for (int i = 0; i < 2; ++i) {
+    reconstruction->InsertCamera(i, new PinholeCamera(d.K[i], d.R[i], d.t[i]));
+  }
+  for (int p = 0; p < npoints; ++p) {
+    reconstruction->InsertTrack(p, new PointStructure(Vec3(d.X.col(p))));
+  }
+  std::list<Reconstruction *> reconstructions;
+  reconstructions.push_back(reconstruction);
+  Vec2u image_size;
+  image_size << 2 * d.K[0](0, 2), 2 * d.K[0](1, 2);
+  EXPECT_TRUE(ReconstructionNonKeyframesParallel(matches, d.K[0], image_size,
+                                                 &reconstructions));
+
+  ASSERT_EQ(nviews, reconstruction->GetNumberCameras());
+  for (int i = 2; i < nviews; ++i) {
+    PinholeCamera *camera = reconstruction->GetPinholeCamera(i);
+    ASSERT_TRUE(camera != NULL);
+    EXPECT_MATRIX_NEAR(d.R[i], camera->orientation_matrix(), 1e-6);
+    EXPECT_MATRIX_NEAR(d.t[i], camera->position(), 1e-6);
+    EXPECT_EQ(image_size(0), camera->image_width());
+  }
+  reconstruction->ClearCamerasMap();
+  reconstruction->ClearStructuresMap();
+  delete reconstruction;
+  std::list<Feature *>::iterator features_iter = list_features.begin();
+  for (; features_iter != list_features.end(); ++features_iter)
+    delete *features_iter;
+}
+
+TEST(CalibratedReconstruction, PoseKeepsOnlyTheInlierTracks) {
+  int npoints = 60;
+  int noutliers = 10;
+  NViewDataSet d = NRealisticCamerasFull(1, npoints);
+  Matches matches;
+  std::list<Feature *> list_features;
+  GenerateMatchesFromNViewDataSet(d, 0, &matches, &list_features);
+  // Moves the first observations far from their projections (the
+  // resection threshold is on the normalized coordinates).
+  for (int p = 0; p < noutliers; ++p) {
+    PointFeature *feature = new PointFeature(d.x[0](0, p) + 2 * d.K[0](0, 0),
+                                             d.x[0](1, p));
+    list_features.push_back(feature);
+    matches.Remove(0, p);
+    matches.Insert(0, p, feature);
+  }
+  Reconstruction reconstruction;
+  for (int p = 0; p < npoints; ++p) {
+    reconstruction.InsertTrack(p, new PointStructure(Vec3(d.X.col(p))));
+  }
+
+  Mat3 R;
+  Vec3 t;
+  vector<StructureID> structures_ids;
+  EXPECT_TRUE(EstimateCalibratedCameraPose(matches, 0, d.K[0],
+                                           reconstruction, &R, &t,
+                                           &structures_ids));
+  EXPECT_MATRIX_NEAR(d.R[0], R, 1e-6);
+  ASSERT_EQ(npoints - noutliers, structures_ids.size());
+  for (int i = 0; i < structures_ids.size(); ++i) {
+    EXPECT_EQ(noutliers + i, structures_ids[i]);
+  }
+  reconstruction.ClearStructuresMap();
+  std::list<Feature *>::iterator features_iter = list_features.begin();
+  for (; features_iter != list_features.end(); ++features_iter)
+    delete *features_iter;
+}
 }
 }  // namespace libmv
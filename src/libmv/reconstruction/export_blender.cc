@@ -47,10 +47,11 @@ void ExportToBlenderScript(const Reconstruction &reconstruct,
   PinholeCamera *pcamera = NULL;
   uint i = 0;
   Mat3 K, R; Vec3 t;
-  std::map<CameraID, Camera *>::const_iterator camera_iter =  
-    reconstruct.cameras().begin();
-  for (; camera_iter != reconstruct.cameras().end(); ++camera_iter) {
-    pcamera = dynamic_cast<PinholeCamera *>(camera_iter->second);
+  vector<int> cameras;
+  reconstruct.CameraIndicesByID(&cameras);
+  for (int k = 0; k < cameras.size(); ++k) {
+    int c = cameras[k];
+    pcamera = reconstruct.pinhole_camera(c);
     // TODO(julien) how to export generic cameras ? 
     if (pcamera) {
       K = pcamera->intrinsic_matrix();
@@ -68,7 +69,7 @@ void ExportToBlenderScript(const Reconstruction &reconstruct,
       fprintf(fid, "c%04d.lens = %g\n", i, lens);
       fprintf(fid, "c%04d.setDrawSize(0.05)\n", i);
       fprintf(fid, "o%04d = Object.New('Camera')\n", i);
-      fprintf(fid, "o%04d.name = 'libmv_cam%04d'\n", i, camera_iter->first);
+      fprintf(fid, "o%04d.name = 'libmv_cam%04d'\n", i, reconstruct.camera_id(c));
 
       // Camera world matrix, which is the inverse transpose of the typical
       // 'projection' matrix as generally thought of by vision researchers.
@@ -110,11 +111,11 @@ void ExportToBlenderScript(const Reconstruction &reconstruct,
   fprintf(fid, "ob.setLocation(0.0,0.0,0.0)\n");
   fprintf(fid, "mesh=ob.getData()\n");
   fprintf(fid, "cur.link(ob)\n");
-  std::map<StructureID, Structure *>::const_iterator track_iter =
-    reconstruct.structures().begin();
-  for (; track_iter != reconstruct.structures().end(); ++track_iter) {
-    PointStructure * point_s = 
-      dynamic_cast<PointStructure*>(track_iter->second);
+  vector<int> structures;
+  reconstruct.StructureIndicesByID(&structures);
+  for (int k = 0; k < structures.size(); ++k) {
+    int s = structures[k];
+    PointStructure * point_s = reconstruct.point_structure(s);
     if (point_s) {
       fprintf(fid, "v = NMesh.Vert(%g,%g,%g)\n", point_s->coords_affine()(0),
                                                  point_s->coords_affine()(1),
@@ -18,13 +18,49 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <locale.h>
+#include <sstream>
 
+#include "libmv/correspondence/feature.h"
 #include "libmv/reconstruction/export_ply.h"
 
 namespace libmv {
 
+namespace {
+
+bool IsLittleEndianHost() {
+  const int one = 1;
+  return *reinterpret_cast<const char *>(&one) == 1;
+}
+
+// Appends the bytes of value to buffer, in little endian order.
+template<typename T>
+void AppendLittleEndian(const T &value, bool swap, std::string *buffer) {
+  char bytes[sizeof(T)];
+  memcpy(bytes, &value, sizeof(T));
+  if (swap) {
+    std::reverse(bytes, bytes + sizeof(T));
+  }
+  buffer->append(bytes, sizeof(T));
+}
+
+void AppendVertex(const Vec3 &position, const PointColor &color,
+                  int observations, bool swap, std::string *buffer) {
+  for (int i = 0; i < 3; ++i) {
+    AppendLittleEndian(static_cast<float>(position(i)), swap, buffer);
+  }
+  buffer->push_back(static_cast<char>(color.r));
+  buffer->push_back(static_cast<char>(color.g));
+  buffer->push_back(static_cast<char>(color.b));
+  AppendLittleEndian(static_cast<int>(observations), swap, buffer);
+}
+
+}  // namespace
+
 void ExportToPLY(const Reconstruction &reconstruct, std::string out_file_name) {
   std::ofstream outfile;
   outfile.open(out_file_name.c_str(), std::ios_base::out);
@@ -50,11 +86,11 @@ void ExportToPLY(const Reconstruction &reconstruct, std::string out_file_name) {
     outfile << "property uchar green" << std::endl;
     outfile << "property uchar blue" << std::endl;
     outfile << "end_header" << std::endl;
-    std::map<StructureID, Structure *>::const_iterator track_iter =
-      reconstruct.structures().begin();
-    for (; track_iter != reconstruct.structures().end(); ++track_iter) {
-      PointStructure * point_s = 
-        dynamic_cast<PointStructure*>(track_iter->second);
+    vector<int> structures;
+    reconstruct.StructureIndicesByID(&structures);
+    for (int k = 0; k < structures.size(); ++k) {
+      int s = structures[k];
+      PointStructure * point_s = reconstruct.point_structure(s);
       if (point_s) {
         // Exports the point affine position
         outfile << point_s->coords_affine().transpose() << " ";
@@ -62,11 +98,11 @@ void ExportToPLY(const Reconstruction &reconstruct, std::string out_file_name) {
         outfile << "255 255 255" << std::endl;
       }
     }
-    std::map<CameraID, Camera *>::const_iterator camera_iter =  
-      reconstruct.cameras().begin();
-    for (; camera_iter != reconstruct.cameras().end(); ++camera_iter) {
-      PinholeCamera * camera_pinhole =  
-        dynamic_cast<PinholeCamera *>(camera_iter->second);
+    vector<int> cameras;
+    reconstruct.CameraIndicesByID(&cameras);
+    for (int k = 0; k < cameras.size(); ++k) {
+      int c = cameras[k];
+      PinholeCamera * camera_pinhole = reconstruct.pinhole_camera(c);
       if (camera_pinhole) {
         // Exports the camera position
         outfile << camera_pinhole->position().transpose() << " ";
@@ -77,4 +113,100 @@ void ExportToPLY(const Reconstruction &reconstruct, std::string out_file_name) {
     outfile.close();
   }
 }
+
+void SamplePointColors(const Reconstruction &reconstruct,
+                       const Matches &matches,
+                       CameraID image_id,
+                       const Array3Du &image,
+                       PointColors *colors) {
+  if (image.Width() == 0 || image.Height() == 0) {
+    return;
+  }
+  for (Matches::Points r = matches.InImage<PointFeature>(image_id); r; ++r) {
+    if (!reconstruct.TrackHasStructure(r.track()) ||
+        colors->find(r.track()) != colors->end()) {
+      continue;
+    }
+    int x = static_cast<int>(r.feature()->x() + 0.5f);
+    int y = static_cast<int>(r.feature()->y() + 0.5f);
+    x = std::min(std::max(x, 0), image.Width() - 1);
+    y = std::min(std::max(y, 0), image.Height() - 1);
+    PointColor color(image(y, x, 0), image(y, x, 0), image(y, x, 0));
+    if (image.Depth() >= 3) {
+      color.g = image(y, x, 1);
+      color.b = image(y, x, 2);
+    }
+    (*colors)[r.track()] = color;
+  }
+}
+
+bool ExportToBinaryPLY(const Reconstruction &reconstruct,
+                       const Matches &matches,
+                       const PointColors *colors,
+                       const std::string &out_file_name) {
+  int num_points = 0, num_cameras = 0;
+  for (int s = 0; s < reconstruct.GetNumberStructures(); ++s) {
+    num_points += reconstruct.point_structure(s) != NULL;
+  }
+  for (int c = 0; c < reconstruct.GetNumberCameras(); ++c) {
+    num_cameras += reconstruct.pinhole_camera(c) != NULL;
+  }
+  std::ostringstream header;
+  header << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "comment Made by libmv authors\n"
+         << "comment " << num_points << " points followed by "
+         << num_cameras << " camera positions\n"
+         << "element vertex " << num_points + num_cameras << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n"
+         << "property uchar red\n"
+         << "property uchar green\n"
+         << "property uchar blue\n"
+         << "property int observations\n"
+         << "end_header\n";
+
+  // Serializes everything in memory so that the file is written at once.
+  const int kVertexSize = 3 * sizeof(float) + 3 + sizeof(int);
+  std::string buffer = header.str();
+  buffer.reserve(buffer.size() + (num_points + num_cameras) * kVertexSize);
+  const bool swap = !IsLittleEndianHost();
+  const PointColor white;
+  vector<int> structures;
+  reconstruct.StructureIndicesByID(&structures);
+  for (int k = 0; k < structures.size(); ++k) {
+    int s = structures[k];
+    PointStructure *point_s = reconstruct.point_structure(s);
+    if (point_s) {
+      StructureID id = reconstruct.structure_id(s);
+      const PointColor *color = &white;
+      if (colors) {
+        PointColors::const_iterator it = colors->find(id);
+        if (it != colors->end()) {
+          color = &it->second;
+        }
+      }
+      AppendVertex(point_s->coords_affine(), *color,
+                   matches.NumFeatureTrack(id), swap, &buffer);
+    }
+  }
+  const PointColor red(255, 0, 0);
+  vector<int> cameras;
+  reconstruct.CameraIndicesByID(&cameras);
+  for (int k = 0; k < cameras.size(); ++k) {
+    int c = cameras[k];
+    PinholeCamera *camera_pinhole = reconstruct.pinhole_camera(c);
+    if (camera_pinhole) {
+      AppendVertex(camera_pinhole->position(), red, 0, swap, &buffer);
+    }
+  }
+
+  FILE *file = fopen(out_file_name.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  bool ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+  return fclose(file) == 0 && ok;
+}
 } // namespace libmv
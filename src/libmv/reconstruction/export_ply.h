@@ -21,11 +21,45 @@
 #ifndef LIBMV_RECONSTRUCTION_EXPORT_PLY_H_
 #define LIBMV_RECONSTRUCTION_EXPORT_PLY_H_
 
+#include <map>
+#include <string>
+
+#include "libmv/image/array_nd.h"
 #include "libmv/reconstruction/reconstruction.h"
 
 namespace libmv {
+
+// The color of a point structure.
+struct PointColor {
+  PointColor(unsigned char r = 255, unsigned char g = 255,
+             unsigned char b = 255) : r(r), g(g), b(b) {}
+  unsigned char r, g, b;
+};
+typedef std::map<StructureID, PointColor> PointColors;
+
 // Exports the reconstruction in a PLY format file
 void ExportToPLY(const Reconstruction &reconstruct, std::string out_file_name);
+
+// Samples in the image the color of the point structures observed in the
+// image image_id (at the nearest pixel of their feature).  Points that
+// already have a color are left unchanged, so calling this on the frames in
+// order colors every point from the first frame that sees it.  Gray images
+// (depth 1) give gray colors.
+void SamplePointColors(const Reconstruction &reconstruct,
+                       const Matches &matches,
+                       CameraID image_id,
+                       const Array3Du &image,
+                       PointColors *colors);
+
+// Exports the reconstruction in a binary little endian PLY file.  Every
+// vertex has its position, its color and the number of images observing its
+// track in matches.  Points without color in colors (or all of them if colors
+// is NULL) are white; cameras are red vertices observed 0 times.
+// Returns false if the file cannot be written.
+bool ExportToBinaryPLY(const Reconstruction &reconstruct,
+                       const Matches &matches,
+                       const PointColors *colors,
+                       const std::string &out_file_name);
 }  // namespace libmv
 
 #endif  // LIBMV_RECONSTRUCTION_EXPORT_PLY_H_
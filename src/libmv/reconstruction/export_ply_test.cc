@@ -0,0 +1,139 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/reconstruction/export_ply.h"
+#include "testing/testing.h"
+
+namespace {
+using namespace libmv;
+
+std::string ReadFile(const char *filename) {
+  std::string data;
+  FILE *file = fopen(filename, "rb");
+  if (file) {
+    char chunk[4096];
+    size_t size;
+    while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+      data.append(chunk, size);
+    }
+    fclose(file);
+  }
+  return data;
+}
+
+TEST(ExportPLY, SamplePointColors) {
+  Reconstruction reconstruction;
+  reconstruction.InsertTrack(0, new PointStructure(Vec3(0, 0, 1)));
+  reconstruction.InsertTrack(1, new PointStructure(Vec3(1, 0, 1)));
+  Matches matches;
+  PointFeature f0(2.2f, 1.0f), f1(100.0f, -5.0f), f2(0.0f, 0.0f);
+  matches.Insert(0, 0, &f0);
+  matches.Insert(0, 1, &f1);  // Out of the image, clamped.
+  matches.Insert(0, 2, &f2);  // Not reconstructed.
+
+  Array3Du image(3, 4, 3);
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      image(y, x, 0) = 10 * y + x;
+      image(y, x, 1) = 100;
+      image(y, x, 2) = 200;
+    }
+  }
+  PointColors colors;
+  SamplePointColors(reconstruction, matches, 0, image, &colors);
+  ASSERT_EQ(2, colors.size());
+  EXPECT_EQ(12, colors[0].r);
+  EXPECT_EQ(100, colors[0].g);
+  EXPECT_EQ(200, colors[0].b);
+  EXPECT_EQ(3, colors[1].r);
+
+  // Colors already sampled are kept.
+  Array3Du gray(3, 4, 1);
+  gray.Fill(7);
+  SamplePointColors(reconstruction, matches, 0, gray, &colors);
+  EXPECT_EQ(12, colors[0].r);
+  reconstruction.ClearStructuresMap();
+}
+
+TEST(ExportPLY, BinaryLittleEndian) {
+  Reconstruction reconstruction;
+  reconstruction.InsertTrack(4, new PointStructure(Vec3(1, 2, 3)));
+  reconstruction.InsertTrack(9, new PointStructure(Vec3(-1, 0, 0.5)));
+  reconstruction.InsertCamera(0, new PinholeCamera(Mat3::Identity(),
+                                                   Mat3::Identity(),
+                                                   Vec3(0, 0, -2)));
+  Matches matches;
+  PointFeature f(0, 0);
+  matches.Insert(0, 4, &f);
+  matches.Insert(1, 4, &f);
+  matches.Insert(1, 9, &f);
+  PointColors colors;
+  colors[9] = PointColor(1, 2, 3);
+
+  const char *filename = "export_ply_test.ply";
+  ASSERT_TRUE(ExportToBinaryPLY(reconstruction, matches, &colors, filename));
+  std::string data = ReadFile(filename);
+  remove(filename);
+  reconstruction.ClearCamerasMap();
+  reconstruction.ClearStructuresMap();
+
+  EXPECT_EQ(0, data.find("ply\nformat binary_little_endian 1.0\n"));
+  EXPECT_NE(std::string::npos, data.find("element vertex 3\n"));
+  const std::string end_header = "end_header\n";
+  size_t body = data.find(end_header);
+  ASSERT_NE(std::string::npos, body);
+  body += end_header.size();
+  const int kVertexSize = 3 * 4 + 3 + 4;
+  ASSERT_EQ(body + 3 * kVertexSize, data.size());
+
+  // The test assumes a little endian host.
+  const char *vertex = data.data() + body;
+  float xyz[3];
+  int observations;
+  memcpy(xyz, vertex, sizeof(xyz));
+  memcpy(&observations, vertex + 15, sizeof(observations));
+  EXPECT_EQ(1, xyz[0]);
+  EXPECT_EQ(2, xyz[1]);
+  EXPECT_EQ(3, xyz[2]);
+  EXPECT_EQ(255, static_cast<unsigned char>(vertex[12]));
+  EXPECT_EQ(2, observations);
+
+  vertex += kVertexSize;
+  memcpy(&observations, vertex + 15, sizeof(observations));
+  EXPECT_EQ(1, vertex[12]);
+  EXPECT_EQ(2, vertex[13]);
+  EXPECT_EQ(3, vertex[14]);
+  EXPECT_EQ(1, observations);
+
+  vertex += kVertexSize;
+  memcpy(xyz, vertex, sizeof(xyz));
+  memcpy(&observations, vertex + 15, sizeof(observations));
+  EXPECT_EQ(-2, xyz[2]);
+  EXPECT_EQ(255, static_cast<unsigned char>(vertex[12]));
+  EXPECT_EQ(0, vertex[13]);
+  EXPECT_EQ(0, observations);
+}
+
+}  // namespace
@@ -20,7 +20,11 @@
 
 #include <algorithm>
 #include <map>
+#include <queue>
+#include <vector>
 
+#include "libmv/correspondence/frozen_matches.h"
+#include "libmv/logging/logging.h"
 #include "libmv/multiview/conditioning.h"
 #include "libmv/multiview/robust_fundamental.h"
 #include "libmv/multiview/robust_homography.h"
@@ -28,159 +32,229 @@
 
 namespace libmv {
 
-void FillPairwiseMatchesMatrix(const Matches &matches, 
-                               Mat *m) {
-  m->resize(matches.NumImages(),
-            matches.NumImages());
-  m->setZero();
-  std::set<Matches::ImageID>::const_iterator image_iter1 =
-    matches.get_images().begin();
-  std::set<Matches::ImageID>::const_iterator image_iter2;
+namespace {
+
+// Median transfer error of a homography fitted robustly to the matches of two
+// images, or 0 if there are not enough matches.
+double MedianHomographyError(const FrozenMatches &matches,
+                             Matches::ImageID image1,
+                             Matches::ImageID image2) {
   vector<Mat> xs2;
-  for (;image_iter1 != matches.get_images().end(); ++image_iter1) {
-    image_iter2 = image_iter1;
-    image_iter2++;
-    for (;image_iter2 != matches.get_images().end(); ++image_iter2) {
-      TwoViewPointMatchMatrices(matches, *image_iter1, *image_iter2, &xs2);
-      (*m)(*image_iter1, *image_iter2) = xs2[0].cols();
-    }
+  matches.TwoViewPointMatchMatrices(image1, image2, &xs2);
+  if (xs2[0].cols() < 4) {
+    return 0;
   }
-}
-
-void FillPairwiseMatchesHomographyMatrix(const Matches &matches, 
-                                         Mat *m) {
-  m->resize(matches.NumImages(),
-            matches.NumImages());
-  m->setZero();
+  double max_error_h = 1;
   Mat3 H;
   vector<int> inliers;
-  double max_error_h = 1;
-  std::set<Matches::ImageID>::const_iterator image_iter1 =
-    matches.get_images().begin();
-  std::set<Matches::ImageID>::const_iterator image_iter2;
-  vector<Mat> xs2;
-  for (;image_iter1 != matches.get_images().end(); ++image_iter1) {
-    image_iter2 = image_iter1;
-    image_iter2++;
-    for (;image_iter2 != matches.get_images().end(); ++image_iter2) {
-      TwoViewPointMatchMatrices(matches, *image_iter1, *image_iter2, &xs2);
-      (*m)(*image_iter1, *image_iter2) = xs2[0].cols();
-      if (xs2[0].cols() >= 4) {
-        Homography2DFromCorrespondences4PointRobust(xs2[0], xs2[1], 
-                                                    max_error_h, 
-                                                    &H, &inliers, 1e-2);
-        // TODO(julien) Put this in a function
-        Vec3 p1;
-        Vec2 e;
-        vector<double> all_errors;
-        all_errors.reserve(inliers.size());
-        for (int i = 0; i < inliers.size(); ++i) {
-          EuclideanToHomogeneous(xs2[0].col(inliers[i]), &p1);
-          p1 = H * p1;
-          HomogeneousToEuclidean(p1, &e);
-          e -= xs2[0].col(inliers[i]);
-          all_errors.push_back(e.norm());
-        }
-        std::sort(all_errors.begin(), all_errors.end());
-        VLOG(1) << "H median:" << all_errors[round(inliers.size()/2)] 
-                << "px.\n";
-        (*m)(*image_iter1, *image_iter2) *= all_errors[round(inliers.size()/2)];
-      }
-    }
+  // Not the global rand(): the edges are scored in parallel.
+  unsigned int random_state = 1 + 65537u * image1 + image2;
+  Homography2DFromCorrespondences4PointRobust(xs2[0], xs2[1], 
+                                              max_error_h, 
+                                              &H, &inliers, 1e-2,
+                                              &random_state);
+  if (inliers.size() == 0) {
+    return 0;
   }
+  Vec3 p1;
+  Vec2 e;
+  std::vector<double> all_errors;
+  all_errors.reserve(inliers.size());
+  for (int i = 0; i < inliers.size(); ++i) {
+    EuclideanToHomogeneous(xs2[0].col(inliers[i]), &p1);
+    p1 = H * p1;
+    HomogeneousToEuclidean(p1, &e);
+    e -= xs2[1].col(inliers[i]);
+    all_errors.push_back(e.norm());
+  }
+  std::nth_element(all_errors.begin(),
+                   all_errors.begin() + all_errors.size() / 2,
+                   all_errors.end());
+  double median = all_errors[all_errors.size() / 2];
+  VLOG(1) << "H median:" << median << "px.\n";
+  return median;
 }
 
-bool AddIndex(int id, vector<uint> *id_ordered) {
-  for (uint i = 0; i < id_ordered->size() ;++i) {
-    if ((*id_ordered)[i] == id) {
-      return false;
+// Orders the edges of the queue by decreasing score, then by image IDs so
+// that the order is deterministic.
+struct EdgeScoreLess {
+  EdgeScoreLess(const vector<CovisibilityEdge> &edges) : edges_(&edges) {}
+  bool operator()(int a, int b) const {
+    const CovisibilityEdge &ea = (*edges_)[a], &eb = (*edges_)[b];
+    if (ea.score != eb.score) {
+      return ea.score < eb.score;
     }
+    return a > b;
   }
-  id_ordered->push_back(id);
-  return true;
-}
+  const vector<CovisibilityEdge> *edges_;
+};
+
+}  // namespace
 
-void RecursivePairwiseHighScoresSearch(Mat &m, 
-                                       const Vec2i seed, 
-                                       vector<uint> *id_ordered) {   
-  double val_c, val_r;
-  Vec2i max_c, max_r;
-  int nothing;
-  // Set to zero (to avoid to get the same couple)
-  m(seed[0], seed[1]) = 0;
-  
-  // Find the best score for the col
-  val_c = m.col(seed[1]).maxCoeff(&max_c[0], &nothing);
-  max_c[1] = seed[1];
-  // Find the best score for the row
-  val_r = m.row(seed[0]).maxCoeff(&nothing, &max_r[1]);
-  max_r[0] = seed[0];
-    
-  if (val_c > 0) 
-    m(max_c[0], max_c[1]) = 0;
-  if (val_r > 0) 
-    m(max_r[0], max_r[1]) = 0;
-  
-  if (val_c < val_r) {
-    if (val_r > 0) {
-      AddIndex(max_r[1], id_ordered);
-      RecursivePairwiseHighScoresSearch(m, max_r, id_ordered);
+void ComputeCovisibilityGraph(const Matches &matches,
+                              int min_shared_tracks,
+                              vector<CovisibilityEdge> *edges) {
+  edges->clear();
+  const std::set<Matches::ImageID> &image_set = matches.get_images();
+  std::vector<Matches::ImageID> images(image_set.begin(), image_set.end());
+  const int num_images = images.size();
+
+  // The images of every track, as indices in images (sorted, since the
+  // reversed edges are sorted by track then image).
+  std::vector<int> track_offsets(1, 0);
+  std::vector<int> track_images;
+  std::vector<int> image_num_tracks(num_images, 0);
+  bool first = true;
+  Matches::TrackID current_track = 0;
+  int image_index = 0;
+  for (Matches::Points r = matches.AllReversed<PointFeature>(); r; ++r) {
+    if (first || r.track() != current_track) {
+      if (!first) {
+        track_offsets.push_back(track_images.size());
+      }
+      first = false;
+      current_track = r.track();
+      image_index = 0;
     }
-    if (val_c > 0) {
-      AddIndex(max_c[0], id_ordered);
-      RecursivePairwiseHighScoresSearch(m, max_c, id_ordered);
+    // Images come in increasing order within a track.
+    image_index = std::lower_bound(images.begin() + image_index, images.end(),
+                                   r.image()) - images.begin();
+    track_images.push_back(image_index);
+    image_num_tracks[image_index]++;
+  }
+  if (!first) {
+    track_offsets.push_back(track_images.size());
+  }
+  const int num_tracks = track_offsets.size() - 1;
+
+  // The tracks of every image, by counting sort.
+  std::vector<int> image_offsets(num_images + 1, 0);
+  for (int i = 0; i < num_images; ++i) {
+    image_offsets[i + 1] = image_offsets[i] + image_num_tracks[i];
+  }
+  std::vector<int> image_tracks(track_images.size());
+  std::vector<int> fill(image_offsets.begin(), image_offsets.end() - 1);
+  for (int t = 0; t < num_tracks; ++t) {
+    for (int k = track_offsets[t]; k < track_offsets[t + 1]; ++k) {
+      image_tracks[fill[track_images[k]]++] = t;
     }
-  } else {
-    if (val_c > 0) {
-      AddIndex(max_c[0], id_ordered);
-      RecursivePairwiseHighScoresSearch(m, max_c, id_ordered);
+  }
+
+  // For every image i, counts the tracks shared with the images j > i.
+  std::vector<std::vector<CovisibilityEdge> > image_edges(num_images);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<int> counts(num_images, 0);
+    std::vector<int> touched;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+    for (int i = 0; i < num_images; ++i) {
+      touched.clear();
+      for (int k = image_offsets[i]; k < image_offsets[i + 1]; ++k) {
+        const int t = image_tracks[k];
+        for (int l = track_offsets[t]; l < track_offsets[t + 1]; ++l) {
+          const int j = track_images[l];
+          if (j > i) {
+            if (counts[j] == 0) {
+              touched.push_back(j);
+            }
+            counts[j]++;
+          }
+        }
+      }
+      std::sort(touched.begin(), touched.end());
+      for (int k = 0; k < touched.size(); ++k) {
+        const int j = touched[k];
+        if (counts[j] >= min_shared_tracks) {
+          CovisibilityEdge edge;
+          edge.image1 = images[i];
+          edge.image2 = images[j];
+          edge.num_shared_tracks = counts[j];
+          edge.score = 0;
+          image_edges[i].push_back(edge);
+        }
+        counts[j] = 0;
+      }
     }
-    if (val_r > 0){
-      AddIndex(max_r[1], id_ordered);
-      RecursivePairwiseHighScoresSearch(m, max_r, id_ordered);
+  }
+  for (int i = 0; i < num_images; ++i) {
+    for (int k = 0; k < image_edges[i].size(); ++k) {
+      edges->push_back(image_edges[i][k]);
     }
   }
 }
 
-void RecoverOrderFromPairwiseHighScores(
-   const Matches &matches,
-   Mat &m, 
-   std::list<vector<Matches::ImageID> > *connected_graph_list) {
-  //connected_graph_list->clear();
-  std::map<uint, Matches::ImageID> map_img_ids;
-  std::set<Matches::ImageID>::const_iterator image_iter1 =
-    matches.get_images().begin();
-  uint i_img = 0;
-  for (;image_iter1 != matches.get_images().end(); ++image_iter1, ++i_img) {
-    map_img_ids[i_img] = *image_iter1;
-  }
-  
-  Vec2i max;
-  double val = 1;
-  while (val > 0) {
-    // Find the global best score
-    val = m.maxCoeff(&max[0], &max[1]);
-    //From this seed, find the second best score in the same col/row
-    if (val > 0) {
-      vector<uint> id_ordered;
-      id_ordered.push_back(max[0]);
-      id_ordered.push_back(max[1]);
-      RecursivePairwiseHighScoresSearch(m, max, &id_ordered);      
-      vector<Matches::ImageID> v_ids(id_ordered.size());
-      for (i_img = 0; i_img < id_ordered.size(); ++i_img) {
-        v_ids[i_img] = (map_img_ids[id_ordered[i_img]]);
-      }
-      connected_graph_list->push_back(v_ids);
-    }
+void ScoreCovisibilityEdgesWithHomography(const Matches &matches,
+                                          vector<CovisibilityEdge> *edges) {
+  const FrozenMatches frozen_matches(matches);
+  const int num_edges = edges->size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < num_edges; ++i) {
+    CovisibilityEdge &edge = (*edges)[i];
+    edge.score = edge.num_shared_tracks *
+        MedianHomographyError(frozen_matches, edge.image1, edge.image2);
   }
 }
 
 void SelectEfficientImageOrder(
     const Matches &matches, 
-    std::list<vector<Matches::ImageID> >*images_list) {
-  Mat m;
-  FillPairwiseMatchesHomographyMatrix(matches, &m);
-  VLOG(1) << " M = " << m <<"\n";
-  RecoverOrderFromPairwiseHighScores(matches, m, images_list);
+    std::list<vector<Matches::ImageID> >*images_list,
+    int min_shared_tracks) {
+  vector<CovisibilityEdge> edges;
+  ComputeCovisibilityGraph(matches, min_shared_tracks, &edges);
+  ScoreCovisibilityEdgesWithHomography(matches, &edges);
+
+  // Adjacency lists of the scored edges.
+  std::map<Matches::ImageID, std::vector<int> > adjacency;
+  std::vector<int> sorted_edges;
+  for (int i = 0; i < edges.size(); ++i) {
+    if (edges[i].score > 0) {
+      adjacency[edges[i].image1].push_back(i);
+      adjacency[edges[i].image2].push_back(i);
+      sorted_edges.push_back(i);
+    }
+  }
+  EdgeScoreLess less(edges);
+  std::sort(sorted_edges.begin(), sorted_edges.end(), less);
+
+  std::set<Matches::ImageID> ordered;
+  // The best edge left seeds a new graph, which grows by its best edge to a
+  // new image.
+  for (int s = sorted_edges.size() - 1; s >= 0; --s) {
+    const CovisibilityEdge &seed = edges[sorted_edges[s]];
+    if (ordered.count(seed.image1) || ordered.count(seed.image2)) {
+      continue;
+    }
+    vector<Matches::ImageID> graph;
+    std::priority_queue<int, std::vector<int>, EdgeScoreLess> queue(less);
+    Matches::ImageID new_image = seed.image1;
+    bool found = true;
+    while (found) {
+      graph.push_back(new_image);
+      ordered.insert(new_image);
+      const std::vector<int> &image_edges = adjacency[new_image];
+      for (int k = 0; k < image_edges.size(); ++k) {
+        queue.push(image_edges[k]);
+      }
+      found = false;
+      while (!found && !queue.empty()) {
+        const CovisibilityEdge &edge = edges[queue.top()];
+        queue.pop();
+        if (!ordered.count(edge.image1)) {
+          new_image = edge.image1;
+          found = true;
+        } else if (!ordered.count(edge.image2)) {
+          new_image = edge.image2;
+          found = true;
+        }
+      }
+    }
+    images_list->push_back(graph);
+  }
 }
 } // namespace libmv
@@ -25,13 +25,42 @@
 
 namespace libmv {
 
+// An edge of the co-visibility graph: two images (image1 < image2) that
+// share tracks.
+struct CovisibilityEdge {
+  Matches::ImageID image1;
+  Matches::ImageID image2;
+  int num_shared_tracks;
+  double score;
+};
+
+// Builds the sparse co-visibility graph of the images: the pairs of images
+// sharing at least min_shared_tracks point tracks, sorted by (image1, image2),
+// with a zero score.  The counts are accumulated in one pass over the tracks
+// (linear in the number of co-observations), in parallel over the images.
+void ComputeCovisibilityGraph(const Matches &matches,
+                              int min_shared_tracks,
+                              vector<CovisibilityEdge> *edges);
+
+// Scores the edges by number of shared tracks x median homography error: a
+// pair that a homography explains badly has a wide baseline.  The homography
+// is fitted robustly on the shared tracks, with random samples seeded from
+// the two image IDs; the edges are scored in parallel.
+void ScoreCovisibilityEdgesWithHomography(const Matches &matches,
+                                          vector<CovisibilityEdge> *edges);
+
 // This method selects an efficient order of images based on an image
 // criterion: median homography error x number of common matches
 // The outpout images_list contains a list of connected graphs
 // (vectors), each vector contains the ImageID ordered by the criterion.
+// Only the pairs of images sharing at least min_shared_tracks tracks are
+// scored.  Every graph starts with the best pair left; the next image is the
+// one of the best edge between the graph and a new image (a priority queue
+// of the edges of the graph).
 void SelectEfficientImageOrder(
   const Matches &matches, 
-  std::list<vector<Matches::ImageID> >*images_list);
+  std::list<vector<Matches::ImageID> >*images_list,
+  int min_shared_tracks = 20);
 
 }  // namespace libmv
 
@@ -0,0 +1,129 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdlib>
+#include <list>
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/multiview/test_data_sets.h"
+#include "libmv/reconstruction/image_selection.h"
+#include "testing/testing.h"
+
+namespace {
+using namespace libmv;
+
+// Inserts the views of the data set as the images first_image, ... and the
+// points as the tracks first_track, ...
+void InsertDataSet(const NViewDataSet &d, int first_image, int first_track,
+                   Matches *matches, std::list<PointFeature> *features) {
+  for (int i = 0; i < d.n; ++i) {
+    for (int p = 0; p < d.x[i].cols(); ++p) {
+      features->push_back(PointFeature(d.x[i](0, p), d.x[i](1, p)));
+      matches->Insert(first_image + i, first_track + p, &features->back());
+    }
+  }
+}
+
+TEST(ImageSelection, CovisibilityGraph) {
+  Matches matches;
+  std::list<PointFeature> features;
+  InsertDataSet(NRealisticCamerasFull(4, 60), 0, 0, &matches, &features);
+  InsertDataSet(NRealisticCamerasFull(3, 60), 4, 100, &matches, &features);
+  // The image 7 sees 5 tracks of the first set.
+  for (int p = 0; p < 5; ++p) {
+    features.push_back(PointFeature(p, p));
+    matches.Insert(7, p, &features.back());
+  }
+
+  vector<CovisibilityEdge> edges;
+  ComputeCovisibilityGraph(matches, 1, &edges);
+  ASSERT_EQ(6 + 3 + 4, edges.size());
+  EXPECT_EQ(0, edges[0].image1);
+  EXPECT_EQ(1, edges[0].image2);
+  EXPECT_EQ(60, edges[0].num_shared_tracks);
+  EXPECT_EQ(0, edges[3].image1);
+  EXPECT_EQ(7, edges[3].image2);
+  EXPECT_EQ(5, edges[3].num_shared_tracks);
+
+  ComputeCovisibilityGraph(matches, 20, &edges);
+  ASSERT_EQ(6 + 3, edges.size());
+  for (int i = 0; i < edges.size(); ++i) {
+    EXPECT_LT(edges[i].image1, edges[i].image2);
+    EXPECT_EQ(60, edges[i].num_shared_tracks);
+    EXPECT_EQ(edges[i].image1 < 4, edges[i].image2 < 4);
+  }
+}
+
+TEST(ImageSelection, SelectEfficientImageOrder) {
+  Matches matches;
+  std::list<PointFeature> features;
+  InsertDataSet(NRealisticCamerasFull(4, 60), 0, 0, &matches, &features);
+  InsertDataSet(NRealisticCamerasFull(3, 60), 4, 100, &matches, &features);
+  for (int p = 0; p < 5; ++p) {
+    features.push_back(PointFeature(p, p));
+    matches.Insert(7, p, &features.back());
+  }
+
+  std::list<vector<Matches::ImageID> > images_list;
+  SelectEfficientImageOrder(matches, &images_list);
+  ASSERT_EQ(2, images_list.size());
+  int num_images = 0;
+  std::list<vector<Matches::ImageID> >::iterator it = images_list.begin();
+  for (; it != images_list.end(); ++it) {
+    const vector<Matches::ImageID> &graph = *it;
+    ASSERT_GE(graph.size(), 3);
+    bool first_set = graph[0] < 4;
+    EXPECT_EQ(first_set ? 4 : 3, graph.size());
+    for (int i = 0; i < graph.size(); ++i) {
+      EXPECT_EQ(first_set, graph[i] < 4);
+    }
+    num_images += graph.size();
+  }
+  // The image 7 shares too few tracks to be ordered.
+  EXPECT_EQ(7, num_images);
+}
+
+TEST(ImageSelection, EdgeScoresDoNotDependOnRand) {
+  NViewDataSet d = NRealisticCamerasFull(2, 100);
+  // Noise and outliers, so that the RANSAC samples matter.
+  for (int i = 0; i < d.x[1].cols(); ++i) {
+    d.x[1](0, i) += (i % 7 - 3) * 0.3;
+    d.x[1](1, i) += (i % 5 - 2) * 0.3;
+    if (i % 4 == 0) {
+      d.x[1](0, i) += 40;
+    }
+  }
+  Matches matches;
+  std::list<PointFeature> features;
+  InsertDataSet(d, 0, 0, &matches, &features);
+
+  vector<CovisibilityEdge> edges, other_edges;
+  ComputeCovisibilityGraph(matches, 1, &edges);
+  ASSERT_EQ(1, edges.size());
+  other_edges = edges;
+  srand(1);
+  ScoreCovisibilityEdgesWithHomography(matches, &edges);
+  srand(2);
+  ScoreCovisibilityEdgesWithHomography(matches, &other_edges);
+  EXPECT_GT(edges[0].score, 0);
+  EXPECT_EQ(edges[0].score, other_edges[0].score);
+}
+
+}  // namespace
@@ -20,9 +20,11 @@
 
 #include <algorithm>
 #include <map>
+#include <vector>
 
 #include "libmv/logging/logging.h"
 #include "libmv/multiview/conditioning.h"
+#include "libmv/multiview/fundamental.h"
 #include "libmv/multiview/robust_fundamental.h"
 #include "libmv/multiview/robust_homography.h"
 #include "libmv/correspondence/matches.h"
@@ -30,10 +32,62 @@
 
 namespace libmv {
 
+namespace {
+
+// Stamps of the tracks of the current keyframe, indexed by track ID: a track
+// is in the keyframe if its stamp is the keyframe stamp.  Restamping a
+// keyframe only touches its own tracks.
+class KeyframeTracks {
+ public:
+  KeyframeTracks(const Matches &matches) : matches_(matches), stamp_(0) {
+    const std::set<Matches::TrackID> &tracks = matches.get_tracks();
+    if (!tracks.empty()) {
+      min_track_ = *tracks.begin();
+      stamps_.resize(*tracks.rbegin() - min_track_ + 1, 0);
+    }
+  }
+  void SetKeyframe(Matches::ImageID keyframe) {
+    ++stamp_;
+    for (Matches::Points r = matches_.InImage<PointFeature>(keyframe); r; ++r) {
+      stamps_[r.track() - min_track_] = stamp_;
+    }
+  }
+  // Number of tracks of the image that are in the keyframe.
+  int NumSharedTracks(Matches::ImageID image) const {
+    int n = 0;
+    for (Matches::Points r = matches_.InImage<PointFeature>(image); r; ++r) {
+      n += stamps_[r.track() - min_track_] == stamp_;
+    }
+    return n;
+  }
+
+ private:
+  const Matches &matches_;
+  Matches::TrackID min_track_;
+  std::vector<int> stamps_;
+  int stamp_;
+};
+
+// Returns true if a homography explains the motion between the images better
+// than a fundamental matrix.
+bool IsHomographyBetter(const Matches &matches,
+                        Matches::ImageID image1,
+                        Matches::ImageID image2,
+                        double sigma) {
+  double gric_F, gric_H;
+  return ComputeGRICScores(matches, image1, image2, sigma, &gric_F, &gric_H) &&
+         gric_H < gric_F;
+}
+
+}  // namespace
+
 void SelectKeyframesBasedOnMatchesNumber(const Matches &matches, 
                                          vector<Matches::ImageID> *keyframes,
                                          float min_matches_pc,
                                          int min_num_matches) {  
+  if (matches.NumImages() == 0) {
+    return;
+  }
   keyframes->reserve(matches.NumImages());
   std::set<Matches::ImageID>::const_iterator image_iter =
     matches.get_images().begin();
@@ -42,90 +96,132 @@ void SelectKeyframesBasedOnMatchesNumber(const Matches &matches,
   // The first frame is selected as a keyframe
   keyframes->push_back(prev_keyframe);
   image_iter++;
+  KeyframeTracks keyframe_tracks(matches);
+  keyframe_tracks.SetKeyframe(prev_keyframe);
   int num_features_to_keep = min_matches_pc * 
                              matches.NumFeatureImage(prev_keyframe);
   num_features_to_keep = std::max(num_features_to_keep, min_num_matches); 
   VLOG(3) << "# Features to keep: " << num_features_to_keep<< std::endl;
-  vector<Matches::ImageID> two_images;
-  two_images.push_back(prev_keyframe);
   for (;image_iter != matches.get_images().end(); ++image_iter) {
-    two_images.push_back(*image_iter);
-    // TODO(julien) make a new function that just count the common tracks!
-    vector<Matches::TrackID> tracks;
-    TracksInAllImages(matches, two_images, &tracks);
-    VLOG(3) << "Shared tracks: " << tracks.size() << std::endl;
+    int num_shared_tracks = keyframe_tracks.NumSharedTracks(*image_iter);
+    VLOG(3) << "Shared tracks: " << num_shared_tracks << std::endl;
     // If the current frame share not enough common matches with the previous 
     // keyframe then we select the previous frame 
     // i.e. the one that has enough common matches
-    if (tracks.size() < num_features_to_keep && 
+    if (num_shared_tracks < num_features_to_keep && 
         prev_frame_good != prev_keyframe) {
       VLOG(2) << "Keyframe Detected!" << std::endl;
       keyframes->push_back(prev_frame_good);
       prev_keyframe = prev_frame_good;
+      keyframe_tracks.SetKeyframe(prev_keyframe);
       num_features_to_keep = min_matches_pc * 
                              matches.NumFeatureImage(prev_keyframe);
       num_features_to_keep = std::max(num_features_to_keep, min_num_matches);
       VLOG(3) << "# Features to keep: " << num_features_to_keep<< std::endl;
-      two_images.clear();
-      two_images.push_back(prev_keyframe);
     } else {
       prev_frame_good = *image_iter;
-      two_images.pop_back();
     }
   }
 }
 
-/*
- * Not yet finished 
- * TODO(julien) It really doesn't work: Finish this function!
- * */
-void SelectKeyframesBasedOnFAndH(
-   const Matches &matches, 
-   vector<Matches::ImageID> *keyframes) {
-  keyframes->reserve(matches.NumImages());
-  Mat m;
-  Mat3 F, H;
-  double f_err, max_error_f = 1;
-  double h_err, max_error_h = 1;
-  double outliers_prob = 1e-2;
-  uint ni, ne = 0;
-  vector<Mat> xs2;
-  vector<int> inliers;
-  std::set<Matches::ImageID>::const_iterator image_iter =
-    matches.get_images().begin();
-  std::set<Matches::ImageID>::const_iterator prev_image_iter = image_iter;
-  ni = matches.NumFeatureImage(*image_iter);
-  image_iter++;
-  for (;image_iter != matches.get_images().end(); ++image_iter) {
-    TwoViewPointMatchMatrices(matches, *prev_image_iter, *image_iter, &xs2);
-    if (xs2[0].cols() >= 7) {
-      h_err = Homography2DFromCorrespondences4PointRobust(xs2[0], xs2[1], 
-                                                          max_error_h, 
-                                                          &H, &inliers, 
-                                                          outliers_prob);
-      h_err /= inliers.size();
-      f_err = FundamentalFromCorrespondences7PointRobust(xs2[0], xs2[1], 
-                                                         max_error_f, 
-                                                         &F, &inliers, 
-                                                         outliers_prob);
-      f_err /= inliers.size();
-      VLOG(1) << "H error:" << h_err << "px" << std::endl;
-      VLOG(1) << "F error:" << f_err << "px" << std::endl;
-      VLOG(1) << "ni:" << ni << " ne:" << ne << std::endl;
-      // TODO(julien) no sure the ni and ne are the good ones.
-      // read Pollefeys'03 and Torr98
-      ne = inliers.size();
-      if (f_err < h_err && ni >= 0.9 * ne) {
-        VLOG(1) << "Keyframe detected: " << *image_iter << std::endl;
-        keyframes->push_back(*image_iter);
-        prev_image_iter = image_iter;
-        ni = ne;
-      }
+int NumSharedTracks(const Matches &matches,
+                    Matches::ImageID image1,
+                    Matches::ImageID image2) {
+  // Both ranges are sorted by track.
+  Matches::Points r1 = matches.InImage<PointFeature>(image1);
+  Matches::Points r2 = matches.InImage<PointFeature>(image2);
+  int n = 0;
+  while (r1 && r2) {
+    if (r1.track() < r2.track()) {
+      ++r1;
+    } else if (r2.track() < r1.track()) {
+      ++r2;
     } else {
-      prev_image_iter = image_iter;
-      ni = ne;
+      ++n;
+      ++r1;
+      ++r2;
+    }
+  }
+  return n;
+}
+
+bool ComputeGRICScores(const Matches &matches,
+                       Matches::ImageID image1,
+                       Matches::ImageID image2,
+                       double sigma,
+                       double *gric_F,
+                       double *gric_H) {
+  vector<Mat> xs;
+  TwoViewPointMatchMatrices(matches, image1, image2, &xs);
+  const int n = xs[0].cols();
+  if (n < 8) {
+    return false;
+  }
+  const double max_error = 3 * sigma;
+  const double outliers_probability = 1e-2;
+  // Not the global rand(): the pairs are scored in parallel.
+  unsigned int random_state = 1 + 65537u * image1 + image2;
+  Mat3 F, H;
+  FundamentalFromCorrespondences7PointRobust(xs[0], xs[1], max_error, &F,
+                                             NULL, outliers_probability,
+                                             &random_state);
+  Homography2DFromCorrespondences4PointRobust(xs[0], xs[1], max_error, &H,
+                                              NULL, outliers_probability,
+                                              &random_state);
+  // Data dimension r, model dimensions d and numbers of parameters k.
+  const double r = 4, d_F = 3, d_H = 2, k_F = 7, k_H = 8;
+  const double inv_sigma2 = 1.0 / (sigma * sigma);
+  *gric_F = n * d_F * log(r) + k_F * log(r * n);
+  *gric_H = n * d_H * log(r) + k_H * log(r * n);
+  for (int i = 0; i < n; ++i) {
+    Vec2 x1 = xs[0].col(i), x2 = xs[1].col(i);
+    double e_F = SampsonDistance2(F, x1, x2) * inv_sigma2;
+    Vec3 Hx1 = H * EuclideanToHomogeneous(x1);
+    double e_H = (x2 - HomogeneousToEuclidean(Hx1)).squaredNorm() * inv_sigma2;
+    *gric_F += std::min(e_F, 2 * (r - d_F));
+    *gric_H += std::min(e_H, 2 * (r - d_H));
+  }
+  VLOG(2) << "GRIC(" << image1 << ", " << image2 << "): F " << *gric_F
+          << " H " << *gric_H << std::endl;
+  return true;
+}
+
+void FilterKeyframesWithGRIC(const Matches &matches,
+                             vector<Matches::ImageID> *keyframes,
+                             double sigma,
+                             int min_num_matches) {
+  const int num_keyframes = keyframes->size();
+  if (num_keyframes < 3) {
+    return;
+  }
+  // Scores every pair of consecutive candidates at once.
+  vector<int> homography_better(num_keyframes, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 1; i < num_keyframes - 1; ++i) {
+    homography_better[i] = IsHomographyBetter(matches, (*keyframes)[i - 1],
+                                              (*keyframes)[i], sigma);
+  }
+  // When a keyframe is removed, the next one is scored again against the
+  // previous kept keyframe.
+  vector<Matches::ImageID> kept;
+  kept.push_back((*keyframes)[0]);
+  for (int i = 1; i < num_keyframes - 1; ++i) {
+    Matches::ImageID last_kept = kept[kept.size() - 1];
+    bool degenerate = last_kept == (*keyframes)[i - 1] ?
+        homography_better[i] :
+        IsHomographyBetter(matches, last_kept, (*keyframes)[i], sigma);
+    if (degenerate &&
+        NumSharedTracks(matches, last_kept, (*keyframes)[i + 1]) >=
+        min_num_matches) {
+      VLOG(2) << "Keyframe " << (*keyframes)[i] << " removed." << std::endl;
+      continue;
     }
+    kept.push_back((*keyframes)[i]);
   }
+  kept.push_back((*keyframes)[num_keyframes - 1]);
+  keyframes->swap(kept);
 }
 
 } // namespace libmv
@@ -33,10 +33,45 @@ namespace libmv {
 // current image and the previous keyframe. If the number of shared tracks drops
 // below min_matches_pc *100% of the keyframe total number of tracks or is less
 // than min_num_matches, then the previous image is selected as a keyframe.
+// The shared tracks are counted with one pass over the features of every
+// image, so the selection is linear in the number of features.
 void SelectKeyframesBasedOnMatchesNumber(const Matches &matches, 
                                          vector<Matches::ImageID> *keyframes,
                                          float min_matches_pc = 0.15,
                                          int min_num_matches = 50);
+
+// Number of tracks observed in both images.
+int NumSharedTracks(const Matches &matches,
+                    Matches::ImageID image1,
+                    Matches::ImageID image2);
+
+// Fits a fundamental matrix and a homography to the shared tracks of two
+// images and computes their GRIC scores (Torr, "Geometric motion segmentation
+// and model selection", 1998), for a noise of sigma pixels:
+//   GRIC = sum_i min(e_i^2 / sigma^2, 2 (r - d)) + n d log(r) + k log(r n)
+// with r = 4, d = 3 and k = 7 for F, d = 2 and k = 8 for H.  The lowest
+// score gives the best model; a homography means that the baseline is too
+// small (or the scene planar) to reconstruct from the pair.  The RANSAC
+// samples are seeded from the two image IDs, so the scores of a pair do not
+// change from one call (or thread) to another.
+// Returns false if the images share less than 8 tracks.
+bool ComputeGRICScores(const Matches &matches,
+                       Matches::ImageID image1,
+                       Matches::ImageID image2,
+                       double sigma,
+                       double *gric_F,
+                       double *gric_H);
+
+// Removes the keyframes whose motion from the previous kept keyframe is better
+// explained by a homography than by a fundamental matrix (see
+// ComputeGRICScores).  A keyframe is kept anyway if removing it would leave
+// less than min_num_matches shared tracks between the previous kept keyframe
+// and the next one.  The first and the last keyframes are always kept.
+// The scores of the consecutive keyframes are computed in parallel.
+void FilterKeyframesWithGRIC(const Matches &matches,
+                             vector<Matches::ImageID> *keyframes,
+                             double sigma = 1.0,
+                             int min_num_matches = 50);
 }  // namespace libmv
 
 #endif  // LIBMV_RECONSTRUCTION_KEYFRAME_SELECTION_H_
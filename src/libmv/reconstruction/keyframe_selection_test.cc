@@ -0,0 +1,124 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdlib>
+#include <list>
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/multiview/projection.h"
+#include "libmv/multiview/test_data_sets.h"
+#include "libmv/reconstruction/keyframe_selection.h"
+#include "testing/testing.h"
+
+namespace {
+using namespace libmv;
+
+// Every frame starts 100 tracks that live 5 frames.
+void SlidingTracks(int num_frames, Matches *matches,
+                   std::list<PointFeature> *features) {
+  for (int f = 0; f < num_frames; ++f) {
+    for (int b = std::max(0, f - 4); b <= f; ++b) {
+      for (int i = 0; i < 100; ++i) {
+        features->push_back(PointFeature(i, f));
+        matches->Insert(f, 100 * b + i, &features->back());
+      }
+    }
+  }
+}
+
+TEST(KeyframeSelection, SlidingTracks) {
+  Matches matches;
+  std::list<PointFeature> features;
+  SlidingTracks(30, &matches, &features);
+  EXPECT_EQ(300, NumSharedTracks(matches, 4, 6));
+  EXPECT_EQ(0, NumSharedTracks(matches, 4, 9));
+
+  vector<Matches::ImageID> keyframes;
+  SelectKeyframesBasedOnMatchesNumber(matches, &keyframes);
+  ASSERT_EQ(8, keyframes.size());
+  for (int i = 0; i < keyframes.size(); ++i) {
+    EXPECT_EQ(4 * i, keyframes[i]);
+  }
+}
+
+void InsertPoints(const Mat2X &x, Matches::ImageID image, Matches *matches,
+                  std::list<PointFeature> *features) {
+  for (int i = 0; i < x.cols(); ++i) {
+    features->push_back(PointFeature(x(0, i), x(1, i)));
+    matches->Insert(image, i, &features->back());
+  }
+}
+
+TEST(KeyframeSelection, GRICPrefersTheRightModel) {
+  NViewDataSet d = NRealisticCamerasFull(3, 100);
+  Matches matches;
+  std::list<PointFeature> features;
+  InsertPoints(d.x[0], 0, &matches, &features);
+  InsertPoints(d.x[1], 1, &matches, &features);
+  // The image 2 is the image 0 seen by a rotating camera.
+  Mat3 H = d.K[0] * RotationAroundY(0.05) * d.K[0].inverse();
+  Mat2X x2 = HomogeneousToEuclidean(
+      static_cast<Mat3X>(H * EuclideanToHomogeneous(d.x[0])));
+  InsertPoints(x2, 2, &matches, &features);
+
+  double gric_F, gric_H;
+  ASSERT_TRUE(ComputeGRICScores(matches, 0, 1, 1.0, &gric_F, &gric_H));
+  EXPECT_LT(gric_F, gric_H);
+  ASSERT_TRUE(ComputeGRICScores(matches, 0, 2, 1.0, &gric_F, &gric_H));
+  EXPECT_LT(gric_H, gric_F);
+
+  // The keyframe 2 only rotates from the keyframe 0: it is removed.
+  vector<Matches::ImageID> keyframes;
+  keyframes.push_back(0);
+  keyframes.push_back(2);
+  keyframes.push_back(1);
+  FilterKeyframesWithGRIC(matches, &keyframes);
+  ASSERT_EQ(2, keyframes.size());
+  EXPECT_EQ(0, keyframes[0]);
+  EXPECT_EQ(1, keyframes[1]);
+}
+
+TEST(KeyframeSelection, GRICScoresDoNotDependOnRand) {
+  NViewDataSet d = NRealisticCamerasFull(2, 100);
+  // Noise and outliers, so that the RANSAC samples matter.
+  Mat2X x1 = d.x[1];
+  for (int i = 0; i < x1.cols(); ++i) {
+    x1(0, i) += (i % 7 - 3) * 0.3;
+    x1(1, i) += (i % 5 - 2) * 0.3;
+    if (i % 4 == 0) {
+      x1(0, i) += 40;
+    }
+  }
+  Matches matches;
+  std::list<PointFeature> features;
+  InsertPoints(d.x[0], 0, &matches, &features);
+  InsertPoints(x1, 1, &matches, &features);
+
+  double gric_F, gric_H, other_gric_F, other_gric_H;
+  srand(1);
+  ASSERT_TRUE(ComputeGRICScores(matches, 0, 1, 1.0, &gric_F, &gric_H));
+  srand(2);
+  ASSERT_TRUE(ComputeGRICScores(matches, 0, 1, 1.0,
+                                &other_gric_F, &other_gric_H));
+  EXPECT_EQ(gric_F, other_gric_F);
+  EXPECT_EQ(gric_H, other_gric_H);
+}
+
+}  // namespace
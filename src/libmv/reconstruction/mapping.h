@@ -21,6 +21,7 @@
 #ifndef LIBMV_RECONSTRUCTION_MAPPING_H_
 #define LIBMV_RECONSTRUCTION_MAPPING_H_
 
+#include "libmv/multiview/batch_triangulation.h"
 #include "libmv/reconstruction/reconstruction.h"
 
 namespace libmv {
@@ -31,8 +32,9 @@ namespace libmv {
 // minimum_num_views images.
 // The method:
 //    selects the tracks that haven't been already reconstructed
-//    reconstructs the tracks into structures
-//    remove outliers (points behind one camera or at infinity) 
+//    gathers their observations and triangulates them all in a batch
+//    remove outliers (points behind one camera, at infinity, with a large
+//    reprojection error or a small triangulation angle, see options)
 //    creates and add them in reconstruction
 // Returns the number of structures reconstructed and the list of triangulated
 // points
@@ -41,7 +43,8 @@ uint PointStructureTriangulationCalibrated(
    CameraID image_id, 
    size_t minimum_num_views, 
    Reconstruction *reconstruction,
-   vector<StructureID> *new_structures_ids = NULL);
+   vector<StructureID> *new_structures_ids = NULL,
+   const BatchTriangulationOptions &options = BatchTriangulationOptions());
 
 // Retriangulates point tracks observed in the image image_id using theirs
 // observations (matches)  when the instrinsic parameters are known.
@@ -49,14 +52,15 @@ uint PointStructureTriangulationCalibrated(
 // minimum_num_views images.
 // The method:
 //    selects the tracks that have been already reconstructed
-//    reconstructs the tracks into structures
-//    remove outliers (points behind one camera or at infinity) 
+//    gathers their observations and triangulates them all in a batch
+//    remove outliers (see PointStructureTriangulationCalibrated)
 //    updates the coordinates in the reconstruction
 // Returns the number of structures retriangulated
 uint PointStructureRetriangulationCalibrated(
    const Matches &matches, 
    CameraID image_id,  
-   Reconstruction *reconstruction);
+   Reconstruction *reconstruction,
+   const BatchTriangulationOptions &options = BatchTriangulationOptions());
 
 // Reconstructs unreconstructed point tracks observed in the image image_id
 // using theirs observations (matches) when the instrinsic param. are unknown. 
@@ -64,8 +68,9 @@ uint PointStructureRetriangulationCalibrated(
 // minimum_num_views images.
 // The method:
 //    selects the tracks that haven't been already reconstructed
-//    reconstructs the tracks into structures
-//    remove outliers (contains NaN coord) TODO(julien) do other tests (rms?)
+//    gathers their observations and triangulates them all in a batch
+//    remove outliers (NaN coords, points behind one camera or with a large
+//    reprojection error; the triangulation angle is not checked)
 //    creates and add them in reconstruction
 // Returns the number of structures reconstructed and the list of triangulated
 // points
@@ -74,7 +79,8 @@ uint PointStructureTriangulationUncalibrated(
    CameraID image_id, 
    size_t minimum_num_views, 
    Reconstruction *reconstruction,
-   vector<StructureID> *new_structures_ids = NULL);
+   vector<StructureID> *new_structures_ids = NULL,
+   const BatchTriangulationOptions &options = BatchTriangulationOptions());
 
 // Retriangulates point tracks observed in the image image_id using theirs
 // observations (matches)  when the instrinsic parameters are unknown.  
@@ -82,14 +88,15 @@ uint PointStructureTriangulationUncalibrated(
 // minimum_num_views images.
 // The method:
 //    selects the tracks that have been already reconstructed
-//    reconstructs the tracks into structures
-//    remove outliers (contains NaN coord) TODO(julien) do other tests (rms?)
+//    gathers their observations and triangulates them all in a batch
+//    remove outliers (see PointStructureTriangulationUncalibrated)
 //    updates the coordinates in the reconstruction
 // Returns the number of structures retriangulated
 uint PointStructureRetriangulationUncalibrated(
    const Matches &matches, 
    CameraID image_id,  
-   Reconstruction *reconstruction);
+   Reconstruction *reconstruction,
+   const BatchTriangulationOptions &options = BatchTriangulationOptions());
 }  // namespace libmv
 
 #endif  // LIBMV_RECONSTRUCTION_MAPPING_H_
@@ -32,13 +32,10 @@ double EstimateRootMeanSquareError(const Matches &matches,
   Mat4X X_world;
   double sum_rms2 = 0;
   size_t num_features = 0;
-  std::map<StructureID, Structure *>::iterator stucture_iter;
-  std::map<CameraID, Camera *>::iterator camera_iter = 
-      reconstruction->cameras().begin();
-  for (; camera_iter != reconstruction->cameras().end(); ++camera_iter) {
-    pcamera = dynamic_cast<PinholeCamera *>(camera_iter->second);
+  for (int c = 0; c < reconstruction->GetNumberCameras(); ++c) {
+    pcamera = reconstruction->pinhole_camera(c);
     if (pcamera) {
-      SelectExistingPointStructures(matches, camera_iter->first,
+      SelectExistingPointStructures(matches, reconstruction->camera_id(c),
                                     *reconstruction, 
                                     &structures_ids,
                                     &x_image);
@@ -46,7 +43,7 @@ double EstimateRootMeanSquareError(const Matches &matches,
                                         *reconstruction,
                                         &X_world);
       Mat2X dx =Project(pcamera->projection_matrix(), X_world) - x_image;
-      VLOG(1)   << "|Err Cam "<<camera_iter->first<<"| = " 
+      VLOG(1)   << "|Err Cam "<<reconstruction->camera_id(c)<<"| = " 
                 << sqrt(Square(dx.norm()) / x_image.cols()) << " ("
                 << x_image.cols() << " pts)" << std::endl;
       // TODO(julien) use normSquare
@@ -71,18 +68,14 @@ double MetricBundleAdjust(const Matches &matches,
   vector<Vec3>  ts(ncamera);
   Mat3X         X(3, nstructure);
   vector<StructureID> structures_ids;
-  std::map<StructureID, uint> map_structures_ids;
   
-  size_t str_id = 0;
+  // The parameters are packed in the storage order of the reconstruction, so
+  // the column of a structure in X is its index.
   PointStructure *pstructure = NULL;
-  std::map<StructureID, Structure *>::iterator str_iter =  
-    reconstruction->structures().begin();
-  for (; str_iter != reconstruction->structures().end(); ++str_iter) {
-    pstructure = dynamic_cast<PointStructure *>(str_iter->second);
+  for (int s = 0; s < nstructure; ++s) {
+    pstructure = reconstruction->point_structure(s);
     if (pstructure) {
-      X.col(str_id) = pstructure->coords_affine();
-      map_structures_ids[str_iter->first] = str_id;
-      str_id++;
+      X.col(s) = pstructure->coords_affine();
     } else {
       LOG(FATAL) << "Error: the bundle adjustment cannot handle non point "
                  << "structure.";
@@ -90,25 +83,24 @@ double MetricBundleAdjust(const Matches &matches,
     }
   }
   
+  // The observations of all the cameras are gathered from one snapshot.
+  const FrozenMatches frozen_matches(matches);
   PinholeCamera * pcamera = NULL;
-  size_t cam_id = 0;
-  std::map<CameraID, Camera *>::iterator cam_iter =  
-    reconstruction->cameras().begin();
-  for (; cam_iter != reconstruction->cameras().end(); ++cam_iter) {
-    pcamera = dynamic_cast<PinholeCamera *>(cam_iter->second);
+  for (int cam_id = 0; cam_id < ncamera; ++cam_id) {
+    pcamera = reconstruction->pinhole_camera(cam_id);
     if (pcamera) {
       pcamera->GetIntrinsicExtrinsicParameters(&Ks[cam_id],
                                                &Rs[cam_id],
                                                &ts[cam_id]);
-      SelectExistingPointStructures(matches, cam_iter->first,
+      SelectExistingPointStructures(frozen_matches,
+                                    reconstruction->camera_id(cam_id),
                                     *reconstruction,
                                     &structures_ids, &x[cam_id]);
       x_ids[cam_id].resize(structures_ids.size());
       for (size_t s = 0; s < structures_ids.size(); ++s) {
-        x_ids[cam_id][s] = map_structures_ids[structures_ids[s]];
+        x_ids[cam_id][s] = reconstruction->StructureIndex(structures_ids[s]);
       }
       //VLOG(1)   << "x_ids = " << x_ids[cam_id].transpose()<<"\n";
-      cam_id++;
     } else {
       LOG(FATAL) << "Error: the bundle adjustment cannot handle non pinhole "
                  << "cameras.";
@@ -119,25 +111,12 @@ double MetricBundleAdjust(const Matches &matches,
   rms = EuclideanBA(x, x_ids, &Ks, &Rs, &ts, &X, eBUNDLE_METRIC);
   // Copy the results only if it's better
   if (rms < rms0) {
-    cam_id = 0;
-    cam_iter = reconstruction->cameras().begin();
-    for (; cam_iter != reconstruction->cameras().end(); ++cam_iter) {
-      pcamera = dynamic_cast<PinholeCamera *>(cam_iter->second);
-      if (pcamera) {
-        pcamera->SetIntrinsicExtrinsicParameters(Ks[cam_id],
-                                                 Rs[cam_id],
-                                                 ts[cam_id]);
-        cam_id++;
-      }
+    for (int cam_id = 0; cam_id < ncamera; ++cam_id) {
+      reconstruction->pinhole_camera(cam_id)->SetIntrinsicExtrinsicParameters(
+          Ks[cam_id], Rs[cam_id], ts[cam_id]);
     }
-    str_id = 0;
-    str_iter = reconstruction->structures().begin();
-    for (; str_iter != reconstruction->structures().end(); ++str_iter) {
-      pstructure = dynamic_cast<PointStructure *>(str_iter->second);
-      if (pstructure) {
-        pstructure->set_coords_affine(X.col(str_id));
-        str_id++;
-      }
+    for (int s = 0; s < nstructure; ++s) {
+      reconstruction->point_structure(s)->set_coords_affine(X.col(s));
     }
   }
   //rms = EstimateRootMeanSquareError(matches, reconstruction);
@@ -166,15 +145,13 @@ uint RemoveOutliers(CameraID image_id,
   PointStructure *pstructure = NULL;
   double err = 0;
   for (size_t t = 0; t < structures_ids.size(); ++t) {
-    pstructure = dynamic_cast<PointStructure *>(
-      reconstruction->GetStructure(structures_ids[t]));
+    pstructure = reconstruction->GetPointStructure(structures_ids[t]);
     if (pstructure) {
       Matches::Features<PointFeature> fp =
        matches->InTrack<PointFeature>(structures_ids[t]);
       current_point_removed = false;
       while (fp) {
-        camera = dynamic_cast<PinholeCamera *>(
-          reconstruction->GetCamera(fp.image()));
+        camera = reconstruction->GetPinholeCamera(fp.image());
         if (camera) {
           q << fp.feature()->x(), fp.feature()->y();
           camera->ProjectPointStructure(*pstructure, &q2);
@@ -193,8 +170,7 @@ uint RemoveOutliers(CameraID image_id,
       fp = matches->InTrack<PointFeature>(structures_ids[t]);
       num_views = 0;
       while (fp) {
-        camera = dynamic_cast<PinholeCamera *>(
-          reconstruction->GetCamera(fp.image()));
+        camera = reconstruction->GetPinholeCamera(fp.image());
         if (camera) {
           num_views++;
         }
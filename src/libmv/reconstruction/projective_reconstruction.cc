@@ -20,6 +20,7 @@
 
 #include "libmv/base/vector_utils.h"
 #include "libmv/camera/pinhole_camera.h"
+#include "libmv/logging/tracing.h"
 #include "libmv/multiview/autocalibration.h"
 #include "libmv/multiview/fundamental.h"
 #include "libmv/multiview/robust_fundamental.h"
@@ -65,8 +66,7 @@ bool ReconstructFromTwoUncalibratedViews(const Matches &matches,
   Mat34 P2;
   P1<< Mat3::Identity(), Vec3::Zero();
   PinholeCamera * pcamera = NULL;
-  pcamera = dynamic_cast<PinholeCamera *>(
-    reconstruction->GetCamera(image_id1));
+  pcamera = reconstruction->GetPinholeCamera(image_id1);
   // If the first image has no associated camera, we choose the center of the 
   // coordinate frame
   if (!pcamera) {
@@ -107,6 +107,7 @@ bool UncalibratedCameraResection(const Matches &matches,
                                  CameraID image_id, 
                                  Matches *matches_inliers,
                                  Reconstruction *reconstruction) {
+  LIBMV_TRACE_SCOPE("resect");
   double rms_inliers_threshold = 1;// in pixels
   vector<StructureID> structures_ids;
   Mat2X x_image;
@@ -157,10 +158,8 @@ bool UpgradeToMetric(const Matches &matches,
   uint image_width = 0;
   uint image_height = 0;
   PinholeCamera * pcamera = NULL;
-  std::map<CameraID, Camera *>::iterator camera_iter =
-    reconstruction->cameras().begin();
-  for (; camera_iter != reconstruction->cameras().end(); ++camera_iter) {
-    pcamera = dynamic_cast<PinholeCamera *>(camera_iter->second);
+  for (int c = 0; c < reconstruction->GetNumberCameras(); ++c) {
+    pcamera = reconstruction->pinhole_camera(c);
     if (pcamera) {
       image_width = pcamera->image_width();
       image_height = pcamera->image_height();
@@ -184,9 +183,8 @@ bool UpgradeToMetric(const Matches &matches,
     return false;
   }
   Mat34 P;
-  camera_iter = reconstruction->cameras().begin();
-  for (; camera_iter != reconstruction->cameras().end(); ++camera_iter) {
-    pcamera = dynamic_cast<PinholeCamera *>(camera_iter->second);
+  for (int c = 0; c < reconstruction->GetNumberCameras(); ++c) {
+    pcamera = reconstruction->pinhole_camera(c);
     if (pcamera) {
       P = pcamera->projection_matrix() * H;
       pcamera->set_projection_matrix(P);
@@ -199,10 +197,8 @@ bool UpgradeToMetric(const Matches &matches,
   }
   Mat4 H_inverse = H.inverse();
   PointStructure * pstructure = NULL;
-  std::map<StructureID, Structure *>::iterator stucture_iter =
-    reconstruction->structures().begin();
-  for (; stucture_iter != reconstruction->structures().end(); ++stucture_iter) {
-    pstructure = dynamic_cast<PointStructure *>(stucture_iter->second);
+  for (int s = 0; s < reconstruction->GetNumberStructures(); ++s) {
+    pstructure = reconstruction->point_structure(s);
     if (pstructure) {
       pstructure->set_coords(H_inverse * pstructure->coords());
     }
@@ -21,10 +21,12 @@
 #ifndef LIBMV_RECONSTRUCTION_RECONSTRUCTION_H_
 #define LIBMV_RECONSTRUCTION_RECONSTRUCTION_H_
 
+#include <algorithm>
 #include <cstdio>
 #include <list>
 #include <map>
 
+#include "libmv/base/vector.h"
 #include "libmv/camera/pinhole_camera.h"
 #include "libmv/correspondence/matches.h"
 #include "libmv/numeric/numeric.h"
@@ -93,7 +95,28 @@ typedef Matches::TrackID StructureID;
 //   MergeReconstructions(Matches, Reconstruction &, Reconstruction &, Matches *, Reconstruction *);
 //   BundleAdjust(Matches, Reconstruction *);
 //
+// Type tags of the cameras and structures of a reconstruction.  The tag is
+// computed once when an element is inserted so that the passes over the
+// reconstruction (bundle adjustment, export, ...) do not need a dynamic_cast
+// per element.
+enum CameraType {
+  OTHER_CAMERA,
+  PINHOLE_CAMERA
+};
+
+enum StructureType {
+  OTHER_STRUCTURE,
+  POINT_STRUCTURE
+};
+
 // The reconstruction takes ownership of camera and structure.
+//
+// Cameras and structures are stored in dense arrays, in no particular order,
+// and addressed either by ID or by index in [0, GetNumberCameras()) (resp.
+// [0, GetNumberStructures())).  The ID to index tables make the ID queries
+// O(1); removing an element moves the last element into its slot, so indices
+// are only stable as long as nothing is removed.  Use CameraIndicesByID() and
+// StructureIndicesByID() where the output must be in ID order.
 class Reconstruction {
  public:
    
@@ -101,102 +124,215 @@ class Reconstruction {
   ~Reconstruction() {}
 
   void InsertCamera(CameraID id, Camera *camera) {
-    std::map<CameraID, Camera *>::iterator it = cameras_.find(id);
-    if (it != cameras_.end()) {
-      delete it->second;
-      it->second = camera;
+    int index = CameraIndex(id);
+    if (index >= 0) {
+      delete cameras_[index];
+      cameras_[index] = camera;
+      camera_types_[index] = TypeOf(camera);
     } else {
-      cameras_[id] = camera;
+      SetIndex(id, cameras_.size(), &camera_indices_);
+      camera_ids_.push_back(id);
+      cameras_.push_back(camera);
+      camera_types_.push_back(TypeOf(camera));
     }
   }
   
   void InsertTrack(StructureID id, Structure *structure) {
-    std::map<StructureID, Structure *>::iterator it = structures_.find(id);
-    if (it != structures_.end()) {
-      delete it->second;
-      it->second = structure; 
+    int index = StructureIndex(id);
+    if (index >= 0) {
+      delete structures_[index];
+      structures_[index] = structure;
+      structure_types_[index] = TypeOf(structure);
     } else {
-      structures_[id] = structure;
+      SetIndex(id, structures_.size(), &structure_indices_);
+      structure_ids_.push_back(id);
+      structures_.push_back(structure);
+      structure_types_.push_back(TypeOf(structure));
     }
   }
   
   void RemoveCamera(CameraID id) {
-    std::map<CameraID, Camera *>::iterator it = cameras_.find(id);
-    if (it != cameras_.end()) {
-      delete it->second; 
-      cameras_.erase(it);
+    int index = CameraIndex(id);
+    if (index >= 0) {
+      delete cameras_[index];
+      int last = cameras_.size() - 1;
+      camera_ids_[index]   = camera_ids_[last];
+      cameras_[index]      = cameras_[last];
+      camera_types_[index] = camera_types_[last];
+      camera_indices_[camera_ids_[index]] = index;
+      camera_indices_[id] = -1;
+      camera_ids_.pop_back();
+      cameras_.pop_back();
+      camera_types_.pop_back();
     }
   }
   
   void RemoveTrack(StructureID id) {
-    std::map<StructureID, Structure *>::iterator it = structures_.find(id);
-    if (it != structures_.end()) {
-      delete it->second; 
-      structures_.erase(it);
+    int index = StructureIndex(id);
+    if (index >= 0) {
+      delete structures_[index];
+      int last = structures_.size() - 1;
+      structure_ids_[index]   = structure_ids_[last];
+      structures_[index]      = structures_[last];
+      structure_types_[index] = structure_types_[last];
+      structure_indices_[structure_ids_[index]] = index;
+      structure_indices_[id] = -1;
+      structure_ids_.pop_back();
+      structures_.pop_back();
+      structure_types_.pop_back();
     }
   }
   
   bool ImageHasCamera(CameraID id) const {
-    std::map<CameraID, Camera *>::const_iterator it = cameras_.find(id);
-    return it != cameras_.end();
+    return CameraIndex(id) >= 0;
   }
   
   bool TrackHasStructure(StructureID id) const {
-    std::map<StructureID, Structure *>::const_iterator it =
-      structures_.find(id);
-    return it != structures_.end();
+    return StructureIndex(id) >= 0;
   }
   
   Camera * GetCamera(CameraID id) const {
-    std::map<CameraID, Camera *>::const_iterator it = cameras_.find(id);
-    if (it != cameras_.end()) {
-      return it->second;
-    }
-    return NULL;
+    int index = CameraIndex(id);
+    return index >= 0 ? cameras_[index] : NULL;
   }
   
   Structure * GetStructure(StructureID id) const {
-    std::map<StructureID, Structure *>::const_iterator it =
-      structures_.find(id);
-    if (it != structures_.end()) {
-      return it->second;
-    }
-    return NULL;
+    int index = StructureIndex(id);
+    return index >= 0 ? structures_[index] : NULL;
+  }
+
+  // Returns the camera as a pinhole camera, or NULL if there is no such
+  // camera or if it is not a pinhole camera.
+  PinholeCamera * GetPinholeCamera(CameraID id) const {
+    int index = CameraIndex(id);
+    return index >= 0 ? pinhole_camera(index) : NULL;
+  }
+
+  // Returns the structure as a point structure, or NULL if there is no such
+  // structure or if it is not a point.
+  PointStructure * GetPointStructure(StructureID id) const {
+    int index = StructureIndex(id);
+    return index >= 0 ? point_structure(index) : NULL;
   }
   
   void ClearCamerasMap() {
-    std::map<CameraID, Camera *>::iterator it = cameras_.begin();
-    for (; it != cameras_.end(); ++it) {
-      delete it->second;
+    for (int i = 0; i < cameras_.size(); ++i) {
+      delete cameras_[i];
     }
+    camera_ids_.clear();
     cameras_.clear();
+    camera_types_.clear();
+    camera_indices_.clear();
   }
   void ClearStructuresMap() {
-    std::map<StructureID, Structure *>::iterator it = structures_.begin();
-    for (; it != structures_.end(); ++it) {
-      delete it->second;
+    for (int i = 0; i < structures_.size(); ++i) {
+      delete structures_[i];
     }
+    structure_ids_.clear();
     structures_.clear();
+    structure_types_.clear();
+    structure_indices_.clear();
   }
   
   size_t GetNumberCameras() const    { return cameras_.size(); }
   size_t GetNumberStructures() const { return structures_.size(); }
 
-  std::map<CameraID, Camera *>       & cameras()  { return cameras_; }
-  std::map<StructureID, Structure *> & structures() { return structures_; }
-  Matches                            & matches() { return matches_; }
+  // Index of the camera (resp. structure) with the given ID, or -1.
+  int CameraIndex(CameraID id) const {
+    return id >= 0 && id < camera_indices_.size() ? camera_indices_[id] : -1;
+  }
+  int StructureIndex(StructureID id) const {
+    return id >= 0 && id < structure_indices_.size() ?
+        structure_indices_[id] : -1;
+  }
+
+  // Accessors by index, for linear scans.
+  CameraID        camera_id(int index) const   { return camera_ids_[index]; }
+  Camera *        camera(int index) const      { return cameras_[index]; }
+  CameraType      camera_type(int index) const { return camera_types_[index]; }
+  PinholeCamera * pinhole_camera(int index) const {
+    return camera_types_[index] == PINHOLE_CAMERA ?
+        static_cast<PinholeCamera *>(cameras_[index]) : NULL;
+  }
+  StructureID     structure_id(int index) const {
+    return structure_ids_[index]; }
+  Structure *     structure(int index) const   { return structures_[index]; }
+  StructureType   structure_type(int index) const {
+    return structure_types_[index]; }
+  PointStructure * point_structure(int index) const {
+    return structure_types_[index] == POINT_STRUCTURE ?
+        static_cast<PointStructure *>(structures_[index]) : NULL;
+  }
 
-  const std::map<CameraID, Camera *>        & cameras() const {
-    return cameras_; }
-  const std::map<StructureID, Structure *>  & structures() const  {
-    return structures_; }
-  const Matches                             & matches() const {
-    return matches_; }
+  // Indices of the cameras (resp. structures) sorted by increasing ID, the
+  // iteration order of cameras() and structures().  Linear in the largest ID.
+  void CameraIndicesByID(vector<int> *indices) const {
+    IndicesByID(camera_indices_, indices);
+  }
+  void StructureIndicesByID(vector<int> *indices) const {
+    IndicesByID(structure_indices_, indices);
+  }
+
+  // Map views of the cameras and structures.  They are built on each call;
+  // prefer the accessors by index.
+  std::map<CameraID, Camera *> cameras() const {
+    std::map<CameraID, Camera *> cameras;
+    for (int i = 0; i < cameras_.size(); ++i) {
+      cameras[camera_ids_[i]] = cameras_[i];
+    }
+    return cameras;
+  }
+  std::map<StructureID, Structure *> structures() const {
+    std::map<StructureID, Structure *> structures;
+    for (int i = 0; i < structures_.size(); ++i) {
+      structures[structure_ids_[i]] = structures_[i];
+    }
+    return structures;
+  }
+
+  Matches                            & matches() { return matches_; }
+  const Matches                      & matches() const { return matches_; }
   
  private:
-  std::map<CameraID, Camera *>        cameras_;
-  std::map<StructureID, Structure *>  structures_;
-  Matches                             matches_;
+  static CameraType TypeOf(Camera *camera) {
+    return dynamic_cast<PinholeCamera *>(camera) ? PINHOLE_CAMERA :
+                                                    OTHER_CAMERA;
+  }
+  static StructureType TypeOf(Structure *structure) {
+    return dynamic_cast<PointStructure *>(structure) ? POINT_STRUCTURE :
+                                                        OTHER_STRUCTURE;
+  }
+  static void SetIndex(int id, int index, vector<int> *indices) {
+    CHECK_GE(id, 0);
+    if (id >= indices->size()) {
+      int old_size = indices->size();
+      indices->resize(std::max(id + 1, 2 * old_size));
+      for (int i = old_size; i < indices->size(); ++i) {
+        (*indices)[i] = -1;
+      }
+    }
+    (*indices)[id] = index;
+  }
+
+  static void IndicesByID(const vector<int> &id_to_index,
+                          vector<int> *indices) {
+    indices->clear();
+    for (int id = 0; id < id_to_index.size(); ++id) {
+      if (id_to_index[id] >= 0) {
+        indices->push_back(id_to_index[id]);
+      }
+    }
+  }
+
+  vector<CameraID>      camera_ids_;
+  vector<Camera *>      cameras_;
+  vector<CameraType>    camera_types_;
+  vector<int>           camera_indices_;
+  vector<StructureID>   structure_ids_;
+  vector<Structure *>   structures_;
+  vector<StructureType> structure_types_;
+  vector<int>           structure_indices_;
+  Matches               matches_;
 };
 
 }  // namespace libmv
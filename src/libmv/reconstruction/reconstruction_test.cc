@@ -0,0 +1,122 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/camera/pinhole_camera.h"
+#include "libmv/multiview/structure.h"
+#include "libmv/reconstruction/reconstruction.h"
+#include "testing/testing.h"
+
+namespace {
+using namespace libmv;
+
+// A camera which is not a pinhole camera.
+class RayCamera : public Camera {
+ public:
+  virtual Vec3 Ray(const Vec2f &pixel) { return Vec3(pixel.x(), pixel.y(), 1); }
+};
+
+TEST(Reconstruction, InsertAndRemoveKeepIndicesConsistent) {
+  Reconstruction reconstruction;
+  for (int i = 0; i < 5; ++i) {
+    reconstruction.InsertTrack(10 * i, new PointStructure(Vec3(i, 0, 0)));
+  }
+  EXPECT_EQ(5, reconstruction.GetNumberStructures());
+  EXPECT_FALSE(reconstruction.TrackHasStructure(5));
+  EXPECT_FALSE(reconstruction.TrackHasStructure(1000));
+  EXPECT_FALSE(reconstruction.TrackHasStructure(-1));
+
+  reconstruction.RemoveTrack(10);
+  reconstruction.RemoveTrack(7);  // Not in the reconstruction.
+  EXPECT_EQ(4, reconstruction.GetNumberStructures());
+  EXPECT_FALSE(reconstruction.TrackHasStructure(10));
+  for (int i = 0; i < 5; ++i) {
+    if (i == 1) {
+      continue;
+    }
+    int index = reconstruction.StructureIndex(10 * i);
+    ASSERT_GE(index, 0);
+    EXPECT_EQ(10 * i, reconstruction.structure_id(index));
+    PointStructure *point = reconstruction.GetPointStructure(10 * i);
+    ASSERT_TRUE(point != NULL);
+    EXPECT_EQ(point, reconstruction.point_structure(index));
+    EXPECT_EQ(i, point->coords_affine()(0));
+  }
+
+  // Replacing a structure keeps its index.
+  int index = reconstruction.StructureIndex(30);
+  reconstruction.InsertTrack(30, new PointStructure(Vec3(7, 0, 0)));
+  EXPECT_EQ(index, reconstruction.StructureIndex(30));
+  EXPECT_EQ(7, reconstruction.point_structure(index)->coords_affine()(0));
+
+  std::map<StructureID, Structure *> structures = reconstruction.structures();
+  EXPECT_EQ(4, structures.size());
+  EXPECT_EQ(reconstruction.GetStructure(40), structures[40]);
+  reconstruction.ClearStructuresMap();
+  EXPECT_EQ(0, reconstruction.GetNumberStructures());
+  EXPECT_FALSE(reconstruction.TrackHasStructure(0));
+}
+
+TEST(Reconstruction, CameraTypeTags) {
+  Reconstruction reconstruction;
+  reconstruction.InsertCamera(0, new PinholeCamera);
+  reconstruction.InsertCamera(2, new RayCamera);
+  EXPECT_TRUE(reconstruction.ImageHasCamera(2));
+  EXPECT_FALSE(reconstruction.ImageHasCamera(1));
+
+  int pinhole = reconstruction.CameraIndex(0);
+  int ray = reconstruction.CameraIndex(2);
+  EXPECT_EQ(PINHOLE_CAMERA, reconstruction.camera_type(pinhole));
+  EXPECT_EQ(OTHER_CAMERA, reconstruction.camera_type(ray));
+  EXPECT_TRUE(reconstruction.pinhole_camera(pinhole) != NULL);
+  EXPECT_TRUE(reconstruction.pinhole_camera(ray) == NULL);
+  EXPECT_TRUE(reconstruction.GetPinholeCamera(2) == NULL);
+  EXPECT_TRUE(reconstruction.GetCamera(2) != NULL);
+
+  // Replacing a camera updates its tag.
+  reconstruction.InsertCamera(2, new PinholeCamera);
+  EXPECT_EQ(PINHOLE_CAMERA, reconstruction.camera_type(ray));
+
+  reconstruction.RemoveCamera(0);
+  EXPECT_EQ(1, reconstruction.GetNumberCameras());
+  EXPECT_EQ(0, reconstruction.CameraIndex(2));
+  EXPECT_EQ(2, reconstruction.camera_id(0));
+  reconstruction.ClearCamerasMap();
+}
+
+TEST(Reconstruction, IndicesByID) {
+  Reconstruction reconstruction;
+  const int kIDs[5] = {7, 2, 9, 0, 4};
+  for (int i = 0; i < 5; ++i) {
+    reconstruction.InsertTrack(kIDs[i], new PointStructure(Vec3(i, 0, 0)));
+  }
+  // The removal moves the last structure (ID 4) into the slot of ID 2.
+  reconstruction.RemoveTrack(2);
+
+  vector<int> indices;
+  reconstruction.StructureIndicesByID(&indices);
+  const int kSortedIDs[4] = {0, 4, 7, 9};
+  ASSERT_EQ(4, indices.size());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(kSortedIDs[i], reconstruction.structure_id(indices[i]));
+  }
+  reconstruction.ClearStructuresMap();
+}
+
+}  // namespace
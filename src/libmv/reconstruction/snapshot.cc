@@ -0,0 +1,321 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/logging/logging.h"
+#include "libmv/reconstruction/export_blender.h"
+#include "libmv/reconstruction/snapshot.h"
+
+namespace libmv {
+
+namespace {
+
+const char kSnapshotMagic[8] = {'L', 'M', 'V', 'S', 'N', 'A', 'P', '1'};
+const int kSnapshotByteOrder = 0x01020304;
+const int kSnapshotVersion = 1;
+
+template<typename T>
+void Append(const T &record, std::string *buffer) {
+  buffer->append(reinterpret_cast<const char *>(&record), sizeof(T));
+}
+
+void CopyMatrix(const Mat3 &M, double *out) {
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      out[3 * i + j] = M(i, j);
+    }
+  }
+}
+
+Mat3 ToMatrix(const double *in) {
+  Mat3 M;
+  M << in[0], in[1], in[2],
+       in[3], in[4], in[5],
+       in[6], in[7], in[8];
+  return M;
+}
+
+// Exports a snapshot as a Blender script, from the writer thread.
+class BlenderDumpJob : public WriteJob {
+ public:
+  BlenderDumpJob(const std::string &filename, std::string *buffer)
+      : filename_(filename) {
+    buffer_.swap(*buffer);
+  }
+  virtual bool Run() {
+    ReconstructionSnapshot snapshot;
+    if (!snapshot.OpenBuffer(buffer_)) {
+      return false;
+    }
+    Reconstruction reconstruction;
+    snapshot.ToReconstruction(&reconstruction);
+    ExportToBlenderScript(reconstruction, filename_);
+    reconstruction.ClearCamerasMap();
+    reconstruction.ClearStructuresMap();
+    return true;
+  }
+
+ private:
+  std::string filename_;
+  std::string buffer_;
+};
+
+}  // namespace
+
+void SerializeReconstructionSnapshot(const Reconstruction &reconstruction,
+                                     const Matches &matches,
+                                     std::string *buffer) {
+  vector<SnapshotCamera> cameras;
+  for (int c = 0; c < reconstruction.GetNumberCameras(); ++c) {
+    PinholeCamera *camera = reconstruction.pinhole_camera(c);
+    if (!camera) {
+      continue;
+    }
+    SnapshotCamera record;
+    memset(&record, 0, sizeof(record));
+    CopyMatrix(camera->intrinsic_matrix(), record.K);
+    CopyMatrix(camera->orientation_matrix(), record.R);
+    for (int i = 0; i < 3; ++i) {
+      record.t[i] = camera->position()(i);
+    }
+    record.image_id = reconstruction.camera_id(c);
+    record.width = camera->image_width();
+    record.height = camera->image_height();
+    cameras.push_back(record);
+  }
+  vector<SnapshotPoint> points;
+  vector<SnapshotLink> links;
+  for (int s = 0; s < reconstruction.GetNumberStructures(); ++s) {
+    PointStructure *point = reconstruction.point_structure(s);
+    if (!point) {
+      continue;
+    }
+    SnapshotPoint record;
+    memset(&record, 0, sizeof(record));
+    for (int i = 0; i < 4; ++i) {
+      record.X[i] = point->coords()(i);
+    }
+    record.track_id = reconstruction.structure_id(s);
+    for (Matches::Points r = matches.InTrack<PointFeature>(record.track_id);
+         r; ++r) {
+      if (!reconstruction.ImageHasCamera(r.image())) {
+        continue;
+      }
+      SnapshotLink link;
+      link.image_id = r.image();
+      link.track_id = r.track();
+      link.x = r.feature()->x();
+      link.y = r.feature()->y();
+      links.push_back(link);
+      record.num_links++;
+    }
+    points.push_back(record);
+  }
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header.byte_order = kSnapshotByteOrder;
+  header.version = kSnapshotVersion;
+  header.num_cameras = cameras.size();
+  header.num_points = points.size();
+  header.num_links = links.size();
+
+  buffer->clear();
+  buffer->reserve(sizeof(header) +
+                  cameras.size() * sizeof(SnapshotCamera) +
+                  points.size() * sizeof(SnapshotPoint) +
+                  links.size() * sizeof(SnapshotLink));
+  Append(header, buffer);
+  for (int i = 0; i < cameras.size(); ++i) {
+    Append(cameras[i], buffer);
+  }
+  for (int i = 0; i < points.size(); ++i) {
+    Append(points[i], buffer);
+  }
+  for (int i = 0; i < links.size(); ++i) {
+    Append(links[i], buffer);
+  }
+}
+
+bool WriteReconstructionSnapshot(const Reconstruction &reconstruction,
+                                 const Matches &matches,
+                                 const std::string &filename) {
+  std::string buffer;
+  SerializeReconstructionSnapshot(reconstruction, matches, &buffer);
+  return BufferWriteJob(filename, buffer).Run();
+}
+
+void WriteReconstructionSnapshotAsync(const Reconstruction &reconstruction,
+                                      const Matches &matches,
+                                      const std::string &filename,
+                                      BackgroundWriter *writer) {
+  std::string buffer;
+  SerializeReconstructionSnapshot(reconstruction, matches, &buffer);
+  writer->Queue(new BufferWriteJob(filename, buffer));
+}
+
+ReconstructionSnapshot::ReconstructionSnapshot()
+    : header_(NULL), cameras_(NULL), points_(NULL), links_(NULL),
+      mapped_data_(NULL), mapped_size_(0) {}
+
+ReconstructionSnapshot::~ReconstructionSnapshot() {
+  Close();
+}
+
+bool ReconstructionSnapshot::Open(const std::string &filename) {
+  Close();
+#ifndef _WIN32
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  mapped_data_ = data;
+  mapped_size_ = file_stat.st_size;
+  if (!SetData(static_cast<const char *>(data), mapped_size_)) {
+    Close();
+    return false;
+  }
+  return true;
+#else
+  FILE *file = fopen(filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  char chunk[1 << 16];
+  size_t size;
+  while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    read_data_.append(chunk, size);
+  }
+  fclose(file);
+  if (!SetData(read_data_.data(), read_data_.size())) {
+    Close();
+    return false;
+  }
+  return true;
+#endif
+}
+
+bool ReconstructionSnapshot::OpenBuffer(const std::string &buffer) {
+  Close();
+  return SetData(buffer.data(), buffer.size());
+}
+
+void ReconstructionSnapshot::Close() {
+#ifndef _WIN32
+  if (mapped_data_) {
+    munmap(mapped_data_, mapped_size_);
+  }
+#endif
+  mapped_data_ = NULL;
+  mapped_size_ = 0;
+  read_data_.clear();
+  header_ = NULL;
+  cameras_ = NULL;
+  points_ = NULL;
+  links_ = NULL;
+}
+
+bool ReconstructionSnapshot::SetData(const char *data, size_t size) {
+  if (size < sizeof(SnapshotHeader)) {
+    return false;
+  }
+  const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(data);
+  if (memcmp(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+    return false;
+  }
+  if (header->byte_order != kSnapshotByteOrder ||
+      header->version != kSnapshotVersion) {
+    LOG(ERROR) << "Unsupported snapshot version or byte order.";
+    return false;
+  }
+  if (header->num_cameras < 0 || header->num_points < 0 ||
+      header->num_links < 0 ||
+      size != sizeof(SnapshotHeader) +
+              header->num_cameras * sizeof(SnapshotCamera) +
+              header->num_points * sizeof(SnapshotPoint) +
+              header->num_links * sizeof(SnapshotLink)) {
+    LOG(ERROR) << "Truncated snapshot.";
+    return false;
+  }
+  header_ = header;
+  data += sizeof(SnapshotHeader);
+  cameras_ = reinterpret_cast<const SnapshotCamera *>(data);
+  data += header->num_cameras * sizeof(SnapshotCamera);
+  points_ = reinterpret_cast<const SnapshotPoint *>(data);
+  data += header->num_points * sizeof(SnapshotPoint);
+  links_ = reinterpret_cast<const SnapshotLink *>(data);
+  return true;
+}
+
+void ReconstructionSnapshot::ToReconstruction(
+    Reconstruction *reconstruction) const {
+  for (int i = 0; i < num_cameras(); ++i) {
+    const SnapshotCamera &record = cameras_[i];
+    Vec3 t(record.t[0], record.t[1], record.t[2]);
+    PinholeCamera *camera = new PinholeCamera(ToMatrix(record.K),
+                                              ToMatrix(record.R), t);
+    Vec2u image_size;
+    image_size << record.width, record.height;
+    camera->set_image_size(image_size);
+    reconstruction->InsertCamera(record.image_id, camera);
+  }
+  for (int i = 0; i < num_points(); ++i) {
+    const SnapshotPoint &record = points_[i];
+    Vec4 X(record.X[0], record.X[1], record.X[2], record.X[3]);
+    reconstruction->InsertTrack(record.track_id, new PointStructure(X));
+  }
+}
+
+void ReconstructionDumper::Dump(const Reconstruction &reconstruction,
+                                const Matches &matches,
+                                const std::string &name) {
+  std::string filename = prefix_ + name;
+  std::string buffer;
+  SerializeReconstructionSnapshot(reconstruction, matches, &buffer);
+  if (filename.size() >= 3 &&
+      filename.compare(filename.size() - 3, 3, ".py") == 0) {
+    writer_.Queue(new BlenderDumpJob(filename, &buffer));
+  } else {
+    writer_.Queue(new BufferWriteJob(filename, buffer));
+  }
+}
+
+}  // namespace libmv
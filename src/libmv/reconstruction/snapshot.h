@@ -0,0 +1,150 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_RECONSTRUCTION_SNAPSHOT_H_
+#define LIBMV_RECONSTRUCTION_SNAPSHOT_H_
+
+#include <string>
+
+#include "libmv/reconstruction/background_writer.h"
+#include "libmv/reconstruction/reconstruction.h"
+
+namespace libmv {
+
+// A reconstruction snapshot is a compact binary file made of a header and
+// three arrays of fixed size records: the pinhole cameras, the point
+// structures and the links between them (the features of the reconstructed
+// tracks in the localized images, grouped by point).  The records are written
+// in the byte order of the host, so that a snapshot can be memory mapped and
+// used in place.
+struct SnapshotHeader {
+  char magic[8];       // "LMVSNAP1"
+  int byte_order;      // kSnapshotByteOrder, as written by the host.
+  int version;
+  int num_cameras;
+  int num_points;
+  int num_links;
+  int reserved;
+};
+
+struct SnapshotCamera {
+  double K[9];         // Row major.
+  double R[9];         // Row major.
+  double t[3];
+  int image_id;
+  int width;
+  int height;
+  int reserved;
+};
+
+struct SnapshotPoint {
+  double X[4];         // Homogeneous coordinates.
+  int track_id;
+  int num_links;       // Number of links of the point.
+};
+
+struct SnapshotLink {
+  int image_id;
+  int track_id;
+  float x, y;
+};
+
+// Serializes the pinhole cameras and point structures of the reconstruction,
+// and the features of matches linking them, in a snapshot.
+void SerializeReconstructionSnapshot(const Reconstruction &reconstruction,
+                                     const Matches &matches,
+                                     std::string *buffer);
+
+// Writes a snapshot of the reconstruction in a file.
+// Returns false if the file cannot be written.
+bool WriteReconstructionSnapshot(const Reconstruction &reconstruction,
+                                 const Matches &matches,
+                                 const std::string &filename);
+
+// Queues the write of a snapshot of the reconstruction on writer.  The
+// snapshot is serialized before returning, the disk access is done in the
+// background.
+void WriteReconstructionSnapshotAsync(const Reconstruction &reconstruction,
+                                      const Matches &matches,
+                                      const std::string &filename,
+                                      BackgroundWriter *writer);
+
+// A read only view of a snapshot, either memory mapped from a file or on a
+// buffer.
+class ReconstructionSnapshot {
+ public:
+  ReconstructionSnapshot();
+  ~ReconstructionSnapshot();
+
+  // Maps the snapshot file.  Returns false if the file cannot be read or is
+  // not a valid snapshot.
+  bool Open(const std::string &filename);
+
+  // Uses a serialized snapshot; the buffer must outlive this view.
+  bool OpenBuffer(const std::string &buffer);
+
+  void Close();
+
+  int num_cameras() const { return header_ ? header_->num_cameras : 0; }
+  int num_points() const  { return header_ ? header_->num_points : 0; }
+  int num_links() const   { return header_ ? header_->num_links : 0; }
+  const SnapshotCamera *cameras() const { return cameras_; }
+  const SnapshotPoint *points() const   { return points_; }
+  const SnapshotLink *links() const     { return links_; }
+
+  // Inserts the cameras and point structures in reconstruction.
+  void ToReconstruction(Reconstruction *reconstruction) const;
+
+ private:
+  bool SetData(const char *data, size_t size);
+
+  const SnapshotHeader *header_;
+  const SnapshotCamera *cameras_;
+  const SnapshotPoint *points_;
+  const SnapshotLink *links_;
+  void *mapped_data_;
+  size_t mapped_size_;
+  std::string read_data_;
+};
+
+// Dumps intermediate reconstructions to files with a background writer, to
+// debug the reconstruction pipeline.  The format is given by the extension
+// of the name: ".py" for a Blender script (see ExportToBlenderScript), a
+// snapshot otherwise.  Files are named prefix + name.
+class ReconstructionDumper {
+ public:
+  explicit ReconstructionDumper(const std::string &prefix = "")
+      : prefix_(prefix) {}
+
+  void Dump(const Reconstruction &reconstruction,
+            const Matches &matches,
+            const std::string &name);
+
+  // Waits for all the dumps to be written.  Returns the number of failures.
+  int Wait() { return writer_.Wait(); }
+
+ private:
+  std::string prefix_;
+  BackgroundWriter writer_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_RECONSTRUCTION_SNAPSHOT_H_
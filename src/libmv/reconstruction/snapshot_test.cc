@@ -0,0 +1,168 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cstdio>
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/reconstruction/snapshot.h"
+#include "testing/testing.h"
+
+namespace {
+using namespace libmv;
+
+// Two cameras observing three points; the track 3 is also seen in the image
+// 5, which has no camera.
+struct TestScene {
+  TestScene() {
+    Mat3 K;
+    K << 500, 0, 320,
+         0, 500, 240,
+         0, 0, 1;
+    Mat3 R;
+    R = RotationAroundY(0.1);
+    Vec2u image_size;
+    image_size << 640, 480;
+    for (int c = 0; c < 2; ++c) {
+      PinholeCamera *camera = new PinholeCamera(K, R, Vec3(c, 0.5, -1));
+      camera->set_image_size(image_size);
+      reconstruction.InsertCamera(c, camera);
+    }
+    for (int t = 1; t <= 3; ++t) {
+      reconstruction.InsertTrack(t, new PointStructure(Vec3(t, -t, 5)));
+      for (int c = 0; c < 2; ++c) {
+        features.push_back(new PointFeature(10 * t + c, 20 * t));
+        matches.Insert(c, t, features.back());
+      }
+    }
+    features.push_back(new PointFeature(1, 2));
+    matches.Insert(5, 3, features.back());
+  }
+  ~TestScene() {
+    reconstruction.ClearCamerasMap();
+    reconstruction.ClearStructuresMap();
+    for (int i = 0; i < features.size(); ++i) {
+      delete features[i];
+    }
+  }
+
+  Reconstruction reconstruction;
+  Matches matches;
+  vector<PointFeature *> features;
+};
+
+TEST(Snapshot, FileRoundTrip) {
+  TestScene scene;
+  const char *filename = "snapshot_test.snap";
+  ASSERT_TRUE(WriteReconstructionSnapshot(scene.reconstruction, scene.matches,
+                                          filename));
+  ReconstructionSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(filename));
+  EXPECT_EQ(2, snapshot.num_cameras());
+  EXPECT_EQ(3, snapshot.num_points());
+  EXPECT_EQ(6, snapshot.num_links());
+
+  // The links are grouped by point.
+  int link = 0;
+  for (int i = 0; i < snapshot.num_points(); ++i) {
+    const SnapshotPoint &point = snapshot.points()[i];
+    EXPECT_EQ(2, point.num_links);
+    for (int j = 0; j < point.num_links; ++j, ++link) {
+      const SnapshotLink &l = snapshot.links()[link];
+      EXPECT_EQ(point.track_id, l.track_id);
+      EXPECT_EQ(10 * l.track_id + l.image_id, l.x);
+      EXPECT_EQ(20 * l.track_id, l.y);
+    }
+  }
+
+  Reconstruction loaded;
+  snapshot.ToReconstruction(&loaded);
+  snapshot.Close();
+  remove(filename);
+  ASSERT_EQ(2, loaded.GetNumberCameras());
+  ASSERT_EQ(3, loaded.GetNumberStructures());
+  for (int c = 0; c < 2; ++c) {
+    PinholeCamera *expected = scene.reconstruction.GetPinholeCamera(c);
+    PinholeCamera *camera = loaded.GetPinholeCamera(c);
+    ASSERT_TRUE(camera != NULL);
+    EXPECT_MATRIX_NEAR(expected->projection_matrix(),
+                       camera->projection_matrix(), 1e-12);
+    EXPECT_EQ(640, camera->image_width());
+    EXPECT_EQ(480, camera->image_height());
+  }
+  for (int t = 1; t <= 3; ++t) {
+    EXPECT_MATRIX_NEAR(scene.reconstruction.GetPointStructure(t)->coords(),
+                       loaded.GetPointStructure(t)->coords(), 1e-12);
+  }
+  loaded.ClearCamerasMap();
+  loaded.ClearStructuresMap();
+}
+
+TEST(Snapshot, RejectsInvalidData) {
+  TestScene scene;
+  std::string buffer;
+  SerializeReconstructionSnapshot(scene.reconstruction, scene.matches,
+                                  &buffer);
+  ReconstructionSnapshot snapshot;
+  EXPECT_TRUE(snapshot.OpenBuffer(buffer));
+  std::string truncated = buffer.substr(0, buffer.size() - 1);
+  EXPECT_FALSE(snapshot.OpenBuffer(truncated));
+  EXPECT_EQ(0, snapshot.num_points());
+  std::string corrupted = buffer;
+  corrupted[0] = 'X';
+  EXPECT_FALSE(snapshot.OpenBuffer(corrupted));
+  EXPECT_FALSE(snapshot.Open("snapshot_test_missing.snap"));
+}
+
+TEST(Snapshot, AsyncWritesSeeTheStateWhenQueued) {
+  TestScene scene;
+  const char *filename = "snapshot_test_async.snap";
+  BackgroundWriter writer;
+  WriteReconstructionSnapshotAsync(scene.reconstruction, scene.matches,
+                                   filename, &writer);
+  // Changing the reconstruction does not change the queued snapshot.
+  scene.reconstruction.RemoveTrack(2);
+  EXPECT_EQ(0, writer.Wait());
+
+  ReconstructionSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(filename));
+  EXPECT_EQ(3, snapshot.num_points());
+  snapshot.Close();
+  remove(filename);
+}
+
+TEST(Snapshot, DumperWritesBlenderScriptsAndSnapshots) {
+  TestScene scene;
+  ReconstructionDumper dumper("snapshot_test_dump-");
+  dumper.Dump(scene.reconstruction, scene.matches, "a.py");
+  dumper.Dump(scene.reconstruction, scene.matches, "b.snap");
+  EXPECT_EQ(0, dumper.Wait());
+
+  FILE *script = fopen("snapshot_test_dump-a.py", "r");
+  ASSERT_TRUE(script != NULL);
+  fclose(script);
+  remove("snapshot_test_dump-a.py");
+  ReconstructionSnapshot snapshot;
+  EXPECT_TRUE(snapshot.Open("snapshot_test_dump-b.snap"));
+  EXPECT_EQ(2, snapshot.num_cameras());
+  snapshot.Close();
+  remove("snapshot_test_dump-b.snap");
+}
+
+}  // namespace
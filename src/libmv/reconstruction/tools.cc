@@ -53,6 +53,30 @@ void SelectExistingPointStructures(const Matches &matches,
     VectorToMatrix<Vec2, Mat2X>(xs, x_image);
 }
 
+void SelectExistingPointStructures(const FrozenMatches &matches,
+                                   CameraID image_id,
+                                   const Reconstruction &reconstruction,
+                                   vector<StructureID> *structures_ids,
+                                   Mat2X *x_image) {
+  structures_ids->resize(0);
+  const int image_index = matches.ImageIndex(image_id);
+  if (image_index < 0) {
+    if (x_image)
+      x_image->resize(2, 0);
+    return;
+  }
+  vector<int> entries;
+  const FrozenMatches::TrackID *tracks = matches.tracks();
+  for (int i = matches.begin(image_index); i < matches.end(image_index); ++i) {
+    if (reconstruction.TrackHasStructure(tracks[i])) {
+      structures_ids->push_back(tracks[i]);
+      entries.push_back(i);
+    }
+  }
+  if (x_image)
+    matches.Gather(entries, x_image);
+}
+
 // Selects only the NOT already reconstructed tracks observed in the image
 // image_id and returns a vector of StructureID and their feature coordinates
 void SelectNonReconstructedPointStructures(const Matches &matches, 
@@ -89,8 +113,7 @@ void MatrixOfPointStructureCoordinates(
   X_world->resize(4, structures_ids.size());
   PointStructure *point_s = NULL;
   for (size_t s = 0; s < structures_ids.size(); ++s) {
-    point_s = dynamic_cast<PointStructure*>(
-      reconstruction.GetStructure(structures_ids[s]));
+    point_s = reconstruction.GetPointStructure(structures_ids[s]);
     if (point_s) {
       X_world->col(s) << point_s->coords();
     }
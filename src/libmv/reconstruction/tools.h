@@ -21,6 +21,7 @@
 #ifndef LIBMV_RECONSTRUCTION_TOOLS_H_
 #define LIBMV_RECONSTRUCTION_TOOLS_H_
 
+#include "libmv/correspondence/frozen_matches.h"
 #include "libmv/reconstruction/reconstruction.h"
 
 namespace libmv {
@@ -47,6 +48,13 @@ void SelectExistingPointStructures(const Matches &matches,
                                    vector<StructureID> *structures_ids,
                                    Mat2X *x_image = NULL);
 
+// Same as above, on a snapshot of the matches.
+void SelectExistingPointStructures(const FrozenMatches &matches,
+                                   CameraID image_id,
+                                   const Reconstruction &reconstruction,
+                                   vector<StructureID> *structures_ids,
+                                   Mat2X *x_image = NULL);
+
 // Selects only the NOT already reconstructed tracks observed in the image
 // image_id and returns a vector of StructureID and their feature coordinates
 void SelectNonReconstructedPointStructures(const Matches &matches, 
@@ -25,8 +25,10 @@
 #define LIBMV_TOOLS_TOOL_H_
 
 #include <cstdio>
+#include <iostream>
 #include <string>
 
+#include "libmv/logging/tracing.h"
 #include "third_party/gflags/gflags.h"
 #include "third_party/glog/src/glog/logging.h"
 
@@ -38,6 +40,26 @@ inline void Init(const char *usage, int *argc, char ***argv) {
   google::ParseCommandLineFlags(argc, argv, true);
 }
 
+// Starts recording the pipeline stages if a trace file is given (--trace).
+inline void StartTracing(const std::string &trace_file) {
+  if (!trace_file.empty()) {
+    tracing::SetEnabled(true);
+  }
+}
+
+// Writes the recorded stages to the trace file, in the Chrome trace format,
+// and prints the time spent per stage.
+inline void FinishTracing(const std::string &trace_file) {
+  if (trace_file.empty()) {
+    return;
+  }
+  tracing::SetEnabled(false);
+  if (!tracing::WriteChromeTrace(trace_file)) {
+    LOG(ERROR) << "Couldn't write the trace to " << trace_file;
+  }
+  tracing::WriteSummary(std::cout);
+}
+
 }  // namespace libmv
 
 #endif  // ifndef LIBMV_TOOLS_TOOL_H_
@@ -48,6 +48,7 @@
 
 #include "libmv/image/image.h"
 #include "libmv/base/vector.h"
+#include "libmv/correspondence/feature_arena.h"
 #include <cmath>
 
 namespace libmv {
@@ -296,6 +297,7 @@ static void
 icvStarDetectorSuppressNonmax( const Image& responses, // image in float
                                const Image1& sizes,    // image in short
                                vector<Feature *> *keypoints, // detected feature
+                               FeatureArena *arena, // storage of the features, or NULL
                                int iBorder, // max number of scale explored
                                int iSuppressNonMaxSize = 5, // x*y*z non max suppression
                                float fResponseThreshold = 30.0f, // blob response filtering
@@ -346,7 +348,7 @@ icvStarDetectorSuppressNonmax( const Image& responses, // image in float
                 if( (featureSize = s_ptr[maxPt.y*sstep + maxPt.x]) >= 4 &&
                     !icvStarDetectorSuppressLines( responses, sizes, maxPt.x, maxPt.y, ilineThresholdProjected, ilineThresholdBinarized ))
                 {
-                  PointFeature *f = new PointFeature(maxPt.x, maxPt.y);
+                  PointFeature *f = NewPointFeature(arena, maxPt.x, maxPt.y);
                   f->scale = featureSize;
                   f->orientation = 0.0;
                   keypoints->push_back(f);
@@ -365,7 +367,7 @@ icvStarDetectorSuppressNonmax( const Image& responses, // image in float
                 if( (featureSize = s_ptr[minPt.y*sstep + minPt.x]) >= 4 &&
                     !icvStarDetectorSuppressLines( responses, sizes, minPt.x, minPt.y, ilineThresholdProjected, ilineThresholdBinarized ))
                 {
-                    PointFeature *f = new PointFeature(minPt.x, minPt.y);
+                    PointFeature *f = NewPointFeature(arena, minPt.x, minPt.y);
                     f->scale = featureSize;
                     f->orientation = 0.0;
                     keypoints->push_back(f);
@@ -31,6 +31,7 @@
  *              Use the same graph traversal as in image_selection.
  */
 #include <algorithm>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -42,10 +43,9 @@
 #include "libmv/image/image.h"
 #include "libmv/image/image_drawing.h"
 #include "libmv/image/image_io.h"
-#include "libmv/image/image_sequence_io.h"
 #include "libmv/image/image_transform_linear.h"
-#include "libmv/image/cached_image_sequence.h"
 #include "libmv/image/sample.h"
+#include "libmv/image/tiled_mosaic.h"
 #include "libmv/multiview/robust_affine.h"
 #include "libmv/multiview/robust_euclidean.h"
 #include "libmv/multiview/robust_homography.h"
@@ -65,6 +65,17 @@ DEFINE_int32 (transformation, SIMILARITY, "Transformation type:\n\t 0: \
 Euclidean\n\t 1:Similarity\n\t 2:Affinity\n\t 3:Homography");
 DEFINE_double(blending_ratio, 0.7, "Blending ratio");
 DEFINE_bool(draw_lines, false, "Draw image bounds");
+DEFINE_int32(tile_size, 256, "Size of the mosaic tiles");
+DEFINE_int32(max_resident_tiles, 1024, "Number of mosaic tiles kept in memory, \
+the others are spilled to disk");
+DEFINE_string(spill_file, "", "File receiving the spilled tiles (a temporary \
+file if empty)");
+DEFINE_int32(overview_factor, 0, "If positive, also writes overviews of the \
+mosaic reduced by this factor, named MOSAIC_IMAGE_overviewN");
+DEFINE_int32(overview_levels, 1, "Number of overviews, each one is half the \
+size of the previous one");
+DEFINE_int32(max_extent, 5000, "Largest mosaic coordinate, in pixels, to \
+protect from degenerate warps");
              
 using namespace libmv;
 
@@ -260,39 +271,46 @@ void ComputeGlobalBoundingBox(const Vec2u &images_size,
         (*bbox)(3) = q(1);
     }
   }
-  // HACK to protect from huge memory allocation
-  (*bbox)(0) = std::max((int)-5e3, (*bbox)(0));
-  (*bbox)(2) = std::max((int)-5e3, (*bbox)(2));
-  (*bbox)(1) = std::min((int) 5e3, (*bbox)(1));
-  (*bbox)(3) = std::min((int) 5e3, (*bbox)(3));
+  // Protect from degenerate warps
+  (*bbox)(0) = std::max(-FLAGS_max_extent, (*bbox)(0));
+  (*bbox)(2) = std::max(-FLAGS_max_extent, (*bbox)(2));
+  (*bbox)(1) = std::min( FLAGS_max_extent, (*bbox)(1));
+  (*bbox)(3) = std::min( FLAGS_max_extent, (*bbox)(3));
 }
 
 /**
  * Builds a mosaic of a list of image files.
  * 
+ * The mosaic is stored by tiles: each image is warped only into the tiles it
+ * touches and the least recently used tiles are spilled to disk, so the size
+ * of the mosaic is not bounded by the memory.
+ *
  * \param image_files The input image files
  * \param Hs The 2D relative warp matrices
  * \param blending_ratio The blending ratio for overlapping zones, 
  *        a typical value is 0.5
  * \param draw_lines If true, the images bounds are drawn
- * \param mosaic The ouput mosaic image
- * 
- * TODO(julien) This rendering doesn't scale well?
+ * \param tile_size The size of the mosaic tiles
+ * \param max_resident_tiles The number of tiles kept in memory
+ * \param spill_file The file receiving the other tiles (a temporary file if
+ *        empty)
+ * \return The mosaic, to be deleted by the caller
  */
-void BuildMosaic(const std::vector<std::string> &image_files,
-                 const vector<Mat3> &Hs,
-                 float blending_ratio,
-                 bool draw_lines,
-                 FloatImage *mosaic) {
-  assert(mosaic != NULL);
+TiledMosaic *BuildMosaic(const std::vector<std::string> &image_files,
+                         const vector<Mat3> &Hs,
+                         float blending_ratio,
+                         bool draw_lines,
+                         int tile_size,
+                         int max_resident_tiles,
+                         const std::string &spill_file) {
   assert(image_files.size() == Hs.size() - 1);
   
   // Get the size of the first image
   Vec2u images_size;
-  ByteImage imageArrayBytes;
-  ReadImage (image_files[0].c_str(), &imageArrayBytes);
-  images_size << imageArrayBytes.Width(), imageArrayBytes.Height();
-  unsigned int depth = imageArrayBytes.Depth();
+  ByteImage image;
+  ReadImage (image_files[0].c_str(), &image);
+  images_size << image.Width(), image.Height();
+  unsigned int depth = image.Depth();
 
   Vec4i bbox;
   VLOG(0) << "Computing global bounding box..." << std::endl;
@@ -306,11 +324,11 @@ void BuildMosaic(const std::vector<std::string> &image_files,
   H.setIdentity(); 
   const unsigned int w = bbox(1) - bbox(0);
   const unsigned int h = bbox(3) - bbox(2);
-  mosaic->Resize(h, w, depth);
+  TiledMosaic *mosaic = new TiledMosaic(w, h, depth, tile_size,
+                                        max_resident_tiles, spill_file);
   VLOG(0) << "Image size: h=" << mosaic->Height() << " "
           << "w="             << mosaic->Width() << " "
           << "d="             << mosaic->Depth() << std::endl;
-  mosaic->Fill(0);
   // Register everyone so that the min (x, y) are (0, 0)
   Mat3 Hreg;
   Hreg << 1, 0, -bbox(0),
@@ -318,31 +336,44 @@ void BuildMosaic(const std::vector<std::string> &image_files,
           0, 0, 1;
   //for (size_t i = 0; i < image_files.size() / 2; ++i)
   //  Hreg = Hreg * Hs[i];
-  float lines_color[3] = {1, 1, 1};
-  FloatImage *image = NULL;
-  ImageCache cache;
-  scoped_ptr<ImageSequence> source(ImageSequenceFromFiles(image_files, &cache));
+  unsigned char lines_color[3] = {255, 255, 255};
   for (size_t i = 0; i < image_files.size(); ++i) {
     if (i > 0)
       H = Hs[i - 1].inverse() * H;
-    image = source->GetFloatImage(i);
-    if (image) {
+    if (ReadImage(image_files[i].c_str(), &image)) {
       if (draw_lines) {
-        DrawLine<FloatImage, float[3]>(0, 0, 0, images_size(1) - 1, 
-                                       lines_color, image);
-        DrawLine<FloatImage, float[3]>(0, 0, images_size(0) - 1, 0, 
-                                       lines_color, image);
-        DrawLine<FloatImage, float[3]>(               0, images_size(1)-1, 
-                                       images_size(0)-1, images_size(1)-1, 
-                                       lines_color, image);
-        DrawLine<FloatImage, float[3]>(images_size(0)-1,                0, 
-                                       images_size(0)-1, images_size(1)-1, 
-                                       lines_color, image); 
+        typedef unsigned char Color[3];
+        DrawLine<ByteImage, Color>(0, 0, 0, images_size(1) - 1, 
+                                   lines_color, &image);
+        DrawLine<ByteImage, Color>(0, 0, images_size(0) - 1, 0, 
+                                   lines_color, &image);
+        DrawLine<ByteImage, Color>(               0, images_size(1)-1, 
+                                   images_size(0)-1, images_size(1)-1, 
+                                   lines_color, &image);
+        DrawLine<ByteImage, Color>(images_size(0)-1,                0, 
+                                   images_size(0)-1, images_size(1)-1, 
+                                   lines_color, &image); 
       }
-      WarpImageBlend(*image, (Hreg * H), mosaic, blending_ratio);
+      mosaic->WarpBlend(image, (Hreg * H), blending_ratio);
     }
-    source->Unpin(i);
   }
+  VLOG(1) << "Tiles in memory: " << mosaic->NumResidentTiles()
+          << ", spilled: " << mosaic->NumSpilledTiles();
+  return mosaic;
+}
+
+/**
+ * Returns the name of the overview level of an output file, e.g.
+ * mosaic_overview1.jpg for mosaic.jpg.
+ */
+std::string OverviewFilename(const std::string &filename, int level) {
+  std::ostringstream name;
+  size_t dot = filename.rfind('.');
+  name << filename.substr(0, dot) << "_overview" << level;
+  if (dot != std::string::npos) {
+    name << filename.substr(dot);
+  }
+  return name.str();
 }
 
 int main(int argc, char **argv) {
@@ -393,18 +424,31 @@ int main(int argc, char **argv) {
   }
   VLOG(0) << "Estimating relative matrices...[DONE]." << std::endl;
 
-  Image mosaic(new FloatImage());
   VLOG(0) << "Building mosaic..." << std::endl;
-  BuildMosaic(files, Hs, 
-              FLAGS_blending_ratio, 
-              FLAGS_draw_lines,
-              mosaic.AsArray3Df());
+  scoped_ptr<TiledMosaic> mosaic(BuildMosaic(files, Hs,
+                                             FLAGS_blending_ratio,
+                                             FLAGS_draw_lines,
+                                             FLAGS_tile_size,
+                                             FLAGS_max_resident_tiles,
+                                             FLAGS_spill_file));
   VLOG(0) << "Building mosaic...[DONE]." << std::endl;
   
   // Write the mosaic
   VLOG(0) << "Saving mosaic image." << std::endl;
-  WriteImage(*mosaic.AsArray3Df(), FLAGS_o.c_str());
+  vector<ByteImage> overviews;
+  bool ok = mosaic->Write(FLAGS_o.c_str(), FLAGS_overview_factor,
+                          FLAGS_overview_levels, &overviews);
+  if (!ok) {
+    LOG(ERROR) << "Cannot write the mosaic to " << FLAGS_o << ".";
+  }
+  for (int i = 0; ok && i < overviews.size(); ++i) {
+    std::string filename = OverviewFilename(FLAGS_o, i + 1);
+    if (!WriteImage(overviews[i], filename.c_str())) {
+      LOG(ERROR) << "Cannot write the overview " << filename << ".";
+      ok = false;
+    }
+  }
   // Delete the features graph
   fg.DeleteAndClear();
-  return 0;
+  return ok ? 0 : 1;
 }
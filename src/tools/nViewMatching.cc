@@ -44,7 +44,7 @@
 using namespace libmv;
 using namespace std;
 
-DEFINE_string(detector, "FAST", "select the detector (FAST,STAR,SURF,MSER)");
+DEFINE_string(detector, "FAST", "select the detector (FAST,FAST_GRID,STAR,SURF,MSER)");
 DEFINE_string(describer, "DIPOLE",
               "select the descriptor (SIMPLIEST,SURF,DIPOLE,DAISY)");
 DEFINE_bool(save_matches_results, true,
@@ -57,6 +57,9 @@ DEFINE_bool(save_hugin, true,
 //TODO(pmoulon) this parameter must set the homography as geometric constraint
 DEFINE_bool(save_reconstruction, true,
             "save perspective reconstruction from largest track (.ply)");
+DEFINE_string(trace, "",
+              "Write a Chrome trace of the pipeline stages to this file (JSON)"
+              " and print the time spent per stage.");
 
 // TODO(pmoulon) move this function in a more general file
 template <typename Image>
@@ -122,6 +125,7 @@ int main(int argc, char **argv) {
 
   google::SetUsageMessage("NViewMatching Demo.");
   google::ParseCommandLineFlags(&argc, &argv, true);
+  StartTracing(FLAGS_trace);
 
   libmv::vector<string> image_vector;
 
@@ -135,6 +139,8 @@ int main(int argc, char **argv) {
   detector::eDetector edetector = detector::FAST_DETECTOR;
   if (FLAGS_detector == "FAST") {
     edetector = detector::FAST_DETECTOR;
+  } else if (FLAGS_detector == "FAST_GRID") {
+    edetector = detector::FAST_GRID_DETECTOR;
   } else if (FLAGS_detector == "SURF") {
     edetector = detector::SURF_DETECTOR;
   } else if (FLAGS_detector == "STAR") {
@@ -326,6 +332,7 @@ int main(int argc, char **argv) {
     //TODO(pmoulon) : perform the perspective reconstruction from NviewTensor
   }
 
+  FinishTracing(FLAGS_trace);
   return 0;
 }
 
@@ -19,18 +19,30 @@
 // IN THE SOFTWARE.
 #include <list>
 #include <string>
+#include <vector>
 
 #include "libmv/correspondence/import_matches_txt.h"
 #include "libmv/correspondence/tracker.h"
+#include "libmv/image/image_io.h"
 #include "libmv/logging/logging.h"
 #include "libmv/reconstruction/euclidean_reconstruction.h"
 #include "libmv/reconstruction/export_blender.h"
 #include "libmv/reconstruction/export_ply.h"
+#include "libmv/reconstruction/snapshot.h"
+#include "libmv/tools/tool.h"
 
 using namespace libmv;
 
 DEFINE_string(i, "matches.txt", "Matches input file");
-DEFINE_string(o, "reconstruction.py", "Reconstruction output file");
+DEFINE_string(o, "reconstruction.py", "Reconstruction output file "
+              "(.py Blender script, .ply or .snap reconstruction snapshot)");
+DEFINE_bool(parallel_non_keyframes, false,
+            "Localize the non-keyframes in parallel against the keyframe"
+            " structure, with a single final bundle adjustment");
+DEFINE_bool(ply_ascii, false, "Write ASCII instead of binary PLY files");
+DEFINE_string(dump_prefix, "",
+              "If not empty, dump the intermediate reconstructions to files"
+              " starting with this prefix (written in the background)");
 
 DEFINE_int32(w, 0, "Image width (px)");
 DEFINE_int32(h, 0, "Image height (px)");
@@ -42,6 +54,32 @@ DEFINE_double(u0, 0,
               "Principal point u coordinate (px)");
 DEFINE_double(v0, 0,
              "Principal point v coordinate (px)");
+DEFINE_string(trace, "",
+              "Write a Chrome trace of the pipeline stages to this file (JSON)"
+              " and print the time spent per stage.");
+
+// Colors the points of the reconstruction from the frames that observe them,
+// the frame of the image ID i being image_files[i].  A point takes the color
+// of its first frame.
+void SampleColorsFromFrames(const Reconstruction &reconstruction,
+                            const Matches &matches,
+                            const std::vector<std::string> &image_files,
+                            PointColors *colors) {
+  vector<int> cameras;
+  reconstruction.CameraIndicesByID(&cameras);
+  for (int k = 0; k < cameras.size(); ++k) {
+    CameraID image_id = reconstruction.camera_id(cameras[k]);
+    if (image_id < 0 || image_id >= int(image_files.size())) {
+      continue;
+    }
+    ByteImage image;
+    if (!ReadImage(image_files[image_id].c_str(), &image)) {
+      LOG(ERROR) << "Cannot read the frame " << image_files[image_id];
+      continue;
+    }
+    SamplePointColors(reconstruction, matches, image_id, image, colors);
+  }
+}
 
 void GetFilePathExtention(const std::string &file, 
                           std::string *path_name, 
@@ -59,11 +97,16 @@ void GetFilePathExtention(const std::string &file,
 
 int main (int argc, char *argv[]) {
   std::string usage ="Estimate the camera trajectory using matches.\n";
-  usage += "Usage: " + std::string(argv[0]) + " -i INFILE.txt -o OUTFILE.ply.";
+  usage += "Usage: " + std::string(argv[0]) + " -i INFILE.txt -o OUTFILE.ply"
+           " [IMAGE1 ... IMAGEN]\n";
+  usage += "\t - IMAGE1 ... IMAGEN are the frames of the image IDs 0 ... N-1;"
+           " they color the points of a binary PLY file\n";
   
   //usage += argv[0] + "<detector>";
   google::SetUsageMessage(usage);
   google::ParseCommandLineFlags(&argc, &argv, true);
+  StartTracing(FLAGS_trace);
+  std::vector<std::string> image_files(argv + 1, argv + argc);
 
   // Imports matches
   tracker::FeaturesGraph fg;
@@ -83,10 +126,20 @@ int main (int argc, char *argv[]) {
   // TODO(julien) put u and v as arguments of EuclideanReconstructionFromVideo
   VLOG(0) << "Euclidean Reconstruction From Video..." << std::endl;
   std::list<Reconstruction *> reconstructions;
+  ReconstructionDumper *dumper = NULL;
+  if (!FLAGS_dump_prefix.empty()) {
+    dumper = new ReconstructionDumper(FLAGS_dump_prefix);
+  }
   EuclideanReconstructionFromVideo(fg.matches_, 
                                    w, h,
                                    FLAGS_f,
-                                   &reconstructions);
+                                   &reconstructions,
+                                   dumper,
+                                   FLAGS_parallel_non_keyframes);
+  if (dumper) {
+    dumper->Wait();
+    delete dumper;
+  }
   VLOG(0) << "Euclidean Reconstruction From Video...[DONE]" << std::endl;
   
   // Exports the reconstructions
@@ -96,18 +149,40 @@ int main (int argc, char *argv[]) {
   std::transform(file_ext.begin(), file_ext.end(), file_ext.begin(), ::tolower);
   
   int i = 0;
+  int num_failures = 0;
   std::list<Reconstruction *>::iterator iter = reconstructions.begin();
   if (file_ext == "ply") {
-    for (; iter != reconstructions.end(); ++iter) {
+    for (; iter != reconstructions.end(); ++iter, ++i) {
       std::stringstream s;
       if (reconstructions.size() > 1)
         s << file_path_name << "-" << i << ".ply";
       else
         s << FLAGS_o;
-      ExportToPLY(**iter, s.str());
+      if (FLAGS_ply_ascii) {
+        ExportToPLY(**iter, s.str());
+        continue;
+      }
+      PointColors colors;
+      SampleColorsFromFrames(**iter, fg.matches_, image_files, &colors);
+      if (!ExportToBinaryPLY(**iter, fg.matches_, &colors, s.str())) {
+        LOG(ERROR) << "Cannot write " << s.str();
+        num_failures++;
+      }
+    }
+  } else if (file_ext == "snap") {
+    for (; iter != reconstructions.end(); ++iter, ++i) {
+      std::stringstream s;
+      if (reconstructions.size() > 1)
+        s << file_path_name << "-" << i << ".snap";
+      else
+        s << FLAGS_o;
+      if (!WriteReconstructionSnapshot(**iter, fg.matches_, s.str())) {
+        LOG(ERROR) << "Cannot write " << s.str();
+        num_failures++;
+      }
     }
   } else  if (file_ext == "py") {    
-    for (; iter != reconstructions.end(); ++iter) {
+    for (; iter != reconstructions.end(); ++iter, ++i) {
       std::stringstream s;
       if (reconstructions.size() > 1)
         s << file_path_name << "-" << i << ".py";
@@ -129,5 +204,6 @@ int main (int argc, char *argv[]) {
   reconstructions.clear();
   // Delete the features graph
   fg.DeleteAndClear();
-  return 0;
+  FinishTracing(FLAGS_trace);
+  return num_failures ? 1 : 0;
 }
@@ -24,18 +24,28 @@
  * (euclidean or homography) and images are warped so that the features keep 
  * the same position in all images.
  * 
- * \note This version supports only fixed camera.
+ * With --smoothing_radius the camera motion is smoothed instead of removed,
+ * which supports moving cameras.
+ *
  * \note The colors are not smoothed
  * \note The empty spaces are filled with the images stabilized images and are 
  *       not  blended/smoothed.
- * 
- * TODO(julien) Support moving camera (using a "mean" H)
  */
 #include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <sstream>
 #include <string>
 #include <vector>
 
-#include "libmv/base/scoped_ptr.h"
+#include <pthread.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "libmv/base/vector_utils.h"
 #include "libmv/correspondence/feature.h"
 #include "libmv/correspondence/import_matches_txt.h"
 #include "libmv/correspondence/matches.h"
@@ -43,10 +53,7 @@
 #include "libmv/image/image.h"
 #include "libmv/image/image_drawing.h"
 #include "libmv/image/image_io.h"
-#include "libmv/image/image_sequence_io.h"
-#include "libmv/image/image_transform_linear.h"
-#include "libmv/image/cached_image_sequence.h"
-#include "libmv/image/sample.h"
+#include "libmv/image/image_warp.h"
 #include "libmv/multiview/robust_affine.h"
 #include "libmv/multiview/robust_euclidean.h"
 #include "libmv/multiview/robust_homography.h"
@@ -67,6 +74,10 @@ DEFINE_bool(draw_lines, false, "Draw image bounds");
              
 DEFINE_string(of, "./",     "Output folder.");
 DEFINE_string(os, "_stab",  "Output file suffix.");
+DEFINE_int32(smoothing_radius, 0, "Radius, in images, of the smoothing of the \
+camera motion; 0 stabilizes for a fixed camera.");
+DEFINE_int32(threads, 0, "Number of threads decoding, warping and encoding \
+the images (0: all the cores).");
 
 using namespace libmv;
 
@@ -251,68 +262,336 @@ void ComputeRelativeHomographyMatrices(const Matches &matches,
   }
 }
 
+/**
+ * Computes the warps stabilizing each image.
+ *
+ * The cumulative matrices $Ci = Hi-1^-1 * ... * H1^-1$ map the image i to the
+ * first image. Without smoothing the images are warped by Ci, which fixes
+ * the camera. Otherwise the images are warped by Si^-1 * Ci where Si is a
+ * Gaussian average of the Cj over a window of smoothing_radius images around
+ * i: the jitter is removed but the camera motion is kept.
+ *
+ * \param Hs The 2D relative warp matrices
+ * \param num_images The number of images
+ * \param smoothing_radius The radius of the smoothing window, 0 for a fixed
+ *        camera
+ * \param warps The stabilizing warps, one per image
+ */
+void ComputeStabilizingWarps(const vector<Mat3> &Hs,
+                             int num_images,
+                             int smoothing_radius,
+                             vector<Mat3> *warps) {
+  vector<Mat3> Cs(num_images);
+  Mat3 H;
+  H.setIdentity();
+  for (int i = 0; i < num_images; ++i) {
+    if (i > 0 && i - 1 < Hs.size())
+      H = Hs[i - 1].inverse() * H;
+    Cs[i] = H / H(2, 2);
+  }
+  warps->resize(num_images);
+  if (smoothing_radius <= 0) {
+    for (int i = 0; i < num_images; ++i)
+      (*warps)[i] = Cs[i];
+    return;
+  }
+  const double sigma = smoothing_radius / 2.0;
+  for (int i = 0; i < num_images; ++i) {
+    Mat3 S = Mat3::Zero();
+    double sum = 0;
+    for (int j = std::max(i - smoothing_radius, 0);
+         j <= std::min(i + smoothing_radius, num_images - 1); ++j) {
+      const double w = exp(-(j - i) * (j - i) / (2 * sigma * sigma));
+      S += w * Cs[j];
+      sum += w;
+    }
+    S /= sum;
+    (*warps)[i] = S.inverse() * Cs[i];
+  }
+}
+
+/// Returns the name of the stabilized image of an image file.
+std::string StabilizedFilename(const std::string &image_file) {
+  std::stringstream s;
+  s << ReplaceFolder(image_file.substr(0, image_file.rfind(".")), FLAGS_of);
+  s << FLAGS_os;
+  s << image_file.substr(image_file.rfind("."), image_file.size());
+  return s.str();
+}
+
+/// Wall clock time in seconds.
+double Now() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return clock() / double(CLOCKS_PER_SEC);
+#endif
+}
+
+/**
+ * Stabilizes images with three overlapped stages: images are decoded by any
+ * number of threads, warped in order by one thread at a time (each output
+ * image is drawn over the previous one), and encoded by any number of
+ * threads. Decoded images wait in a reorder buffer for their turn to be
+ * warped; at most max_images_in_flight images are between the decoding and
+ * the end of the encoding.
+ *
+ * The threads are the ones of an OpenMP parallel region; each thread runs
+ * the most urgent available task: the warp, then the encodings, then the
+ * decodings. A thread without a task sleeps until another task finishes,
+ * since only a finished task can make a new one available.
+ */
+class StabilizePipeline {
+ public:
+  StabilizePipeline(const std::vector<std::string> &image_files,
+                    const vector<Mat3> &warps,
+                    bool draw_lines,
+                    int max_images_in_flight)
+    : image_files_(image_files),
+      warps_(warps),
+      draw_lines_(draw_lines),
+      max_images_in_flight_(std::max(max_images_in_flight, 1)),
+      images_(image_files.size(), NULL),
+      decoded_(image_files.size(), false),
+      next_decode_(0),
+      next_warp_(0),
+      warp_busy_(false),
+      num_images_in_flight_(0),
+      num_done_(0),
+      num_write_failures_(0),
+      num_threads_(1) {
+    for (int stage = 0; stage < NUM_STAGES; ++stage) {
+      busy_time_[stage] = 0;
+      num_tasks_[stage] = 0;
+    }
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&task_finished_, NULL);
+  }
+
+  ~StabilizePipeline() {
+    pthread_cond_destroy(&task_finished_);
+    pthread_mutex_destroy(&mutex_);
+    DeleteElements(&images_);
+  }
+
+  void Run(int num_threads) {
+    num_threads_ = num_threads;
+    const double start = Now();
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      Stage stage;
+      int image;
+      pthread_mutex_lock(&mutex_);
+      while (num_done_ < int(image_files_.size())) {
+        if (!NextTask(&stage, &image)) {
+          pthread_cond_wait(&task_finished_, &mutex_);
+          continue;
+        }
+        pthread_mutex_unlock(&mutex_);
+        const double task_start = Now();
+        bool ok = RunTask(stage, image);
+        const double task_time = Now() - task_start;
+        pthread_mutex_lock(&mutex_);
+        FinishTask(stage, image);
+        busy_time_[stage] += task_time;
+        num_tasks_[stage]++;
+        num_write_failures_ += !ok;
+        pthread_cond_broadcast(&task_finished_);
+      }
+      pthread_mutex_unlock(&mutex_);
+    }
+    wall_time_ = Now() - start;
+  }
+
+  /// Number of stabilized images that could not be written.
+  int num_write_failures() const { return num_write_failures_; }
+
+  /// Logs the throughput and the utilization of each stage, in threads.
+  void LogStats() const {
+    const char *names[NUM_STAGES] = {"decode", "warp", "encode"};
+    LOG(INFO) << image_files_.size() << " images in " << wall_time_ << "s ("
+              << image_files_.size() / wall_time_ << " images/s) on "
+              << num_threads_ << " threads.";
+    for (int stage = 0; stage < NUM_STAGES; ++stage) {
+      LOG(INFO) << names[stage] << ": " << num_tasks_[stage] << " images, "
+                << 1000 * busy_time_[stage] / std::max(num_tasks_[stage], 1)
+                << " ms/image, utilization "
+                << busy_time_[stage] / wall_time_ << " threads.";
+    }
+  }
+
+ private:
+  enum Stage {
+    DECODE = 0,
+    WARP,
+    ENCODE,
+    NUM_STAGES
+  };
+
+  // Must be called with mutex_ locked.
+  bool NextTask(Stage *stage, int *image) {
+    if (!warp_busy_ && next_warp_ < image_files_.size() &&
+        decoded_[next_warp_]) {
+      warp_busy_ = true;
+      *stage = WARP;
+      *image = next_warp_;
+      return true;
+    }
+    if (!to_encode_.empty()) {
+      *stage = ENCODE;
+      *image = to_encode_.front();
+      to_encode_.pop_front();
+      return true;
+    }
+    if (next_decode_ < image_files_.size() &&
+        num_images_in_flight_ < max_images_in_flight_) {
+      *stage = DECODE;
+      *image = next_decode_++;
+      num_images_in_flight_++;
+      return true;
+    }
+    return false;
+  }
+
+  // Must be called with mutex_ locked.
+  void FinishTask(Stage stage, int image) {
+    switch (stage) {
+      case DECODE:
+        decoded_[image] = true;
+        break;
+      case WARP:
+        warp_busy_ = false;
+        next_warp_++;
+        if (images_[image]) {
+          to_encode_.push_back(image);
+        } else {
+          ImageDone(image);
+        }
+        break;
+      case ENCODE:
+        ImageDone(image);
+        break;
+      default:
+        break;
+    }
+  }
+
+  void ImageDone(int image) {
+    delete images_[image];
+    images_[image] = NULL;
+    num_images_in_flight_--;
+    num_done_++;
+  }
+
+  // Runs without mutex_: only the thread running the task of an image
+  // accesses it. Returns false if the stabilized image cannot be written.
+  bool RunTask(Stage stage, int image) {
+    switch (stage) {
+      case DECODE: {
+        ByteImage *decoded = new ByteImage;
+        if (ReadImage(image_files_[image].c_str(), decoded)) {
+          images_[image] = decoded;
+        } else {
+          delete decoded;
+        }
+        break;
+      }
+      case WARP:
+        if (images_[image]) {
+          Warp(image);
+        }
+        break;
+      case ENCODE: {
+        const std::string filename = StabilizedFilename(image_files_[image]);
+        if (!WriteImage(*images_[image], filename.c_str())) {
+          LOG(ERROR) << "Cannot write " << filename;
+          return false;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    return true;
+  }
+
+  // Warps an image over the previous stabilized image, then replaces it by
+  // the stabilized image to be encoded.
+  void Warp(int image) {
+    ByteImage &frame = *images_[image];
+    if (image_stab_.Size() == 0) {
+      image_stab_.Resize(frame.Height(), frame.Width(), frame.Depth());
+      image_stab_.Fill(0);
+    }
+    if (draw_lines_) {
+      typedef unsigned char Color[3];
+      unsigned char lines_color[3] = {255, 255, 255};
+      const int w = frame.Width(), h = frame.Height();
+      DrawLine<ByteImage, Color>(0, 0, 0, h - 1, lines_color, &frame);
+      DrawLine<ByteImage, Color>(0, 0, w - 1, 0, lines_color, &frame);
+      DrawLine<ByteImage, Color>(0, h - 1, w - 1, h - 1, lines_color, &frame);
+      DrawLine<ByteImage, Color>(w - 1, 0, w - 1, h - 1, lines_color, &frame);
+    }
+    WarpHomography(frame, warps_[image], WARP_BILINEAR, &image_stab_);
+    frame = image_stab_;
+  }
+
+  const std::vector<std::string> &image_files_;
+  const vector<Mat3> &warps_;
+  bool draw_lines_;
+  int max_images_in_flight_;
+
+  // The decoded, then stabilized, images; NULL if not decoded (yet).
+  vector<ByteImage *> images_;
+  vector<bool> decoded_;
+  std::deque<int> to_encode_;
+  int next_decode_;
+  int next_warp_;
+  bool warp_busy_;
+  int num_images_in_flight_;
+  int num_done_;
+  int num_write_failures_;
+  ByteImage image_stab_;
+  // Guards the state above but the images, and signals the end of a task.
+  pthread_mutex_t mutex_;
+  pthread_cond_t task_finished_;
+
+  double busy_time_[NUM_STAGES];
+  int num_tasks_[NUM_STAGES];
+  double wall_time_;
+  int num_threads_;
+};
+
 /**
  * Stabilize a list of images.
  * 
  * \param image_files The input image files
  * \param Hs The 2D relative warp matrices
  * \param draw_lines If true, the images bounds are drawn
- * 
- * \note this is only for a fixed camera.
- * TODO(julien) propose a way for a moving camera ("mean" H)
+ * \param smoothing_radius The radius of the camera motion smoothing, 0 for
+ *        a fixed camera
+ * \param num_threads The number of threads of the pipeline (all the cores
+ *        if 0)
+ * \return false if a stabilized image cannot be written
  */
-void Stabilize(const std::vector<std::string> &image_files,
+bool Stabilize(const std::vector<std::string> &image_files,
                const vector<Mat3> &Hs,
-               bool draw_lines) {
-  assert(image_files.size() == Hs.size() - 1);
-  
-  // Get the size of the first image
-  Vec2u images_size;
-  ByteImage imageArrayBytes;
-  ReadImage (image_files[0].c_str(), &imageArrayBytes);
-  images_size << imageArrayBytes.Width(), imageArrayBytes.Height();
-  
-  Mat3 H;
-  H.setIdentity(); 
-  FloatImage image_stab(imageArrayBytes.Height(),
-                        imageArrayBytes.Width(), 
-                        imageArrayBytes.Depth());
-  image_stab.Fill(0);
-  float lines_color[3] = {1, 1, 1};
-  FloatImage *image = NULL;
-  ImageCache cache;
-  scoped_ptr<ImageSequence> source(ImageSequenceFromFiles(image_files, &cache));
-  for (size_t i = 0; i < image_files.size(); ++i) {
-    if (i > 0)
-      H = Hs[i - 1].inverse() * H;
-    image = source->GetFloatImage(i);
-    if (image) {
-      //VLOG(1) << "H = \n" << H << "\n";
-      if (draw_lines) {
-        DrawLine<FloatImage, float[3]>(0, 0, 0, images_size(1) - 1, 
-                                       lines_color, image);
-        DrawLine<FloatImage, float[3]>(0, 0, images_size(0) - 1, 0, 
-                                       lines_color, image);
-        DrawLine<FloatImage, float[3]>(               0, images_size(1)-1, 
-                                       images_size(0)-1, images_size(1)-1, 
-                                       lines_color, image);
-        DrawLine<FloatImage, float[3]>(images_size(0)-1,                0, 
-                                       images_size(0)-1, images_size(1)-1, 
-                                       lines_color, image); 
-      }        
-      WarpImage(*image, H, &image_stab);
-      
-      // Saves the stabilized image
-      std::stringstream s;
-      s << ReplaceFolder(image_files[i].substr(0, image_files[i].rfind(".")), 
-                         FLAGS_of);
-      s << FLAGS_os;
-      s << image_files[i].substr(image_files[i].rfind("."), 
-                                 image_files[i].size());
-      WriteImage(image_stab, s.str().c_str());
-    }
-    source->Unpin(i);
-  }
+               bool draw_lines,
+               int smoothing_radius,
+               int num_threads) {
+  vector<Mat3> warps;
+  ComputeStabilizingWarps(Hs, image_files.size(), smoothing_radius, &warps);
+#ifdef _OPENMP
+  if (num_threads <= 0)
+    num_threads = omp_get_max_threads();
+#endif
+  num_threads = std::max(num_threads, 1);
+  StabilizePipeline pipeline(image_files, warps, draw_lines, 2 * num_threads);
+  pipeline.Run(num_threads);
+  pipeline.LogStats();
+  return pipeline.num_write_failures() == 0;
 }
 
 int main(int argc, char **argv) {
@@ -358,9 +637,10 @@ int main(int argc, char **argv) {
   VLOG(0) << "Estimating relative matrices...[DONE]." << std::endl;
 
   VLOG(0) << "Stabilizing images..." << std::endl;
-  Stabilize(files, Hs, FLAGS_draw_lines);
+  bool ok = Stabilize(files, Hs, FLAGS_draw_lines, FLAGS_smoothing_radius,
+                      FLAGS_threads);
   VLOG(0) << "Stabilizing images...[DONE]." << std::endl;
   // Delete the features graph
   fg.DeleteAndClear();
-  return 0;
+  return ok ? 0 : 1;
 }
@@ -61,7 +61,7 @@
 
 using namespace libmv;
 
-DEFINE_string(detector, "FAST", "select the detector (FAST,STAR,SURF,MSER)");
+DEFINE_string(detector, "FAST", "select the detector (FAST,FAST_GRID,STAR,SURF,MSER)");
 DEFINE_string(describer, "DAISY",
               "select the descriptor (SIMPLIEST,SURF,DIPOLE,DAISY)");
 DEFINE_bool  (save_features, false,
@@ -76,6 +76,13 @@ DEFINE_double(robust_tracker_threshold, 1.0,
 DEFINE_bool  (track_all_known_features, false,
               "track all known features in all images");
 
+DEFINE_bool  (streaming, false,
+              "track each image against the previous one only, detecting and "
+              "describing every image once (no robust filtering)");
+DEFINE_int32 (keyframe_interval, 0,
+              "with -streaming, keep one image in N as a keyframe to recover "
+              "the tracks lost for a few images (0: no keyframes)");
+
 DEFINE_bool  (pose_estimation, false,
               "perform a pose estimation");
 DEFINE_double(focal, 50,
@@ -86,6 +93,9 @@ DEFINE_double(principal_point_v, 0,
               "principal point v coordinate");
 
 DEFINE_string(o, "matches.txt", "Matches output file");
+DEFINE_string(trace, "",
+              "Write a Chrome trace of the pipeline stages to this file (JSON)"
+              " and print the time spent per stage.");
 
 void DrawFeatures(ByteImage &imageArrayBytes,
                   Matches::Features<PointFeature> &features,
@@ -265,6 +275,7 @@ int main (int argc, char *argv[]) {
   //usage += argv[0] + "<detector>";
   google::SetUsageMessage(usage);
   google::ParseCommandLineFlags(&argc, &argv, true);
+  StartTracing(FLAGS_trace);
 
   std::list<std::string> image_list;
   vector<std::pair<size_t, size_t> > image_sizes;
@@ -287,6 +298,7 @@ int main (int argc, char *argv[]) {
   detector::eDetector edetector = detector::FAST_DETECTOR;
   std::map<std::string, detector::eDetector> detectorMap;
   detectorMap["FAST"] = detector::FAST_DETECTOR;
+  detectorMap["FAST_GRID"] = detector::FAST_GRID_DETECTOR;
   detectorMap["SURF"] = detector::SURF_DETECTOR;
   detectorMap["STAR"] = detector::STAR_DETECTOR;
   detectorMap["MSER"] = detector::MSER_DETECTOR;
@@ -342,6 +354,24 @@ int main (int argc, char *argv[]) {
       arrayGrayBytes->Height(), arrayGrayBytes->Width()));
 
     libmv::Matches::ImageID new_image_id = 0;
+    if (FLAGS_streaming) {
+      bool keyframe = FLAGS_keyframe_interval > 0 &&
+                      image_index % FLAGS_keyframe_interval == 0;
+      new_image_id = points_tracker->PushFrame(image, &all_features_graph,
+                                               keyframe);
+      VLOG(1) << " New Image ID "<< new_image_id << std::endl;
+      if (FLAGS_save_features || FLAGS_save_matches) {
+        Matches::Features<PointFeature> features_set =
+          all_features_graph.matches_.InImage<PointFeature>(new_image_id);
+        if (FLAGS_save_features)
+          DrawFeatures(imageArrayBytes, features_set, false);
+        if (FLAGS_save_matches)
+          DrawMatches(imageArrayBytes, new_image_id, all_features_graph);
+        SaveImage(imageArrayBytes, image_path, "-features");
+      }
+      image_index++;
+      continue;
+    }
     if (FLAGS_track_all_known_features) {
       // TODO(julien) this case is not a simple tracker and should be moved
       // to another tool?
@@ -411,5 +441,6 @@ int main (int argc, char *argv[]) {
   all_features_graph.DeleteAndClear();
 
   // TODO(julien) Clean the variables detector, describer, matcher
+  FinishTracing(FLAGS_trace);
   return 0;
 }
@@ -23,7 +23,9 @@
 // (up to 2 coef).
 // Undistorted images are saved in the same location as input images, with a
 // suffix "_undist" placed at the end of the file name.
-// Note: All images must have the same size.
+// The undistortion map is computed once per image size and, with
+// -map_cache, saved to disk so that the next runs on the same camera reuse it.
+// Several images are undistorted concurrently.
 // 
 // We use the Brown's distortion model
 // Variables:
@@ -42,22 +44,24 @@
 //   + (p2(r^2 + 2(y-cy)^2) + 2p1(x-cx)(y-cy))(1 + p3*r^2 +...)
 
 #include <algorithm>
+#include <cstdio>
+#include <map>
+#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include "libmv/base/scoped_ptr.h"
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
 #include "libmv/camera/lens_distortion.h"
 #include "libmv/camera/pinhole_camera.h"
-#include "libmv/correspondence/feature.h"
-#include "libmv/correspondence/import_matches_txt.h"
-#include "libmv/correspondence/matches.h"
-#include "libmv/correspondence/tracker.h"
-#include "libmv/image/cached_image_sequence.h"
 #include "libmv/image/image.h"
 #include "libmv/image/image_io.h"
-#include "libmv/image/image_sequence_io.h"
-#include "libmv/image/sample.h"
+#include "libmv/image/image_warp.h"
 #include "libmv/logging/logging.h"
+#include "libmv/tools/tool.h"
 
 DEFINE_double(k1, 0,  "Radial distortion coefficient k1 (Brown's model)");
 DEFINE_double(k2, 0,  "Radial distortion coefficient k2 (Brown's model)");
@@ -76,6 +80,9 @@ DEFINE_double(sk, 0,  "Skew factor");
 
 DEFINE_string(of, "",         "Output folder.");
 DEFINE_string(os, "_undist",  "Output file suffix.");
+DEFINE_string(map_cache, "",
+              "Folder where the undistortion maps are saved and looked up, "
+              "keyed by the camera parameters and the image size.");
 
 using namespace libmv;
 
@@ -108,6 +115,166 @@ std::string ReplaceFolder(const std::string &s,
   return so;
 }
 
+void SetLensDistortion(LensDistortion *lens_distortion) {
+  // The radial coefficients are k1 up to the last non zero one.
+  const double k[5] = { FLAGS_k1, FLAGS_k2, FLAGS_k3, FLAGS_k4, FLAGS_k5 };
+  int num_radial = 5;
+  while (num_radial > 0 && k[num_radial - 1] == 0) {
+    --num_radial;
+  }
+  if (num_radial > 0) {
+    Vec radial_k(num_radial);
+    for (int i = 0; i < num_radial; ++i) {
+      radial_k(i) = k[i];
+    }
+    lens_distortion->set_radial_distortion(radial_k);
+  }
+  VLOG(0) << "Radial coefficients: " 
+          << lens_distortion->radial_distortion().transpose() << std::endl;
+  
+  if (FLAGS_p1 != 0 && FLAGS_p2 != 0) {
+    Vec tangential_p(2);
+    tangential_p(0) = FLAGS_p1;
+    tangential_p(1) = FLAGS_p2;
+    lens_distortion->set_tangential_distortion(tangential_p);
+  }
+  VLOG(0) << "Tangential coefficients: " 
+          << lens_distortion->tangential_distortion().transpose() << std::endl;
+}
+
+// The principal point defaults to the image center, so the intrinsics depend
+// on the image size.
+Mat3 IntrinsicMatrix(int width, int height) {
+  double u0 = FLAGS_u0 != 0 ? FLAGS_u0 : width / 2 - 0.5;
+  double v0 = FLAGS_v0 != 0 ? FLAGS_v0 : height / 2 - 0.5;
+  double fy = FLAGS_fy != 0 ? FLAGS_fy : FLAGS_fx;
+  Mat3 K;
+  K << FLAGS_fx, FLAGS_sk, u0,
+              0,       fy, v0,
+              0,        0,  1;
+  return K;
+}
+
+// Output pixel (x, y) samples the input image at the undistorted coordinates
+// of (x, y). Rows are independent and computed in parallel.
+void ComputeUndistortionRemap(const PinholeCameraDistortion &camera,
+                              int width, int height,
+                              RemapGrid *grid) {
+  grid->Resize(width, height);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 8)
+#endif
+  for (int y = 0; y < height; ++y) {
+    Vec2 q;
+    for (int x = 0; x < width; ++x) {
+      q << x, y;
+      camera.ComputeUndistortedCoordinates(q, &q);
+      if (q(0) > -1 && q(0) < width && q(1) > -1 && q(1) < height) {
+        grid->xs[y * width + x] = q(0);
+        grid->ys[y * width + x] = q(1);
+      } else {
+        grid->SetInvalid(x, y);
+      }
+    }
+  }
+}
+
+// Undistortion maps, computed on first use for each image size and shared by
+// all the threads.
+class UndistortionMaps {
+ public:
+  UndistortionMaps(const LensDistortion &lens_distortion,
+                   const std::string &cache_folder)
+      : lens_distortion_(lens_distortion), cache_folder_(cache_folder) {}
+
+  ~UndistortionMaps() {
+    std::map<std::pair<int, int>, RemapGrid *>::iterator it;
+    for (it = maps_.begin(); it != maps_.end(); ++it) {
+      delete it->second;
+    }
+  }
+
+  const RemapGrid &Get(int width, int height) {
+    RemapGrid *grid = NULL;
+#ifdef _OPENMP
+#pragma omp critical(undistortion_maps)
+#endif
+    {
+      std::pair<int, int> size(width, height);
+      if (maps_.find(size) == maps_.end()) {
+        maps_[size] = Compute(width, height);
+      }
+      grid = maps_[size];
+    }
+    return *grid;
+  }
+
+ private:
+  RemapGrid *Compute(int width, int height) {
+    Mat3 K = IntrinsicMatrix(width, height);
+    RemapGrid *grid = new RemapGrid;
+    std::string key = Key(K, width, height);
+    std::string filename = CacheFilename(key);
+    if (!filename.empty() &&
+        ReadRemapGrid(filename.c_str(), key, grid)) {
+      VLOG(0) << "Loaded the undistortion map from " << filename;
+      return grid;
+    }
+    VLOG(0) << "Estimating undistortion map..." << std::endl;
+    LensDistortion lens_distortion = lens_distortion_;
+    PinholeCameraDistortion camera(&lens_distortion);
+    Vec2u size_image;
+    size_image << width, height;
+    camera.set_image_size(size_image);
+    camera.set_intrinsic_matrix(K);
+    ComputeUndistortionRemap(camera, width, height, grid);
+    VLOG(0) << "Estimating undistortion map...[DONE]." << std::endl;
+    if (!filename.empty() &&
+        !WriteRemapGrid(*grid, key, filename.c_str())) {
+      LOG(ERROR) << "Couldn't save the undistortion map to " << filename;
+    }
+    return grid;
+  }
+
+  // Everything the map depends on, at full precision.
+  std::string Key(const Mat3 &K, int width, int height) const {
+    std::ostringstream key;
+    key.precision(17);
+    key << "brown " << width << "x" << height
+        << " K " << K.row(0) << " " << K.row(1)
+        << " k " << lens_distortion_.radial_distortion().transpose()
+        << " p " << lens_distortion_.tangential_distortion().transpose();
+    return key.str();
+  }
+
+  // The file of a map is named by a hash of its key (FNV-1a); the key stored
+  // in the file resolves collisions.
+  std::string CacheFilename(const std::string &key) const {
+    if (cache_folder_.empty()) {
+      return "";
+    }
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < key.size(); ++i) {
+      hash = (hash ^ static_cast<unsigned char>(key[i])) * 16777619u;
+    }
+    char name[32];
+    sprintf(name, "undistort_%08x.map", hash);
+    return ReplaceFolder(name, cache_folder_);
+  }
+
+  LensDistortion lens_distortion_;
+  std::string cache_folder_;
+  std::map<std::pair<int, int>, RemapGrid *> maps_;
+};
+
+std::string OutputFilename(const std::string &file) {
+  std::stringstream s;
+  s << ReplaceFolder(file.substr(0, file.rfind(".")), FLAGS_of);
+  s << FLAGS_os;
+  s << file.substr(file.rfind("."), file.size());
+  return s.str();
+}
+
 int main(int argc, char **argv) {
   std::string usage ="Undistort images using know distortion parameters.\n";
   usage += "Usage: " + std::string(argv[0]) + " IMAGE1 [IMAGE2 ... IMAGEN] ";
@@ -117,136 +284,45 @@ int main(int argc, char **argv) {
   google::SetUsageMessage(usage);
   google::ParseCommandLineFlags(&argc, &argv, true);
 
-  // This is not the place for this. I am experimenting with what sort of API
-  // will be convenient for the tracking base classes.
   std::vector<std::string> files;
   for (int i = 1; i < argc; ++i) {
     files.push_back(argv[i]);
   }
   
   LensDistortion lens_distortion;
-  if (FLAGS_k5 == 0) {
-    if (FLAGS_k4 == 0) {
-      if (FLAGS_k3 == 0) {
-        if (FLAGS_k2 == 0) {
-          if (FLAGS_k1 != 0) {
-            Vec radial_k(1);
-            radial_k << FLAGS_k1;
-            lens_distortion.set_radial_distortion(radial_k);
-          }
-        } else {
-          Vec radial_k(2);
-          radial_k << FLAGS_k1, FLAGS_k2;
-          lens_distortion.set_radial_distortion(radial_k);
-        }
-      } else {
-        Vec radial_k(3);
-        radial_k << FLAGS_k1, FLAGS_k2, FLAGS_k3;
-        lens_distortion.set_radial_distortion(radial_k);
-      }
-    } else {
-      Vec radial_k(4);
-      radial_k << FLAGS_k1, FLAGS_k2, FLAGS_k3, FLAGS_k4;
-      lens_distortion.set_radial_distortion(radial_k);
+  SetLensDistortion(&lens_distortion);
+  UndistortionMaps maps(lens_distortion, FLAGS_map_cache);
+
+  // Decoding and encoding dominate, so whole images are spread over the
+  // threads when there are enough of them; otherwise each image is remapped
+  // with all the threads.
+  const int num_files = files.size();
+  bool parallel_files = false;
+#ifdef _OPENMP
+  parallel_files = num_files >= omp_get_max_threads();
+#endif
+  int num_failed = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) if (parallel_files) \
+    reduction(+:num_failed)
+#endif
+  for (int i = 0; i < num_files; ++i) {
+    ByteImage image;
+    if (!ReadImage(files[i].c_str(), &image)) {
+      LOG(ERROR) << "Couldn't read " << files[i];
+      ++num_failed;
+      continue;
     }
-  } else {
-    Vec radial_k(5);
-    radial_k << FLAGS_k1, FLAGS_k2, FLAGS_k3, FLAGS_k4, FLAGS_k5;
-    lens_distortion.set_radial_distortion(radial_k);
-  }
-  VLOG(0) << "Radial coefficients: " 
-          << lens_distortion.radial_distortion().transpose() << std::endl;
-  
-  if (FLAGS_p1 != 0 && FLAGS_p2 != 0) {
-    Vec tangential_p(2);
-    tangential_p(0) = FLAGS_p1;
-    tangential_p(1) = FLAGS_p2;
-    lens_distortion.set_tangential_distortion(tangential_p);
-  }
-  VLOG(0) << "Tangential coefficients: " 
-          << lens_distortion.tangential_distortion().transpose() << std::endl;
-  
-  PinholeCameraDistortion camera(&lens_distortion);
-  FloatImage *image = NULL;
-  FloatImage *image_out = NULL;
-  ImageCache cache;
-  Vec2u size_image;
-  Vec2 q;
-  Mat qs_x(0, 0);
-  Mat qs_y(0, 0);
-  
-  scoped_ptr<ImageSequence> source(ImageSequenceFromFiles(files, &cache));
-  for (size_t i = 0; i < files.size(); ++i) {
-    image = source->GetFloatImage(i);
-    if (image) {
-      if (qs_x.cols() == 0) {
-        VLOG(0) << "Estimating undistortion map..." << std::endl;
-        size_image << image->Width(), image->Height();
-        image_out = new FloatImage(image->Height(),
-                                   image->Width(),
-                                   image->Depth());
-        image_out->fill(0);
-        if (!image_out)
-          return 1;
-        camera.set_image_size(size_image);
-        Mat3 K;
-        if (FLAGS_u0 == 0)
-          FLAGS_u0 = size_image(0) / 2 - 0.5;
-        if (FLAGS_v0 == 0)
-          FLAGS_v0 = size_image(1) / 2 - 0.5;
-        if (FLAGS_fy == 0)
-          FLAGS_fy = FLAGS_fx;
-        K << FLAGS_fx, FLAGS_sk, FLAGS_u0,
-                    0, FLAGS_fy, FLAGS_v0,
-                    0,        0,        1;
-        camera.set_intrinsic_matrix(K);
-        qs_x.resize(image->Height(), image->Width());
-        qs_y.resize(image->Height(), image->Width());
-        qs_x.fill(-1);
-        qs_y.fill(-1);
-        // TODO(julien) Put this map building in lens_distortion
-        for (size_t x = 0; x < image->Width(); ++x) 
-          for (size_t y = 0; y < image->Height(); ++y) {
-            q << x, y;
-            camera.ComputeUndistortedCoordinates(q, &q);
-            if (image->Contains(q(1), q(0))) {
-              qs_x(y, x) = q(0);
-              qs_y(y, x) = q(1);
-              for (int d = 0; d < image_out->Depth(); ++d) 
-              (*image_out)(y, x, d) = SampleLinear(*image, q(1), q(0), d);
-            }
-          }
-        VLOG(0) << "Estimating undistortion map...[DONE]." << std::endl;
-        VLOG(1) << "qs_x : \n" << qs_x << std::endl;
-        VLOG(1) << "qs_y : \n" << qs_y << std::endl;
-      } else {
-        // Tests if the size of the image is the same as the previous one
-        if (size_image(0) != image->Width() || size_image(1) != image->Height())
-          return 2;
-        // TODO(julien) Put this image undistorting in camera?
-        VLOG(0) << "Undistorting image " << i << "..." << std::endl;
-        for (size_t x = 0; x < image->Width(); ++x) 
-        for (size_t y = 0; y < image->Height(); ++y) {
-          if (image->Contains(qs_y(y, x), qs_x(y, x))) {
-          for (int d = 0; d < image_out->Depth(); ++d) 
-            (*image_out)(y, x, d) = SampleLinear(*image,
-                                                 qs_y(y, x), 
-                                                 qs_x(y, x), d);
-          }
-        }
-        VLOG(0) << "Undistorting image " << i << "...[DONE]." << std::endl;
-      }
+    const RemapGrid &grid = maps.Get(image.Width(), image.Height());
+    VLOG(0) << "Undistorting image " << i << "..." << std::endl;
+    ByteImage undistorted(image.Height(), image.Width(), image.Depth());
+    undistorted.Fill(0);
+    Remap(image, grid, WARP_BILINEAR, &undistorted);
+    std::string output = OutputFilename(files[i]);
+    if (!WriteImage(undistorted, output.c_str())) {
+      LOG(ERROR) << "Couldn't write " << output;
+      ++num_failed;
     }
-    source->Unpin(i);
-    // Write the output image
-    VLOG(0) << "Saving undistorted image." << std::endl;
-    std::stringstream s;
-    s << ReplaceFolder(files[i].substr(0, files[i].rfind(".")), FLAGS_of);
-    s << FLAGS_os;
-    s << files[i].substr(files[i].rfind("."), files[i].size());
-    WriteImage(*image_out, s.str().c_str());
   }
-  if (image_out)
-    delete image_out;
-  return 0;
+  return num_failed ? 1 : 0;
 }